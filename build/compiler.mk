@@ -133,6 +133,7 @@ CXXFLAGS_UT_RUN           := $(filter-out -Wswitch-enum, $(CXXFLAGS_UT_RUN))
 
 # Test preprocessor flags
 CPPFLAGS_UT_RUN           := $(CPPFLAGS_RUN)
+CPPFLAGS_UT_RUN           += -DCATCH_CONFIG_ENABLE_BENCHMARKING
 
 # Test linker flags, if any
 LDFLAGS_UT_RUN            :=
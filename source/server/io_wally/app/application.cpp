@@ -19,6 +19,7 @@ namespace io_wally::app
         {
             auto cli = options_factory_.create( );
             const auto config = cli.parse( argc, argv );
+            options_factory::validate( config );
             if ( config.count( context::HELP ) )
             {
                 std::cout << cli.help( options_factory::GROUPS ) << std::endl;
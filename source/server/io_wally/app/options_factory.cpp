@@ -1,5 +1,6 @@
 #include "io_wally/app/options_factory.hpp"
 
+#include <initializer_list>
 #include <string>
 #include <vector>
 
@@ -30,7 +31,8 @@ DISCLAIMER:
 
     const std::vector<std::string> options_factory::GROUPS = {
         options_factory::COMMAND_LINE_GROUP, options_factory::SERVER_GROUP,      options_factory::CONNECTION_GROUP,
-        options_factory::LOGGING_GROUP,      options_factory::PUBLICATION_GROUP, options_factory::AUTHENTICATION_GROUP};
+        options_factory::LOGGING_GROUP,      options_factory::PUBLICATION_GROUP, options_factory::RETAIN_GROUP,
+        options_factory::AUTHENTICATION_GROUP};
 
     auto options_factory::create( ) const -> cxxopts::Options
     {
@@ -51,7 +53,15 @@ DISCLAIMER:
                 ( SERVER_PORT_SPEC, 
                   "Bind server to <port>",
                   cxxopts::value<int>( )->default_value( std::to_string( DEFAULT_SERVER_PORT ) ), 
-                  "<port>" );
+                  "<port>" )
+                ( NETWORK_THREADS_SPEC, 
+                  "Serve client connections using <threads> network threads",
+                  cxxopts::value<size_t>( )->default_value( std::to_string( DEFAULT_NETWORK_THREADS ) ), 
+                  "<threads>" )
+                ( DISPATCHER_THREADS_SPEC, 
+                  "Partition client sessions across <threads> dispatcher threads by client id",
+                  cxxopts::value<size_t>( )->default_value( std::to_string( DEFAULT_DISPATCHER_THREADS ) ), 
+                  "<threads>" );
 
             options.add_options( CONNECTION_GROUP )
                 ( CONNECT_TIMEOUT_SPEC,
@@ -62,9 +72,17 @@ DISCLAIMER:
                   "Use initial read buffer of size <bytes>",
                   cxxopts::value<size_t>( )->default_value( std::to_string( DEFAULT_INITIAL_READ_BUFFER_SIZE ) ),
                   "<bytes>" )
+                ( READ_SHARE_THRESHOLD_SPEC, 
+                  "Share incoming application messages of at least <bytes> with read buffer instead of copying them (0: never)",
+                  cxxopts::value<size_t>( )->default_value( std::to_string( DEFAULT_READ_SHARE_THRESHOLD ) ),
+                  "<bytes>" )
                 ( WRITE_BUFFER_SIZE_SPEC, 
                   "Use initial write buffer of size <bytes>",
                   cxxopts::value<size_t>( )->default_value( std::to_string( DEFAULT_INITIAL_WRITE_BUFFER_SIZE ) ),
+                  "<bytes>" )
+                ( WRITE_FLUSH_THRESHOLD_SPEC, 
+                  "Write at most <bytes> of queued outgoing packets using a single (vectored) socket write",
+                  cxxopts::value<size_t>( )->default_value( std::to_string( DEFAULT_WRITE_FLUSH_THRESHOLD ) ),
                   "<bytes>" );
 
             options.add_options( LOGGING_GROUP ) 
@@ -91,7 +109,49 @@ DISCLAIMER:
                 ( PUB_MAX_RETRIES_SPEC, 
                   "Retry sending PUBLISH for at most <retries> times",
                   cxxopts::value<size_t>( )->default_value( std::to_string( DEFAULT_PUB_MAX_RETRIES ) ),
-                  "<retries>" );
+                  "<retries>" )
+                ( PUB_MAX_IN_FLIGHT_SPEC,
+                  "Send at most <count> QoS 1 and QoS 2 PUBLISH to a client before awaiting their acknowledgement, "
+                  "queueing any further PUBLISH (1 - 65535)",
+                  cxxopts::value<uint16_t>( )->default_value( std::to_string( DEFAULT_PUB_MAX_IN_FLIGHT ) ),
+                  "<count>" )
+                ( PUB_MAX_QUEUED_SPEC,
+                  "Queue at most <count> QoS 1 and QoS 2 PUBLISH for a client, be it offline or with a full in flight "
+                  "window, discarding the oldest queued PUBLISH if necessary (0: unlimited)",
+                  cxxopts::value<size_t>( )->default_value( std::to_string( DEFAULT_PUB_MAX_QUEUED ) ),
+                  "<count>" )
+                ( PUB_SPILL_DIR_SPEC,
+                  "Spill queued PUBLISH to segment files in directory <dir> once they no longer fit into memory "
+                  "(empty: keep all queued PUBLISH in memory)",
+                  cxxopts::value<std::string>( )->default_value( DEFAULT_PUB_SPILL_DIR ),
+                  "<dir>" )
+                ( PUB_SPILL_THRESHOLD_SPEC,
+                  "Spill queued PUBLISH once all clients' queues hold more than <bytes> in memory, given a spill "
+                  "directory",
+                  cxxopts::value<size_t>( )->default_value( std::to_string( DEFAULT_PUB_SPILL_THRESHOLD ) ),
+                  "<bytes>" )
+                ( PUB_SUBSCRIBER_CACHE_SIZE_SPEC,
+                  "Cache resolved subscribers for at most <count> topics (0: disable cache)",
+                  cxxopts::value<size_t>( )->default_value( std::to_string( DEFAULT_PUB_SUBSCRIBER_CACHE_SIZE ) ),
+                  "<count>" );
+
+            options.add_options( RETAIN_GROUP )
+                ( RETAIN_MAX_BYTES_SPEC,
+                  "Keep retained messages within <bytes> of memory, evicting messages if necessary (0: unlimited)",
+                  cxxopts::value<size_t>( )->default_value( std::to_string( DEFAULT_RETAIN_MAX_BYTES ) ),
+                  "<bytes>" )
+                ( RETAIN_EVICTION_SPEC,
+                  "Evict least recently delivered or oldest retained messages first: (lru|oldest)",
+                  cxxopts::value<std::string>( )->default_value( DEFAULT_RETAIN_EVICTION ),
+                  "<policy>" )
+                ( RETAIN_TTL_SPEC,
+                  "Discard retained messages <ttl> s after they have been retained (0: never)",
+                  cxxopts::value<uint32_t>( )->default_value( std::to_string( DEFAULT_RETAIN_TTL_SECS ) ),
+                  "<ttl>" )
+                ( RETAIN_STORE_DIR_SPEC,
+                  "Keep retained messages across restarts in directory <dir> (empty: in memory only)",
+                  cxxopts::value<std::string>( )->default_value( DEFAULT_RETAIN_STORE_DIR ),
+                  "<dir>" );
 
             options.add_options( AUTHENTICATION_GROUP )
                 ( AUTHENTICATION_SERVICE_FACTORY_SPEC,
@@ -102,4 +162,13 @@ DISCLAIMER:
 
         return options;
     }
+
+    void options_factory::validate( const cxxopts::ParseResult& config )
+    {
+        for ( const auto* const threads : {NETWORK_THREADS, DISPATCHER_THREADS} )
+        {
+            if ( config[threads].as<size_t>( ) < 1 )
+                throw cxxopts::OptionParseException( "Option '" + std::string{threads} + "' must be at least 1" );
+        }
+    }
 }  // namespace io_wally::app
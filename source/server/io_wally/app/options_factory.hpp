@@ -32,6 +32,12 @@ namespace io_wally::app
         static constexpr const char* SERVER_PORT = "server-port";
         static constexpr const char* SERVER_PORT_SPEC = "p,server-port";
 
+        static constexpr const char* NETWORK_THREADS = "network-threads";
+        static constexpr const char* NETWORK_THREADS_SPEC = "network-threads";
+
+        static constexpr const char* DISPATCHER_THREADS = "dispatcher-threads";
+        static constexpr const char* DISPATCHER_THREADS_SPEC = "dispatcher-threads";
+
         static constexpr const char* AUTHENTICATION_SERVICE_FACTORY = "auth-service-factory";
         static constexpr const char* AUTHENTICATION_SERVICE_FACTORY_SPEC = "auth-service-factory";
 
@@ -41,24 +47,63 @@ namespace io_wally::app
         static constexpr const char* READ_BUFFER_SIZE = "conn-rbuf-size";
         static constexpr const char* READ_BUFFER_SIZE_SPEC = "conn-rbuf-size";
 
+        static constexpr const char* READ_SHARE_THRESHOLD = "conn-rbuf-share-threshold";
+        static constexpr const char* READ_SHARE_THRESHOLD_SPEC = "conn-rbuf-share-threshold";
+
         static constexpr const char* WRITE_BUFFER_SIZE = "conn-wbuf-size";
         static constexpr const char* WRITE_BUFFER_SIZE_SPEC = "conn-wbuf-size";
 
+        static constexpr const char* WRITE_FLUSH_THRESHOLD = "conn-wbuf-flush-threshold";
+        static constexpr const char* WRITE_FLUSH_THRESHOLD_SPEC = "conn-wbuf-flush-threshold";
+
         static constexpr const char* PUB_ACK_TIMEOUT = "pub-ack-timeout";
         static constexpr const char* PUB_ACK_TIMEOUT_SPEC = "pub-ack-timeout";
 
         static constexpr const char* PUB_MAX_RETRIES = "pub-max-retries";
         static constexpr const char* PUB_MAX_RETRIES_SPEC = "pub-max-retries";
 
+        static constexpr const char* PUB_MAX_IN_FLIGHT = "pub-max-in-flight";
+        static constexpr const char* PUB_MAX_IN_FLIGHT_SPEC = "pub-max-in-flight";
+
+        static constexpr const char* PUB_MAX_QUEUED = "pub-max-queued";
+        static constexpr const char* PUB_MAX_QUEUED_SPEC = "pub-max-queued";
+
+        static constexpr const char* PUB_SPILL_DIR = "pub-spill-dir";
+        static constexpr const char* PUB_SPILL_DIR_SPEC = "pub-spill-dir";
+
+        static constexpr const char* PUB_SPILL_THRESHOLD = "pub-spill-threshold";
+        static constexpr const char* PUB_SPILL_THRESHOLD_SPEC = "pub-spill-threshold";
+
+        static constexpr const char* PUB_SUBSCRIBER_CACHE_SIZE = "pub-subscriber-cache-size";
+        static constexpr const char* PUB_SUBSCRIBER_CACHE_SIZE_SPEC = "pub-subscriber-cache-size";
+
+        static constexpr const char* RETAIN_MAX_BYTES = "retain-max-bytes";
+        static constexpr const char* RETAIN_MAX_BYTES_SPEC = "retain-max-bytes";
+
+        static constexpr const char* RETAIN_EVICTION = "retain-eviction";
+        static constexpr const char* RETAIN_EVICTION_SPEC = "retain-eviction";
+
+        static constexpr const char* RETAIN_TTL = "retain-ttl";
+        static constexpr const char* RETAIN_TTL_SPEC = "retain-ttl";
+
+        static constexpr const char* RETAIN_STORE_DIR = "retain-store-dir";
+        static constexpr const char* RETAIN_STORE_DIR_SPEC = "retain-store-dir";
+
         static constexpr const char* COMMAND_LINE_GROUP = "Command line";
         static constexpr const char* SERVER_GROUP = "Server";
         static constexpr const char* CONNECTION_GROUP = "Connection";
         static constexpr const char* LOGGING_GROUP = "Logging";
         static constexpr const char* PUBLICATION_GROUP = "Publication";
+        static constexpr const char* RETAIN_GROUP = "Retained messages";
         static constexpr const char* AUTHENTICATION_GROUP = "Authentication";
         static const std::vector<std::string> GROUPS;
 
        public:
         [[nodiscard]] auto create( ) const -> cxxopts::Options;
+
+        /// \brief Reject option values in \c config that parse fine, yet are out of range.
+        ///
+        /// \throws cxxopts::OptionParseException naming the first option found out of range
+        static void validate( const cxxopts::ParseResult& config );
     };  // class options_factory
 }  // namespace io_wally::app
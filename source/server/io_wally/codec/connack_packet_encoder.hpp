@@ -12,9 +12,13 @@ namespace io_wally::encoder
     /// \brief Encoder for CONNACK packet bodies.
     ///
     template <typename OutputIterator>
-    class connack_packet_encoder final : public packet_body_encoder<OutputIterator>
+    class connack_packet_encoder final
     {
        public:
+        /// Type of packet encoded by this encoder, and its control packet type
+        using packet_type = protocol::connack;
+        static constexpr protocol::packet::Type TYPE = protocol::packet::Type::CONNACK;
+
         /// Methods
 
         /// \brief Encode \c mqtt_packet into supplied buffer.
@@ -23,16 +27,13 @@ namespace io_wally::encoder
         /// immediately past the last byte written. If \c connack does not conform to spec, throw
         /// error::invalid_mqtt_packet.
         ///
-        /// \param connack_packet \c connack packet to encode
+        /// \param connack \c connack packet to encode
         /// \param buf_start      Start of buffer to encode \c mqtt_packet into
         /// \return         \c OutputIterator that points immediately past the last byte written
-        auto encode( const protocol::mqtt_packet& connack_packet, OutputIterator buf_start ) const -> OutputIterator
+        auto encode( const protocol::connack& connack, OutputIterator buf_start ) const -> OutputIterator
         {
             using namespace io_wally::protocol;
 
-            assert( connack_packet.type( ) == packet::Type::CONNACK );
-
-            const auto& connack = dynamic_cast<const struct connack&>( connack_packet );
             const auto first_byte = ( connack.is_session_present( ) ? 0x01 : 0x00 );
             auto second_byte = uint8_t{0x00};
             switch ( connack.return_code( ) )
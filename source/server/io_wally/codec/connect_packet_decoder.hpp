@@ -3,22 +3,28 @@
 #include <cassert>
 #include <cstdint>
 #include <memory>
+#include <string>
+#include <string_view>
 #include <tuple>
 
 #include "io_wally/codec/decoder.hpp"
 #include "io_wally/protocol/common.hpp"
 #include "io_wally/protocol/connect_packet.hpp"
+#include "io_wally/protocol/packet_pool.hpp"
 
 namespace io_wally::decoder
 {
-    class connect_packet_decoder_impl final : public packet_decoder_impl
+    class connect_packet_decoder_impl final
     {
        public:
+        /// Control packet type decoded by this decoder
+        static constexpr protocol::packet::Type TYPE = protocol::packet::Type::CONNECT;
+
         /// \brief Decode the supplied buffer into a \c connect_packet.
         ///
         /// \see io_wally::protocol::decoder::packet_body_decoder::parse
         ///
-        [[nodiscard]] auto decode( const frame& frame ) const -> std::shared_ptr<protocol::mqtt_packet> override
+        [[nodiscard]] auto decode( const frame& frame ) const -> std::shared_ptr<protocol::mqtt_packet>
         {
             using namespace io_wally::protocol;
 
@@ -72,10 +78,11 @@ namespace io_wally::decoder
                 std::tie( new_buf_start, username ) = decode_utf8_string( new_buf_start, frame.end );
             }
 
-            auto password = std::string{};
+            // MQTT defines passwords as binary data, not as UTF-8 strings
+            auto password = std::string_view{};
             if ( cf.has_password( ) )
             {
-                std::tie( new_buf_start, password ) = decode_utf8_string( new_buf_start, frame.end );
+                std::tie( new_buf_start, password ) = decode_binary_data( new_buf_start, frame.end );
             }
 
             if ( new_buf_start != frame.end )
@@ -84,10 +91,10 @@ namespace io_wally::decoder
                     "Combined size of fields in buffers does not add up to advertised remaining length"};
             }
 
-            return std::make_shared<protocol::connect>( static_cast<uint32_t>( frame.remaining_length( ) ),
-                                                        protocol_name.c_str( ), protocol_level, connect_flags,
-                                                        keep_alive_secs, client_id.c_str( ), last_will_topic.c_str( ),
-                                                        last_will_msg, username.c_str( ), password.c_str( ) );
+            return protocol::make_packet<protocol::connect>(
+                static_cast<uint32_t>( frame.remaining_length( ) ), protocol_name.c_str( ), protocol_level,
+                connect_flags, keep_alive_secs, client_id.c_str( ), last_will_topic.c_str( ), last_will_msg,
+                username.c_str( ), std::string{password}.c_str( ) );
         }
     };  // class connect_packet_decoder_impl
 
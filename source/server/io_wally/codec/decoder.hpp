@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+#include <cassert>
 #include <cmath>
 #include <cstdint>
 #include <cstring>
@@ -7,6 +9,7 @@
 #include <memory>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <tuple>
 #include <vector>
 
@@ -15,6 +18,7 @@
 
 #include "io_wally/error/protocol.hpp"
 #include "io_wally/protocol/common.hpp"
+#include "io_wally/protocol/utf8.hpp"
 
 namespace io_wally::decoder
 {
@@ -24,8 +28,11 @@ namespace io_wally::decoder
         using const_iterator_t = std::vector<uint8_t>::const_iterator;
 
        public:
-        frame( const uint8_t type_and_flags, const const_iterator_t begin, const const_iterator_t end )
-            : type_and_flags{type_and_flags}, begin{begin}, end{end}
+        frame( const uint8_t type_and_flags,
+               const const_iterator_t begin,
+               const const_iterator_t end,
+               std::shared_ptr<const std::vector<uint8_t>> chunk = nullptr )
+            : type_and_flags{type_and_flags}, begin{begin}, end{end}, chunk{std::move( chunk )}
         {
         }
 
@@ -43,13 +50,48 @@ namespace io_wally::decoder
         const uint8_t type_and_flags;
         const const_iterator_t begin;
         const const_iterator_t end;
+        /// If set, the buffer this frame lives in, which decoders may share instead of copying this frame's contents
+        const std::shared_ptr<const std::vector<uint8_t>> chunk;
     };  // struct frame
 
-    class frame_reader final
+    /// \brief Decode remaining length and header length of the MQTT frame starting at \c begin.
+    ///
+    /// \param begin Start of frame, i.e. its type and flags byte
+    /// \param end   End of bytes received so far
+    /// \return Pair of remaining length and header length, or \c std::nullopt if the remaining length header field
+    ///         has not been fully received yet
+    /// \throws error::malformed_mqtt_packet If the encoded remaining length exceeds maximum allowed value
+    [[nodiscard]] inline auto decode_remaining_length( const frame::const_iterator_t begin,
+                                                       const frame::const_iterator_t end )
+        -> std::optional<std::pair<std::size_t, std::size_t>>
     {
-       private:  // static
-        static constexpr const uint8_t MSB_MASK = 0x80;
+        constexpr const uint8_t MSB_MASK = 0x80;
+        const auto bytes_received = static_cast<std::size_t>( std::distance( begin, end ) );
+        if ( bytes_received < 2 )
+        {
+            return std::nullopt;
+        }
 
+        auto rlen = std::size_t{0};
+        for ( std::size_t i = 1; i < bytes_received; ++i )
+        {
+            if ( i > 4 )
+            {
+                throw error::malformed_mqtt_packet( "Encoded remaining length exceeds maximum allowed value" );
+            }
+            const auto current_byte = *( begin + i );
+            rlen += static_cast<std::size_t>( current_byte & ~MSB_MASK ) << ( 7 * ( i - 1 ) );
+            if ( ( current_byte & MSB_MASK ) == 0 )
+            {
+                return std::make_pair( rlen, i + 1 );
+            }
+        }
+
+        return std::nullopt;
+    }
+
+    class frame_reader final
+    {
        public:
         frame_reader( std::vector<uint8_t>& buffer ) : buffer_{buffer}
         {
@@ -106,34 +148,149 @@ namespace io_wally::decoder
         [[nodiscard]] auto decode_remaining_length( std::size_t bytes_transferred ) const
             -> const std::optional<std::pair<std::size_t, std::size_t>>
         {
-            if ( bytes_transferred < 2 )
+            return decoder::decode_remaining_length( std::cbegin( buffer_ ), std::cbegin( buffer_ ) + bytes_transferred );
+        }
+
+       private:
+        std::vector<uint8_t>& buffer_;
+        std::optional<const frame> frame_ = std::nullopt;
+    };  // class frame_reader
+
+    /// \brief Buffer for data received on a connection, handing out every complete MQTT frame it contains.
+    ///
+    /// Whereas \c frame_reader reads exactly one frame per read operation, a \c frame_buffer is meant to be filled
+    /// with whatever a single read happens to return. A client sending many small packets in quick succession thus
+    /// costs one read per batch of packets instead of (at least) one read per packet. A frame that has only been
+    /// partially received stays buffered until the next read completes it.
+    ///
+    /// Frames whose remaining length reaches a configurable threshold are handed out together with the ref-counted
+    /// chunk of memory they live in, allowing decoders to reference their contents instead of copying them. While a
+    /// chunk is still referenced this way, a \c frame_buffer will never overwrite or move it, but replace it with a
+    /// fresh chunk instead.
+    ///
+    /// Usage: read at most \c free_space() bytes into \c free_space_begin(), \c commit() them, then call \c
+    /// next_frame() until it returns \c std::nullopt.
+    class frame_buffer final
+    {
+       public:
+        /// \brief Create a new \c frame_buffer.
+        ///
+        /// \param initial_size Initial size in bytes. This buffer will grow to accommodate larger frames, and shrink
+        ///        back to this size once those have been consumed.
+        /// \param share_threshold Minimum remaining length of frames whose chunk will be shared with decoders, or 0
+        ///        if chunks should never be shared
+        explicit frame_buffer( const std::size_t initial_size, const std::size_t share_threshold = 0 )
+            : initial_size_{initial_size > 0 ? initial_size : 1},
+              share_threshold_{share_threshold},
+              chunk_{std::make_shared<std::vector<uint8_t>>( initial_size_ )}
+        {
+        }
+
+        /// \brief Start of free space the next read may fill.
+        [[nodiscard]] auto free_space_begin( ) -> uint8_t*
+        {
+            return chunk_->data( ) + end_;
+        }
+
+        /// \brief Number of bytes the next read may fill. Never 0.
+        [[nodiscard]] auto free_space( ) const -> std::size_t
+        {
+            return chunk_->size( ) - end_;
+        }
+
+        /// \brief Mark \c bytes_read bytes at \c free_space_begin() as received.
+        void commit( const std::size_t bytes_read )
+        {
+            assert( bytes_read <= free_space( ) );
+            end_ += bytes_read;
+        }
+
+        /// \brief Take next complete frame off this buffer.
+        ///
+        /// A returned \c frame references this buffer's memory and is only valid until the next call to \c
+        /// next_frame(), unless it carries its \c chunk.
+        ///
+        /// \return Next complete frame, or \c std::nullopt if this buffer does not contain another complete frame
+        /// \throws error::malformed_mqtt_packet If the next frame's remaining length header field is malformed
+        [[nodiscard]] auto next_frame( ) -> std::optional<const frame>
+        {
+            const auto start = std::cbegin( *chunk_ ) + begin_;
+            const auto rlen_hlen = decode_remaining_length( start, std::cbegin( *chunk_ ) + end_ );
+            if ( !rlen_hlen )
             {
+                make_room( buffered( ) + 1 );
                 return std::nullopt;
             }
 
-            auto rlen = std::size_t{0};
-            for ( std::vector<uint8_t>::size_type i = 1; i < bytes_transferred; ++i )
+            const auto [rlen, hlen] = *rlen_hlen;
+            const auto len = rlen + hlen;
+            if ( len > buffered( ) )
             {
-                if ( i > 4 )
-                {
-                    throw error::malformed_mqtt_packet( "Encoded remaining length exceeds maximum allowed value" );
-                }
-                const auto current_byte = buffer_[i];
-                const auto multiplier = pow( 128, i - 1 );
-                rlen += ( current_byte & ~MSB_MASK ) * multiplier;
-                if ( ( current_byte & MSB_MASK ) == 0 )
-                {
-                    return std::make_pair( rlen, i + 1 );
-                }
+                make_room( len );
+                return std::nullopt;
             }
+            begin_ += len;
 
-            return std::nullopt;
+            if ( ( share_threshold_ > 0 ) && ( rlen >= share_threshold_ ) )
+                return frame{*start, start + hlen, start + len, chunk_};
+            return frame{*start, start + hlen, start + len};
+        }
+
+        /// \brief Number of bytes received, but not yet handed out as part of a frame.
+        [[nodiscard]] auto buffered( ) const -> std::size_t
+        {
+            return end_ - begin_;
+        }
+
+        /// \brief This buffer's current size in bytes.
+        [[nodiscard]] auto size( ) const -> std::size_t
+        {
+            return chunk_->size( );
         }
 
        private:
-        std::vector<uint8_t>& buffer_;
-        std::optional<const frame> frame_ = std::nullopt;
-    };  // class frame_reader
+        /// Move a partially received frame to the front of our buffer, and make sure our buffer can hold \c
+        /// required bytes
+        void make_room( const std::size_t required )
+        {
+            if ( chunk_.use_count( ) > 1 )
+            {
+                // Our current chunk is still referenced by decoded packets: leave it alone
+                auto fresh = std::make_shared<std::vector<uint8_t>>( std::max( required, initial_size_ ) );
+                std::copy( std::cbegin( *chunk_ ) + begin_, std::cbegin( *chunk_ ) + end_, std::begin( *fresh ) );
+                chunk_ = std::move( fresh );
+                end_ -= begin_;
+                begin_ = 0;
+                return;
+            }
+
+            auto& buffer = *chunk_;
+            if ( begin_ > 0 )
+            {
+                std::copy( std::begin( buffer ) + begin_, std::begin( buffer ) + end_, std::begin( buffer ) );
+                end_ -= begin_;
+                begin_ = 0;
+            }
+            if ( required > buffer.size( ) )
+            {
+                buffer.resize( required );
+            }
+            else if ( ( buffer.size( ) > initial_size_ ) && ( required <= initial_size_ ) )
+            {
+                buffer.resize( initial_size_ );
+            }
+            assert( free_space( ) > 0 );
+        }
+
+       private:
+        const std::size_t initial_size_;
+        const std::size_t share_threshold_;
+        std::shared_ptr<std::vector<uint8_t>> chunk_;
+        /// Start of first byte not yet handed out as part of a frame
+        std::size_t begin_{0};
+        /// End of bytes received
+        std::size_t end_{0};
+    };  // class frame_buffer
 
     /// \brief Parse a 8 bit wide unsigned int in the supplied buffer into a \c packet::QoS.
     ///
@@ -213,6 +370,69 @@ namespace io_wally::decoder
         return uint8_start;
     }  // decode_qos
 
+    /// \brief Decode binary data, i.e. two bytes encoding its length followed by that many bytes, without copying it.
+    ///
+    /// Unlike \c decode_utf8_string_view this does not check whether the decoded bytes form a well-formed string,
+    /// leaving that to callers that check them in a single pass anyway, and to callers decoding fields that MQTT
+    /// defines as binary data in the first place.
+    ///
+    /// \param data_start       Start of buffer to parse. MUST point to first byte of two byte sequence
+    ///                         encoding data length.
+    /// \param buf_end          End of entire packet buffer. Needed for range checks.
+    /// \return                 The updated InputIterator \c data_start, and a view of the parsed data that is
+    ///                         only valid as long as the buffer it was parsed from
+    /// \throws error::malformed_mqtt_packet        If decoding fails due to malformed input.
+    ///
+    /// \pre        \c InputIterator iterates over a contiguous buffer
+    template <typename InputIterator>
+    inline auto decode_binary_data( InputIterator data_start, const InputIterator buf_end )
+        -> std::pair<InputIterator, std::string_view>
+    {
+        // We need at least two bytes for encoding data length
+        if ( std::distance( data_start, buf_end ) < 2 )
+        {
+            throw error::malformed_mqtt_packet( "Encoding an UTF-8 string needs at least two bytes" );
+        }
+
+        auto data_length = uint16_t{0};
+        std::tie( data_start, data_length ) = decode_uint16( data_start, buf_end );
+        // Do we have enough room for our data?
+        if ( std::distance( data_start, buf_end ) < data_length )
+        {
+            throw error::malformed_mqtt_packet( "Buffer truncated: cannot decode UTF-8 string" );
+        }
+
+        const auto parsed_data_ptr = reinterpret_cast<const char*>( &( *data_start ) );
+        const auto parsed_data = std::string_view{parsed_data_ptr, data_length};
+
+        // Update buffer start iterator
+        data_start += data_length;
+
+        return std::make_pair( data_start, parsed_data );
+    }
+
+    /// \brief Decode a UTF-8 string like \c decode_utf8_string does, yet without copying it.
+    ///
+    /// \param string_start     Start of buffer to parse. MUST point to first byte of two byte sequence
+    ///                         encoding string length.
+    /// \param buf_end          End of entire packet buffer. Needed for range checks.
+    /// \return                 The updated InputIterator \c string_start, and a view of the parsed string that is
+    ///                         only valid as long as the buffer it was parsed from
+    /// \throws error::malformed_mqtt_packet        If decoding fails due to malformed input, including strings that
+    ///                                             are not well-formed UTF-8 or contain U+0000.
+    ///
+    /// \pre        \c InputIterator iterates over a contiguous buffer
+    template <typename InputIterator>
+    inline auto decode_utf8_string_view( InputIterator string_start, const InputIterator buf_end )
+        -> std::pair<InputIterator, std::string_view>
+    {
+        auto parsed_string = std::string_view{};
+        std::tie( string_start, parsed_string ) = decode_binary_data( string_start, buf_end );
+        protocol::utf8::check_string( parsed_string );
+
+        return std::make_pair( string_start, parsed_string );
+    }
+
     /// \brief Parse a UTF-8 string in the supplied buffer.
     ///
     /// Start decoding at \c string_start, interpreting the supplied buffer as an MQTT UTF-8 string. Stop
@@ -243,52 +463,57 @@ namespace io_wally::decoder
     inline auto decode_utf8_string( InputIterator string_start, const InputIterator buf_end )
         -> std::pair<InputIterator, const std::string>
     {
-        // We need at least two bytes for encoding string length
-        if ( std::distance( string_start, buf_end ) < 2 )
-        {
-            throw error::malformed_mqtt_packet( "Encoding an UTF-8 string needs at least two bytes" );
-        }
+        auto parsed_string = std::string_view{};
+        std::tie( string_start, parsed_string ) = decode_utf8_string_view( string_start, buf_end );
 
-        auto string_length = uint16_t{0};
-        std::tie( string_start, string_length ) = decode_uint16( string_start, buf_end );
-        // Do we have enough room for our string?
-        if ( std::distance( string_start, buf_end ) < string_length )
-        {
-            throw error::malformed_mqtt_packet( "Buffer truncated: cannot decode UTF-8 string" );
-        }
-
-        const auto parsed_string_ptr = reinterpret_cast<const char*>( &( *string_start ) );
-        const auto parsed_string = std::string{parsed_string_ptr, string_length};
-
-        // Update buffer start iterator
-        string_start += string_length;
-
-        return std::make_pair( string_start, parsed_string );
+        return std::make_pair( string_start, std::string{parsed_string} );
     }
 
-    /// \brief Interface for decoders capable of decoding a single type of MQTT packets.
+    /// \brief Compile-time list of decoders, each capable of decoding a single type of MQTT packets.
     ///
-    /// Defines and interface for decoders/decoders that take \c header_flags and a buffer containing an MQTT
-    /// packet's on the wire representation and return a decoded \c mqtt_packet.
+    /// Each \c DECODER takes a \c frame containing an MQTT packet's on the wire representation and returns a decoded
+    /// \c mqtt_packet. It handles exactly one concrete \c mqtt_packet type (CONNECT, CONNACK, ...), and provides
     ///
-    /// Note that the concrete type of \c mqtt_packet to decode is already known when an implementation of this
-    /// interface is called.
+    ///  - \c TYPE: the \c packet::Type it decodes, and
+    ///  - <tt>decode( const frame& frame ) -> std::shared_ptr<protocol::mqtt_packet></tt>, throwing
+    ///    error::malformed_mqtt_packet if encoding is malformed.
     ///
-    /// Note further that a concrete \c packet_decoder_impl implementation handles exactly one concrete
-    /// \c mqtt_packet type (CONNECT, CONNACK, ...).
-    class packet_decoder_impl
+    /// Selecting a \c DECODER for a \c frame only compares its type against each \c DECODER's \c TYPE, all of
+    /// which are known at compile time. The selected \c DECODER is then called directly, without virtual calls, and
+    /// may be inlined.
+    template <typename... DECODERS>
+    class packet_body_decoders final
     {
        public:
         /// @brief Parse the supplied @c frame into an MQTT packet.
         ///
         /// @param frame                @c frame to decode into an @c mqtt_packet
-        /// @attention                  Implementations are asked to throw an assertion error if the the type
-        ///                             of MQTT packet to parse contained in @c frame does not match this
-        ///                             implementation.
         /// @return                     The parsed @c mqtt_packet, i.e. an instance of a concrete subclass of
         ///                             @c mqtt_packet. Note that the caller assumes ownership.
         /// @throws error::malformed_mqtt_packet    If encoding is malformed, e.g. remaining length has been
         ///                                         incorrectly encoded.
-        [[nodiscard]] virtual auto decode( const frame& frame ) const -> std::shared_ptr<protocol::mqtt_packet> = 0;
-    };  // packet_decoder_impl
+        /// @throws std::invalid_argument           If none of \c DECODERS handles \c frame's type
+        [[nodiscard]] auto decode( const frame& frame ) const -> std::shared_ptr<protocol::mqtt_packet>
+        {
+            const auto type = frame.type( );
+            auto packet = std::shared_ptr<protocol::mqtt_packet>{};
+            if ( !( decode_as<DECODERS>( type, frame, packet ) || ... ) )
+                throw std::invalid_argument( "Unsupported MQTT control packet type" );
+
+            return packet;
+        }
+
+       private:
+        template <typename DECODER>
+        static auto decode_as( const protocol::packet::Type type,
+                               const frame& frame,
+                               std::shared_ptr<protocol::mqtt_packet>& packet ) -> bool
+        {
+            if ( type != DECODER::TYPE )
+                return false;
+
+            packet = DECODER{}.decode( frame );
+            return true;
+        }
+    };  // packet_body_decoders
 }  // namespace io_wally::decoder
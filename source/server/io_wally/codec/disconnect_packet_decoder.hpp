@@ -6,6 +6,7 @@
 #include "io_wally/codec/decoder.hpp"
 #include "io_wally/protocol/common.hpp"
 #include "io_wally/protocol/disconnect_packet.hpp"
+#include "io_wally/protocol/packet_pool.hpp"
 
 namespace io_wally::decoder
 {
@@ -15,14 +16,17 @@ namespace io_wally::decoder
     /// decoded \c disconnect_packet.
     ///
     /// \see http://docs.oasis-open.org/mqtt/mqtt/v3.1.1/os/mqtt-v3.1.1-os.html#_Toc398718081
-    class disconnect_packet_decoder_impl final : public packet_decoder_impl
+    class disconnect_packet_decoder_impl final
     {
        public:
+        /// Control packet type decoded by this decoder
+        static constexpr protocol::packet::Type TYPE = protocol::packet::Type::DISCONNECT;
+
         /// \brief Decode the supplied frame into a \c disconnect_packet.
         ///
         /// \see io_wally::protocol::decoder::packet_body_decoder::decode
         ///
-        [[nodiscard]] auto decode( const frame& frame ) const -> std::shared_ptr<protocol::mqtt_packet> override
+        [[nodiscard]] auto decode( const frame& frame ) const -> std::shared_ptr<protocol::mqtt_packet>
         {
             using namespace io_wally::protocol;
 
@@ -42,7 +46,7 @@ namespace io_wally::decoder
                     "DISCONNECT fixed header reports remaining length != 0 (violates MQTT 3.1.1 spec)"};
             }
 
-            return std::make_shared<protocol::disconnect>( );
+            return protocol::make_packet<protocol::disconnect>( );
         }
     };
 }  // namespace io_wally::decoder
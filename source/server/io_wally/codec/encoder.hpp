@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cassert>
 #include <cstdint>
 #include <stdexcept>
 #include <string>
@@ -128,9 +129,19 @@ namespace io_wally::encoder
         return buf_start;
     }
 
-    /// \brief Encoder for \c mqtt_packet bodies, i.e. \c mqtt_packets sans fixed header.
-    template <typename OutputIterator>
-    class packet_body_encoder
+    /// \brief Compile-time list of encoders for \c mqtt_packet bodies, i.e. \c mqtt_packets sans fixed header.
+    ///
+    /// Each \c ENCODER handles exactly one concrete \c mqtt_packet type, and provides
+    ///
+    ///  - \c packet_type: the \c mqtt_packet subtype it encodes,
+    ///  - \c TYPE: that subtype's \c packet::Type, and
+    ///  - <tt>encode( const packet_type& packet, OutputIterator buf_start ) -> OutputIterator</tt>.
+    ///
+    /// Selecting an \c ENCODER for an \c mqtt_packet only compares its type against each \c ENCODER's \c TYPE,
+    /// all of which are known at compile time. The selected \c ENCODER is then called directly, without virtual
+    /// calls or RTTI, and may be inlined.
+    template <typename OutputIterator, typename... ENCODERS>
+    class packet_body_encoders final
     {
        public:
         /// \brief Encode \c mqtt_packet's body.
@@ -142,8 +153,26 @@ namespace io_wally::encoder
         /// \param packet        \c mqtt_packet to encode the body of
         /// \param buf_start     Start of buffer to encode packet body into
         /// \return              An \c OutputIterator pointing immediately past the last byte written
-        virtual auto encode( const protocol::mqtt_packet& packet, OutputIterator buf_start ) const
-            -> OutputIterator = 0;
-    };  // packet_body_encoder
+        auto encode( const protocol::mqtt_packet& packet, OutputIterator buf_start ) const -> OutputIterator
+        {
+            const auto type = packet.type( );
+            [[maybe_unused]] const auto encoded = ( encode_as<ENCODERS>( type, packet, buf_start ) || ... );
+            assert( encoded );
+
+            return buf_start;
+        }
+
+       private:
+        template <typename ENCODER>
+        static auto encode_as( const protocol::packet::Type type,
+                               const protocol::mqtt_packet& packet,
+                               OutputIterator& buf_start ) -> bool
+        {
+            if ( type != ENCODER::TYPE )
+                return false;
 
+            buf_start = ENCODER{}.encode( static_cast<const typename ENCODER::packet_type&>( packet ), buf_start );
+            return true;
+        }
+    };  // packet_body_encoders
 }  // namespace io_wally::encoder
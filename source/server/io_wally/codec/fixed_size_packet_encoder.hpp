@@ -0,0 +1,76 @@
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <cstdint>
+
+#include "io_wally/protocol/common.hpp"
+#include "io_wally/protocol/connack_packet.hpp"
+
+namespace io_wally::encoder
+{
+    /// \brief A complete packet, fixed header included, encoded into a fixed number of bytes.
+    template <std::size_t N>
+    using encoded_packet = std::array<std::uint8_t, N>;
+
+    /// \brief PINGRESP packet, fully encoded: it does not have any variable parts.
+    inline constexpr auto PINGRESP = encoded_packet<2>{0xD0, 0x00};
+
+    /// \brief First byte of an encoded PUBACK, PUBREC, PUBREL or PUBCOMP packet's fixed header.
+    ///
+    /// All four packets consist of a fixed header with a remaining length of \c 2, followed by their packet
+    /// identifier. Only PUBREL sets a flag - bit 1 - in its fixed header.
+    ///
+    /// \see http://docs.oasis-open.org/mqtt/mqtt/v3.1.1/os/mqtt-v3.1.1-os.html#_Toc398718043
+    constexpr auto publish_ack_header( protocol::packet::Type type ) -> std::uint8_t
+    {
+        assert( ( type == protocol::packet::Type::PUBACK ) || ( type == protocol::packet::Type::PUBREC ) ||
+                ( type == protocol::packet::Type::PUBREL ) || ( type == protocol::packet::Type::PUBCOMP ) );
+
+        return static_cast<std::uint8_t>( ( static_cast<std::uint8_t>( type ) << 4 ) |
+                                          ( type == protocol::packet::Type::PUBREL ? 0x02 : 0x00 ) );
+    }
+
+    /// \brief Encoded CONNACK packet, with session present flag unset and return code CONNECTION_ACCEPTED.
+    ///
+    /// \see http://docs.oasis-open.org/mqtt/mqtt/v3.1.1/os/mqtt-v3.1.1-os.html#_Toc398718033
+    inline constexpr auto CONNACK_TEMPLATE = encoded_packet<4>{0x20, 0x02, 0x00, 0x00};
+
+    /// \brief Encode a PUBACK, PUBREC, PUBREL or PUBCOMP packet, patching \c packet_identifier into its fixed header.
+    ///
+    /// \param type              Type of packet to encode, one of PUBACK, PUBREC, PUBREL or PUBCOMP
+    /// \param packet_identifier Packet identifier to encode
+    /// \return                  Encoded packet
+    constexpr auto encode_publish_ack( protocol::packet::Type type, std::uint16_t packet_identifier )
+        -> encoded_packet<4>
+    {
+        auto encoded = encoded_packet<4>{publish_ack_header( type ), 0x02, 0x00, 0x00};
+        encoded[2] = static_cast<std::uint8_t>( packet_identifier >> 8 );
+        encoded[3] = static_cast<std::uint8_t>( packet_identifier & 0x00FF );
+
+        return encoded;
+    }
+
+    /// \brief Encode a CONNACK packet, patching \c session_present and \c return_code into its template.
+    ///
+    /// \param session_present Whether the server already holds a session for connecting client
+    /// \param return_code     Return code to encode
+    /// \return                Encoded packet
+    constexpr auto encode_connack( bool session_present, protocol::connect_return_code return_code )
+        -> encoded_packet<4>
+    {
+        auto encoded = CONNACK_TEMPLATE;
+        encoded[2] = ( session_present ? 0x01 : 0x00 );
+        encoded[3] = static_cast<std::uint8_t>( return_code );
+
+        return encoded;
+    }
+
+    static_assert( publish_ack_header( protocol::packet::Type::PUBREL ) == 0x62, "PUBREL needs flags 0x02" );
+    static_assert( publish_ack_header( protocol::packet::Type::PUBCOMP ) == 0x70, "PUBCOMP has no flags" );
+    static_assert( ( encode_publish_ack( protocol::packet::Type::PUBACK, 0x1234 )[2] == 0x12 ) &&
+                       ( encode_publish_ack( protocol::packet::Type::PUBACK, 0x1234 )[3] == 0x34 ),
+                   "Packet identifier is encoded MSB first" );
+    static_assert( encode_connack( false, protocol::connect_return_code::NOT_AUTHORIZED )[3] == 0x05,
+                   "connect_return_code's values need to be its wire encoding" );
+}  // namespace io_wally::encoder
@@ -1,6 +1,5 @@
 #pragma once
 
-#include <cassert>
 #include <memory>
 
 #include "io_wally/protocol/common.hpp"
@@ -22,7 +21,7 @@ namespace io_wally::decoder
     ///
     /// Takes \c frame containing an MQTT packet's on the wire representation. Deduces
     /// from the supplied \c frame the type of \c mqtt_packet to decode and delegates to an appropriate
-    /// \c packet_body_decoder implementation.
+    /// packet body decoder, selected at compile time from \c body_decoders.
     class mqtt_packet_decoder final
     {
        public:
@@ -31,7 +30,7 @@ namespace io_wally::decoder
         /// \brief Decode the supplied \c frame into an MQTT packet.
         ///
         /// From the supplied \c frame determine the concrete type of \c mqtt_packet to decode. Find an
-        /// appropriate implementation of \c packet_body_decoder and delegate decoding to it. Return the decoded
+        /// appropriate packet body decoder and delegate decoding to it. Return the decoded
         /// \c mqtt_packet, transferring ownership to the caller. If decoding fails throw an
         /// \c error::malformed_mqtt_packet.
         ///
@@ -40,59 +39,20 @@ namespace io_wally::decoder
         ///                                         incorrectly encoded.
         [[nodiscard]] auto decode( const frame& frame ) const -> std::shared_ptr<protocol::mqtt_packet>
         {
-            return body_decoder_for( frame ).decode( frame );
+            return body_decoders{}.decode( frame );
         }
 
        private:
-        /// Methods
-        [[nodiscard]] auto body_decoder_for( const frame& frame ) const -> const packet_decoder_impl&
-        {
-            switch ( frame.type( ) )
-            {
-                case protocol::packet::Type::CONNECT:
-                    return connect_packet_decoder_;
-                case protocol::packet::Type::PINGREQ:
-                    return pingreq_packet_decoder_;
-                case protocol::packet::Type::DISCONNECT:
-                    return disconnect_packet_decoder_;
-                case protocol::packet::Type::SUBSCRIBE:
-                    return subscribe_packet_decoder_;
-                case protocol::packet::Type::UNSUBSCRIBE:
-                    return unsubscribe_packet_decoder_;
-                case protocol::packet::Type::PUBLISH:
-                    return publish_packet_decoder_;
-                case protocol::packet::Type::PUBACK:
-                    return puback_packet_decoder_;
-                case protocol::packet::Type::PUBREC:
-                    return pubrec_packet_decoder_;
-                case protocol::packet::Type::PUBCOMP:
-                    return pubcomp_packet_decoder_;
-                case protocol::packet::Type::PUBREL:
-                    return pubrel_packet_decoder_;
-                case protocol::packet::Type::CONNACK:
-                case protocol::packet::Type::SUBACK:
-                case protocol::packet::Type::UNSUBACK:
-                case protocol::packet::Type::PINGRESP:
-                case protocol::packet::Type::RESERVED1:
-                case protocol::packet::Type::RESERVED2:
-                default:
-                    throw std::invalid_argument( "Unsupported MQTT control packet type" );
-            }
-
-            assert( false );
-        }
-
-       private:
-        /// Fields
-        const connect_packet_decoder_impl connect_packet_decoder_{};
-        const pingreq_packet_decoder_impl pingreq_packet_decoder_{};
-        const disconnect_packet_decoder_impl disconnect_packet_decoder_{};
-        const subscribe_packet_decoder_impl subscribe_packet_decoder_{};
-        const unsubscribe_packet_decoder_impl unsubscribe_packet_decoder_{};
-        const publish_packet_decoder_impl publish_packet_decoder_{};
-        const puback_packet_decoder_impl puback_packet_decoder_{};
-        const pubrec_packet_decoder_impl pubrec_packet_decoder_{};
-        const pubrel_packet_decoder_impl pubrel_packet_decoder_{};
-        const pubcomp_packet_decoder_impl pubcomp_packet_decoder_{};
+        /// Types
+        using body_decoders = packet_body_decoders<connect_packet_decoder_impl,
+                                                   pingreq_packet_decoder_impl,
+                                                   disconnect_packet_decoder_impl,
+                                                   subscribe_packet_decoder_impl,
+                                                   unsubscribe_packet_decoder_impl,
+                                                   publish_packet_decoder_impl,
+                                                   puback_packet_decoder_impl,
+                                                   pubrec_packet_decoder_impl,
+                                                   pubcomp_packet_decoder_impl,
+                                                   pubrel_packet_decoder_impl>;
     };
 }  // namespace io_wally::decoder
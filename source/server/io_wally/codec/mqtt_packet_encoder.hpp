@@ -40,56 +40,21 @@ namespace io_wally::encoder
                 encode_fixed_header( mqtt_packet.type_and_flags( ), mqtt_packet.remaining_length( ), buf_start );
             assert( ( buf_end - buf_start ) >= mqtt_packet.remaining_length( ) );
 
-            return body_encoder_for( mqtt_packet ).encode( mqtt_packet, buf_start );
+            return body_encoders{}.encode( mqtt_packet, buf_start );
         }
 
        private:
-        auto body_encoder_for( const protocol::mqtt_packet& mqtt_packet ) const
-            -> const packet_body_encoder<OutputIterator>&
-        {
-            switch ( mqtt_packet.type( ) )
-            {
-                case protocol::packet::Type::CONNACK:
-                    return connack_encoder_;
-                case protocol::packet::Type::PINGRESP:
-                    return pingresp_encoder_;
-                case protocol::packet::Type::SUBACK:
-                    return suback_encoder_;
-                case protocol::packet::Type::UNSUBACK:
-                    return unsuback_encoder_;
-                case protocol::packet::Type::PUBLISH:
-                    return publish_encoder_;
-                case protocol::packet::Type::PUBACK:
-                    return puback_encoder_;
-                case protocol::packet::Type::PUBREL:
-                    return pubrel_encoder_;
-                case protocol::packet::Type::PUBREC:
-                    return pubrec_encoder_;
-                case protocol::packet::Type::PUBCOMP:
-                    return pubcomp_encoder_;
-                case protocol::packet::Type::CONNECT:
-                case protocol::packet::Type::PINGREQ:
-                case protocol::packet::Type::DISCONNECT:
-                case protocol::packet::Type::SUBSCRIBE:
-                case protocol::packet::Type::UNSUBSCRIBE:
-                case protocol::packet::Type::RESERVED1:
-                case protocol::packet::Type::RESERVED2:
-                default:
-                    assert( false );
-            }
-        }
-
-       private:
-        /// Fields
-        const connack_packet_encoder<OutputIterator> connack_encoder_{};
-        const pingresp_packet_encoder<OutputIterator> pingresp_encoder_{};
-        const suback_packet_encoder<OutputIterator> suback_encoder_{};
-        const unsuback_packet_encoder<OutputIterator> unsuback_encoder_{};
-        const publish_packet_encoder<OutputIterator> publish_encoder_{};
-        const puback_packet_encoder<OutputIterator> puback_encoder_{};
-        const pubrel_packet_encoder<OutputIterator> pubrel_encoder_{};
-        const pubrec_packet_encoder<OutputIterator> pubrec_encoder_{};
-        const pubcomp_packet_encoder<OutputIterator> pubcomp_encoder_{};
+        /// Types
+        using body_encoders = packet_body_encoders<OutputIterator,
+                                                   connack_packet_encoder<OutputIterator>,
+                                                   pingresp_packet_encoder<OutputIterator>,
+                                                   suback_packet_encoder<OutputIterator>,
+                                                   unsuback_packet_encoder<OutputIterator>,
+                                                   publish_packet_encoder<OutputIterator>,
+                                                   puback_packet_encoder<OutputIterator>,
+                                                   pubrel_packet_encoder<OutputIterator>,
+                                                   pubrec_packet_encoder<OutputIterator>,
+                                                   pubcomp_packet_encoder<OutputIterator>>;
     };
 
 }  // namespace io_wally::encoder
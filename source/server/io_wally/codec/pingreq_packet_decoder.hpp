@@ -5,6 +5,7 @@
 
 #include "io_wally/codec/decoder.hpp"
 #include "io_wally/protocol/common.hpp"
+#include "io_wally/protocol/packet_pool.hpp"
 #include "io_wally/protocol/pingreq_packet.hpp"
 
 namespace io_wally::decoder
@@ -15,14 +16,17 @@ namespace io_wally::decoder
     /// decoded \c pingreq_packet.
     ///
     /// \see http://docs.oasis-open.org/mqtt/mqtt/v3.1.1/os/mqtt-v3.1.1-os.html#_Toc398718081
-    class pingreq_packet_decoder_impl final : public packet_decoder_impl
+    class pingreq_packet_decoder_impl final
     {
        public:
+        /// Control packet type decoded by this decoder
+        static constexpr protocol::packet::Type TYPE = protocol::packet::Type::PINGREQ;
+
         /// \brief Decode the supplied buffer into a \c pingreq_packet.
         ///
         /// \see io_wally::protocol::decoder::packet_body_decoder::decode
         ///
-        [[nodiscard]] auto decode( const frame& frame ) const -> std::shared_ptr<protocol::mqtt_packet> override
+        [[nodiscard]] auto decode( const frame& frame ) const -> std::shared_ptr<protocol::mqtt_packet>
         {
             assert( frame.type( ) == protocol::packet::Type::PINGREQ );
 
@@ -36,7 +40,7 @@ namespace io_wally::decoder
                     "PINGREQ fixed header reports remaining length != 0 (violates MQTT 3.1.1 spec)"};
             }
 
-            return std::make_shared<protocol::pingreq>( );
+            return protocol::make_packet<protocol::pingreq>( );
         }
     };
 }  // namespace io_wally::decoder
@@ -1,7 +1,5 @@
 #pragma once
 
-#include <cassert>
-
 #include "io_wally/codec/encoder.hpp"
 #include "io_wally/protocol/common.hpp"
 #include "io_wally/protocol/pingresp_packet.hpp"
@@ -11,9 +9,13 @@ namespace io_wally::encoder
     /// \brief Encoder for PINGRESP packet bodies.
     ///
     template <typename OutputIterator>
-    class pingresp_packet_encoder final : public packet_body_encoder<OutputIterator>
+    class pingresp_packet_encoder final
     {
        public:
+        /// Type of packet encoded by this encoder, and its control packet type
+        using packet_type = protocol::pingresp;
+        static constexpr protocol::packet::Type TYPE = protocol::packet::Type::PINGRESP;
+
         /// Methods
 
         /// \brief Encode \c mqtt_packet into supplied buffer.
@@ -21,13 +23,12 @@ namespace io_wally::encoder
         /// Encode \c pingresp into buffer starting at \c buf_start. Return an \c OutputIterator that points
         /// immediately past the last byte written.
         ///
-        /// \param pingresp_packet \c pingresp packet to encode
+        /// \param pingresp \c pingresp packet to encode
         /// \param buf_start      Start of buffer to encode \c mqtt_packet into
         /// \return         \c OutputIterator that points immediately past the last byte written
-        auto encode( const protocol::mqtt_packet& pingresp_packet, OutputIterator buf_start ) const -> OutputIterator
+        auto encode( [[maybe_unused]] const protocol::pingresp& pingresp, OutputIterator buf_start ) const
+            -> OutputIterator
         {
-            assert( pingresp_packet.type( ) == protocol::packet::Type::PINGRESP );
-
             return buf_start;
         }
     };
@@ -1,7 +1,5 @@
 #pragma once
 
-#include <cassert>
-
 #include "io_wally/codec/encoder.hpp"
 #include "io_wally/protocol/common.hpp"
 #include "io_wally/protocol/pubcomp_packet.hpp"
@@ -11,9 +9,13 @@ namespace io_wally::encoder
     /// \brief Encoder for PUBCOMP packet bodies.
     ///
     template <typename OutputIterator>
-    class pubcomp_packet_encoder final : public packet_body_encoder<OutputIterator>
+    class pubcomp_packet_encoder final
     {
        public:
+        /// Type of packet encoded by this encoder, and its control packet type
+        using packet_type = protocol::pubcomp;
+        static constexpr protocol::packet::Type TYPE = protocol::packet::Type::PUBCOMP;
+
         /// Methods
 
         /// \brief Encode \c mqtt_packet into supplied buffer.
@@ -22,17 +24,11 @@ namespace io_wally::encoder
         /// immediately past the last byte written. If \c pubcomp does not conform to spec, throw
         /// error::invalid_mqtt_packet.
         ///
-        /// \param pubcomp_packet \c pubcomp packet to encode
+        /// \param pubcomp \c pubcomp packet to encode
         /// \param buf_start      Start of buffer to encode \c mqtt_packet into
         /// \return         \c OutputIterator that points immediately past the last byte written
-        auto encode( const protocol::mqtt_packet& pubcomp_packet, OutputIterator buf_start ) const -> OutputIterator
+        auto encode( const protocol::pubcomp& pubcomp, OutputIterator buf_start ) const -> OutputIterator
         {
-            using namespace io_wally::protocol;
-
-            assert( pubcomp_packet.type( ) == packet::Type::PUBCOMP );
-
-            const auto& pubcomp = dynamic_cast<const struct pubcomp&>( pubcomp_packet );
-
             // Encode packet identifier
             buf_start = encode_uint16( pubcomp.packet_identifier( ), buf_start );
 
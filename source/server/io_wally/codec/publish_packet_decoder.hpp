@@ -2,13 +2,20 @@
 
 #include <cassert>
 #include <cstdint>
+#include <iterator>
 #include <memory>
+#include <string_view>
 #include <tuple>
+#include <utility>
 #include <vector>
 
 #include "io_wally/codec/decoder.hpp"
 #include "io_wally/protocol/common.hpp"
+#include "io_wally/protocol/packet_pool.hpp"
+#include "io_wally/protocol/payload.hpp"
 #include "io_wally/protocol/publish_packet.hpp"
+#include "io_wally/protocol/topic_name.hpp"
+#include "io_wally/protocol/utf8.hpp"
 
 namespace io_wally::decoder
 {
@@ -18,14 +25,17 @@ namespace io_wally::decoder
     /// decoded \c publish_packet.
     ///
     /// \see http://docs.oasis-open.org/mqtt/mqtt/v3.1.1/os/mqtt-v3.1.1-os.html#_Toc398718nullptr28
-    class publish_packet_decoder_impl final : public packet_decoder_impl
+    class publish_packet_decoder_impl final
     {
        public:
+        /// Control packet type decoded by this decoder
+        static constexpr protocol::packet::Type TYPE = protocol::packet::Type::PUBLISH;
+
         /// \brief Decode supplied frame into a \c publish packet.
         ///
         /// \see io_wally::protocol::decoder::packet_body_decoder::parse
         ///
-        [[nodiscard]] auto decode( const frame& frame ) const -> std::shared_ptr<protocol::mqtt_packet> override
+        [[nodiscard]] auto decode( const frame& frame ) const -> std::shared_ptr<protocol::mqtt_packet>
         {
             using namespace io_wally::protocol;
 
@@ -44,10 +54,11 @@ namespace io_wally::decoder
 
             auto new_buf_start = frame.begin;
 
-            // Parse topic_name
-            auto topic_name = std::string{};
-            std::tie( new_buf_start, topic_name ) = decode_utf8_string( new_buf_start, frame.end );
-            check_well_formed_topic_name( topic_name );
+            // Parse topic_name, interning it straight from our frame: hot topics are thus neither copied nor
+            // tokenized again. Checking it is a well-formed string and a well-formed topic name takes a single pass.
+            auto topic_name = std::string_view{};
+            std::tie( new_buf_start, topic_name ) = decode_binary_data( new_buf_start, frame.end );
+            protocol::utf8::check_topic_name( topic_name );
 
             // Parse variable header publish_header IFF QoS > 0
             auto packet_id = uint16_t{0};
@@ -56,38 +67,24 @@ namespace io_wally::decoder
                 std::tie( new_buf_start, packet_id ) = decode_uint16( new_buf_start, frame.end );
             }
 
-            // Parse application message
-            auto application_message = std::vector<uint8_t>{new_buf_start, frame.end};
-
-            return std::make_shared<protocol::publish>( frame.type_and_flags,
-                                                        static_cast<uint32_t>( frame.remaining_length( ) ), topic_name,
-                                                        packet_id, application_message );
-        }
-
-       private:
-        void check_well_formed_topic_name( const std::string& topic_name ) const
-        {
-            if ( topic_name.empty( ) )
-                throw error::malformed_mqtt_packet( "[MQTT-4.7.3-1] Topic name MUST be at least one character long" );
-
-            if ( topic_name.size( ) > 65535 )
-                throw error::malformed_mqtt_packet(
-                    "[MQTT-4.7.3-3] Topic name MUST NOT be longer than 65535 characters" );
-
-            std::size_t found = topic_name.find( '\0' );
-            if ( found != std::string::npos )
-                throw error::malformed_mqtt_packet(
-                    "[MQTT-4.7.3-2] Topic name MUST NOT include null character (U+0000)" );
-
-            found = topic_name.find( '+' );
-            if ( found != std::string::npos )
-                throw error::malformed_mqtt_packet(
-                    "[MQTT-4.7.1-1] Topic name MUST NOT include wildcard character '+'" );
+            // Parse application message: if our frame's buffer may be shared, reference our application message
+            // in place instead of copying it
+            auto application_message = protocol::payload{};
+            if ( frame.chunk )
+            {
+                const auto offset = std::distance( frame.chunk->cbegin( ), new_buf_start );
+                const auto length = static_cast<std::size_t>( std::distance( new_buf_start, frame.end ) );
+                application_message = protocol::payload{frame.chunk, frame.chunk->data( ) + offset, length};
+            }
+            else
+            {
+                application_message = protocol::payload{std::vector<uint8_t>{new_buf_start, frame.end}};
+            }
 
-            found = topic_name.find( '#' );
-            if ( found != std::string::npos )
-                throw error::malformed_mqtt_packet(
-                    "[MQTT-4.7.1-1] Topic name MUST NOT include wildcard character '#'" );
+            return protocol::make_packet<protocol::publish>( frame.type_and_flags,
+                                                             static_cast<uint32_t>( frame.remaining_length( ) ),
+                                                             protocol::topic_name::intern( topic_name ), packet_id,
+                                                             std::move( application_message ) );
         }
     };  // class publish_packet_decoder_impl
 }  // namespace io_wally::decoder
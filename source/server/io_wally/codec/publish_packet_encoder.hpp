@@ -1,6 +1,8 @@
 #pragma once
 
-#include <cassert>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 
 #include "io_wally/codec/encoder.hpp"
 #include "io_wally/protocol/common.hpp"
@@ -11,9 +13,13 @@ namespace io_wally::encoder
     /// \brief Encoder for PUBLISH packet bodies.
     ///
     template <typename OutputIterator>
-    class publish_packet_encoder final : public packet_body_encoder<OutputIterator>
+    class publish_packet_encoder final
     {
        public:
+        /// Type of packet encoded by this encoder, and its control packet type
+        using packet_type = protocol::publish;
+        static constexpr protocol::packet::Type TYPE = protocol::packet::Type::PUBLISH;
+
         /// Methods
 
         /// \brief Encode \c mqtt_packet into supplied buffer.
@@ -22,19 +28,13 @@ namespace io_wally::encoder
         /// immediately past the last byte written. If \c publish does not conform to spec, throw
         /// error::invalid_mqtt_packet.
         ///
-        /// \param publish_packet \c publish packet to encode
+        /// \param publish \c publish packet to encode
         /// \param buf_start      Start of buffer to encode \c mqtt_packet into
         /// \return         \c OutputIterator that points immediately past the last byte written
-        auto encode( const protocol::mqtt_packet& publish_packet, OutputIterator buf_start ) const -> OutputIterator
+        auto encode( const protocol::publish& publish, OutputIterator buf_start ) const -> OutputIterator
         {
-            using namespace io_wally::protocol;
-
-            assert( publish_packet.type( ) == packet::Type::PUBLISH );
-
-            const auto& publish = dynamic_cast<const struct publish&>( publish_packet );
-
             // Encode topic
-            buf_start = encode_utf8_string( publish.topic( ), buf_start );
+            buf_start = encode_utf8_string( publish.topic( ).name( ), buf_start );
 
             // Encode packet identifier IF QOS > 0
             if ( publish.has_packet_identifier( ) )
@@ -51,4 +51,68 @@ namespace io_wally::encoder
             return buf_start;
         }
     };
+
+    /// Topics and application messages shorter than this will be copied by \c encode_publish_parts, since an extra
+    /// buffer in a vectored write would cost more than copying them.
+    constexpr std::size_t MIN_SHARED_PUBLISH_PART_LENGTH = 64;
+
+    /// \brief Encode \c publish for a vectored write, without copying its topic and application message.
+    ///
+    /// Only the parts specific to each recipient - fixed header, topic length and packet identifier - will be encoded
+    /// into buffers provided by \c writer. \c publish's topic and application message will be handed to \c writer
+    /// as references into its shared \c protocol::publish_body, unless they are too short to be worth it.
+    ///
+    /// \param publish PUBLISH packet to encode
+    /// \param writer  Object providing
+    ///                 - <tt>append( std::size_t length, ENCODE encode )</tt>, calling \c encode with an iterator
+    ///                   range of \c length bytes to encode into, and
+    ///                 - <tt>append_shared( const std::uint8_t* data, std::size_t length )</tt>, appending an
+    ///                   externally owned buffer
+    template <typename WRITER>
+    void encode_publish_parts( const protocol::publish& publish, WRITER& writer )
+    {
+        const auto& body = *publish.body( );
+        const auto* topic = reinterpret_cast<const std::uint8_t*>( body.topic.name( ).data( ) );
+        const auto& message = body.application_message;
+        const auto share_topic = body.topic.name( ).size( ) >= MIN_SHARED_PUBLISH_PART_LENGTH;
+        const auto share_message = message.size( ) >= MIN_SHARED_PUBLISH_PART_LENGTH;
+        const auto header_length = publish.total_length( ) - publish.remaining_length( );
+        const auto packet_identifier_length = publish.has_packet_identifier( ) ? std::size_t{2} : std::size_t{0};
+
+        auto head_length = header_length + 2;
+        if ( !share_topic )
+        {
+            head_length += body.topic.name( ).size( ) + packet_identifier_length;
+            if ( !share_message )
+                head_length += message.size( );
+        }
+        writer.append( head_length, [&]( auto buf_start, auto /* buf_end */ ) {
+            buf_start = encode_fixed_header( publish.type_and_flags( ), publish.remaining_length( ), buf_start );
+            buf_start = encode_uint16( static_cast<uint16_t>( body.topic.name( ).size( ) ), buf_start );
+            if ( !share_topic )
+            {
+                buf_start = std::copy( topic, topic + body.topic.name( ).size( ), buf_start );
+                if ( packet_identifier_length > 0 )
+                    buf_start = encode_uint16( publish.packet_identifier( ), buf_start );
+                if ( !share_message )
+                    std::copy( message.begin( ), message.end( ), buf_start );
+            }
+        } );
+        if ( share_topic )
+        {
+            writer.append_shared( topic, body.topic.name( ).size( ) );
+            if ( packet_identifier_length > 0 || !share_message )
+            {
+                writer.append( packet_identifier_length + ( share_message ? 0 : message.size( ) ),
+                               [&]( auto buf_start, auto /* buf_end */ ) {
+                                   if ( packet_identifier_length > 0 )
+                                       buf_start = encode_uint16( publish.packet_identifier( ), buf_start );
+                                   if ( !share_message )
+                                       std::copy( message.begin( ), message.end( ), buf_start );
+                               } );
+            }
+        }
+        if ( share_message )
+            writer.append_shared( message.data( ), message.size( ) );
+    }
 }  // namespace io_wally::encoder
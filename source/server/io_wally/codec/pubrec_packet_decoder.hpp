@@ -7,6 +7,7 @@
 
 #include "io_wally/codec/decoder.hpp"
 #include "io_wally/protocol/common.hpp"
+#include "io_wally/protocol/packet_pool.hpp"
 #include "io_wally/protocol/pubrec_packet.hpp"
 
 namespace io_wally::decoder
@@ -15,14 +16,17 @@ namespace io_wally::decoder
     ///
     /// Interprets supplied \c frame to contain a serialized PUBREC packet. Decodes \c frame and returns
     /// decoded \c pubrec_packet.
-    class pubrec_packet_decoder_impl final : public packet_decoder_impl
+    class pubrec_packet_decoder_impl final
     {
        public:
+        /// Control packet type decoded by this decoder
+        static constexpr protocol::packet::Type TYPE = protocol::packet::Type::PUBREC;
+
         /// \brief Decode the supplied buffer into a \c pubrec packet.
         ///
         /// \see io_wally::protocol::decoder::packet_body_decoder::parse
         ///
-        [[nodiscard]] auto decode( const frame& frame ) const -> std::shared_ptr<protocol::mqtt_packet> override
+        [[nodiscard]] auto decode( const frame& frame ) const -> std::shared_ptr<protocol::mqtt_packet>
         {
             using namespace io_wally::protocol;
 
@@ -36,7 +40,7 @@ namespace io_wally::decoder
             auto packet_id = uint16_t{0};
             std::tie( std::ignore, packet_id ) = decode_uint16( frame.begin, frame.end );
 
-            return std::make_shared<protocol::pubrec>( packet_id );
+            return protocol::make_packet<protocol::pubrec>( packet_id );
         }
     };  // class pubrec_packet_decoder_impl
 }  // namespace io_wally::decoder
@@ -11,9 +11,13 @@ namespace io_wally::encoder
     /// \brief Encoder for SUBACK packet bodies.
     ///
     template <typename OutputIterator>
-    class suback_packet_encoder final : public packet_body_encoder<OutputIterator>
+    class suback_packet_encoder final
     {
        public:
+        /// Type of packet encoded by this encoder, and its control packet type
+        using packet_type = protocol::suback;
+        static constexpr protocol::packet::Type TYPE = protocol::packet::Type::SUBACK;
+
         /// Methods
 
         /// \brief Encode \c mqtt_packet into supplied buffer.
@@ -22,17 +26,13 @@ namespace io_wally::encoder
         /// immediately past the last byte written. If \c suback does not conform to spec, throw
         /// error::invalid_mqtt_packet.
         ///
-        /// \param suback_packet \c suback packet to encode
+        /// \param suback \c suback packet to encode
         /// \param buf_start      Start of buffer to encode \c mqtt_packet into
         /// \return         \c OutputIterator that points immediately past the last byte written
-        auto encode( const protocol::mqtt_packet& suback_packet, OutputIterator buf_start ) const -> OutputIterator
+        auto encode( const protocol::suback& suback, OutputIterator buf_start ) const -> OutputIterator
         {
             using namespace io_wally::protocol;
 
-            assert( suback_packet.type( ) == packet::Type::SUBACK );
-
-            const auto& suback = dynamic_cast<const struct suback&>( suback_packet );
-
             // Encode packet identifier
             buf_start = encode_uint16( suback.packet_identifier( ), buf_start );
 
@@ -3,11 +3,14 @@
 #include <cassert>
 #include <cstdint>
 #include <memory>
+#include <string>
+#include <string_view>
 #include <tuple>
 #include <vector>
 
 #include "io_wally/codec/decoder.hpp"
 #include "io_wally/protocol/common.hpp"
+#include "io_wally/protocol/packet_pool.hpp"
 #include "io_wally/protocol/subscribe_packet.hpp"
 #include "io_wally/protocol/subscription.hpp"
 
@@ -19,14 +22,17 @@ namespace io_wally::decoder
     /// decoded \c subscribe_packet.
     ///
     /// \see http://docs.oasis-open.org/mqtt/mqtt/v3.1.1/os/mqtt-v3.1.1-os.html#_Toc398718nullptr28
-    class subscribe_packet_decoder_impl final : public packet_decoder_impl
+    class subscribe_packet_decoder_impl final
     {
        public:
+        /// Control packet type decoded by this decoder
+        static constexpr protocol::packet::Type TYPE = protocol::packet::Type::SUBSCRIBE;
+
         /// \brief Decode supplied \c frame into a \c subscribe packet.
         ///
         /// \see io_wally::protocol::decoder::packet_body_decoder::parse
         ///
-        [[nodiscard]] auto decode( const frame& frame ) const -> std::shared_ptr<protocol::mqtt_packet> override
+        [[nodiscard]] auto decode( const frame& frame ) const -> std::shared_ptr<protocol::mqtt_packet>
         {
             using namespace io_wally::protocol;
 
@@ -47,22 +53,22 @@ namespace io_wally::decoder
             auto subscriptions = std::vector<subscription>{};
             while ( new_buf_start != frame.end )
             {
-                // char* topic_filter = nullptr;
-                auto topic_filter = std::string{};
-                std::tie( new_buf_start, topic_filter ) = decode_utf8_string( new_buf_start, frame.end );
+                // Our subscription checks it is a well-formed string and a well-formed topic filter in a single pass
+                auto topic_filter = std::string_view{};
+                std::tie( new_buf_start, topic_filter ) = decode_binary_data( new_buf_start, frame.end );
 
                 auto maximum_qos = packet::QoS{};
                 new_buf_start = decode_qos( new_buf_start, frame.end, &maximum_qos );
 
-                subscriptions.emplace_back( topic_filter, maximum_qos );
+                subscriptions.emplace_back( std::string{topic_filter}, maximum_qos );
             }
             if ( subscriptions.empty( ) )
                 throw error::malformed_mqtt_packet{
                     "[MQTT-3.8.3-3] A SUBSCRIBE packet MUST contain at least one subscription (topic filter/QoS "
                     "pair)"};
 
-            return std::make_shared<protocol::subscribe>( static_cast<uint32_t>( frame.remaining_length( ) ), packet_id,
-                                                          subscriptions );
+            return protocol::make_packet<protocol::subscribe>( static_cast<uint32_t>( frame.remaining_length( ) ),
+                                                               packet_id, subscriptions );
         }
     };  // class subscribe_packet_decoder_impl
 }  // namespace io_wally::decoder
@@ -3,12 +3,16 @@
 #include <cassert>
 #include <cstdint>
 #include <memory>
+#include <string>
+#include <string_view>
 #include <tuple>
 #include <vector>
 
 #include "io_wally/codec/decoder.hpp"
 #include "io_wally/protocol/common.hpp"
+#include "io_wally/protocol/packet_pool.hpp"
 #include "io_wally/protocol/unsubscribe_packet.hpp"
+#include "io_wally/protocol/utf8.hpp"
 
 namespace io_wally::decoder
 {
@@ -18,14 +22,17 @@ namespace io_wally::decoder
     /// decoded \c unsubscribe_packet.
     ///
     /// \see http://docs.oasis-open.org/mqtt/mqtt/v3.1.1/os/mqtt-v3.1.1-os.html#_Toc398718nullptr28
-    class unsubscribe_packet_decoder_impl final : public packet_decoder_impl
+    class unsubscribe_packet_decoder_impl final
     {
        public:
+        /// Control packet type decoded by this decoder
+        static constexpr protocol::packet::Type TYPE = protocol::packet::Type::UNSUBSCRIBE;
+
         /// \brief Decode supplied \c frame into a \c unsubscribe packet.
         ///
         /// \see io_wally::protocol::decoder::packet_body_decoder::parse
         ///
-        [[nodiscard]] auto decode( const frame& frame ) const -> std::shared_ptr<protocol::mqtt_packet> override
+        [[nodiscard]] auto decode( const frame& frame ) const -> std::shared_ptr<protocol::mqtt_packet>
         {
             using namespace io_wally::protocol;
 
@@ -46,8 +53,10 @@ namespace io_wally::decoder
             auto topic_filters = std::vector<std::string>{};
             while ( new_buf_start != frame.end )
             {
-                auto topic_filter = std::string{};
-                std::tie( new_buf_start, topic_filter ) = decode_utf8_string( new_buf_start, frame.end );
+                // Checking it is a well-formed string and a well-formed topic filter takes a single pass
+                auto topic_filter = std::string_view{};
+                std::tie( new_buf_start, topic_filter ) = decode_binary_data( new_buf_start, frame.end );
+                protocol::utf8::check_topic_filter( topic_filter );
 
                 topic_filters.emplace_back( topic_filter );
             }
@@ -55,8 +64,8 @@ namespace io_wally::decoder
                 throw error::malformed_mqtt_packet{
                     "[MQTT-3.10.3-2] A UNSUBSCRIBE packet MUST contain at least one subscription (topic filter)"};
 
-            return std::make_shared<protocol::unsubscribe>( static_cast<uint32_t>( frame.remaining_length( ) ),
-                                                            packet_id, topic_filters );
+            return protocol::make_packet<protocol::unsubscribe>( static_cast<uint32_t>( frame.remaining_length( ) ),
+                                                                 packet_id, topic_filters );
         }
     };  // class unsubscribe_packet_decoder_impl
 }  // namespace io_wally::decoder
@@ -21,6 +21,7 @@
 /// Contains
 ///
 ///  - \c io_service_pool  A pool of \c asio::io_service instances, each executing in a dedicated thread
+///  - \c mpsc_queue       A lock-free queue handing values from any number of threads to a single thread
 namespace io_wally::concurrency
 {
     /// \brief Pool of \c asio::io_service objects, each executing in a dedicated thread.
@@ -114,6 +115,17 @@ namespace io_wally::concurrency
             return *io_services_[next % pool_size_];
         }
 
+        /// \brief Get \c io_service object at \c index in pool, for callers confining state of their own to each of
+        /// this pool's threads.
+        ///
+        /// \param index Index of \c io_service object to return, less than this pool's size
+        /// \return \c io_service object at \c index in this pool
+        auto io_service( const std::size_t index ) -> asio::io_service&
+        {
+            assert( index < pool_size_ );
+            return *io_services_[index];
+        }
+
         void wait_until_stopped( )
         {
             auto ul = std::unique_lock<std::mutex>{stop_mutex_};
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <atomic>
+#include <optional>
+#include <utility>
+
+namespace io_wally::concurrency
+{
+    /// \brief Unbounded lock-free FIFO queue, fed by any number of producer threads and drained by a single consumer
+    /// thread.
+    ///
+    /// A linked list of nodes, \c push appending at its head using a single atomic exchange, and \c pop removing from
+    /// its tail. Producers never wait for each other nor for our consumer. Values pushed by the same producer are
+    /// popped in the order they have been pushed.
+    ///
+    /// A producer that has been preempted between its atomic exchange and linking its node to its predecessor
+    /// temporarily hides all nodes pushed after its own: our consumer sees our queue as empty until that producer has
+    /// finished its \c push. Callers that wake our consumer after each \c push must thus be prepared for that consumer
+    /// to find nothing to \c pop.
+    ///
+    /// \see http://www.1024cores.net/home/lock-free-algorithms/queues/intrusive-mpsc-node-based-queue
+    template <typename T>
+    class mpsc_queue final
+    {
+       public:
+        mpsc_queue( ) = default;
+
+        mpsc_queue( const mpsc_queue& ) = delete;
+
+        auto operator=( const mpsc_queue& ) -> mpsc_queue& = delete;
+
+        /// \brief Destroy this queue, and all values still queued. Must not race with any producer.
+        ~mpsc_queue( )
+        {
+            while ( pop( ) )
+            {
+            }
+        }
+
+        /// \brief Append \c value. May be called on any thread.
+        void push( T value )
+        {
+            push_node( new node{std::move( value )} );
+        }
+
+        /// \brief Remove and return the oldest value, if any. Must only be called on our consumer thread.
+        auto pop( ) -> std::optional<T>
+        {
+            auto* tail = tail_;
+            auto* next = tail->next.load( );
+            if ( tail == &stub_ )
+            {
+                if ( !next )
+                    return std::nullopt;
+                tail_ = next;
+                tail = next;
+                next = next->next.load( );
+            }
+            if ( !next )
+            {
+                if ( tail != head_.load( ) )
+                    // A producer is still linking its node to tail
+                    return std::nullopt;
+                // Re-insert our stub node so that tail can be popped without leaving our list empty
+                push_node( &stub_ );
+                next = tail->next.load( );
+                if ( !next )
+                    return std::nullopt;
+            }
+            tail_ = next;
+            auto popped = std::move( tail->value );
+            delete tail;
+
+            return popped;
+        }
+
+       private:
+        struct node final
+        {
+            node( ) = default;
+
+            explicit node( T v ) : value{std::move( v )}
+            {
+            }
+
+            std::atomic<node*> next{nullptr};
+            std::optional<T> value{};
+        };  // struct node
+
+       private:
+        void push_node( node* appended )
+        {
+            appended->next.store( nullptr );
+            auto* const previous = head_.exchange( appended );
+            previous->next.store( appended );
+        }
+
+       private:
+        /// Placeholder keeping our list non-empty
+        node stub_{};
+        /// Most recently pushed node, updated by all producers
+        std::atomic<node*> head_{&stub_};
+        /// Oldest node, only ever accessed by our consumer
+        node* tail_{&stub_};
+    };  // class mpsc_queue
+}  // namespace io_wally::concurrency
@@ -28,6 +28,10 @@ namespace io_wally
 
         static constexpr const char* SERVER_PORT = app::options_factory::SERVER_PORT;
 
+        static constexpr const char* NETWORK_THREADS = app::options_factory::NETWORK_THREADS;
+
+        static constexpr const char* DISPATCHER_THREADS = app::options_factory::DISPATCHER_THREADS;
+
         static constexpr const char* AUTHENTICATION_SERVICE_FACTORY =
             app::options_factory::AUTHENTICATION_SERVICE_FACTORY;
 
@@ -35,12 +39,34 @@ namespace io_wally
 
         static constexpr const char* READ_BUFFER_SIZE = app::options_factory::READ_BUFFER_SIZE;
 
+        static constexpr const char* READ_SHARE_THRESHOLD = app::options_factory::READ_SHARE_THRESHOLD;
+
         static constexpr const char* WRITE_BUFFER_SIZE = app::options_factory::WRITE_BUFFER_SIZE;
 
+        static constexpr const char* WRITE_FLUSH_THRESHOLD = app::options_factory::WRITE_FLUSH_THRESHOLD;
+
         static constexpr const char* PUB_ACK_TIMEOUT = app::options_factory::PUB_ACK_TIMEOUT;
 
         static constexpr const char* PUB_MAX_RETRIES = app::options_factory::PUB_MAX_RETRIES;
 
+        static constexpr const char* PUB_MAX_IN_FLIGHT = app::options_factory::PUB_MAX_IN_FLIGHT;
+
+        static constexpr const char* PUB_MAX_QUEUED = app::options_factory::PUB_MAX_QUEUED;
+
+        static constexpr const char* PUB_SPILL_DIR = app::options_factory::PUB_SPILL_DIR;
+
+        static constexpr const char* PUB_SPILL_THRESHOLD = app::options_factory::PUB_SPILL_THRESHOLD;
+
+        static constexpr const char* PUB_SUBSCRIBER_CACHE_SIZE = app::options_factory::PUB_SUBSCRIBER_CACHE_SIZE;
+
+        static constexpr const char* RETAIN_MAX_BYTES = app::options_factory::RETAIN_MAX_BYTES;
+
+        static constexpr const char* RETAIN_EVICTION = app::options_factory::RETAIN_EVICTION;
+
+        static constexpr const char* RETAIN_TTL = app::options_factory::RETAIN_TTL;
+
+        static constexpr const char* RETAIN_STORE_DIR = app::options_factory::RETAIN_STORE_DIR;
+
        public:
         context( cxxopts::ParseResult options,
                  std::unique_ptr<spi::authentication_service> authentication_service,
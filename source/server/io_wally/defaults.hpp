@@ -9,8 +9,12 @@ namespace io_wally::defaults
 
     static const size_t DEFAULT_INITIAL_READ_BUFFER_SIZE = 256;
 
+    static const size_t DEFAULT_READ_SHARE_THRESHOLD = 1024;
+
     static const size_t DEFAULT_INITIAL_WRITE_BUFFER_SIZE = 256;
 
+    static const size_t DEFAULT_WRITE_FLUSH_THRESHOLD = 64 * 1024;
+
     static const std::string DEFAULT_LOG_FILE = "/var/log/mqttd.log";
 
     static const std::string DEFAULT_LOG_LEVEL = "info";
@@ -19,9 +23,31 @@ namespace io_wally::defaults
 
     static const int DEFAULT_SERVER_PORT = 1883;
 
+    static const size_t DEFAULT_NETWORK_THREADS = 1;
+
+    static const size_t DEFAULT_DISPATCHER_THREADS = 1;
+
     static const uint32_t DEFAULT_PUB_ACK_TIMEOUT_MS = 1000;
 
     static const size_t DEFAULT_PUB_MAX_RETRIES = 5;
 
+    static const uint16_t DEFAULT_PUB_MAX_IN_FLIGHT = 64;
+
+    static const size_t DEFAULT_PUB_MAX_QUEUED = 1000;
+
+    static const std::string DEFAULT_PUB_SPILL_DIR = "";
+
+    static const size_t DEFAULT_PUB_SPILL_THRESHOLD = 256 * 1024 * 1024;
+
+    static const size_t DEFAULT_PUB_SUBSCRIBER_CACHE_SIZE = 4096;
+
+    static const size_t DEFAULT_RETAIN_MAX_BYTES = 0;
+
+    static const std::string DEFAULT_RETAIN_EVICTION = "lru";
+
+    static const uint32_t DEFAULT_RETAIN_TTL_SECS = 0;
+
+    static const std::string DEFAULT_RETAIN_STORE_DIR = "";
+
     static const std::string DEFAULT_AUTHENTICATION_SERVICE_FACTORY = "accept_all";
 }  // namespace io_wally::defaults
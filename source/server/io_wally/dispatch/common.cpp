@@ -2,55 +2,41 @@
 
 #include <cstdint>
 #include <string>
+#include <string_view>
+
+#include "io_wally/protocol/topic_name.hpp"
 
 namespace io_wally::dispatch
 {
-    auto topic_filter_matches_topic( const std::string& topic_filter, const std::string& topic ) -> bool
+    auto topic_filter_matches_topic( std::string_view topic_filter, const protocol::topic_name& topic ) -> bool
     {
-        auto t_idx = size_t{0};
-        auto tf_idx = size_t{0};
-        while ( ( t_idx < topic.length( ) ) && ( tf_idx < topic_filter.length( ) ) )
-        {
-            auto tf_char = topic_filter[tf_idx];
-            auto t_char = topic[t_idx];
-            switch ( tf_char )
-            {
-                case '+':  // single-level wildcard
-                {
-                    // + matches empty topic level
-                    if ( t_char != '/' )
-                    {
-                        while ( ( topic[t_idx] != '/' ) && ( t_idx < topic.length( ) ) )
-                            ++t_idx;
-                    }
-                    ++tf_idx;
-                }
-                break;
-                case '#':  // multi-level wildcard
-                {
-                    return true;
-                }
-                break;
-                case '/':  // topic separator
-                default:   // regular character
-                {
-                    if ( t_char != tf_char )
-                    {
-                        return false;
-                    }
-                    ++t_idx;
-                    ++tf_idx;
-                }
-            }
-        }
-        // If both topic_filter and topic are exhausted when we get here, the match has succeeded.
-        if ( ( t_idx == topic.length( ) ) && ( tf_idx == topic_filter.length( ) ) )
+        constexpr auto END = std::string_view::npos;
+
+        auto level = std::size_t{0};
+        auto pos = std::size_t{0};
+        while ( true )
         {
-            return true;
+            const auto level_end = topic_filter.find( '/', pos );
+            const auto filter_level = topic_filter.substr( pos, level_end == END ? END : level_end - pos );
+            // Wildcard character "#" represents the PARENT and any number of child levels. Since it also matches the
+            // PARENT level, "sport/tennis/player1/#" matches "sport/tennis/player1" (SIC!).
+            if ( filter_level == "#" )
+                return true;
+            if ( level == topic.level_count( ) )
+                return false;
+            // Single-level wildcard "+" matches any topic level, including an empty one
+            if ( ( filter_level != "+" ) && ( filter_level != topic.level( level ) ) )
+                return false;
+            ++level;
+            // If both topic_filter and topic are exhausted when we get here, the match has succeeded
+            if ( level_end == END )
+                return level == topic.level_count( );
+            pos = level_end + 1;
         }
-        // Special case: wildcard character "#" represents the PARENT and any number of child levels. Since it also
-        // matches the PARENT level, "sport/tennis/player1/#" matches "sport/tennis/player1" (SIC!).
-        return ( ( tf_idx < topic_filter.length( ) - 1 ) &&
-                 ( topic_filter.compare( topic_filter.length( ) - 2, 2, "/#" ) == 0 ) );
+    }
+
+    auto topic_filter_matches_topic( const std::string& topic_filter, const std::string& topic ) -> bool
+    {
+        return topic_filter_matches_topic( std::string_view{topic_filter}, protocol::topic_name::intern( topic ) );
     }
 }  // namespace io_wally::dispatch
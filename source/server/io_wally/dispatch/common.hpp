@@ -3,8 +3,10 @@
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <utility>
 
+#include "io_wally/dispatch/slot_map.hpp"
 #include "io_wally/protocol/common.hpp"
 #include "io_wally/protocol/connect_packet.hpp"
 #include "io_wally/protocol/disconnect_packet.hpp"
@@ -13,16 +15,21 @@
 #include "io_wally/protocol/publish_packet.hpp"
 #include "io_wally/protocol/pubrec_packet.hpp"
 #include "io_wally/protocol/subscribe_packet.hpp"
+#include "io_wally/protocol/topic_name.hpp"
 
 namespace io_wally::dispatch
 {
+    /// Dense integer handle identifying a client's session slot in \c mqtt_client_session_manager. Used instead of
+    /// that client's ID wherever sessions are referenced on the dispatch path, e.g. in topic subscriptions.
+    using session_handle = slot_handle;
+
     /// Represents a resolved topic subscriber: when processing a PUBLISH packet an MQTT broker may conclude
     /// (correctly) that a client has registered more than one topic filter matching that PUBLISH packet's
     /// topic. In this case, MQTT 3.1.1 mandates that the PUBLISH packet be delivered to that client only
     /// once, using the maximum QoS of all matching subscriptions.
     ///
     /// This type represents this resolution process' result.
-    using resolved_subscriber_t = std::pair<const std::string, protocol::packet::QoS>;
+    using resolved_subscriber_t = std::pair<session_handle, protocol::packet::QoS>;
 
     /// \brief Flags reason for why a client disconnected.
     ///
@@ -82,75 +89,17 @@ namespace io_wally::dispatch
         return output;
     }
 
-    template <typename SENDER>
-    struct packet_container final
-    {
-       public:  // static
-        using ptr = std::shared_ptr<packet_container<SENDER>>;
-
-        using sender_ptr = std::shared_ptr<SENDER>;
-
-        static auto contain( const std::string& client_id,
-                             const std::shared_ptr<SENDER>& rx_connection,
-                             std::shared_ptr<protocol::mqtt_packet> packet,
-                             const dispatch::disconnect_reason disconnect_reason =
-                                 dispatch::disconnect_reason::not_a_disconnect ) -> packet_container<SENDER>::ptr
-        {
-            return std::make_shared<packet_container<SENDER>>( client_id, rx_connection, packet, disconnect_reason );
-        }
-
-       public:
-        packet_container( std::string client_id,
-                          const std::shared_ptr<SENDER>& rx_connection,
-                          std::shared_ptr<protocol::mqtt_packet> packet,
-                          const dispatch::disconnect_reason disconnect_reason )
-            : client_id_{std::move( client_id )},
-              rx_connection_{rx_connection},
-              packet_{std::move( packet )},
-              disconnect_reason_{disconnect_reason}
-        {
-            return;
-        }
-
-        [[nodiscard]] auto client_id( ) const -> const std::string&
-        {
-            return client_id_;
-        }
-
-        auto rx_connection( ) const -> std::weak_ptr<SENDER>
-        {
-            return rx_connection_;
-        }
-
-        [[nodiscard]] auto packet_type( ) const -> protocol::packet::Type
-        {
-            return packet_->type( );
-        }
-
-        auto packet( ) -> std::shared_ptr<protocol::mqtt_packet>
-        {
-            return packet_;
-        }
-
-        [[nodiscard]] auto disconnect_reason( ) const -> dispatch::disconnect_reason
-        {
-            return disconnect_reason_;
-        }
-
-        template <typename PACKET>
-        auto packet_as( ) -> std::shared_ptr<PACKET>
-        {
-            static_assert( std::is_base_of<protocol::mqtt_packet, PACKET>::value,
-                           "Template parameter PACKET needs to be a subtype of protocol::mqtt_packet" );
-            return std::dynamic_pointer_cast<PACKET>( packet_ );
-        }
-
-       private:
-        const std::string client_id_;
-        std::weak_ptr<SENDER> rx_connection_;
-        std::shared_ptr<protocol::mqtt_packet> packet_;
-        const dispatch::disconnect_reason disconnect_reason_;
-    };  // struct packet_container
+    /// \brief Test if \c topic matches \c topic_filter.
+    ///
+    /// Compares \c topic_filter's levels one by one against \c topic's pre-tokenized levels.
+    ///
+    /// \param topic_filter Well-formed topic filter
+    /// \param topic Interned topic name
+    /// \return \c true if \c topic matches \c topic_filter, \c false otherwise
+    ///
+    /// \see http://docs.oasis-open.org/mqtt/mqtt/v3.1.1/os/mqtt-v3.1.1-os.html#_Toc398718106
+    auto topic_filter_matches_topic( std::string_view topic_filter, const protocol::topic_name& topic ) -> bool;
 
+    /// \brief Test if \c topic matches \c topic_filter, interning \c topic first.
     auto topic_filter_matches_topic( const std::string& topic_filter, const std::string& topic ) -> bool;
 }  // namespace io_wally::dispatch
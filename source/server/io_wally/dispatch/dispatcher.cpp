@@ -1,6 +1,7 @@
 #include "io_wally/dispatch/dispatcher.hpp"
 
 #include <cassert>
+#include <cstddef>
 #include <memory>
 #include <string>
 
@@ -10,15 +11,13 @@
 #include <spdlog/spdlog.h>
 
 #include "io_wally/dispatch/common.hpp"
+#include "io_wally/dispatch/mqtt_client_session.hpp"
+#include "io_wally/dispatch/mqtt_client_session_manager.hpp"
+#include "io_wally/dispatch/session_binding.hpp"
+#include "io_wally/dispatch/session_shard.hpp"
 #include "io_wally/logging/logging.hpp"
 #include "io_wally/mqtt_packet_sender.hpp"
-#include "io_wally/protocol/common.hpp"
 #include "io_wally/protocol/connect_packet.hpp"
-#include "io_wally/protocol/puback_packet.hpp"
-#include "io_wally/protocol/pubcomp_packet.hpp"
-#include "io_wally/protocol/pubrec_packet.hpp"
-#include "io_wally/protocol/subscribe_packet.hpp"
-#include "io_wally/protocol/unsubscribe_packet.hpp"
 
 namespace io_wally::dispatch
 {
@@ -26,80 +25,127 @@ namespace io_wally::dispatch
     // Public
     // ------------------------------------------------------------------------------------------------------------
 
-    dispatcher::dispatcher( const context& context, asio::io_service& io_service )
-        : session_manager_{context, io_service}
+    dispatcher::dispatcher( const context& context )
+        : dispatcher_service_pool_{context, "dispatcher",
+                                   context[io_wally::context::DISPATCHER_THREADS].as<std::size_t>( )},
+          logger_{context.logger_factory( ).logger( "dispatcher" )}
     {
-        logger_ = context.logger_factory( ).logger( "dispatcher" );
+        const auto shard_count = context[io_wally::context::DISPATCHER_THREADS].as<std::size_t>( );
+        const auto retained_messages = std::make_shared<shared_retained_messages>( context );
+        shards_.reserve( shard_count );
+        for ( auto index = std::size_t{0}; index < shard_count; ++index )
+            shards_.push_back( std::make_unique<session_shard>( context, dispatcher_service_pool_.io_service( index ),
+                                                                index, shard_count, shards_, retained_messages ) );
     }
 
-    void dispatcher::handle_packet_received( const mqtt_packet_sender::packet_container_t::ptr& packet_container )
+    void dispatcher::run( )
     {
-        logger_->debug( "RX: {}", *packet_container->packet( ) );
-        if ( packet_container->packet_type( ) == protocol::packet::Type::CONNECT )
-        {
+        dispatcher_service_pool_.run( );
+    }
+
+    void dispatcher::client_connected( const std::shared_ptr<protocol::connect>& connect,
+                                       const std::weak_ptr<mqtt_packet_sender>& connection,
+                                       const std::shared_ptr<session_binding>& binding )
+    {
+        binding->shard = session_shard::index_of( connect->client_id( ), shards_.size( ) );
+        auto& shard = *shards_[binding->shard];
+        shard.io_service( ).post( [this, &shard, connect, connection, binding]( ) {
+            logger_->debug( "RX: {} [shard:{}]", *connect, shard.index( ) );
             // For now, we do not support retained LWT messages
-            const auto connect = packet_container->packet_as<protocol::connect>( );
             assert( !connect->contains_last_will( ) || !connect->retain_last_will( ) );
-            session_manager_.client_connected( packet_container->packet_as<protocol::connect>( ),
-                                               packet_container->rx_connection( ) );
-        }
-        else if ( packet_container->packet_type( ) == protocol::packet::Type::DISCONNECT )
-        {
-            session_manager_.client_disconnected( packet_container->client_id( ),
-                                                  packet_container->disconnect_reason( ) );
-        }
-        else if ( packet_container->packet_type( ) == protocol::packet::Type::SUBSCRIBE )
-        {
-            const auto subscribe = packet_container->packet_as<protocol::subscribe>( );
-            session_manager_.client_subscribed( packet_container->client_id( ), subscribe );
-        }
-        else if ( packet_container->packet_type( ) == protocol::packet::Type::UNSUBSCRIBE )
-        {
-            const auto unsubscribe = packet_container->packet_as<protocol::unsubscribe>( );
-            session_manager_.client_unsubscribed( packet_container->client_id( ), unsubscribe );
-        }
-        else if ( packet_container->packet_type( ) == protocol::packet::Type::PUBLISH )
-        {
-            const auto publish = packet_container->packet_as<protocol::publish>( );
-            session_manager_.client_published( packet_container->client_id( ), publish );
-        }
-        else if ( packet_container->packet_type( ) == protocol::packet::Type::PUBACK )
-        {
-            const auto puback = packet_container->packet_as<protocol::puback>( );
-            session_manager_.client_acked_publish( packet_container->client_id( ), puback );
-        }
-        else if ( packet_container->packet_type( ) == protocol::packet::Type::PUBREC )
-        {
-            const auto pubrec = packet_container->packet_as<protocol::pubrec>( );
-            session_manager_.client_received_publish( packet_container->client_id( ), pubrec );
-        }
-        else if ( packet_container->packet_type( ) == protocol::packet::Type::PUBREL )
-        {
-            const auto pubrel = packet_container->packet_as<protocol::pubrel>( );
-            session_manager_.client_released_publish( packet_container->client_id( ), pubrel );
-        }
-        else if ( packet_container->packet_type( ) == protocol::packet::Type::PUBCOMP )
-        {
-            const auto pubcomp = packet_container->packet_as<protocol::pubcomp>( );
-            session_manager_.client_completed_publish( packet_container->client_id( ), pubcomp );
-        }
-        else
-        {
-            assert( false );
-        }
+            binding->session = shard.session_manager( ).client_connected( connect, connection );
+        } );
     }
 
-    void dispatcher::client_disconnected_ungracefully( const std::string& client_id,
+    void dispatcher::client_disconnected( const std::shared_ptr<session_binding>& binding,
+                                          dispatch::disconnect_reason reason )
+    {
+        post_to_session( binding, [reason]( mqtt_client_session_manager& session_manager,
+                                            const mqtt_client_session::ptr& session ) {
+            session_manager.client_disconnected( session, reason );
+        } );
+    }
+
+    void dispatcher::client_disconnected_ungracefully( const std::shared_ptr<session_binding>& binding,
                                                        dispatch::disconnect_reason reason )
     {
-        logger_->info( "Client [{}] disconnected ungracefully: {}", client_id, reason );
-        session_manager_.client_disconnected_ungracefully( client_id, reason );
+        post_to_session( binding, [this, reason]( mqtt_client_session_manager& session_manager,
+                                                  const mqtt_client_session::ptr& session ) {
+            logger_->info( "Client [{}] disconnected ungracefully: {}", session->client_id( ), reason );
+            session_manager.client_disconnected_ungracefully( session, reason );
+        } );
+    }
+
+    void dispatcher::client_subscribed( const std::shared_ptr<session_binding>& binding,
+                                        const std::shared_ptr<protocol::subscribe>& subscribe )
+    {
+        post_to_session( binding, [subscribe]( mqtt_client_session_manager& session_manager,
+                                               const mqtt_client_session::ptr& session ) {
+            session_manager.client_subscribed( session, subscribe );
+        } );
+    }
+
+    void dispatcher::client_unsubscribed( const std::shared_ptr<session_binding>& binding,
+                                          const std::shared_ptr<protocol::unsubscribe>& unsubscribe )
+    {
+        post_to_session( binding, [unsubscribe]( mqtt_client_session_manager& session_manager,
+                                                 const mqtt_client_session::ptr& session ) {
+            session_manager.client_unsubscribed( session, unsubscribe );
+        } );
+    }
+
+    void dispatcher::client_published( const std::shared_ptr<session_binding>& binding,
+                                       const std::shared_ptr<protocol::publish>& publish )
+    {
+        post_to_session( binding, [publish]( mqtt_client_session_manager& session_manager,
+                                             const mqtt_client_session::ptr& session ) {
+            session_manager.client_published( session, publish );
+        } );
+    }
+
+    void dispatcher::client_acked_publish( const std::shared_ptr<session_binding>& binding,
+                                           const std::shared_ptr<protocol::puback>& puback )
+    {
+        post_to_session( binding, [puback]( mqtt_client_session_manager& session_manager,
+                                            const mqtt_client_session::ptr& session ) {
+            session_manager.client_acked_publish( session, puback );
+        } );
+    }
+
+    void dispatcher::client_received_publish( const std::shared_ptr<session_binding>& binding,
+                                              const std::shared_ptr<protocol::pubrec>& pubrec )
+    {
+        post_to_session( binding, [pubrec]( mqtt_client_session_manager& session_manager,
+                                            const mqtt_client_session::ptr& session ) {
+            session_manager.client_received_publish( session, pubrec );
+        } );
+    }
+
+    void dispatcher::client_released_publish( const std::shared_ptr<session_binding>& binding,
+                                              const std::shared_ptr<protocol::pubrel>& pubrel )
+    {
+        post_to_session( binding, [pubrel]( mqtt_client_session_manager& session_manager,
+                                            const mqtt_client_session::ptr& session ) {
+            session_manager.client_released_publish( session, pubrel );
+        } );
+    }
+
+    void dispatcher::client_completed_publish( const std::shared_ptr<session_binding>& binding,
+                                               const std::shared_ptr<protocol::pubcomp>& pubcomp )
+    {
+        post_to_session( binding, [pubcomp]( mqtt_client_session_manager& session_manager,
+                                             const mqtt_client_session::ptr& session ) {
+            session_manager.client_completed_publish( session, pubcomp );
+        } );
     }
 
     void dispatcher::stop( const std::string& message )
     {
         logger_->info( "STOPPING: Dispatcher ({}) ...", message );
-        session_manager_.destroy_all( );
+        dispatcher_service_pool_.stop( );
+        // Our threads have terminated, so it is safe to access our sessions from the calling thread
+        for ( auto& shard : shards_ )
+            shard->session_manager( ).destroy_all( );
         logger_->info( "STOPPED:  Dispatcher ({})", message );
     }
 }  // namespace io_wally::dispatch
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <cstddef>
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <system_error>
 
@@ -9,60 +12,126 @@
 
 #include <spdlog/spdlog.h>
 
+#include "io_wally/concurrency/io_service_pool.hpp"
 #include "io_wally/context.hpp"
 #include "io_wally/dispatch/common.hpp"
 #include "io_wally/dispatch/mqtt_client_session_manager.hpp"
+#include "io_wally/dispatch/session_binding.hpp"
+#include "io_wally/dispatch/session_shard.hpp"
 #include "io_wally/logging/logging.hpp"
 #include "io_wally/mqtt_packet_sender.hpp"
+#include "io_wally/protocol/connect_packet.hpp"
+#include "io_wally/protocol/puback_packet.hpp"
+#include "io_wally/protocol/pubcomp_packet.hpp"
+#include "io_wally/protocol/publish_packet.hpp"
+#include "io_wally/protocol/pubrec_packet.hpp"
+#include "io_wally/protocol/pubrel_packet.hpp"
+#include "io_wally/protocol/subscribe_packet.hpp"
+#include "io_wally/protocol/unsubscribe_packet.hpp"
 
 namespace io_wally::dispatch
 {
-    /// \brief Responsible for processing MQTT packet received on dispatcher queue, forwarding them appropriately.
+    /// \brief Responsible for processing MQTT packets received on client connections, forwarding them appropriately.
     ///
-    /// Depending on its type, received MQTT packets will be forwarded to one of several further components:
+    /// Each received packet is handed to one of \c dispatcher's typed methods, together with its connection's \c
+    /// session_binding:
     ///
-    ///  - CONNECT:     CONNECT packets will be forwarded to \c mqtt_client_session_manager which will create a new
-    ///                 \c mqtt_client_session
-    ///  - SUBSCRIBE:   XXX
-    ///  - PUBLISH:     XXX
+    ///  - CONNECT:     forwarded to \c mqtt_client_session_manager which will create a new \c mqtt_client_session,
+    ///                 which is then bound to its connection's \c session_binding
+    ///  - all others:  forwarded to \c mqtt_client_session_manager together with the \c mqtt_client_session bound
+    ///                 to their connection, without any further lookup. Packets whose connection is not (or no
+    ///                 longer) bound to a session are dropped.
     ///
     /// Note that \c dispatcher is an *active* component: it manages its own internal \c
-    /// concurrency::io_service_pool, used for pulling MQTT packets received on the network subsystem from a shared
-    /// dispatcher queue.
+    /// concurrency::io_service_pool, used for processing MQTT packets received on the network subsystem. Client
+    /// sessions are partitioned into one \c session_shard per thread in that pool, by client id. Each client session
+    /// is thus confined to its shard's thread, and may be used without further synchronization, while \c
+    /// dispatcher's public methods may be called from any network thread.
     class dispatcher final : public std::enable_shared_from_this<dispatcher>
     {
        public:  // static
         /// \brief Create new \c dispatcher instance.
         ///
         /// \param context Context containing our configuration
-        /// \param io_service Asio io_service instance to be passed on to \c mqtt_client_session_manager
-        dispatcher( const context& context, asio::io_service& io_service );
+        explicit dispatcher( const context& context );
 
        public:
-        /**
-         * @brief Called for each MQTT packet received on a client connection.
-         *
-         * @param packet_container A @c mqtt_packet_sender::packet_container_t carrying the packet received on a
-         *                         client connection
-         */
-        void handle_packet_received( const mqtt_packet_sender::packet_container_t::ptr& packet_container );
+        /// \brief Start this \c dispatcher's thread, and return immediately.
+        void run( );
+
+        /// \brief Called when a client sent a CONNECT packet that has been authenticated.
+        ///
+        /// Thread safe: this and all following methods queue their packet for processing on this dispatcher's thread.
+        ///
+        /// \param connect CONNECT packet sent by client
+        /// \param connection Connection CONNECT has been received on
+        /// \param binding Binding that will refer to new \c mqtt_client_session, to be passed with all later packets
+        ///                received on \c connection
+        void client_connected( const std::shared_ptr<protocol::connect>& connect,
+                               const std::weak_ptr<mqtt_packet_sender>& connection,
+                               const std::shared_ptr<session_binding>& binding );
+
+        /// \brief Called when a client disconnected, either by sending DISCONNECT or since its connection was closed
+        /// by us.
+        void client_disconnected( const std::shared_ptr<session_binding>& binding, dispatch::disconnect_reason reason );
 
         /**
-         * @brief Called when client @c client_id disconnected without sending a DISCONNECT packet, e.g. due to a
-         *        network error.
+         * @brief Called when a client disconnected without sending a DISCONNECT packet, e.g. due to a network error.
          *
-         * @param client_id ID of client that disconnected ungracefully
+         * @param binding Binding referring to disconnected client's session
          * @param reason Why the client disconnected
          */
-        void client_disconnected_ungracefully( const std::string& client_id, dispatch::disconnect_reason reason );
+        void client_disconnected_ungracefully( const std::shared_ptr<session_binding>& binding,
+                                               dispatch::disconnect_reason reason );
+
+        void client_subscribed( const std::shared_ptr<session_binding>& binding,
+                                const std::shared_ptr<protocol::subscribe>& subscribe );
+
+        void client_unsubscribed( const std::shared_ptr<session_binding>& binding,
+                                  const std::shared_ptr<protocol::unsubscribe>& unsubscribe );
+
+        void client_published( const std::shared_ptr<session_binding>& binding,
+                               const std::shared_ptr<protocol::publish>& publish );
+
+        void client_acked_publish( const std::shared_ptr<session_binding>& binding,
+                                   const std::shared_ptr<protocol::puback>& puback );
+
+        void client_received_publish( const std::shared_ptr<session_binding>& binding,
+                                      const std::shared_ptr<protocol::pubrec>& pubrec );
+
+        void client_released_publish( const std::shared_ptr<session_binding>& binding,
+                                      const std::shared_ptr<protocol::pubrel>& pubrel );
+
+        void client_completed_publish( const std::shared_ptr<session_binding>& binding,
+                                       const std::shared_ptr<protocol::pubcomp>& pubcomp );
 
         /// \brief Stop this \c dispatcher instance, closing all \c mqtt_client_sessions
         ///
+        /// Blocks until this dispatcher's thread has terminated.
+        ///
         /// \param message Optional message to log when stopping
         void stop( const std::string& message = "" );
 
        private:
-        mqtt_client_session_manager session_manager_;
+        /// \brief On the thread of the shard \c binding belongs to, invoke \c handler with that shard's session
+        /// manager and the session bound to \c binding, unless there is none.
+        template <typename HANDLER>
+        void post_to_session( const std::shared_ptr<session_binding>& binding, HANDLER handler )
+        {
+            auto& shard = *shards_[binding->shard];
+            shard.io_service( ).post( [this, &shard, binding, handler = std::move( handler )]( ) {
+                if ( const auto session = binding->session.lock( ) )
+                    handler( shard.session_manager( ), session );
+                else
+                    logger_->debug( "No session bound to connection - packet dropped" );
+            } );
+        }
+
+       private:
+        /// Pool of io_service objects used for processing received packets, one per shard
+        concurrency::io_service_pool dispatcher_service_pool_;
         std::unique_ptr<spdlog::logger> logger_;
+        /// All client sessions, partitioned by client id
+        std::vector<std::unique_ptr<session_shard>> shards_{};
     };  // class dispatcher
 }  // namespace io_wally::dispatch
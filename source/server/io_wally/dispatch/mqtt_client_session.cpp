@@ -1,5 +1,6 @@
 #include "io_wally/dispatch/mqtt_client_session.hpp"
 
+#include <cassert>
 #include <memory>
 #include <string>
 
@@ -10,6 +11,7 @@
 #include "io_wally/logging/logging.hpp"
 #include "io_wally/mqtt_packet_sender.hpp"
 #include "io_wally/protocol/common.hpp"
+#include "io_wally/protocol/connect_packet.hpp"
 #include "io_wally/protocol/puback_packet.hpp"
 #include "io_wally/protocol/pubcomp_packet.hpp"
 #include "io_wally/protocol/publish_packet.hpp"
@@ -22,20 +24,25 @@ namespace io_wally::dispatch
     // ------------------------------------------------------------------------------------------------------------
 
     auto mqtt_client_session::client_connected( mqtt_client_session_manager& session_manager,
+                                                session_handle handle,
                                                 std::shared_ptr<protocol::connect> connect,
                                                 std::weak_ptr<mqtt_packet_sender> connection )
         -> mqtt_client_session::ptr
     {
-        return std::make_shared<mqtt_client_session>( session_manager, connect, connection );
+        return std::make_shared<mqtt_client_session>( session_manager, handle, connect, connection );
     }
 
     mqtt_client_session::mqtt_client_session( mqtt_client_session_manager& session_manager,
+                                              session_handle handle,
                                               const std::shared_ptr<protocol::connect>& connect,
                                               const std::weak_ptr<mqtt_packet_sender>& connection )
         : session_manager_{session_manager},
+          handle_{handle},
           client_id_{connect->client_id( )},
+          clean_session_{connect->clean_session( )},
           connection_{connection},
-          tx_in_flight_publications_{session_manager.context( ), session_manager.io_service( ), connection},
+          tx_in_flight_publications_{session_manager.context( ), session_manager.io_service( ), connection,
+                                     session_manager.spill_store( )},
           rx_in_flight_publications_{session_manager.context( ), session_manager.io_service( ), connection}
     {
         lwt_message_ = connect->contains_last_will( ) ? connect : nullptr;
@@ -47,6 +54,21 @@ namespace io_wally::dispatch
         return client_id_;
     }
 
+    auto mqtt_client_session::handle( ) const -> session_handle
+    {
+        return handle_;
+    }
+
+    auto mqtt_client_session::clean_session( ) const -> bool
+    {
+        return clean_session_;
+    }
+
+    auto mqtt_client_session::connected( ) const -> bool
+    {
+        return connected_;
+    }
+
     void mqtt_client_session::send( const protocol::mqtt_packet::ptr& packet )
     {
         if ( const auto conn_local = connection_.lock( ) )
@@ -121,6 +143,36 @@ namespace io_wally::dispatch
         }
     }
 
+    void mqtt_client_session::client_disconnected( )
+    {
+        connected_ = false;
+        connection_.reset( );
+        tx_in_flight_publications_.suspend( );
+        rx_in_flight_publications_.suspend( );
+        logger_->debug( "SUSPENDED: [in-flight:{}|queued:{}]", tx_in_flight_publications_.size( ),
+                        tx_in_flight_publications_.pending( ) );
+    }
+
+    void mqtt_client_session::client_reconnected( const std::shared_ptr<protocol::connect>& connect,
+                                                  const std::weak_ptr<mqtt_packet_sender>& connection )
+    {
+        assert( !connected_ && !connect->clean_session( ) );
+        connected_ = true;
+        connection_ = connection;
+        lwt_message_ = connect->contains_last_will( ) ? connect : nullptr;
+    }
+
+    void mqtt_client_session::resume( )
+    {
+        assert( connected_ );
+        logger_->debug( "RESUMING: [in-flight:{}|queued:{}|discarded:{}] ...", tx_in_flight_publications_.size( ),
+                        tx_in_flight_publications_.pending( ), tx_in_flight_publications_.discarded( ) );
+        rx_in_flight_publications_.resume( connection_ );
+        tx_in_flight_publications_.resume( connection_ );
+        logger_->info( "RESUMED: [in-flight:{}|queued:{}]", tx_in_flight_publications_.size( ),
+                       tx_in_flight_publications_.pending( ) );
+    }
+
     void mqtt_client_session::destroy( )
     {
         session_manager_.destroy( client_id_ );
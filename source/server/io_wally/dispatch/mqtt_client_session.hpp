@@ -5,6 +5,7 @@
 
 #include <spdlog/spdlog.h>
 
+#include "io_wally/dispatch/common.hpp"
 #include "io_wally/dispatch/rx_in_flight_publications.hpp"
 #include "io_wally/dispatch/tx_in_flight_publications.hpp"
 #include "io_wally/mqtt_packet_sender.hpp"
@@ -25,10 +26,12 @@ namespace io_wally::dispatch
         using ptr = std::shared_ptr<mqtt_client_session>;
 
         static auto client_connected( mqtt_client_session_manager& session_manager,
+                                      session_handle handle,
                                       std::shared_ptr<protocol::connect> connect,
                                       std::weak_ptr<mqtt_packet_sender> connection ) -> mqtt_client_session::ptr;
 
         mqtt_client_session( mqtt_client_session_manager& session_manager,
+                             session_handle handle,
                              const std::shared_ptr<protocol::connect>& connect,
                              const std::weak_ptr<mqtt_packet_sender>& connection );
 
@@ -38,6 +41,19 @@ namespace io_wally::dispatch
         /// \return ID of client connected to this \c mqtt_client_session
         auto client_id( ) const -> const std::string&;
 
+        /// \brief Handle identifying this \c mqtt_client_session in its \c mqtt_client_session_manager.
+        [[nodiscard]] auto handle( ) const -> session_handle;
+
+        /// \brief Whether client requested a clean session, i.e. whether this session's state - its subscriptions -
+        /// should be discarded once it ends.
+        ///
+        /// \return \c true if client connected with \c clean_session set to 1
+        [[nodiscard]] auto clean_session( ) const -> bool;
+
+        /// \brief Whether this session's client is currently connected. A persistent session outlives its client's
+        /// connection.
+        [[nodiscard]] auto connected( ) const -> bool;
+
         /// \brief Send an \c mqtt_packet to connected client.
         ///
         /// \param packet MQTT packet to send
@@ -82,13 +98,35 @@ namespace io_wally::dispatch
          */
         void client_disconnected_ungracefully( dispatch::disconnect_reason reason );
 
+        /// \brief Called when this client disconnected, either gracefully or not, from a persistent session.
+        ///
+        /// Detaches this session from its client's connection, keeping all its in flight publications, and queueing
+        /// all QoS 1 and QoS 2 publications until its client reconnects.
+        void client_disconnected( );
+
+        /// \brief Called when this persistent session's client reconnected, with \c clean_session set to 0.
+        ///
+        /// Attaches this session to its client's new \c connection. Nothing is sent until we \c resume.
+        ///
+        /// \param connect    CONNECT packet sent by client
+        /// \param connection Client's new connection
+        void client_reconnected( const std::shared_ptr<protocol::connect>& connect,
+                                 const std::weak_ptr<mqtt_packet_sender>& connection );
+
+        /// \brief Resend all in flight and queued publications of this reconnected persistent session, once its
+        /// client has been sent its CONNACK.
+        void resume( );
+
         /// \brief Destroy this \c mqtt_client_session.
         void destroy( );
 
        private:
         mqtt_client_session_manager& session_manager_;
+        const session_handle handle_;
         const std::string client_id_;
+        const bool clean_session_;
         std::weak_ptr<mqtt_packet_sender> connection_;
+        bool connected_{true};
         tx_in_flight_publications tx_in_flight_publications_;
         rx_in_flight_publications rx_in_flight_publications_;
         std::shared_ptr<protocol::connect> lwt_message_;
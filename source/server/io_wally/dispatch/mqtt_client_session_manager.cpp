@@ -1,11 +1,14 @@
 #include "io_wally/dispatch/mqtt_client_session_manager.hpp"
 
-#include <map>
+#include <filesystem>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include <asio.hpp>
-#include <utility>
 
 #include <spdlog/fmt/ostr.h>
 #include <spdlog/spdlog.h>
@@ -15,6 +18,9 @@
 #include "io_wally/dispatch/mqtt_client_session.hpp"
 #include "io_wally/dispatch/topic_subscriptions.hpp"
 #include "io_wally/mqtt_packet_sender.hpp"
+#include "io_wally/persistence/spill_store.hpp"
+#include "io_wally/protocol/common.hpp"
+#include "io_wally/protocol/connack_packet.hpp"
 #include "io_wally/protocol/puback_packet.hpp"
 #include "io_wally/protocol/pubcomp_packet.hpp"
 #include "io_wally/protocol/publish_packet.hpp"
@@ -26,6 +32,18 @@
 
 namespace io_wally::dispatch
 {
+    namespace
+    {
+        /// Where a session manager responsible for \c shard keeps its files, given configured directory \c dir:
+        /// shards must not share their files
+        auto shard_dir( const std::string& dir, const shard_link& shard ) -> std::filesystem::path
+        {
+            if ( !shard.forward )
+                return dir;
+            return std::filesystem::path{dir} / ( "shard-" + std::to_string( shard.index ) );
+        }
+    }  // namespace
+
     // ------------------------------------------------------------------------------------------------------------
     // mqtt_client_session_manager::session_store: public
     // ------------------------------------------------------------------------------------------------------------
@@ -37,12 +55,27 @@ namespace io_wally::dispatch
     auto mqtt_client_session_manager::session_store::operator[]( const std::string& client_id ) const
         -> mqtt_client_session::ptr
     {
-        if ( const auto pos = sessions_.find( client_id ); pos != std::end( sessions_ ) )
-            return pos->second;
+        return ( *this )[handle_of( client_id )];
+    }
+
+    auto mqtt_client_session_manager::session_store::operator[]( const session_handle handle ) const
+        -> mqtt_client_session::ptr
+    {
+        if ( const auto* const slot = slots_.get( handle ) )
+            return slot->session;
         else
             return mqtt_client_session::ptr{};
     }
 
+    auto mqtt_client_session_manager::session_store::handle_of( const std::string& client_id ) const
+        -> session_handle
+    {
+        if ( const auto pos = handles_.find( client_id ); pos != std::end( handles_ ) )
+            return pos->second;
+        else
+            return session_handle{};
+    }
+
     auto mqtt_client_session_manager::session_store::insert( std::shared_ptr<protocol::connect> connect,
                                                              const std::weak_ptr<mqtt_packet_sender>& connection )
         -> bool
@@ -50,15 +83,33 @@ namespace io_wally::dispatch
         if ( const auto locked_connection = connection.lock( ) )
         {
             assert( locked_connection->client_id( ) );
+            const auto& client_id = *locked_connection->client_id( );
 
-            auto stored = false;
-            auto pos = std::map<const std::string, mqtt_client_session::ptr>::iterator{};
-            std::tie( pos, stored ) = sessions_.try_emplace(
-                *locked_connection->client_id( ),
-                mqtt_client_session::client_connected( parent_, std::move( connect ), connection ) );
+            auto handle = handle_of( client_id );
+            if ( !handle.valid( ) )
+            {
+                handle = slots_.insert( client_slot{client_id, mqtt_client_session::ptr{}} );
+                handles_.emplace( client_id, handle );
+            }
+            auto& slot = *slots_.get( handle );
+            if ( slot.session && slot.session->connected( ) )
+                return false;
+
+            if ( slot.session && !slot.session->clean_session( ) && !connect->clean_session( ) )
+            {
+                slot.session->client_reconnected( connect, connection );
+            }
+            else
+            {
+                // Keep any previous session alive until it has been replaced: destroying it may call back into this
+                // store
+                const auto previous = std::exchange(
+                    slot.session,
+                    mqtt_client_session::client_connected( parent_, handle, std::move( connect ), connection ) );
+            }
+            ++size_;
 
-            // We touch both stored AND pos since otherwise clang-analyzer complains about a dead store to pos.
-            return stored && ( pos != sessions_.end( ) );
+            return true;
         }
 
         return false;
@@ -66,17 +117,49 @@ namespace io_wally::dispatch
 
     void mqtt_client_session_manager::session_store::remove( const std::string& client_id )
     {
-        sessions_.erase( client_id );
+        if ( auto* const slot = slots_.get( handle_of( client_id ) );
+             slot && slot->session && slot->session->connected( ) )
+        {
+            slot->session->client_disconnected( );
+            --size_;
+        }
+    }
+
+    void mqtt_client_session_manager::session_store::release( const std::string& client_id )
+    {
+        remove( client_id );
+        if ( const auto pos = handles_.find( client_id ); pos != std::end( handles_ ) )
+        {
+            // Move session out of its slot first: destroying it may call back into this store
+            const auto session = std::move( slots_.get( pos->second )->session );
+            slots_.erase( pos->second );
+            handles_.erase( pos );
+        }
     }
 
     void mqtt_client_session_manager::session_store::clear( )
     {
-        sessions_.clear( );
+        // Keep all sessions alive until this store is in a consistent state again
+        auto sessions = std::vector<mqtt_client_session::ptr>{};
+        sessions.reserve( size_ );
+        for ( const auto& [client_id, handle] : handles_ )
+        {
+            if ( auto* const slot = slots_.get( handle ); slot->session )
+                sessions.push_back( std::move( slot->session ) );
+        }
+        slots_.clear( );
+        handles_.clear( );
+        size_ = 0;
     }
 
     auto mqtt_client_session_manager::session_store::size( ) const -> std::size_t
     {
-        return sessions_.size( );
+        return size_;
+    }
+
+    auto mqtt_client_session_manager::session_store::offline_size( ) const -> std::size_t
+    {
+        return handles_.size( ) - size_;
     }
 
     // ------------------------------------------------------------------------------------------------------------
@@ -84,9 +167,23 @@ namespace io_wally::dispatch
     // ------------------------------------------------------------------------------------------------------------
 
     mqtt_client_session_manager::mqtt_client_session_manager( const io_wally::context& context,
-                                                              asio::io_service& io_service )
-        : context_{context}, io_service_{io_service}, topic_subscriptions_{context}
+                                                              asio::io_service& io_service,
+                                                              shard_link shard )
+        : context_{context},
+          io_service_{io_service},
+          topic_subscriptions_{context},
+          shard_{std::move( shard )},
+          retained_messages_{shard_.retained_messages ? shard_.retained_messages
+                                                      : std::make_shared<shared_retained_messages>( context )}
     {
+        const auto spill_dir = context[io_wally::context::PUB_SPILL_DIR].as<std::string>( );
+        if ( !spill_dir.empty( ) )
+        {
+            const auto dir = shard_dir( spill_dir, shard_ );
+            spill_store_ = std::make_unique<persistence::spill_store>(
+                dir, context[io_wally::context::PUB_SPILL_THRESHOLD].as<std::size_t>( ), context.logger_factory( ) );
+            logger_->info( "Spilling queued publications to {}", dir.string( ) );
+        }
     }
 
     mqtt_client_session_manager::~mqtt_client_session_manager( )
@@ -99,157 +196,165 @@ namespace io_wally::dispatch
         return context_;
     }
 
+    auto mqtt_client_session_manager::spill_store( ) const -> persistence::spill_store*
+    {
+        return spill_store_.get( );
+    }
+
     auto mqtt_client_session_manager::io_service( ) const -> asio::io_service&
     {
         return io_service_;
     }
 
-    void mqtt_client_session_manager::client_connected( const std::shared_ptr<protocol::connect>& connect,
+    auto mqtt_client_session_manager::client_connected( const std::shared_ptr<protocol::connect>& connect,
                                                         const std::weak_ptr<mqtt_packet_sender>& connection )
+        -> mqtt_client_session::ptr
     {
-        if ( sessions_.insert( connect, connection ) )
-        {
-            logger_->info( "Session for client [cltid:{}] created [total:{}]", connect->client_id( ),
-                           sessions_.size( ) );
-        }
-        else
+        const auto previous = sessions_[connect->client_id( )];
+        // [MQTT-3.2.2-2] Tell client whether we kept its persistent session
+        const auto session_present =
+            previous && !previous->connected( ) && !previous->clean_session( ) && !connect->clean_session( );
+        if ( !sessions_.insert( connect, connection ) )
         {
             logger_->warn( "Client connected [cltid:{}], yet session was immediately closed (network/protocol error)",
                            connect->client_id( ) );
+            if ( const auto locked_connection = connection.lock( ) )
+                locked_connection->stop( "Failed to create session for client [" + connect->client_id( ) + "]" );
+            return mqtt_client_session::ptr{};
         }
+
+        const auto session = sessions_[connect->client_id( )];
+        // Send CONNACK only once our session exists, and before resuming a persistent session, which will send
+        // everything queued for its client
+        if ( const auto locked_connection = connection.lock( ) )
+            locked_connection->send( std::make_shared<protocol::connack>(
+                session_present, protocol::connect_return_code::CONNECTION_ACCEPTED ) );
+        if ( session_present )
+            session->resume( );
+        if ( connect->clean_session( ) )
+        {
+            // [MQTT-3.1.2-6] Discard any subscriptions left over from a previous persistent session
+            topic_subscriptions_.unsubscribe_all( session->handle( ) );
+        }
+        logger_->info( "Session for client [cltid:{}] {} [total:{}|offline:{}]", connect->client_id( ),
+                       session_present ? "resumed" : "created", sessions_.size( ), sessions_.offline_size( ) );
+
+        return session;
     }
 
-    void mqtt_client_session_manager::client_disconnected( const std::string& client_id,
+    void mqtt_client_session_manager::client_disconnected( const mqtt_client_session::ptr& session,
                                                            const dispatch::disconnect_reason reason )
     {
-        sessions_.remove( client_id );
-        logger_->debug( "Client disconnected: [cltid:{}|rsn:{}] - session destroyed", client_id, reason );
+        remove_session( session->client_id( ) );
+        logger_->debug( "Client disconnected: [cltid:{}|rsn:{}] - session {}", session->client_id( ), reason,
+                        session->clean_session( ) ? "destroyed" : "kept" );
     }
 
-    void mqtt_client_session_manager::client_subscribed( const std::string& client_id,
+    void mqtt_client_session_manager::client_subscribed( const mqtt_client_session::ptr& session,
                                                          const std::shared_ptr<protocol::subscribe>& subscribe )
     {
-        if ( const auto suback = topic_subscriptions_.subscribe( client_id, subscribe );
-             const auto session = sessions_[client_id] )
+        const auto suback = topic_subscriptions_.subscribe( session->handle( ), subscribe );
+        // TODO: mqtt_client_session exposes an event-oriented interface, i.e. client code (as this code) tells
+        // it what has happened, not what to do. This "send()" method is the only exception. Can we get rid of
+        // it?
+        session->send( suback );
+
+        const auto matching_retained_messages = [this, &subscribe]( ) {
+            const auto lock = std::lock_guard<std::mutex>{retained_messages_->mutex};
+            return retained_messages_->messages.messages_for( subscribe );
+        }( );
+        for ( const auto& retained_message : matching_retained_messages )
         {
-            // TODO: mqtt_client_session exposes an event-oriented interface, i.e. client code (as this code) tells
-            // it what has happened, not what to do. This "send()" method is the only exception. Can we get rid of
-            // it?
-            session->send( suback );
-
-            const auto matching_retained_messages = retained_messages_.messages_for( subscribe );
-            for ( const auto& retained_message : matching_retained_messages )
-            {
-                assert( retained_message.first->retain( ) );
-                session->publish( retained_message.first, retained_message.second );
-            }
-
-            logger_->debug( "SUBSCRIBED: [cltid:{}|pkt:{}] - received [{}] retained message(s)", client_id, *subscribe,
-                            matching_retained_messages.size( ) );
+            assert( retained_message.first->retain( ) );
+            // Publish a copy: retained messages are shared with other shards, and publishing may alter its QoS
+            const auto& retained = retained_message.first;
+            session->publish( retained->with_new_packet_identifier( retained->packet_identifier( ) ),
+                              retained_message.second );
         }
+
+        logger_->debug( "SUBSCRIBED: [cltid:{}|pkt:{}] - received [{}] retained message(s)", session->client_id( ),
+                        *subscribe, matching_retained_messages.size( ) );
     }
 
-    void mqtt_client_session_manager::client_unsubscribed( const std::string& client_id,
+    void mqtt_client_session_manager::client_unsubscribed( const mqtt_client_session::ptr& session,
                                                            const std::shared_ptr<protocol::unsubscribe>& unsubscribe )
     {
-        if ( const auto unsuback = topic_subscriptions_.unsubscribe( client_id, unsubscribe );
-             const auto session = sessions_[client_id] )
-        {
-            // TODO: mqtt_client_session exposes an event-oriented interface, i.e. client code (as this code) tells
-            // it
-            // what has happened, not what to do. This "send()" method is the only exception. Can we get rid of it?
-            session->send( unsuback );
-        }
-        logger_->debug( "UNSUBSCRIBED: [cltid:{}|pkt:{}]", client_id, *unsubscribe );
+        const auto unsuback = topic_subscriptions_.unsubscribe( session->handle( ), unsubscribe );
+        // TODO: mqtt_client_session exposes an event-oriented interface, i.e. client code (as this code) tells it
+        // what has happened, not what to do. This "send()" method is the only exception. Can we get rid of it?
+        session->send( unsuback );
+        logger_->debug( "UNSUBSCRIBED: [cltid:{}|pkt:{}]", session->client_id( ), *unsubscribe );
     }
 
-    void mqtt_client_session_manager::client_published( const std::string& client_id,
+    void mqtt_client_session_manager::client_published( const mqtt_client_session::ptr& session,
                                                         const std::shared_ptr<protocol::publish>& incoming_publish )
     {
-        logger_->debug( "RX PUBLISH: [cltid:{}|pkt:{}]", client_id, *incoming_publish );
-        const auto session = sessions_[client_id];
-        if ( !session )
-        {
-            logger_->warn( "No session for client [{}] - session asynchronously closed?", client_id );
-            return;
-        }
-
+        logger_->debug( "RX PUBLISH: [cltid:{}|pkt:{}]", session->client_id( ), *incoming_publish );
         if ( incoming_publish->retain( ) )
         {
+            // Retain incoming publish BEFORE dispatching it: other shards may deliver it as soon as it has been
+            // forwarded to them, and a client concurrently subscribing on one of those must then find it retained.
+            // Retained messages keep a copy of their own, so that clearing its retain flag below leaves them alone.
+            {
+                const auto lock = std::lock_guard<std::mutex>{retained_messages_->mutex};
+                retained_messages_->messages.retain( incoming_publish );
+            }
+            logger_->debug( "RETAINED: [topic:{}|size:{}]", incoming_publish->topic( ),
+                            incoming_publish->application_message( ).size( ) );
             // [MQTT-3.3.1.3] PUBLISH packets forwarded to subscriptions that already existed when they were
             // published MUST have their retain flag set to 0
             incoming_publish->retain( false );
-            session->client_sent_publish( incoming_publish );
-            // Retain incoming publish only AFTER it has been published to all interested subscribers with retained
-            // flag set to 0. Otherwise, we will store it in retained_messages_ with a retained flag initially set
-            // to 0, and a concurrently subcribing client may pull it out of retained_messages_ BEFORE its retained
-            // flag could be set to 1 again.
-            incoming_publish->retain( true );
-            retained_messages_.retain( incoming_publish );
-            logger_->debug( "RETAINED: [topic:{}|size:{}]", incoming_publish->topic( ),
-                            incoming_publish->application_message( ).size( ) );
         }
-        else
+        session->client_sent_publish( incoming_publish );
+    }
+
+    void mqtt_client_session_manager::deliver( const std::shared_ptr<protocol::publish>& incoming_publish )
+    {
+        for ( const auto& subscriber : topic_subscriptions_.resolve_subscribers( incoming_publish ) )
         {
-            session->client_sent_publish( incoming_publish );
+            if ( const auto session = sessions_[subscriber.first] )
+            {
+                session->publish( incoming_publish, subscriber.second );
+            }
         }
     }
 
-    void mqtt_client_session_manager::client_acked_publish( const std::string& client_id,
+    void mqtt_client_session_manager::client_acked_publish( const mqtt_client_session::ptr& session,
                                                             const std::shared_ptr<protocol::puback>& puback )
     {
-        logger_->debug( "RX ACK: [cltid:{}|pkt:{}]", client_id, *puback );
-        if ( const auto session = sessions_[client_id] )
-        {
-            session->client_acked_publish( puback );
-        }
+        logger_->debug( "RX ACK: [cltid:{}|pkt:{}]", session->client_id( ), *puback );
+        session->client_acked_publish( puback );
     }
 
-    void mqtt_client_session_manager::client_received_publish( const std::string& client_id,
+    void mqtt_client_session_manager::client_received_publish( const mqtt_client_session::ptr& session,
                                                                const std::shared_ptr<protocol::pubrec>& pubrec )
     {
-        logger_->debug( "RX REC: [cltid:{}|pkt:{}]", client_id, *pubrec );
-        if ( const auto session = sessions_[client_id] )
-        {
-            session->client_received_publish( pubrec );
-        }
+        logger_->debug( "RX REC: [cltid:{}|pkt:{}]", session->client_id( ), *pubrec );
+        session->client_received_publish( pubrec );
     }
 
-    void mqtt_client_session_manager::client_released_publish( const std::string& client_id,
+    void mqtt_client_session_manager::client_released_publish( const mqtt_client_session::ptr& session,
                                                                const std::shared_ptr<protocol::pubrel>& pubrel )
     {
-        logger_->debug( "RX REL: [cltid:{}|pkt:{}]", client_id, *pubrel );
-        if ( const auto session = sessions_[client_id] )
-        {
-            session->client_released_publish( pubrel );
-        }
+        logger_->debug( "RX REL: [cltid:{}|pkt:{}]", session->client_id( ), *pubrel );
+        session->client_released_publish( pubrel );
     }
 
-    void mqtt_client_session_manager::client_completed_publish( const std::string& client_id,
+    void mqtt_client_session_manager::client_completed_publish( const mqtt_client_session::ptr& session,
                                                                 const std::shared_ptr<protocol::pubcomp>& pubcomp )
     {
-        logger_->debug( "RX COMP: [cltid:{}|pkt:{}]", client_id, *pubcomp );
-        if ( const auto session = sessions_[client_id] )
-        {
-            session->client_completed_publish( pubcomp );
-        }
+        logger_->debug( "RX COMP: [cltid:{}|pkt:{}]", session->client_id( ), *pubcomp );
+        session->client_completed_publish( pubcomp );
     }
 
-    void mqtt_client_session_manager::client_disconnected_ungracefully( const std::string& client_id,
+    void mqtt_client_session_manager::client_disconnected_ungracefully( const mqtt_client_session::ptr& session,
                                                                         dispatch::disconnect_reason reason )
     {
-        if ( const auto session = sessions_[client_id] )
-        {
-            // so that we do not send an LWT message to ourselves if we happen to be subscribed to our own LWT topic
-            sessions_.remove( client_id );
-            session->client_disconnected_ungracefully( reason );
-            logger_->info( "Client session [cltid:{}] destroyed after ungraceful disconnect: {}", client_id, reason );
-        }
-        else
-        {
-            logger_->warn( "Client [{}] discconnected ungracefully, yet there is no client session for this client",
-                           client_id );
-        }
+        // so that we do not send an LWT message to ourselves if we happen to be subscribed to our own LWT topic
+        remove_session( session->client_id( ) );
+        session->client_disconnected_ungracefully( reason );
+        logger_->info( "Client session [cltid:{}] destroyed after ungraceful disconnect: {}", session->client_id( ),
+                       reason );
     }
 
     auto mqtt_client_session_manager::connected_clients_count( ) const -> std::size_t
@@ -259,15 +364,22 @@ namespace io_wally::dispatch
 
     void mqtt_client_session_manager::destroy( const std::string& client_id )
     {
-        sessions_.remove( client_id );
+        remove_session( client_id );
         logger_->info( "Client session [cltid:{}] destroyed", client_id );
     }
 
     void mqtt_client_session_manager::destroy_all( )
     {
         const auto sess_cnt = sessions_.size( );
+        const auto offline_sess_cnt = sessions_.offline_size( );
         sessions_.clear( );
-        logger_->info( "SHUTDOWN: [{}] client session(s) destroyed", sess_cnt );
+        logger_->info( "SHUTDOWN: [{}] client session(s) and [{}] offline persistent session(s) destroyed", sess_cnt,
+                       offline_sess_cnt );
+        logger_->info( "SHUTDOWN: resolved subscriber cache {}", topic_subscriptions_.cache_stats( ) );
+        const auto lock = std::lock_guard<std::mutex>{retained_messages_->mutex};
+        const auto& retained = retained_messages_->messages;
+        logger_->info( "SHUTDOWN: [{}] retained message(s) - [footprint:{}|evicted:{}|expired:{}]", retained.size( ),
+                       retained.footprint( ), retained.evicted_count( ), retained.expired_count( ) );
     }
 
     // ------------------------------------------------------------------------------------------------------------
@@ -276,12 +388,27 @@ namespace io_wally::dispatch
 
     void mqtt_client_session_manager::publish( const std::shared_ptr<protocol::publish>& incoming_publish )
     {
-        for ( const auto& subscriber : topic_subscriptions_.resolve_subscribers( incoming_publish ) )
+        // Hand other shards a copy of their own, taken before delivering to our subscribers may alter its QoS
+        if ( shard_.forward )
+            shard_.forward( incoming_publish->with_new_packet_identifier( incoming_publish->packet_identifier( ) ) );
+        deliver( incoming_publish );
+    }
+
+    void mqtt_client_session_manager::remove_session( const std::string& client_id )
+    {
+        const auto session = sessions_[client_id];
+        if ( !session )
+            return;
+
+        if ( session->clean_session( ) )
         {
-            if ( const auto session = sessions_[subscriber.first] )
-            {
-                session->publish( incoming_publish, subscriber.second );
-            }
+            topic_subscriptions_.unsubscribe_all( session->handle( ) );
+            sessions_.release( client_id );
+        }
+        else
+        {
+            // Keep subscriptions and queue publications until client reconnects
+            sessions_.remove( client_id );
         }
     }
 }  // namespace io_wally::dispatch
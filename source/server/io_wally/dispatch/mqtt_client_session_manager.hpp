@@ -1,8 +1,11 @@
 #pragma once
 
-#include <map>
+#include <cstddef>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 
 #include <asio.hpp>
 
@@ -12,10 +15,12 @@
 #include "io_wally/dispatch/common.hpp"
 #include "io_wally/dispatch/mqtt_client_session.hpp"
 #include "io_wally/dispatch/retained_messages.hpp"
+#include "io_wally/dispatch/slot_map.hpp"
 #include "io_wally/dispatch/topic_subscriptions.hpp"
 #include "io_wally/logging/logging.hpp"
 #include "io_wally/logging_support.hpp"
 #include "io_wally/mqtt_packet_sender.hpp"
+#include "io_wally/persistence/spill_store.hpp"
 #include "io_wally/protocol/puback_packet.hpp"
 #include "io_wally/protocol/pubcomp_packet.hpp"
 #include "io_wally/protocol/publish_packet.hpp"
@@ -25,6 +30,35 @@
 
 namespace io_wally::dispatch
 {
+    /// \brief Retained messages shared by the session managers of all shards, guarded by their \c mutex.
+    struct shared_retained_messages final
+    {
+        explicit shared_retained_messages( const context& context ) : messages{context}
+        {
+        }
+
+        std::mutex mutex{};
+        retained_messages messages;
+    };  // struct shared_retained_messages
+
+    /// \brief Connects the session manager responsible for one shard of all client sessions to all other shards.
+    ///
+    /// Client sessions may be partitioned into shards by client id, each shard's session manager confined to a
+    /// thread of its own. Each session manager delivers a PUBLISH received from one of its clients to its own
+    /// subscribers, and hands it to \c forward for delivery to all other shards' subscribers. Retained messages are
+    /// not partitioned, but shared by all shards. A retained PUBLISH is stored before it is handed to \c forward.
+    ///
+    /// A default constructed \c shard_link stands for a session manager responsible for all client sessions.
+    struct shard_link final
+    {
+        /// This shard's index, naming its subdirectory of any spill and write-ahead log directory
+        std::size_t index{0};
+        /// Retained messages shared by all shards
+        std::shared_ptr<shared_retained_messages> retained_messages{};
+        /// Called with each PUBLISH to deliver to all other shards' subscribers, on this shard's thread
+        std::function<void( const std::shared_ptr<protocol::publish>& )> forward{};
+    };  // struct shard_link
+
     /// Manages open \c mqtt_client_sessions so that they may be cleanly stopped when the server
     /// needs to shut down.
     ///
@@ -40,6 +74,12 @@ namespace io_wally::dispatch
         /// more easily replacing the default std::map with data structures that are a better fit for our needs.
         /// In particular, we will need to find a concurrent, thread-safe implementation. This struct's very
         /// restricted interface should accommodate many such alternatives.
+        ///
+        /// Each client is assigned a session slot in a \c slot_map when it first connects, identified by a \c
+        /// session_handle. Subscriptions refer to clients by that handle, which allows resolving a PUBLISH's
+        /// subscribers' sessions without looking up client ids. A persistent session stays in its slot while its
+        /// client is offline, so that a client reconnecting to it regains its handle, its subscriptions and all
+        /// publications queued for it in the meantime.
         struct session_store final
         {
            public:
@@ -53,44 +93,79 @@ namespace io_wally::dispatch
            public:
             auto operator=( const session_store& ) -> session_store& = delete;
 
-            /// \brief Look up \c mqtt_client_session for client having \c client_id.
+            /// \brief Look up \c mqtt_client_session for client having \c client_id, connected or not.
             ///
-            ///         if no such session exists
+            /// \return Session, or an empty pointer if no such session exists
             auto operator[]( const std::string& client_id ) const -> mqtt_client_session::ptr;
 
-            /// \brief Create a new \c mqtt_client_session and store it.
+            /// \brief Look up \c mqtt_client_session identified by \c handle, connected or not.
+            ///
+            /// \return Session, or an empty pointer if \c handle is stale
+            auto operator[]( session_handle handle ) const -> mqtt_client_session::ptr;
+
+            /// \brief Return handle of session slot assigned to client \c client_id, or an invalid handle if there is
+            /// none.
+            [[nodiscard]] auto handle_of( const std::string& client_id ) const -> session_handle;
+
+            /// \brief Resume the persistent \c mqtt_client_session of a client reconnecting with \c clean_session
+            /// set to 0, or else create a new \c mqtt_client_session and store it, replacing any session its client
+            /// had before while re-using that session's slot.
             ///
             /// \param connect    CONNECT packet sent by client
             /// \param connection Handle to \c mqtt_connection via which the client is connected
-            /// \return \c true if no \c mqtt_client_session was associated with \c client_id prior to calling this
-            ///         method, \c false otherwise. In the latter case, no new \c mqtt_client_session was created
+            /// \return \c true if no connected \c mqtt_client_session was associated with \c client_id prior to
+            ///         calling this method, \c false otherwise. In the latter case, nothing has changed
             auto insert( std::shared_ptr<protocol::connect> connect,
                          const std::weak_ptr<mqtt_packet_sender>& connection ) -> bool;
 
-            /// \brief Destroy \c mqtt_client_session associated with \c client_id, if any.
+            /// \brief Disconnect \c mqtt_client_session associated with \c client_id, if any, keeping it and its
+            /// session slot for when that client reconnects.
             ///
-            /// \param client_id ID of client whose associated \c mqtt_client_session will be destroyed.
+            /// \param client_id ID of client whose associated \c mqtt_client_session will be disconnected.
             void remove( const std::string& client_id );
 
-            /// \brief Destroy all \c mqtt_client_sessions.
+            /// \brief Destroy \c mqtt_client_session associated with \c client_id, if any, and release its session
+            /// slot, invalidating its \c session_handle.
+            ///
+            /// \param client_id ID of client whose associated \c mqtt_client_session will be destroyed.
+            void release( const std::string& client_id );
+
+            /// \brief Destroy all \c mqtt_client_sessions, and release all session slots.
             ///
             void clear( );
 
-            /// \brief Return number of \c mqtt_client_sessions currently stored.
+            /// \brief Return number of \c mqtt_client_sessions currently connected.
             ///
-            /// \return Number of \c mqtt_client_sessions currently stored.
+            /// \return Number of \c mqtt_client_sessions currently connected.
             [[nodiscard]] auto size( ) const -> std::size_t;
 
+            /// \brief Return number of persistent \c mqtt_client_sessions whose client is currently offline.
+            [[nodiscard]] auto offline_size( ) const -> std::size_t;
+
            private:
             /// The mqtt_client_session_manager that owns us
             mqtt_client_session_manager& parent_;
-            /// The managed sessions.
-            std::map<const std::string, mqtt_client_session::ptr> sessions_{};
+            struct client_slot final
+            {
+                std::string client_id{};
+                mqtt_client_session::ptr session{};
+            };  // struct client_slot
+
+            /// The managed sessions, one slot per client
+            slot_map<client_slot> slots_{};
+            /// Session handles by client id
+            std::unordered_map<std::string, session_handle> handles_{};
+            /// Number of connected sessions
+            std::size_t size_{0};
         };  // struct session_store
 
        public:  // static
         /// \brief Create a session manager.
-        mqtt_client_session_manager( const context& context, asio::io_service& io_service );
+        ///
+        /// \param context    Our configuration context
+        /// \param io_service The \c io_service all our client sessions are confined to
+        /// \param shard      How to reach other shards, if this session manager is responsible for one of several
+        mqtt_client_session_manager( const context& context, asio::io_service& io_service, shard_link shard = {} );
 
         /// \brief Destroy this session manager, taking care to destroy all \c mqtt_client_session instances.
         ~mqtt_client_session_manager( );
@@ -112,9 +187,14 @@ namespace io_wally::dispatch
         /// \return \c io_service associated with this session manager
         auto io_service( ) const -> asio::io_service&;
 
+        /// \brief Return where client sessions should spill queued publications to, or \c nullptr if they should
+        /// keep them in memory.
+        auto spill_store( ) const -> persistence::spill_store*;
+
         /**
-         * @brief Called when a new successful CONNECT request has been received. Creates a new @c
-         * mqtt_client_session.
+         * @brief Called when a new successful CONNECT request has been received. Sends CONNACK, and then either
+         * resumes the client's persistent @c mqtt_client_session, sending it everything queued while it was offline,
+         * or creates a new @c mqtt_client_session.
          *
          * @param connect     CONNECT packet sent by client, passed on since it may contain LWT and clean_session
          *                    flag we will need when creating a session
@@ -122,69 +202,82 @@ namespace io_wally::dispatch
          *                    new @c mqtt_client_session. Passed as a @c std::weak_ptr since @c mqtt_packet_sender
          *                    instances are owned by the network subsystem which may decide - potentially because
          *                    network errors - to discard a connection at any time.
+         * @return            Resumed or newly created session, or an empty pointer if no session could be
+         *                    created, e.g. since a session for the same client id is already connected
          */
-        void client_connected( const std::shared_ptr<protocol::connect>& connect,
-                               const std::weak_ptr<mqtt_packet_sender>& connection );
+        auto client_connected( const std::shared_ptr<protocol::connect>& connect,
+                               const std::weak_ptr<mqtt_packet_sender>& connection ) -> mqtt_client_session::ptr;
 
         /// \brief Called when a client disconnects, either voluntarily by sending a DISCONNECT, or involuntarily
-        /// due to network or protocol error. Destroys associated \c mqtt_client_session.
+        /// due to network or protocol error. Destroys associated \c mqtt_client_session, unless it is persistent.
         ///
-        /// \param client_id   Disconnected client's ID.
+        /// \param session     Disconnected client's session
         /// \param reason      Why client was disconnected
-        void client_disconnected( const std::string& client_id, const dispatch::disconnect_reason reason );
+        void client_disconnected( const mqtt_client_session::ptr& session, const dispatch::disconnect_reason reason );
 
         /// \brief Called when a client sent a SUBSCRIBE packet.
         ///
-        /// \param client_id ID of client that sent SUBSCRIBE packet
+        /// \param session Session of client that sent SUBSCRIBE packet
         /// \param subscribe MQTT SUBSCRIBE packet received from client
-        void client_subscribed( const std::string& client_id, const std::shared_ptr<protocol::subscribe>& subscribe );
+        void client_subscribed( const mqtt_client_session::ptr& session,
+                                const std::shared_ptr<protocol::subscribe>& subscribe );
 
         /// \brief Called when a client sent an UNSUBSCRIBE packet.
         ///
-        /// \param client_id ID of client that sent UNSUBSCRIBE packet
+        /// \param session Session of client that sent UNSUBSCRIBE packet
         /// \param usubscribe MQTT UNSUBSCRIBE packet received from client
-        void client_unsubscribed( const std::string& client_id,
+        void client_unsubscribed( const mqtt_client_session::ptr& session,
                                   const std::shared_ptr<protocol::unsubscribe>& unsubscribe );
 
         /// \brief Called when client sent a PUBLISH packet.
         ///
-        /// \param client_id ID of client that sent PUBLISH packet
-        /// \param incoming_publish MQTT PUBLISH packet received from client \c client_id
-        void client_published( const std::string& client_id,
+        /// \param session Session of client that sent PUBLISH packet
+        /// \param incoming_publish MQTT PUBLISH packet received from client
+        void client_published( const mqtt_client_session::ptr& session,
                                const std::shared_ptr<protocol::publish>& incoming_publish );
 
+        /// \brief Called with a PUBLISH another shard received from one of its clients, to deliver it to our
+        /// subscribers.
+        ///
+        /// \param incoming_publish MQTT PUBLISH packet, owned by this session manager
+        void deliver( const std::shared_ptr<protocol::publish>& incoming_publish );
+
         /// \brief Called when a client acknowledged a received QoS 1 PUBLISH, i.e. sent a PUBACK
         ///
-        /// \param client_id ID of client that acked PUBLISH
+        /// \param session Session of client that acked PUBLISH
         /// \param puback PUBACK sent by connected client
-        void client_acked_publish( const std::string& client_id, const std::shared_ptr<protocol::puback>& puback );
+        void client_acked_publish( const mqtt_client_session::ptr& session,
+                                   const std::shared_ptr<protocol::puback>& puback );
 
         /// \brief Called when a client received a QoS 2 PUBLISH, i.e. sent a PUBREC.
         ///
-        /// \param client_id ID of client that received PUBLISH
+        /// \param session Session of client that received PUBLISH
         /// \param pubrec PUBREC sent by connected client
-        void client_received_publish( const std::string& client_id, const std::shared_ptr<protocol::pubrec>& pubrec );
+        void client_received_publish( const mqtt_client_session::ptr& session,
+                                      const std::shared_ptr<protocol::pubrec>& pubrec );
 
         /// \brief Called when a client released a QoS 2 PUBLISH, i.e. sent a PUBREL.
         ///
-        /// \param client_id ID of client that received PUBLISH
+        /// \param session Session of client that received PUBLISH
         /// \param pubrel PUBREL sent by connected client
-        void client_released_publish( const std::string& client_id, const std::shared_ptr<protocol::pubrel>& pubrel );
+        void client_released_publish( const mqtt_client_session::ptr& session,
+                                      const std::shared_ptr<protocol::pubrel>& pubrel );
 
         /// \brief Called when a client completed a QoS 2 PUBLISH, i.e. sent a PUBCOMP.
         ///
-        /// \param client_id ID of client that completed PUBLISH
+        /// \param session Session of client that completed PUBLISH
         /// \param pubrec PUBCOMP sent by connected client
-        void client_completed_publish( const std::string& client_id,
+        void client_completed_publish( const mqtt_client_session::ptr& session,
                                        const std::shared_ptr<protocol::pubcomp>& pubcomp );
 
         /**
          * @brief Called when a client disconnected ungracefully, without sending a DISCONNECT packet.
          *
-         * @param client_id ID of client that disconnected ungracefully
+         * @param session Session of client that disconnected ungracefully
          * @param reason Why the client disconnected
          */
-        void client_disconnected_ungracefully( const std::string& client_id, dispatch::disconnect_reason reason );
+        void client_disconnected_ungracefully( const mqtt_client_session::ptr& session,
+                                               dispatch::disconnect_reason reason );
 
         /**
          * @brief Return number of currently connected clients.
@@ -204,6 +297,10 @@ namespace io_wally::dispatch
        private:
         void publish( const std::shared_ptr<protocol::publish>& incoming_publish );
 
+        /// \brief Destroy \c mqtt_client_session identified by \c client_id, cancelling all its subscriptions and
+        /// releasing its session slot, if it is a clean session. Otherwise, keep it while its client is offline.
+        void remove_session( const std::string& client_id );
+
        private:
         /// Our configuration context, to be passed on to client sessions
         const io_wally::context& context_;
@@ -211,10 +308,14 @@ namespace io_wally::dispatch
         asio::io_service& io_service_;
         /// Where we store topic subscriptions
         topic_subscriptions topic_subscriptions_;
+        /// Shared by all sessions' queues, and thus to be destroyed after them
+        std::unique_ptr<persistence::spill_store> spill_store_{};
         /// The managed sessions.
         session_store sessions_{*this};
-        /// All retained messages
-        retained_messages retained_messages_{};
+        /// How to reach other shards, if any
+        const shard_link shard_;
+        /// All retained messages, shared with all other shards
+        std::shared_ptr<shared_retained_messages> retained_messages_;
         /// Our logger
         std::unique_ptr<spdlog::logger> logger_ = context_.logger_factory( ).logger( "session-manager" );
     };
@@ -0,0 +1,95 @@
+#include "io_wally/dispatch/resolved_subscriber_cache.hpp"
+
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <string_view>
+#include <utility>
+
+#include "io_wally/dispatch/common.hpp"
+#include "io_wally/protocol/topic_name.hpp"
+
+namespace io_wally::dispatch
+{
+    // ------------------------------------------------------------------------------------------------------------
+    // Public
+    // ------------------------------------------------------------------------------------------------------------
+
+    resolved_subscriber_cache::resolved_subscriber_cache( const std::size_t capacity ) : capacity_{capacity}
+    {
+        index_.reserve( capacity_ );
+    }
+
+    auto resolved_subscriber_cache::find( const protocol::topic_name& topic ) -> const subscribers_t*
+    {
+        const auto cached = index_.find( topic );
+        if ( cached == index_.end( ) )
+        {
+            ++stats_.misses;
+            return nullptr;
+        }
+        ++stats_.hits;
+        entries_.splice( entries_.begin( ), entries_, cached->second );
+
+        return &cached->second->subscribers;
+    }
+
+    auto resolved_subscriber_cache::insert( const protocol::topic_name& topic, subscribers_t subscribers )
+        -> const subscribers_t&
+    {
+        assert( capacity_ > 0 );
+        assert( index_.find( topic ) == index_.end( ) );
+        if ( index_.size( ) >= capacity_ )
+        {
+            erase( std::prev( entries_.end( ) ) );
+            ++stats_.evictions;
+        }
+        entries_.push_front( entry{topic, std::move( subscribers )} );
+        index_.emplace( topic, entries_.begin( ) );
+
+        return entries_.front( ).subscribers;
+    }
+
+    auto resolved_subscriber_cache::invalidate( const std::string_view topic_filter ) -> std::size_t
+    {
+        if ( entries_.empty( ) )
+            return 0;
+
+        auto invalidated = std::size_t{0};
+        if ( topic_filter.find_first_of( "+#" ) == std::string_view::npos )
+        {
+            const auto cached = index_.find( protocol::topic_name::intern( topic_filter ) );
+            if ( cached != index_.end( ) )
+            {
+                erase( cached->second );
+                ++invalidated;
+            }
+        }
+        else
+        {
+            for ( auto pos = entries_.begin( ); pos != entries_.end( ); )
+            {
+                const auto next = std::next( pos );
+                if ( topic_filter_matches_topic( topic_filter, pos->topic ) )
+                {
+                    erase( pos );
+                    ++invalidated;
+                }
+                pos = next;
+            }
+        }
+        stats_.invalidations += invalidated;
+
+        return invalidated;
+    }
+
+    // ------------------------------------------------------------------------------------------------------------
+    // Private
+    // ------------------------------------------------------------------------------------------------------------
+
+    auto resolved_subscriber_cache::erase( const entries_t::iterator pos ) -> void
+    {
+        index_.erase( pos->topic );
+        entries_.erase( pos );
+    }
+}  // namespace io_wally::dispatch
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <ostream>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "io_wally/dispatch/common.hpp"
+#include "io_wally/protocol/topic_name.hpp"
+
+namespace io_wally::dispatch
+{
+    /// \brief Bounded cache mapping topics to their resolved, deduplicated subscribers.
+    ///
+    /// Most PUBLISH packets go to a comparatively small set of hot topics whose subscribers rarely change. Caching
+    /// each such topic's resolved subscribers saves matching its topic against all topic filters for every single
+    /// PUBLISH.
+    ///
+    /// A \c resolved_subscriber_cache holds at most \c capacity topics, evicting the least recently used topic when
+    /// full. Whenever a topic filter's subscriptions change, exactly those topics matching that topic filter need to
+    /// be \c invalidated.
+    ///
+    /// NOTE: This class is not thread safe.
+    class resolved_subscriber_cache final
+    {
+       public:
+        using subscribers_t = std::vector<resolved_subscriber_t>;
+
+        /// \brief How well a \c resolved_subscriber_cache has been doing so far.
+        struct statistics final
+        {
+            /// Number of lookups that found a cached topic
+            std::uint64_t hits{0};
+            /// Number of lookups that did not find a cached topic
+            std::uint64_t misses{0};
+            /// Number of topics invalidated because subscriptions to a matching topic filter changed
+            std::uint64_t invalidations{0};
+            /// Number of topics evicted to make room for another topic
+            std::uint64_t evictions{0};
+
+            /// \brief Share of lookups that found a cached topic, between 0 and 1.
+            [[nodiscard]] auto hit_rate( ) const -> double
+            {
+                const auto lookups = hits + misses;
+                return lookups > 0 ? static_cast<double>( hits ) / static_cast<double>( lookups ) : 0.0;
+            }
+
+            friend auto operator<<( std::ostream& output, const statistics& stats ) -> std::ostream&
+            {
+                return output << "[hits:" << stats.hits << "|misses:" << stats.misses
+                              << "|hit-rate:" << stats.hit_rate( ) << "|invalidations:" << stats.invalidations
+                              << "|evictions:" << stats.evictions << "]";
+            }
+        };  // struct statistics
+
+       public:
+        /// \brief Create a new \c resolved_subscriber_cache holding at most \c capacity topics.
+        ///
+        /// \param capacity Maximum number of cached topics, 0 disabling this cache
+        explicit resolved_subscriber_cache( std::size_t capacity );
+
+        resolved_subscriber_cache( const resolved_subscriber_cache& ) = delete;
+
+        auto operator=( resolved_subscriber_cache ) -> resolved_subscriber_cache& = delete;
+
+        /// \brief Look up cached subscribers for \c topic, marking \c topic as most recently used.
+        ///
+        /// \param topic Topic to look up
+        /// \return Cached subscribers, valid until this cache is next modified, or \c nullptr if \c topic is not
+        ///         cached
+        [[nodiscard]] auto find( const protocol::topic_name& topic ) -> const subscribers_t*;
+
+        /// \brief Cache \c subscribers for \c topic, evicting the least recently used topic if this cache is full.
+        ///
+        /// \pre \c topic is not cached, and this cache's \c capacity is not 0
+        ///
+        /// \param topic Topic \c subscribers have been resolved for
+        /// \param subscribers Resolved subscribers
+        /// \return Cached subscribers, valid until this cache is next modified
+        auto insert( const protocol::topic_name& topic, subscribers_t subscribers ) -> const subscribers_t&;
+
+        /// \brief Invalidate all cached topics matched by \c topic_filter.
+        ///
+        /// Topic filters without wildcards match at most one topic, which is looked up directly. Only topic filters
+        /// containing wildcards need to be matched against all cached topics.
+        ///
+        /// \param topic_filter Well-formed topic filter whose subscriptions changed
+        /// \return Number of invalidated topics
+        auto invalidate( std::string_view topic_filter ) -> std::size_t;
+
+        /// \brief Maximum number of cached topics.
+        [[nodiscard]] auto capacity( ) const -> std::size_t
+        {
+            return capacity_;
+        }
+
+        /// \brief Number of currently cached topics.
+        [[nodiscard]] auto size( ) const -> std::size_t
+        {
+            return index_.size( );
+        }
+
+        /// \brief This cache's statistics, accumulated since it has been created.
+        [[nodiscard]] auto stats( ) const -> const statistics&
+        {
+            return stats_;
+        }
+
+       private:
+        struct entry final
+        {
+            protocol::topic_name topic;
+            subscribers_t subscribers;
+        };  // struct entry
+
+        using entries_t = std::list<entry>;
+
+       private:
+        auto erase( entries_t::iterator pos ) -> void;
+
+       private:
+        const std::size_t capacity_;
+        /// Cached topics, most recently used first
+        entries_t entries_{};
+        /// Cached topics, indexed by topic
+        std::unordered_map<protocol::topic_name, entries_t::iterator> index_{};
+        statistics stats_{};
+    };  // class resolved_subscriber_cache
+}  // namespace io_wally::dispatch
@@ -2,74 +2,428 @@
 
 #include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cstdint>
 #include <memory>
 #include <string>
-#include <unordered_map>
+#include <string_view>
 #include <vector>
 
+#include <spdlog/spdlog.h>
+
+#include "io_wally/context.hpp"
+#include "io_wally/persistence/retained_store.hpp"
 #include "io_wally/protocol/publish_packet.hpp"
 #include "io_wally/protocol/subscribe_packet.hpp"
 #include "io_wally/protocol/subscription.hpp"
-
-#include "io_wally/dispatch/common.hpp"
+#include "io_wally/protocol/topic_name.hpp"
 
 namespace io_wally::dispatch
 {
+    namespace
+    {
+        constexpr std::size_t END_OF_FILTER = std::string_view::npos;
+
+        constexpr const char* LEAST_RECENTLY_USED = "lru";
+
+        constexpr const char* OLDEST = "oldest";
+
+        auto wall_clock_time_of( const retained_messages::clock::time_point time )
+            -> persistence::retained_store::clock::time_point
+        {
+            return persistence::retained_store::clock::now( ) +
+                   std::chrono::duration_cast<persistence::retained_store::clock::duration>(
+                       time - retained_messages::clock::now( ) );
+        }
+    }  // namespace
+
     // ------------------------------------------------------------------------------------------------------------
     // Public
     // ------------------------------------------------------------------------------------------------------------
 
-    void retained_messages::retain( const std::shared_ptr<protocol::publish>& incoming_publish )
+    retained_messages::retained_messages( const context& context )
+        : max_footprint_{context[io_wally::context::RETAIN_MAX_BYTES].as<std::size_t>( )},
+          eviction_policy_{context[io_wally::context::RETAIN_EVICTION].as<std::string>( ) == OLDEST
+                               ? eviction_policy::oldest
+                               : eviction_policy::least_recently_used},
+          ttl_{std::chrono::seconds{context[io_wally::context::RETAIN_TTL].as<std::uint32_t>( )}},
+          logger_{context.logger_factory( ).logger( "retained-messages" )}
+    {
+        const auto policy = context[io_wally::context::RETAIN_EVICTION].as<std::string>( );
+        if ( ( policy != LEAST_RECENTLY_USED ) && ( policy != OLDEST ) )
+            logger_->warn( "Unsupported eviction policy \"{}\" will be replaced with \"{}\"", policy,
+                           LEAST_RECENTLY_USED );
+        allocate( );
+
+        const auto store_dir = context[io_wally::context::RETAIN_STORE_DIR].as<std::string>( );
+        if ( !store_dir.empty( ) )
+        {
+            // Do not record what we load, nor what we remove while loading
+            auto store = std::make_unique<persistence::retained_store>( store_dir, context.logger_factory( ) );
+            const auto started = clock::now( );
+            const auto wall_clock_started = persistence::retained_store::clock::now( );
+            const auto records = store->load(
+                [this, started, wall_clock_started]( auto message, const auto retained_at ) {
+                    insert( std::move( message ),
+                            started - std::chrono::duration_cast<clock::duration>( wall_clock_started - retained_at ) );
+                },
+                [this]( const auto& topic ) { erase( topic ); } );
+            logger_->info( "LOADED: [{}] retained message(s) from [{}] record(s) in {} in [{}] ms", size_, records,
+                           store_dir,
+                           std::chrono::duration_cast<std::chrono::milliseconds>( clock::now( ) - started ).count( ) );
+
+            store_ = std::move( store );
+            expire( clock::now( ) );
+            evict( );
+        }
+    }
+
+    void retained_messages::retain( const std::shared_ptr<protocol::publish>& incoming_publish,
+                                    const clock::time_point now )
     {
         assert( incoming_publish->retain( ) );
 
+        expire( now );
+        const auto& topic = incoming_publish->topic( );
         // A PUBLISH with retained flag set and application message size 0 REMOVES any retained PUBLISH
         // previously stored under that topic.
         // See: http://docs.oasis-open.org/mqtt/mqtt/v3.1.1/os/mqtt-v3.1.1-os.html#_Toc398718038
-        if ( incoming_publish->application_message( ).size( ) > 0 )
+        auto remove = incoming_publish->application_message( ).size( ) == 0;
+        if ( !remove && ( max_footprint_ > 0 ) && ( footprint_of( *incoming_publish ) > max_footprint_ ) )
         {
-            messages_[incoming_publish->topic( )] = incoming_publish;
+            // Still, it replaces whatever has been retained for its topic before
+            logger_->warn( "Message on topic [{}] too large to retain: {} > {} bytes", topic.name( ),
+                           footprint_of( *incoming_publish ), max_footprint_ );
+            ++evicted_count_;
+            remove = true;
+        }
+
+        if ( !remove )
+        {
+            const auto compacted = compact( *incoming_publish );
+            insert( compacted, now );
+            if ( store_ )
+                store_->retain( *compacted, wall_clock_time_of( now ) );
+            evict( );
         }
         else
         {
-            messages_.erase( incoming_publish->topic( ) );
+            erase( topic );
         }
+        compact_store( );
     }
 
-    auto retained_messages::messages_for( const std::shared_ptr<protocol::subscribe>& incoming_subscribe ) const
+    auto retained_messages::messages_for( const std::shared_ptr<protocol::subscribe>& incoming_subscribe,
+                                          const clock::time_point now )
         -> std::vector<retained_messages::resolved_publish_t>
     {
-        auto resolved_publishes = std::vector<retained_messages::resolved_publish_t>{};
-        for ( const auto& topic_publish : messages_ )
-        {
-            for ( const auto& subscr : incoming_subscribe->subscriptions( ) )
-            {
-                if ( !topic_filter_matches_topic( subscr.topic_filter( ), topic_publish.first ) )
-                    continue;
-
-                const auto& seen_resolved_publish =
-                    std::find_if( resolved_publishes.begin( ), resolved_publishes.end( ),
-                                  [&topic_publish]( const resolved_publish_t& res_publish ) {
-                                      return res_publish.first == topic_publish.second;
-                                  } );
-                if ( seen_resolved_publish != resolved_publishes.end( ) )
-                {
-                    const auto seen_qos = seen_resolved_publish->second;
-                    if ( subscr.maximum_qos( ) > seen_qos )
-                        seen_resolved_publish->second = subscr.maximum_qos( );
-                }
-                else
-                {
-                    resolved_publishes.emplace_back( topic_publish.second, subscr.maximum_qos( ) );
-                }
-            }
+        expire( now );
+        if ( ++resolve_epoch_ == 0 )
+        {
+            // Epoch wrapped around: forget all stamps, lest we mistake an ancient stamp for a current one
+            for ( auto& current : nodes_ )
+                current.resolve_epoch = 0;
+            resolve_epoch_ = 1;
         }
 
+        auto resolved_publishes = std::vector<retained_messages::resolved_publish_t>{};
+        for ( const auto& subscr : incoming_subscribe->subscriptions( ) )
+            match_node( ROOT, subscr.topic_filter( ), 0, subscr.maximum_qos( ), resolved_publishes );
+
         return resolved_publishes;
     }
 
     auto retained_messages::size( ) const -> std::size_t
     {
-        return messages_.size( );
+        return size_;
+    }
+
+    // ------------------------------------------------------------------------------------------------------------
+    // Private
+    // ------------------------------------------------------------------------------------------------------------
+
+    auto retained_messages::match_node( const node_index index,
+                                        const std::string_view topic_filter,
+                                        const std::size_t pos,
+                                        const protocol::packet::QoS maximum_qos,
+                                        std::vector<resolved_publish_t>& resolved ) -> void
+    {
+        if ( pos == END_OF_FILTER )
+        {
+            resolve( index, maximum_qos, resolved );
+            return;
+        }
+
+        const auto level_end = topic_filter.find( '/', pos );
+        const auto level = topic_filter.substr( pos, level_end == END_OF_FILTER ? END_OF_FILTER : level_end - pos );
+        const auto next = level_end == END_OF_FILTER ? END_OF_FILTER : level_end + 1;
+        if ( level == "#" )
+        {
+            // '#' also matches its parent level (MQTT 3.1.1, section 4.7.1.2). Our root does not represent any
+            // topic level, and never holds a message.
+            resolve_subtree( index, maximum_qos, resolved );
+        }
+        else if ( level == "+" )
+        {
+            for ( const auto& child : nodes_[index].children )
+                match_node( child.child, topic_filter, next, maximum_qos, resolved );
+        }
+        else
+        {
+            const auto child = find_child( nodes_[index], level, protocol::topic_name::hash_level( level ) );
+            if ( child != NO_NODE )
+                match_node( child, topic_filter, next, maximum_qos, resolved );
+        }
+    }
+
+    auto retained_messages::resolve_subtree( const node_index index,
+                                             const protocol::packet::QoS maximum_qos,
+                                             std::vector<resolved_publish_t>& resolved ) -> void
+    {
+        // Subtrees may be large and deep: walk them without recursing
+        auto pending = std::vector<node_index>{index};
+        while ( !pending.empty( ) )
+        {
+            const auto current = pending.back( );
+            pending.pop_back( );
+            resolve( current, maximum_qos, resolved );
+            for ( const auto& child : nodes_[current].children )
+                pending.push_back( child.child );
+        }
+    }
+
+    auto retained_messages::resolve( const node_index index,
+                                     const protocol::packet::QoS maximum_qos,
+                                     std::vector<resolved_publish_t>& resolved ) -> void
+    {
+        auto& matching = nodes_[index];
+        if ( !matching.message )
+            return;
+        // A PUBLISH matching several topic filters is delivered only once, using the maximum QoS of all those
+        // subscriptions
+        if ( matching.resolve_epoch != resolve_epoch_ )
+        {
+            matching.resolve_epoch = resolve_epoch_;
+            matching.resolve_position = static_cast<std::uint32_t>( resolved.size( ) );
+            resolved.emplace_back( matching.message, maximum_qos );
+            unlink( by_use_, &node::by_use, index );
+            push_back( by_use_, &node::by_use, index );
+        }
+        else if ( maximum_qos > resolved[matching.resolve_position].second )
+        {
+            resolved[matching.resolve_position].second = maximum_qos;
+        }
+    }
+
+    auto retained_messages::find_child( const node& parent, const std::string_view level, const std::size_t hash ) const
+        -> node_index
+    {
+        const auto sorted_end = parent.children.begin( ) + parent.sorted_children;
+        auto it = std::lower_bound( parent.children.begin( ), sorted_end, hash,
+                                    []( const edge& e, std::size_t h ) { return e.level_hash < h; } );
+        for ( ; ( it != sorted_end ) && ( it->level_hash == hash ); ++it )
+        {
+            if ( nodes_[it->child].level == level )
+                return it->child;
+        }
+        for ( it = sorted_end; it != parent.children.end( ); ++it )
+        {
+            if ( ( it->level_hash == hash ) && ( nodes_[it->child].level == level ) )
+                return it->child;
+        }
+        return NO_NODE;
+    }
+
+    auto retained_messages::add_child( const node_index parent, const std::string_view level, const std::size_t hash )
+        -> node_index
+    {
+        const auto child = allocate( );
+        nodes_[child].level = std::string{level};
+        nodes_[child].parent = parent;
+        auto& adding_to = nodes_[parent];
+        adding_to.children.push_back( edge{hash, child} );
+        // Inserting each new child at its sorted position would cost time proportional to its number of siblings,
+        // which may run into the thousands. Instead, we merge batches of new children into their sorted siblings.
+        if ( adding_to.children.size( ) - adding_to.sorted_children > MAX_UNSORTED_CHILDREN )
+        {
+            const auto by_hash = []( const edge& lhs, const edge& rhs ) { return lhs.level_hash < rhs.level_hash; };
+            const auto sorted_end = adding_to.children.begin( ) + adding_to.sorted_children;
+            std::sort( sorted_end, adding_to.children.end( ), by_hash );
+            std::inplace_merge( adding_to.children.begin( ), sorted_end, adding_to.children.end( ), by_hash );
+            adding_to.sorted_children = static_cast<std::uint32_t>( adding_to.children.size( ) );
+        }
+
+        return child;
+    }
+
+    auto retained_messages::allocate( ) -> node_index
+    {
+        if ( !free_nodes_.empty( ) )
+        {
+            const auto index = free_nodes_.back( );
+            free_nodes_.pop_back( );
+            return index;
+        }
+        nodes_.emplace_back( );
+
+        return static_cast<node_index>( nodes_.size( ) - 1 );
+    }
+
+    auto retained_messages::insert( std::shared_ptr<protocol::publish> message, const clock::time_point retained_at )
+        -> void
+    {
+        const auto& topic = message->topic( );
+        auto current = ROOT;
+        for ( auto level = std::size_t{0}; level < topic.level_count( ); ++level )
+        {
+            auto child = find_child( nodes_[current], topic.level( level ), topic.level_hash( level ) );
+            if ( child == NO_NODE )
+                child = add_child( current, topic.level( level ), topic.level_hash( level ) );
+            current = child;
+        }
+        auto& retaining = nodes_[current];
+        if ( retaining.message )
+        {
+            footprint_ -= footprint_of( *retaining.message );
+            unlink( by_use_, &node::by_use, current );
+            unlink( by_age_, &node::by_age, current );
+        }
+        else
+        {
+            ++size_;
+        }
+        retaining.message = std::move( message );
+        retaining.retained_at = retained_at;
+        footprint_ += footprint_of( *retaining.message );
+        push_back( by_use_, &node::by_use, current );
+        push_back( by_age_, &node::by_age, current );
+    }
+
+    auto retained_messages::erase( const protocol::topic_name& topic ) -> void
+    {
+        auto current = ROOT;
+        for ( auto level = std::size_t{0}; ( level < topic.level_count( ) ) && ( current != NO_NODE ); ++level )
+            current = find_child( nodes_[current], topic.level( level ), topic.level_hash( level ) );
+        if ( ( current != NO_NODE ) && nodes_[current].message )
+            remove_message( current );
+    }
+
+    auto retained_messages::remove_message( const node_index index ) -> void
+    {
+        assert( nodes_[index].message );
+        if ( store_ )
+            store_->remove( nodes_[index].message->topic( ) );
+        footprint_ -= footprint_of( *nodes_[index].message );
+        unlink( by_use_, &node::by_use, index );
+        unlink( by_age_, &node::by_age, index );
+        nodes_[index].message.reset( );
+        --size_;
+        prune( index );
+    }
+
+    auto retained_messages::expire( const clock::time_point now ) -> void
+    {
+        if ( ttl_ == clock::duration::zero( ) )
+            return;
+        while ( ( by_age_.head != NO_NODE ) && ( nodes_[by_age_.head].retained_at + ttl_ <= now ) )
+        {
+            remove_message( by_age_.head );
+            ++expired_count_;
+        }
+    }
+
+    auto retained_messages::evict( ) -> void
+    {
+        if ( max_footprint_ == 0 )
+            return;
+        const auto& victims = ( eviction_policy_ == eviction_policy::oldest ) ? by_age_ : by_use_;
+        auto evicted = std::size_t{0};
+        while ( ( footprint_ > max_footprint_ ) && ( victims.head != NO_NODE ) )
+        {
+            remove_message( victims.head );
+            ++evicted;
+        }
+        if ( evicted > 0 )
+        {
+            evicted_count_ += evicted;
+            logger_->debug( "EVICTED: [{}] retained message(s) - [size:{}|footprint:{}]", evicted, size_, footprint_ );
+        }
+    }
+
+    auto retained_messages::compact_store( ) -> void
+    {
+        if ( !store_ || !store_->compaction_due( footprint_ ) )
+            return;
+
+        auto retained = std::vector<persistence::retained_store::entry>{};
+        retained.reserve( size_ );
+        for ( auto index = by_age_.head; index != NO_NODE; index = nodes_[index].by_age.next )
+        {
+            const auto& current = nodes_[index];
+            retained.push_back( {current.message, current.message->type_and_flags( ),
+                                 wall_clock_time_of( current.retained_at )} );
+        }
+        store_->compact( std::move( retained ) );
+    }
+
+    auto retained_messages::unlink( list& from, links node::*const member, const node_index index ) -> void
+    {
+        auto& unlinked = nodes_[index].*member;
+        if ( unlinked.prev != NO_NODE )
+            ( nodes_[unlinked.prev].*member ).next = unlinked.next;
+        else
+            from.head = unlinked.next;
+        if ( unlinked.next != NO_NODE )
+            ( nodes_[unlinked.next].*member ).prev = unlinked.prev;
+        else
+            from.tail = unlinked.prev;
+        unlinked = links{};
+    }
+
+    auto retained_messages::push_back( list& to, links node::*const member, const node_index index ) -> void
+    {
+        auto& appended = nodes_[index].*member;
+        appended.prev = to.tail;
+        appended.next = NO_NODE;
+        if ( to.tail != NO_NODE )
+            ( nodes_[to.tail].*member ).next = index;
+        else
+            to.head = index;
+        to.tail = index;
+    }
+
+    auto retained_messages::prune( node_index index ) -> void
+    {
+        while ( ( index != ROOT ) && !nodes_[index].message && nodes_[index].children.empty( ) )
+        {
+            const auto parent = nodes_[index].parent;
+            auto& siblings = nodes_[parent].children;
+            const auto pos = std::find_if( siblings.begin( ), siblings.end( ),
+                                           [index]( const edge& e ) { return e.child == index; } );
+            if ( pos - siblings.begin( ) < nodes_[parent].sorted_children )
+                --nodes_[parent].sorted_children;
+            siblings.erase( pos );
+            nodes_[index] = node{};
+            free_nodes_.push_back( index );
+            index = parent;
+        }
+    }
+
+    // ------------------------------------------------------------------------------------------------------------
+    // Private/static
+    // ------------------------------------------------------------------------------------------------------------
+
+    auto retained_messages::footprint_of( const protocol::publish& message ) -> std::size_t
+    {
+        return message.topic( ).name( ).size( ) + message.application_message( ).size( ) + MESSAGE_OVERHEAD;
+    }
+
+    auto retained_messages::compact( const protocol::publish& message ) -> std::shared_ptr<protocol::publish>
+    {
+        // Subscribers receive our application message by reference (see encoder::encode_publish_parts), so copying it
+        // once now spares us pinning the receive buffer it may still reference for as long as it is retained.
+        return std::make_shared<protocol::publish>( message.type_and_flags( ), message.remaining_length( ),
+                                                    message.topic( ), message.packet_identifier( ),
+                                                    message.application_message( ).to_vector( ) );
     }
 }  // namespace io_wally::dispatch
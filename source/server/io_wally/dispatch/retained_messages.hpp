@@ -1,16 +1,46 @@
 #pragma once
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
 #include <memory>
 #include <string>
-#include <unordered_map>
+#include <string_view>
 #include <utility>
 #include <vector>
 
+#include <spdlog/spdlog.h>
+
+#include "io_wally/context.hpp"
+#include "io_wally/persistence/retained_store.hpp"
 #include "io_wally/protocol/publish_packet.hpp"
 #include "io_wally/protocol/subscribe_packet.hpp"
+#include "io_wally/protocol/topic_name.hpp"
 
 namespace io_wally::dispatch
 {
+    /// \brief Store for retained PUBLISH packets, organized as a tree of topic levels.
+    ///
+    /// Every node in this tree represents a single topic level, and holds the PUBLISH retained for the topic ending
+    /// in that level, if any. Children are kept in a vector mostly sorted by level hash. All nodes live in one contiguous
+    /// vector and reference each other by index.
+    ///
+    /// Resolving the retained messages matching a SUBSCRIBE thus only visits those nodes its topic filters match:
+    /// looking up a topic filter without wildcards costs time proportional to its number of topic levels, and a
+    /// topic filter ending in '#' only walks the subtree below its last literal level.
+    ///
+    /// Retained messages are stored in compact form, their application message copied into a buffer of its own,
+    /// exactly as large as needed. Thus, a retained message never keeps alive the (much larger) receive buffer it has
+    /// been decoded from, and its share of our \c footprint may be accounted for accurately. Once our \c footprint
+    /// exceeds \c context::RETAIN_MAX_BYTES, messages are evicted according to \c context::RETAIN_EVICTION: least
+    /// recently delivered to a subscriber, or least recently retained, first. Messages retained longer than \c
+    /// context::RETAIN_TTL seconds expire.
+    ///
+    /// Given a \c context::RETAIN_STORE_DIR, all changes are recorded in a \c persistence::retained_store, from which
+    /// we load all retained messages on startup.
+    ///
+    /// NOTE: This class is not thread safe.
     class retained_messages final
     {
        public:  // static
@@ -24,8 +54,22 @@ namespace io_wally::dispatch
         ///
         using resolved_publish_t = std::pair<const std::shared_ptr<protocol::publish>, protocol::packet::QoS>;
 
+        using clock = std::chrono::steady_clock;
+
+        /// Which retained messages to evict first once we exceed our memory budget
+        enum class eviction_policy : std::uint8_t
+        {
+            /// Evict retained message least recently delivered to a subscriber
+            least_recently_used = 0,
+            /// Evict retained message least recently retained
+            oldest
+        };
+
+        /// Estimated number of bytes a retained message needs besides its topic and application message
+        static constexpr std::size_t MESSAGE_OVERHEAD = 256;
+
        public:
-        retained_messages( ) = default;
+        explicit retained_messages( const context& context );
 
         retained_messages( const retained_messages& ) = delete;
 
@@ -35,14 +79,161 @@ namespace io_wally::dispatch
 
         auto operator=( retained_messages && ) -> retained_messages& = delete;
 
-        void retain( const std::shared_ptr<protocol::publish>& incoming_publish );
+        /// \brief Retain \c incoming_publish, replacing any message retained for its topic, or remove the message
+        /// retained for its topic if \c incoming_publish's application message is empty.
+        ///
+        /// \param incoming_publish PUBLISH with RETAIN flag set
+        /// \param now Current time
+        void retain( const std::shared_ptr<protocol::publish>& incoming_publish,
+                     clock::time_point now = clock::now( ) );
 
-        auto messages_for( const std::shared_ptr<protocol::subscribe>& incoming_subscribe ) const
-            -> std::vector<resolved_publish_t>;
+        /// \brief Resolve all retained messages matching one of \c incoming_subscribe's topic filters.
+        ///
+        /// \param incoming_subscribe SUBSCRIBE packet
+        /// \param now Current time
+        /// \return Retained messages not yet expired, each paired with maximum QoS of all matching subscriptions
+        auto messages_for( const std::shared_ptr<protocol::subscribe>& incoming_subscribe,
+                           clock::time_point now = clock::now( ) ) -> std::vector<resolved_publish_t>;
 
         auto size( ) const -> std::size_t;
 
+        /// \brief Number of bytes all retained messages use, including \c MESSAGE_OVERHEAD for each.
+        [[nodiscard]] auto footprint( ) const -> std::size_t
+        {
+            return footprint_;
+        }
+
+        /// \brief Number of retained messages evicted to stay within our memory budget so far.
+        [[nodiscard]] auto evicted_count( ) const -> std::uint64_t
+        {
+            return evicted_count_;
+        }
+
+        /// \brief Number of retained messages that expired so far.
+        [[nodiscard]] auto expired_count( ) const -> std::uint64_t
+        {
+            return expired_count_;
+        }
+
+        /// \brief Number of nodes currently in use, root node included.
+        [[nodiscard]] auto node_count( ) const -> std::size_t
+        {
+            return nodes_.size( ) - free_nodes_.size( );
+        }
+
+       private:
+        using node_index = std::uint32_t;
+
+        static constexpr node_index ROOT = 0;
+
+        static constexpr node_index NO_NODE = std::numeric_limits<node_index>::max( );
+
+        /// Maximum number of children not yet merged into their sorted siblings
+        static constexpr std::size_t MAX_UNSORTED_CHILDREN = 16;
+
+        struct edge final
+        {
+            std::size_t level_hash;
+            node_index child;
+        };  // struct edge
+
+        /// Links of a node in one of our doubly linked lists of nodes holding a retained message
+        struct links final
+        {
+            node_index prev{NO_NODE};
+            node_index next{NO_NODE};
+        };  // struct links
+
+        struct list final
+        {
+            node_index head{NO_NODE};
+            node_index tail{NO_NODE};
+        };  // struct list
+
+        struct node final
+        {
+            /// Topic level represented by this node
+            std::string level{};
+            node_index parent{NO_NODE};
+            /// Children, the first \c sorted_children sorted by hash of their level, the rest in order of creation
+            std::vector<edge> children{};
+            std::uint32_t sorted_children{0};
+            /// PUBLISH retained for the topic ending in this node, if any
+            std::shared_ptr<protocol::publish> message{};
+            /// When message has been retained
+            clock::time_point retained_at{};
+            /// Position in list of nodes ordered by last delivery
+            links by_use{};
+            /// Position in list of nodes ordered by retained_at
+            links by_age{};
+            /// Marks this node's message as already resolved for the SUBSCRIBE identified by \c resolve_epoch
+            std::uint32_t resolve_epoch{0};
+            /// Position of this node's message in the list of resolved messages
+            std::uint32_t resolve_position{0};
+        };  // struct node
+
+       private:
+        auto match_node( node_index index,
+                         std::string_view topic_filter,
+                         std::size_t pos,
+                         protocol::packet::QoS maximum_qos,
+                         std::vector<resolved_publish_t>& resolved ) -> void;
+
+        auto resolve_subtree( node_index index,
+                              protocol::packet::QoS maximum_qos,
+                              std::vector<resolved_publish_t>& resolved ) -> void;
+
+        auto resolve( node_index index, protocol::packet::QoS maximum_qos, std::vector<resolved_publish_t>& resolved )
+            -> void;
+
+        auto insert( std::shared_ptr<protocol::publish> message, clock::time_point retained_at ) -> void;
+
+        auto erase( const protocol::topic_name& topic ) -> void;
+
+        auto remove_message( node_index index ) -> void;
+
+        auto expire( clock::time_point now ) -> void;
+
+        auto evict( ) -> void;
+
+        auto compact_store( ) -> void;
+
+        auto unlink( list& from, links node::*member, node_index index ) -> void;
+
+        auto push_back( list& to, links node::*member, node_index index ) -> void;
+
+        static auto footprint_of( const protocol::publish& message ) -> std::size_t;
+
+        static auto compact( const protocol::publish& message ) -> std::shared_ptr<protocol::publish>;
+
+        [[nodiscard]] auto find_child( const node& parent, std::string_view level, std::size_t hash ) const
+            -> node_index;
+
+        auto add_child( node_index parent, std::string_view level, std::size_t hash ) -> node_index;
+
+        auto allocate( ) -> node_index;
+
+        auto prune( node_index index ) -> void;
+
        private:
-        std::unordered_map<std::string, std::shared_ptr<protocol::publish>> messages_{};
+        std::vector<node> nodes_{};
+        std::vector<node_index> free_nodes_{};
+        std::size_t size_{0};
+        /// Incremented for each resolved SUBSCRIBE
+        std::uint32_t resolve_epoch_{0};
+        /// Nodes holding a retained message, least recently delivered first
+        list by_use_{};
+        /// Nodes holding a retained message, least recently retained first
+        list by_age_{};
+        const std::size_t max_footprint_;
+        const eviction_policy eviction_policy_;
+        const clock::duration ttl_;
+        std::size_t footprint_{0};
+        std::uint64_t evicted_count_{0};
+        std::uint64_t expired_count_{0};
+        /// Our logger
+        std::unique_ptr<spdlog::logger> logger_;
+        /// Where we record all changes, if anywhere
+        std::unique_ptr<persistence::retained_store> store_{};
     };  // class retained_messages
 }  // namespace io_wally::dispatch
@@ -55,8 +55,8 @@ namespace io_wally::dispatch
         {
             if ( const auto locked_sender = sender_.lock( ) )
             {
-                const auto puback = std::make_shared<protocol::puback>( incoming_publish->packet_identifier( ) );
-                locked_sender->send( puback );
+                locked_sender->send_publish_ack( protocol::packet::Type::PUBACK,
+                                                 incoming_publish->packet_identifier( ) );
             }
         }
         else if ( incoming_publish->qos( ) == protocol::packet::QoS::EXACTLY_ONCE )
@@ -97,6 +97,16 @@ namespace io_wally::dispatch
         }
     }
 
+    void rx_in_flight_publications::suspend( )
+    {
+        sender_.reset( );
+    }
+
+    void rx_in_flight_publications::resume( std::weak_ptr<mqtt_packet_sender> sender )
+    {
+        sender_ = std::move( sender );
+    }
+
     // ------------------------------------------------------------------------------------------------------------
     //  Private
     // ------------------------------------------------------------------------------------------------------------
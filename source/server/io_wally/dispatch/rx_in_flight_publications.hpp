@@ -35,6 +35,13 @@ namespace io_wally::dispatch
 
         void client_sent_pubrel( const std::shared_ptr<protocol::pubrel>& pubrel );
 
+        /// \brief Stop acknowledging anything, since our client has gone offline, keeping all QoS 2 publications that
+        /// await their PUBREL.
+        void suspend( );
+
+        /// \brief Acknowledge via \c sender from now on.
+        void resume( std::weak_ptr<mqtt_packet_sender> sender );
+
        private:
         void release( const std::shared_ptr<rx_publication>& publication );
 
@@ -9,9 +9,7 @@
 #include "io_wally/dispatch/rx_in_flight_publications.hpp"
 #include "io_wally/mqtt_packet_sender.hpp"
 #include "io_wally/protocol/common.hpp"
-#include "io_wally/protocol/pubcomp_packet.hpp"
 #include "io_wally/protocol/publish_packet.hpp"
-#include "io_wally/protocol/pubrec_packet.hpp"
 #include "io_wally/protocol/pubrel_packet.hpp"
 
 namespace io_wally::dispatch
@@ -31,15 +29,14 @@ namespace io_wally::dispatch
           pubrel_timeout_ms_{parent.context( )[io_wally::context::PUB_ACK_TIMEOUT].as<std::uint32_t>( )},
           max_retries_{parent.context( )[io_wally::context::PUB_MAX_RETRIES].as<std::size_t>( )},
           strand_{parent.io_service( )},
-          retry_on_timeout_{parent.io_service( )},
+          timing_wheel_{asio::use_service<timing_wheel>( parent.io_service( ) )},
           publish_id_{publish->packet_identifier( )}
     {
     }
 
     void rx_publication::start( const std::shared_ptr<mqtt_packet_sender>& sender )
     {
-        const auto pubrec = std::make_shared<protocol::pubrec>( publish_id_ );
-        sender->send( pubrec );
+        sender->send_publish_ack( protocol::packet::Type::PUBREC, publish_id_ );
         start_pubrel_timeout( sender );
     }
 
@@ -49,11 +46,10 @@ namespace io_wally::dispatch
         assert( state_ == state::waiting_for_rel );
         assert( pubrel->packet_identifier( ) == publish_id_ );
 
-        const auto pubcomp = std::make_shared<protocol::pubcomp>( publish_id_ );
-        sender->send( pubcomp );
+        sender->send_publish_ack( protocol::packet::Type::PUBCOMP, publish_id_ );
 
         state_ = state::completed;
-        retry_on_timeout_.cancel( );
+        timing_wheel_.cancel( retry_on_timeout_ );
         // Now, this packet identifier may be re-used
         parent_.release( shared_from_this( ) );
     }
@@ -63,8 +59,7 @@ namespace io_wally::dispatch
         assert( state_ == state::waiting_for_rel );
         if ( ++retry_count_ <= max_retries_ )
         {
-            const auto pubrec = std::make_shared<protocol::pubrec>( publish_id_ );
-            sender->send( pubrec );
+            sender->send_publish_ack( protocol::packet::Type::PUBREC, publish_id_ );
             start_pubrel_timeout( sender );
         }
         else
@@ -83,16 +78,11 @@ namespace io_wally::dispatch
         // rx_in_flight_publications - may go away anytime while we wait for this timeout to expire
         const auto self_weak = std::weak_ptr<rx_publication>{shared_from_this( )};
         const auto ack_tmo = std::chrono::milliseconds{pubrel_timeout_ms_};
-        retry_on_timeout_.expires_from_now( ack_tmo );
-        retry_on_timeout_.async_wait( strand_.wrap( [self_weak, sender]( const std::error_code& ec ) {
-            if ( ec )
-            {
-                return;
-            }
+        retry_on_timeout_ = timing_wheel_.schedule( ack_tmo, [self_weak, sender]( ) {
             if ( const auto self = self_weak.lock( ) )
             {
-                self->pubrel_timeout_expired( sender );
+                self->strand_.dispatch( [self, sender]( ) { self->pubrel_timeout_expired( sender ); } );
             }
-        } ) );
+        } );
     }
 }  // namespace io_wally::dispatch
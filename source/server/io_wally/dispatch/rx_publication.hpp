@@ -5,13 +5,13 @@
 #include <memory>
 
 #include <asio.hpp>
-#include <asio/steady_timer.hpp>
 
 #include "io_wally/context.hpp"
 #include "io_wally/mqtt_packet_sender.hpp"
 #include "io_wally/protocol/common.hpp"
 #include "io_wally/protocol/publish_packet.hpp"
 #include "io_wally/protocol/pubrel_packet.hpp"
+#include "io_wally/timing_wheel.hpp"
 
 namespace io_wally::dispatch
 {
@@ -52,7 +52,8 @@ namespace io_wally::dispatch
         const std::uint32_t pubrel_timeout_ms_;
         const std::size_t max_retries_;
         asio::io_service::strand strand_;
-        asio::steady_timer retry_on_timeout_;
+        timing_wheel& timing_wheel_;
+        timing_wheel::timer_id retry_on_timeout_{};
         const std::uint16_t publish_id_;
         std::uint16_t retry_count_{0};
     };  // class rx_publication
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+#include "io_wally/dispatch/mqtt_client_session.hpp"
+
+namespace io_wally::dispatch
+{
+    /// \brief Binds an \c mqtt_connection to the \c mqtt_client_session created for it.
+    ///
+    /// Created by an \c mqtt_connection upon receiving CONNECT and handed to \c dispatcher with every subsequent
+    /// packet. \c dispatcher fills in \c session once that session exists, so that later packets go straight to their
+    /// session without looking it up. Holds a \c std::weak_ptr since sessions are owned by \c
+    /// mqtt_client_session_manager, which may destroy them at any time, e.g. when a client with the same client id
+    /// connects.
+    ///
+    /// \c dispatcher also records which of its shards its connection's client belongs to, so that later packets are
+    /// handed to that shard without hashing their client id again.
+    ///
+    /// NOTE: \c session is only ever accessed on its shard's thread, \c shard only ever by its connection.
+    struct session_binding final
+    {
+        std::weak_ptr<mqtt_client_session> session{};
+        std::size_t shard{0};
+    };  // struct session_binding
+}  // namespace io_wally::dispatch
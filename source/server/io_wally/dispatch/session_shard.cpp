@@ -0,0 +1,118 @@
+#include "io_wally/dispatch/session_shard.hpp"
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <asio.hpp>
+
+#include <spdlog/spdlog.h>
+
+#include "io_wally/context.hpp"
+#include "io_wally/dispatch/mqtt_client_session_manager.hpp"
+#include "io_wally/protocol/publish_packet.hpp"
+
+namespace io_wally::dispatch
+{
+    // ------------------------------------------------------------------------------------------------------------
+    // Public
+    // ------------------------------------------------------------------------------------------------------------
+
+    session_shard::session_shard( const io_wally::context& context,
+                                  asio::io_service& io_service,
+                                  const std::size_t index,
+                                  const std::size_t shard_count,
+                                  const std::vector<std::unique_ptr<session_shard>>& shards,
+                                  std::shared_ptr<shared_retained_messages> retained_messages )
+        : io_service_{io_service},
+          index_{index},
+          shards_{shards},
+          logger_{context.logger_factory( ).logger( "session-shard/" + std::to_string( index ) )},
+          session_manager_{context, io_service, link( index, shard_count, std::move( retained_messages ) )}
+    {
+        outbox_.reserve( MAX_BATCH_SIZE );
+    }
+
+    auto session_shard::index_of( const std::string& client_id, const std::size_t shard_count ) -> std::size_t
+    {
+        return std::hash<std::string>{}( client_id ) % shard_count;
+    }
+
+    // ------------------------------------------------------------------------------------------------------------
+    // Private
+    // ------------------------------------------------------------------------------------------------------------
+
+    auto session_shard::link( const std::size_t index,
+                              const std::size_t shard_count,
+                              std::shared_ptr<shared_retained_messages> retained_messages ) -> shard_link
+    {
+        auto link = shard_link{index, std::move( retained_messages ), {}};
+        if ( shard_count > 1 )
+            link.forward = [this]( const std::shared_ptr<protocol::publish>& incoming_publish ) {
+                forward( incoming_publish );
+            };
+
+        return link;
+    }
+
+    void session_shard::forward( const std::shared_ptr<protocol::publish>& incoming_publish )
+    {
+        outbox_.push_back( incoming_publish );
+        if ( outbox_.size( ) >= MAX_BATCH_SIZE )
+        {
+            flush( );
+        }
+        else if ( !flush_scheduled_ )
+        {
+            // Runs once everything queued on our io_service so far has been processed, collecting all PUBLISH
+            // packets received in the meantime
+            flush_scheduled_ = true;
+            io_service_.post( [this]( ) {
+                flush_scheduled_ = false;
+                flush( );
+            } );
+        }
+    }
+
+    void session_shard::flush( )
+    {
+        if ( outbox_.empty( ) )
+            return;
+
+        const auto flushed = std::make_shared<const batch>( std::move( outbox_ ) );
+        outbox_ = batch{};
+        outbox_.reserve( MAX_BATCH_SIZE );
+        for ( const auto& shard : shards_ )
+        {
+            if ( shard.get( ) != this )
+                shard->receive( flushed );
+        }
+        logger_->trace( "Forwarded [{}] PUBLISH packet(s) to [{}] shard(s)", flushed->size( ), shards_.size( ) - 1 );
+    }
+
+    void session_shard::receive( const std::shared_ptr<const batch>& received )
+    {
+        inbox_.push( received );
+        if ( !drain_scheduled_.exchange( true ) )
+            io_service_.post( [this]( ) { drain( ); } );
+    }
+
+    void session_shard::drain( )
+    {
+        // Reset before draining: a batch pushed while we drain either is drained by us, or wakes us once more
+        drain_scheduled_.store( false );
+        while ( const auto received = inbox_.pop( ) )
+        {
+            ++received_batches_;
+            for ( const auto& incoming_publish : **received )
+            {
+                // Deliver a copy of our own: all shards share received, and delivering may alter its QoS
+                session_manager_.deliver(
+                    incoming_publish->with_new_packet_identifier( incoming_publish->packet_identifier( ) ) );
+            }
+        }
+    }
+}  // namespace io_wally::dispatch
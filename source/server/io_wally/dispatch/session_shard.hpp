@@ -0,0 +1,128 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <asio.hpp>
+
+#include <spdlog/spdlog.h>
+
+#include "io_wally/concurrency/mpsc_queue.hpp"
+#include "io_wally/context.hpp"
+#include "io_wally/dispatch/mqtt_client_session_manager.hpp"
+#include "io_wally/protocol/publish_packet.hpp"
+
+namespace io_wally::dispatch
+{
+    /// \brief One shard of all client sessions, confined to a thread of its own.
+    ///
+    /// Clients are assigned to a shard by hashing their client id, so that a client always returns to the same shard
+    /// and its persistent session. Each shard owns an \c mqtt_client_session_manager managing its clients' sessions
+    /// and subscriptions, used on its own thread only.
+    ///
+    /// A PUBLISH received by a shard is delivered to that shard's subscribers right away. All other shards receive it
+    /// in batches: a shard collects the PUBLISH packets it receives while processing whatever is queued on its \c
+    /// io_service, and then hands each other shard a single batch containing all of them. Each shard receives those
+    /// batches on an \c concurrency::mpsc_queue, so that handing over a batch never blocks, and is woken at most once
+    /// while batches are waiting for it.
+    ///
+    /// Since all PUBLISH packets sent by one client are received by the same shard, and batches are handed over in
+    /// order through FIFO queues, each shard delivers PUBLISH packets sent by the same client in the order that client
+    /// sent them.
+    class session_shard final
+    {
+       public:
+        /// A shard hands all other shards a batch once it contains this many PUBLISH packets
+        static constexpr std::size_t MAX_BATCH_SIZE = 256;
+
+       public:
+        /// \brief Create shard number \c index out of \c shard_count \c shards.
+        ///
+        /// A single shard forwards nothing, and keeps its files directly in any configured spill and write-ahead log
+        /// directory.
+        ///
+        /// \param context           Our configuration context
+        /// \param io_service        The \c io_service this shard is confined to
+        /// \param index             This shard's index in \c shards
+        /// \param shard_count       Number of shards
+        /// \param shards            All shards, filled in by our owner before any packet is dispatched
+        /// \param retained_messages Retained messages shared by all shards
+        session_shard( const io_wally::context& context,
+                       asio::io_service& io_service,
+                       std::size_t index,
+                       std::size_t shard_count,
+                       const std::vector<std::unique_ptr<session_shard>>& shards,
+                       std::shared_ptr<shared_retained_messages> retained_messages );
+
+        session_shard( const session_shard& ) = delete;
+
+        auto operator=( const session_shard& ) -> session_shard& = delete;
+
+        /// \brief Index of shard client \c client_id belongs to, given \c shard_count shards.
+        [[nodiscard]] static auto index_of( const std::string& client_id, std::size_t shard_count ) -> std::size_t;
+
+        /// \brief This shard's index.
+        [[nodiscard]] auto index( ) const -> std::size_t
+        {
+            return index_;
+        }
+
+        /// \brief The \c io_service this shard is confined to.
+        [[nodiscard]] auto io_service( ) const -> asio::io_service&
+        {
+            return io_service_;
+        }
+
+        /// \brief This shard's session manager, only to be used on this shard's thread.
+        [[nodiscard]] auto session_manager( ) -> mqtt_client_session_manager&
+        {
+            return session_manager_;
+        }
+
+        /// \brief Number of batches this shard has received from other shards so far.
+        [[nodiscard]] auto received_batches( ) const -> std::uint64_t
+        {
+            return received_batches_.load( );
+        }
+
+       private:
+        using batch = std::vector<std::shared_ptr<protocol::publish>>;
+
+       private:
+        /// Our session manager's link to all other shards, if any
+        auto link( std::size_t index,
+                   std::size_t shard_count,
+                   std::shared_ptr<shared_retained_messages> retained_messages ) -> shard_link;
+
+        /// On our thread: add \c incoming_publish to the batch for all other shards
+        void forward( const std::shared_ptr<protocol::publish>& incoming_publish );
+
+        /// On our thread: hand our current batch to all other shards
+        void flush( );
+
+        /// On any thread: queue \c received for delivery to our subscribers, and wake us unless already woken
+        void receive( const std::shared_ptr<const batch>& received );
+
+        /// On our thread: deliver all batches received so far to our subscribers
+        void drain( );
+
+       private:
+        asio::io_service& io_service_;
+        const std::size_t index_;
+        const std::vector<std::unique_ptr<session_shard>>& shards_;
+        /// PUBLISH packets to hand to all other shards, collected on our thread
+        batch outbox_{};
+        bool flush_scheduled_{false};
+        /// Batches received from other shards
+        concurrency::mpsc_queue<std::shared_ptr<const batch>> inbox_{};
+        std::atomic<bool> drain_scheduled_{false};
+        std::atomic<std::uint64_t> received_batches_{0};
+        std::unique_ptr<spdlog::logger> logger_;
+        /// Declared last, so that the state it forwards to is still alive while it is being destroyed
+        mqtt_client_session_manager session_manager_;
+    };  // class session_shard
+}  // namespace io_wally::dispatch
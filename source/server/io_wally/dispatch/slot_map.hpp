@@ -0,0 +1,151 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+namespace io_wally::dispatch
+{
+    /// \brief Handle referring to a value stored in a \c slot_map.
+    ///
+    /// A handle is a dense index into its \c slot_map's slots, plus that slot's generation at the time the value was
+    /// inserted. Once that value is erased the slot's generation changes, and all outstanding handles to it become
+    /// stale instead of referring to whichever value reuses that slot. A default constructed handle refers to nothing.
+    struct slot_handle final
+    {
+        static constexpr std::uint32_t NO_INDEX = std::numeric_limits<std::uint32_t>::max( );
+
+        std::uint32_t index{NO_INDEX};
+        std::uint32_t generation{0};
+
+        [[nodiscard]] auto valid( ) const -> bool
+        {
+            return index != NO_INDEX;
+        }
+
+        friend auto operator==( const slot_handle& lhs, const slot_handle& rhs ) -> bool
+        {
+            return ( lhs.index == rhs.index ) && ( lhs.generation == rhs.generation );
+        }
+
+        friend auto operator!=( const slot_handle& lhs, const slot_handle& rhs ) -> bool
+        {
+            return !( lhs == rhs );
+        }
+
+        friend auto operator<<( std::ostream& output, const slot_handle& handle ) -> std::ostream&
+        {
+            return output << handle.index << "." << handle.generation;
+        }
+    };  // struct slot_handle
+
+    /// \brief Values stored in a contiguous vector, addressed by \c slot_handle.
+    ///
+    /// Inserting, erasing and looking up a value all take constant time, without hashing or comparing keys. Erased
+    /// slots are reused, so slot indices stay dense and may be used to index side tables.
+    ///
+    /// NOTE: This class is not thread safe.
+    template <typename T>
+    class slot_map final
+    {
+       public:
+        /// \brief Store \c value in a free slot.
+        ///
+        /// \param value Value to store
+        /// \return Handle referring to stored value
+        auto insert( T value ) -> slot_handle
+        {
+            auto index = slot_handle::NO_INDEX;
+            if ( !free_slots_.empty( ) )
+            {
+                index = free_slots_.back( );
+                free_slots_.pop_back( );
+            }
+            else
+            {
+                index = static_cast<std::uint32_t>( slots_.size( ) );
+                slots_.emplace_back( );
+            }
+            auto& slt = slots_[index];
+            slt.value = std::move( value );
+            slt.occupied = true;
+            ++size_;
+
+            return slot_handle{index, slt.generation};
+        }
+
+        /// \brief Erase value referred to by \c handle, unless \c handle is stale.
+        ///
+        /// \param handle Handle referring to value to erase
+        /// \return \c true if a value was erased, \c false otherwise
+        auto erase( const slot_handle& handle ) -> bool
+        {
+            if ( !get( handle ) )
+                return false;
+
+            auto& slt = slots_[handle.index];
+            slt.value = T{};
+            slt.occupied = false;
+            ++slt.generation;
+            free_slots_.push_back( handle.index );
+            --size_;
+
+            return true;
+        }
+
+        /// \brief Look up value referred to by \c handle.
+        ///
+        /// \param handle Handle to look up
+        /// \return Pointer to value, or \c nullptr if \c handle is stale
+        [[nodiscard]] auto get( const slot_handle& handle ) -> T*
+        {
+            if ( ( handle.index >= slots_.size( ) ) || !slots_[handle.index].occupied ||
+                 ( slots_[handle.index].generation != handle.generation ) )
+                return nullptr;
+            return &slots_[handle.index].value;
+        }
+
+        [[nodiscard]] auto get( const slot_handle& handle ) const -> const T*
+        {
+            return const_cast<slot_map*>( this )->get( handle );
+        }
+
+        /// \brief Erase all values, invalidating all outstanding handles.
+        void clear( )
+        {
+            for ( auto index = std::size_t{0}; index < slots_.size( ); ++index )
+            {
+                if ( slots_[index].occupied )
+                    erase( slot_handle{static_cast<std::uint32_t>( index ), slots_[index].generation} );
+            }
+        }
+
+        /// \brief Number of values currently stored.
+        [[nodiscard]] auto size( ) const -> std::size_t
+        {
+            return size_;
+        }
+
+        /// \brief Number of slots, used or not: every slot index is less than this.
+        [[nodiscard]] auto capacity( ) const -> std::size_t
+        {
+            return slots_.size( );
+        }
+
+       private:
+        struct slot final
+        {
+            T value{};
+            std::uint32_t generation{0};
+            bool occupied{false};
+        };  // struct slot
+
+       private:
+        std::vector<slot> slots_{};
+        std::vector<std::uint32_t> free_slots_{};
+        std::size_t size_{0};
+    };  // class slot_map
+}  // namespace io_wally::dispatch
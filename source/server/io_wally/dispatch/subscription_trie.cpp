@@ -0,0 +1,300 @@
+#include "io_wally/dispatch/subscription_trie.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "io_wally/protocol/common.hpp"
+#include "io_wally/protocol/topic_name.hpp"
+
+namespace io_wally::dispatch
+{
+    // --------------------------------------------------------------------------------
+    // Public
+    // --------------------------------------------------------------------------------
+
+    subscription_trie::subscription_trie( )
+    {
+        allocate( "" );
+    }
+
+    auto subscription_trie::insert( std::string_view topic_filter,
+                                    const subscriber_id_t& subscriber_id,
+                                    protocol::packet::QoS maximum_qos ) -> bool
+    {
+        auto current = ROOT;
+        auto pos = std::size_t{0};
+        auto multi_level = false;
+        while ( pos != END_OF_TOPIC )
+        {
+            const auto level_end = topic_filter.find( '/', pos );
+            const auto level = topic_filter.substr( pos, level_end == END_OF_TOPIC ? END_OF_TOPIC : level_end - pos );
+            if ( level == "#" )
+            {
+                multi_level = true;
+                break;
+            }
+            if ( level == "+" )
+            {
+                if ( nodes_[current].single_level_wildcard == NO_NODE )
+                {
+                    const auto wildcard = allocate( "+" );
+                    nodes_[current].single_level_wildcard = wildcard;
+                }
+                current = nodes_[current].single_level_wildcard;
+                pos = level_end == END_OF_TOPIC ? END_OF_TOPIC : level_end + 1;
+                continue;
+            }
+
+            // Collect run of literal levels up to next wildcard or end of topic filter: this run will become a
+            // single (compressed) node if there is no matching node yet.
+            auto run_end = level_end == END_OF_TOPIC ? topic_filter.size( ) : level_end;
+            while ( run_end < topic_filter.size( ) )
+            {
+                const auto following_end = topic_filter.find( '/', run_end + 1 );
+                const auto following = topic_filter.substr(
+                    run_end + 1, following_end == END_OF_TOPIC ? END_OF_TOPIC : following_end - run_end - 1 );
+                if ( ( following == "+" ) || ( following == "#" ) )
+                    break;
+                run_end = following_end == END_OF_TOPIC ? topic_filter.size( ) : following_end;
+            }
+            const auto run = topic_filter.substr( pos, run_end - pos );
+
+            auto consumed = std::size_t{0};
+            auto child = find_literal_child( nodes_[current], level );
+            if ( child == NO_NODE )
+            {
+                child = add_literal_child( current, std::string{run} );
+                consumed = run.size( );
+            }
+            else
+            {
+                // Determine longest common prefix of child's label and our run, measured in whole topic levels.
+                // Since both share the same first level this prefix will never be empty.
+                const auto label = std::string_view{nodes_[child].label};
+                const auto max = std::min( label.size( ), run.size( ) );
+                auto common = std::size_t{0};
+                while ( ( common < max ) && ( label[common] == run[common] ) )
+                    ++common;
+                const auto at_level_boundary = []( std::string_view str, std::size_t i ) {
+                    return ( i == str.size( ) ) || ( str[i] == '/' );
+                };
+                if ( !at_level_boundary( label, common ) || !at_level_boundary( run, common ) )
+                    common = label.rfind( '/', common - 1 );
+                if ( common < label.size( ) )
+                    split( child, common );
+                consumed = common;
+            }
+            current = child;
+            pos = ( pos + consumed == topic_filter.size( ) ) ? END_OF_TOPIC : pos + consumed + 1;
+        }
+
+        auto& subscribers =
+            multi_level ? nodes_[current].multi_level_subscribers : nodes_[current].subscribers;
+        const auto existing = std::find_if( subscribers.begin( ), subscribers.end( ),
+                                            [&subscriber_id]( const subscriber& s ) { return s.id == subscriber_id; } );
+        if ( existing != subscribers.end( ) )
+        {
+            existing->maximum_qos = maximum_qos;
+            return false;
+        }
+        subscribers.push_back( subscriber{subscriber_id, maximum_qos} );
+        ++size_;
+
+        return true;
+    }
+
+    auto subscription_trie::erase( std::string_view topic_filter, const subscriber_id_t& subscriber_id ) -> bool
+    {
+        auto path = std::vector<node_index>{ROOT};
+        auto pos = std::size_t{0};
+        auto multi_level = false;
+        while ( pos != END_OF_TOPIC )
+        {
+            const auto current = path.back( );
+            const auto level_end = topic_filter.find( '/', pos );
+            const auto level = topic_filter.substr( pos, level_end == END_OF_TOPIC ? END_OF_TOPIC : level_end - pos );
+            if ( level == "#" )
+            {
+                multi_level = true;
+                break;
+            }
+            if ( level == "+" )
+            {
+                if ( nodes_[current].single_level_wildcard == NO_NODE )
+                    return false;
+                path.push_back( nodes_[current].single_level_wildcard );
+                pos = level_end == END_OF_TOPIC ? END_OF_TOPIC : level_end + 1;
+                continue;
+            }
+
+            const auto child = find_literal_child( nodes_[current], level );
+            if ( child == NO_NODE )
+                return false;
+            const auto& label = nodes_[child].label;
+            const auto label_end = pos + label.size( );
+            if ( topic_filter.compare( pos, label.size( ), label ) != 0 )
+                return false;
+            if ( label_end == topic_filter.size( ) )
+                pos = END_OF_TOPIC;
+            else if ( topic_filter[label_end] == '/' )
+                pos = label_end + 1;
+            else
+                return false;
+            path.push_back( child );
+        }
+
+        auto& subscribers =
+            multi_level ? nodes_[path.back( )].multi_level_subscribers : nodes_[path.back( )].subscribers;
+        const auto existing = std::find_if( subscribers.begin( ), subscribers.end( ),
+                                            [&subscriber_id]( const subscriber& s ) { return s.id == subscriber_id; } );
+        if ( existing == subscribers.end( ) )
+            return false;
+        *existing = std::move( subscribers.back( ) );
+        subscribers.pop_back( );
+        --size_;
+        prune( path );
+
+        return true;
+    }
+
+    // --------------------------------------------------------------------------------
+    // Private
+    // --------------------------------------------------------------------------------
+
+    auto subscription_trie::find_literal_child( const node& parent, std::string_view level ) const -> node_index
+    {
+        return find_literal_child( parent, level, level_hash( level ) );
+    }
+
+    auto subscription_trie::find_literal_child( const node& parent,
+                                                std::string_view level,
+                                                std::size_t hash ) const -> node_index
+    {
+        auto it = std::lower_bound( parent.literal_children.begin( ), parent.literal_children.end( ), hash,
+                                    []( const edge& e, std::size_t h ) { return e.level_hash < h; } );
+        for ( ; ( it != parent.literal_children.end( ) ) && ( it->level_hash == hash ); ++it )
+        {
+            if ( first_level( nodes_[it->child].label ) == level )
+                return it->child;
+        }
+        return NO_NODE;
+    }
+
+    auto subscription_trie::add_literal_child( node_index parent, std::string label ) -> node_index
+    {
+        const auto child = allocate( std::move( label ) );
+        const auto hash = level_hash( first_level( nodes_[child].label ) );
+        auto& children = nodes_[parent].literal_children;
+        const auto it = std::upper_bound( children.begin( ), children.end( ), hash,
+                                          []( std::size_t h, const edge& e ) { return h < e.level_hash; } );
+        children.insert( it, edge{hash, child} );
+
+        return child;
+    }
+
+    auto subscription_trie::split( node_index child, std::size_t at ) -> node_index
+    {
+        assert( nodes_[child].label[at] == '/' );
+        // Move everything below the split point into a new node, so that our parent's edge to child remains valid
+        const auto lower = allocate( nodes_[child].label.substr( at + 1 ) );
+        auto& upper_node = nodes_[child];
+        auto& lower_node = nodes_[lower];
+        lower_node.literal_children = std::move( upper_node.literal_children );
+        lower_node.single_level_wildcard = upper_node.single_level_wildcard;
+        lower_node.subscribers = std::move( upper_node.subscribers );
+        lower_node.multi_level_subscribers = std::move( upper_node.multi_level_subscribers );
+
+        upper_node.label.resize( at );
+        upper_node.levels -= lower_node.levels;
+        upper_node.literal_children = {edge{level_hash( first_level( lower_node.label ) ), lower}};
+        upper_node.single_level_wildcard = NO_NODE;
+        upper_node.subscribers.clear( );
+        upper_node.multi_level_subscribers.clear( );
+
+        return child;
+    }
+
+    auto subscription_trie::allocate( std::string label ) -> node_index
+    {
+        auto index = NO_NODE;
+        if ( !free_nodes_.empty( ) )
+        {
+            index = free_nodes_.back( );
+            free_nodes_.pop_back( );
+        }
+        else
+        {
+            index = static_cast<node_index>( nodes_.size( ) );
+            nodes_.emplace_back( );
+        }
+        auto& allocated = nodes_[index];
+        allocated.label = std::move( label );
+        const auto separators = std::count( allocated.label.begin( ), allocated.label.end( ), '/' );
+        allocated.levels = static_cast<std::uint32_t>( separators ) + 1;
+
+        return index;
+    }
+
+    auto subscription_trie::release( node_index index ) -> void
+    {
+        nodes_[index] = node{};
+        free_nodes_.push_back( index );
+    }
+
+    auto subscription_trie::prune( const std::vector<node_index>& path ) -> void
+    {
+        for ( auto i = path.size( ) - 1; i > 0; --i )
+        {
+            const auto index = path[i];
+            auto& parent = nodes_[path[i - 1]];
+            auto& current = nodes_[index];
+            const auto is_wildcard = ( parent.single_level_wildcard == index );
+            if ( current.empty( ) )
+            {
+                if ( is_wildcard )
+                {
+                    parent.single_level_wildcard = NO_NODE;
+                }
+                else
+                {
+                    parent.literal_children.erase(
+                        std::find_if( parent.literal_children.begin( ), parent.literal_children.end( ),
+                                      [index]( const edge& e ) { return e.child == index; } ) );
+                }
+                release( index );
+                continue;
+            }
+
+            // Node still in use: restore path compression by merging it with its only child, if possible
+            if ( !is_wildcard && current.subscribers.empty( ) && current.multi_level_subscribers.empty( ) &&
+                 ( current.single_level_wildcard == NO_NODE ) && ( current.literal_children.size( ) == 1 ) )
+            {
+                const auto only_child = current.literal_children.front( ).child;
+                auto& merged = nodes_[only_child];
+                current.label.append( 1, '/' ).append( merged.label );
+                current.levels += merged.levels;
+                current.literal_children = std::move( merged.literal_children );
+                current.single_level_wildcard = merged.single_level_wildcard;
+                current.subscribers = std::move( merged.subscribers );
+                current.multi_level_subscribers = std::move( merged.multi_level_subscribers );
+                release( only_child );
+            }
+            break;
+        }
+    }
+
+    auto subscription_trie::first_level( std::string_view label ) -> std::string_view
+    {
+        return label.substr( 0, label.find( '/' ) );
+    }
+
+    auto subscription_trie::level_hash( std::string_view level ) -> std::size_t
+    {
+        // Must agree with protocol::topic_name's level hashes, which match( ) uses for looking up literal children
+        return protocol::topic_name::hash_level( level );
+    }
+}  // namespace io_wally::dispatch
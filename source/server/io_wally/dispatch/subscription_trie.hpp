@@ -0,0 +1,183 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "io_wally/dispatch/common.hpp"
+#include "io_wally/protocol/common.hpp"
+#include "io_wally/protocol/topic_name.hpp"
+
+namespace io_wally::dispatch
+{
+    /// \brief Index of topic filters, organized as a trie of topic levels.
+    ///
+    /// Every node in this trie represents one or more topic levels. Literal topic levels are reached via a node's
+    /// \c literal \c children, kept in a vector sorted by level hash, while the wildcards '+' and '#' occupy dedicated
+    /// slots on each node. Chains of literal levels that neither branch nor carry subscribers are collapsed into a
+    /// single node (path compression). All nodes live in one contiguous vector and reference each other by index.
+    ///
+    /// Matching a topic against this index thus costs time proportional to the number of topic levels and of matching
+    /// nodes, and no longer to the total number of subscriptions.
+    ///
+    /// NOTE: This class is not thread safe.
+    class subscription_trie final
+    {
+       public:
+        using subscriber_id_t = session_handle;
+
+        /// \brief A single subscriber registered for a topic filter.
+        struct subscriber final
+        {
+            subscriber_id_t id;
+            protocol::packet::QoS maximum_qos;
+        };  // struct subscriber
+
+       public:
+        subscription_trie( );
+
+        /// \brief Register \c subscriber_id for \c topic_filter, using \c maximum_qos.
+        ///
+        /// If \c subscriber_id is already registered for \c topic_filter its maximum QoS will be replaced (MQTT
+        /// 3.1.1, section 3.8.4).
+        ///
+        /// \param topic_filter Well-formed topic filter
+        /// \param subscriber_id ID of subscribing client
+        /// \param maximum_qos Maximum QoS requested by subscribing client
+        /// \return \c true if a new subscription was added, \c false if an existing subscription was replaced
+        auto insert( std::string_view topic_filter,
+                     const subscriber_id_t& subscriber_id,
+                     protocol::packet::QoS maximum_qos ) -> bool;
+
+        /// \brief Remove \c subscriber_id's subscription to \c topic_filter, if any.
+        ///
+        /// \param topic_filter Topic filter to cancel
+        /// \param subscriber_id ID of unsubscribing client
+        /// \return \c true if a subscription was removed, \c false otherwise
+        auto erase( std::string_view topic_filter, const subscriber_id_t& subscriber_id ) -> bool;
+
+        /// \brief Call \c visitor for each \c subscriber registered for a topic filter matching \c topic.
+        ///
+        /// A subscriber registered for several matching topic filters will be visited once per matching topic
+        /// filter. Uses \c topic's pre-computed level hashes for looking up literal children.
+        ///
+        /// \param topic Interned topic name
+        /// \param visitor Callable taking a <tt>const subscriber&</tt>
+        template <typename VISITOR>
+        auto match( const protocol::topic_name& topic, VISITOR&& visitor ) const -> void
+        {
+            match_node( ROOT, topic, 0, visitor );
+        }
+
+        /// \brief Number of subscriptions (topic filter/subscriber pairs) in this index.
+        [[nodiscard]] auto size( ) const -> std::size_t
+        {
+            return size_;
+        }
+
+        /// \brief Number of nodes currently in use, root node included.
+        [[nodiscard]] auto node_count( ) const -> std::size_t
+        {
+            return nodes_.size( ) - free_nodes_.size( );
+        }
+
+       private:
+        using node_index = std::uint32_t;
+
+        static constexpr node_index ROOT = 0;
+
+        static constexpr node_index NO_NODE = std::numeric_limits<node_index>::max( );
+
+        static constexpr std::size_t END_OF_TOPIC = std::string_view::npos;
+
+        struct edge final
+        {
+            std::size_t level_hash;
+            node_index child;
+        };  // struct edge
+
+        struct node final
+        {
+            /// One or more '/'-separated literal topic levels, or "+" for a single level wildcard node
+            std::string label{};
+            /// Number of topic levels in label
+            std::uint32_t levels{0};
+            /// Literal children, sorted by hash of their label's first level
+            std::vector<edge> literal_children{};
+            /// Child node reached via single level wildcard '+'
+            node_index single_level_wildcard{NO_NODE};
+            /// Subscribers for topic filters ending in this node
+            std::vector<subscriber> subscribers{};
+            /// Subscribers for topic filters ending in this node, followed by multi level wildcard '#'
+            std::vector<subscriber> multi_level_subscribers{};
+
+            [[nodiscard]] auto empty( ) const -> bool
+            {
+                return literal_children.empty( ) && ( single_level_wildcard == NO_NODE ) && subscribers.empty( ) &&
+                       multi_level_subscribers.empty( );
+            }
+        };  // struct node
+
+       private:
+        template <typename VISITOR>
+        auto match_node( node_index index,
+                         const protocol::topic_name& topic,
+                         std::size_t level,
+                         VISITOR& visitor ) const -> void
+        {
+            const auto& current = nodes_[index];
+            // '#' also matches its parent level (MQTT 3.1.1, section 4.7.1.2)
+            for ( const auto& subscr : current.multi_level_subscribers )
+                visitor( subscr );
+            if ( level == topic.level_count( ) )
+            {
+                for ( const auto& subscr : current.subscribers )
+                    visitor( subscr );
+                return;
+            }
+
+            if ( current.single_level_wildcard != NO_NODE )
+                match_node( current.single_level_wildcard, topic, level + 1, visitor );
+
+            const auto child = find_literal_child( current, topic.level( level ), topic.level_hash( level ) );
+            if ( child == NO_NODE )
+                return;
+            // A compressed child spans several levels: compare them all at once
+            const auto& child_node = nodes_[child];
+            const auto& name = topic.name( );
+            const auto pos = topic.level_offset( level );
+            const auto label_end = pos + child_node.label.size( );
+            if ( name.compare( pos, child_node.label.size( ), child_node.label ) != 0 )
+                return;
+            if ( ( label_end == name.size( ) ) || ( name[label_end] == '/' ) )
+                match_node( child, topic, level + child_node.levels, visitor );
+        }
+
+        [[nodiscard]] auto find_literal_child( const node& parent, std::string_view level ) const -> node_index;
+
+        [[nodiscard]] auto find_literal_child( const node& parent, std::string_view level, std::size_t hash ) const
+            -> node_index;
+
+        auto add_literal_child( node_index parent, std::string label ) -> node_index;
+
+        auto split( node_index child, std::size_t at ) -> node_index;
+
+        auto allocate( std::string label ) -> node_index;
+
+        auto release( node_index index ) -> void;
+
+        auto prune( const std::vector<node_index>& path ) -> void;
+
+        static auto first_level( std::string_view label ) -> std::string_view;
+
+        static auto level_hash( std::string_view level ) -> std::size_t;
+
+       private:
+        std::vector<node> nodes_{};
+        std::vector<node_index> free_nodes_{};
+        std::size_t size_{0};
+    };  // class subscription_trie
+}  // namespace io_wally::dispatch
@@ -2,7 +2,9 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstdint>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <spdlog/fmt/ostr.h>
@@ -24,11 +26,16 @@ namespace io_wally::dispatch
 
     subscription_container::subscription_container( std::string topic_filter,
                                                     const protocol::packet::QoS maximum_qosp,
-                                                    std::string client_id )
-        : topic_filter{std::move( topic_filter )}, maximum_qos{maximum_qosp}, client_id{std::move( client_id )}
+                                                    const session_handle subscriber )
+        : topic_filter{std::move( topic_filter )}, maximum_qos{maximum_qosp}, subscriber{subscriber}
     {
     }
 
+    auto subscription_container::matches( const protocol::topic_name& topic ) const -> bool
+    {
+        return io_wally::dispatch::topic_filter_matches_topic( topic_filter, topic );
+    }
+
     auto subscription_container::matches( const std::string& topic ) const -> bool
     {
         return io_wally::dispatch::topic_filter_matches_topic( topic_filter, topic );
@@ -39,70 +46,121 @@ namespace io_wally::dispatch
     // --------------------------------------------------------------------------------
 
     topic_subscriptions::topic_subscriptions( const context& context )
+        : resolved_cache_{context[io_wally::context::PUB_SUBSCRIBER_CACHE_SIZE].as<std::size_t>( )}
     {
         logger_ = context.logger_factory( ).logger( "topic-subscriptions" );
     }
 
-    auto topic_subscriptions::subscribe( const std::string& client_id,
+    auto topic_subscriptions::subscribe( const session_handle subscriber,
                                          const std::shared_ptr<const protocol::subscribe>& subscribe )
         -> std::shared_ptr<const protocol::suback>
     {
+        assert( subscriber.valid( ) );
+        if ( subscriber.index >= client_topic_filters_.size( ) )
+            client_topic_filters_.resize( subscriber.index + 1 );
+
+        auto& topic_filters = client_topic_filters_[subscriber.index];
         for ( const auto& subscr : subscribe->subscriptions( ) )
         {
-            subscriptions_.emplace( subscr.topic_filter( ), subscr.maximum_qos( ), client_id );
+            if ( subscriptions_.insert( subscr.topic_filter( ), subscriber, subscr.maximum_qos( ) ) )
+                topic_filters.push_back( subscr.topic_filter( ) );
+            // Even if it replaced an existing subscription, its maximum QoS may have changed
+            resolved_cache_.invalidate( subscr.topic_filter( ) );
         }
         const auto suback = subscribe->succeed( );
-        logger_->debug( "SUBSRCRIBED: [cltid:{}|subscr:{}] -> {}", client_id, *subscribe, *suback );
+        logger_->debug( "SUBSRCRIBED: [sess:{}|subscr:{}] -> {}", subscriber, *subscribe, *suback );
 
         return suback;
     }
 
-    auto topic_subscriptions::unsubscribe( const std::string& client_id,
+    auto topic_subscriptions::unsubscribe( const session_handle subscriber,
                                            const std::shared_ptr<const protocol::unsubscribe>& unsubscribe )
         -> std::shared_ptr<const protocol::unsuback>
     {
-        for ( auto it = subscriptions_.begin( ); it != subscriptions_.end( ); )
+        if ( subscriber.index < client_topic_filters_.size( ) )
         {
-            if ( it->topic_filter_matches_one_of( unsubscribe->topic_filters( ) ) )
-            {
-                it = subscriptions_.erase( it );
-            }
-            else
+            auto& topic_filters = client_topic_filters_[subscriber.index];
+            for ( const auto& topic_filter : unsubscribe->topic_filters( ) )
             {
-                ++it;
+                if ( !subscriptions_.erase( topic_filter, subscriber ) )
+                    continue;
+                resolved_cache_.invalidate( topic_filter );
+                const auto pos = std::find( topic_filters.begin( ), topic_filters.end( ), topic_filter );
+                assert( pos != topic_filters.end( ) );
+                *pos = std::move( topic_filters.back( ) );
+                topic_filters.pop_back( );
             }
         }
         const auto unsuback = unsubscribe->ack( );
-        logger_->debug( "UNSUBSRCRIBED: [cltid:{}|unsubscr:{}] -> {}", client_id, *unsubscribe, *unsuback );
+        logger_->debug( "UNSUBSRCRIBED: [sess:{}|unsubscr:{}] -> {}", subscriber, *unsubscribe, *unsuback );
 
         return unsuback;
     }
 
+    auto topic_subscriptions::unsubscribe_all( const session_handle subscriber ) -> std::size_t
+    {
+        if ( subscriber.index >= client_topic_filters_.size( ) )
+            return 0;
+
+        auto topic_filters = std::vector<std::string>{};
+        topic_filters.swap( client_topic_filters_[subscriber.index] );
+        for ( const auto& topic_filter : topic_filters )
+        {
+            [[maybe_unused]] const auto erased = subscriptions_.erase( topic_filter, subscriber );
+            assert( erased );
+            resolved_cache_.invalidate( topic_filter );
+        }
+        logger_->debug( "UNSUBSRCRIBED ALL: [sess:{}|count:{}]", subscriber, topic_filters.size( ) );
+
+        return topic_filters.size( );
+    }
+
+    auto topic_subscriptions::subscription_count( const session_handle subscriber ) const -> std::size_t
+    {
+        return subscriber.index < client_topic_filters_.size( ) ? client_topic_filters_[subscriber.index].size( ) : 0;
+    }
+
     auto topic_subscriptions::resolve_subscribers( const std::shared_ptr<const protocol::publish>& publish ) const
-        -> const std::vector<resolved_subscriber_t>
+        -> const std::vector<resolved_subscriber_t>&
     {
         const auto& topic = publish->topic( );
+        if ( resolved_cache_.capacity( ) > 0 )
+        {
+            if ( const auto* cached = resolved_cache_.find( topic ) )
+                return *cached;
+        }
 
-        auto resolved_subscribers = std::vector<resolved_subscriber_t>{};
-        for ( const auto& subscr : subscriptions_ )
+        if ( ++resolve_epoch_ == 0 )
         {
-            if ( !subscr.matches( topic ) )
-                continue;
-            const auto& seen_subscr = std::find_if(
-                resolved_subscribers.begin( ), resolved_subscribers.end( ),
-                [&subscr]( const resolved_subscriber_t& res_subscr ) { return res_subscr.first == subscr.client_id; } );
-            if ( seen_subscr != resolved_subscribers.end( ) )
+            // Epoch wrapped around: forget all stamps, lest we mistake an ancient stamp for a current one
+            std::fill( resolved_stamps_.begin( ), resolved_stamps_.end( ), resolved_stamp{} );
+            resolve_epoch_ = 1;
+        }
+        if ( resolved_stamps_.size( ) < client_topic_filters_.size( ) )
+            resolved_stamps_.resize( client_topic_filters_.size( ) );
+
+        auto resolved_subscribers = std::vector<resolved_subscriber_t>{};
+        subscriptions_.match( topic, [&]( const subscription_trie::subscriber& subscr ) {
+            // A client subscribed to several matching topic filters receives this PUBLISH only once, using the
+            // maximum QoS of all those subscriptions (MQTT 3.1.1, section 3.3.5)
+            auto& stamp = resolved_stamps_[subscr.id.index];
+            if ( stamp.epoch != resolve_epoch_ )
             {
-                const auto seen_qos = seen_subscr->second;
-                if ( subscr.maximum_qos > seen_qos )
-                    seen_subscr->second = subscr.maximum_qos;
+                stamp = resolved_stamp{resolve_epoch_, static_cast<std::uint32_t>( resolved_subscribers.size( ) )};
+                resolved_subscribers.emplace_back( subscr.id, subscr.maximum_qos );
             }
-            else
+            else if ( subscr.maximum_qos > resolved_subscribers[stamp.position].second )
             {
-                resolved_subscribers.emplace_back( resolved_subscriber_t{subscr.client_id, subscr.maximum_qos} );
+                resolved_subscribers[stamp.position].second = subscr.maximum_qos;
             }
+        } );
+
+        if ( resolved_cache_.capacity( ) == 0 )
+        {
+            uncached_ = std::move( resolved_subscribers );
+            return uncached_;
         }
 
-        return resolved_subscribers;
+        return resolved_cache_.insert( topic, std::move( resolved_subscribers ) );
     }
 }  // namespace io_wally::dispatch
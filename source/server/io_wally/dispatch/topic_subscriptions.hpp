@@ -1,19 +1,22 @@
 #pragma once
 
 #include <algorithm>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <string>
 #include <tuple>
-#include <unordered_set>
 #include <vector>
 
 #include "io_wally/context.hpp"
 #include "io_wally/dispatch/common.hpp"
+#include "io_wally/dispatch/resolved_subscriber_cache.hpp"
+#include "io_wally/dispatch/subscription_trie.hpp"
 #include "io_wally/logging/logging.hpp"
 #include "io_wally/protocol/common.hpp"
 #include "io_wally/protocol/publish_packet.hpp"
 #include "io_wally/protocol/suback_packet.hpp"
+#include "io_wally/protocol/topic_name.hpp"
 #include "io_wally/protocol/subscribe_packet.hpp"
 #include "io_wally/protocol/subscription.hpp"
 #include "io_wally/protocol/unsuback_packet.hpp"
@@ -21,7 +24,7 @@
 
 namespace io_wally::dispatch
 {
-    /// \brief Value type combining \c topic \c filter, \c maximum \c QoS and \c client \c id to represent an MQTT
+    /// \brief Value type combining \c topic \c filter, \c maximum \c QoS and \c subscriber to represent an MQTT
     ///        client's subscription to a set of topics.
     ///
     /// NOTE: This class is public (for now) to facilitate unit tests since it encapsulates logic for matching a \c
@@ -32,12 +35,12 @@ namespace io_wally::dispatch
        public:
         subscription_container( std::string topic_filter,
                                 const protocol::packet::QoS maximum_qosp,
-                                std::string client_id );
+                                const session_handle subscriber );
 
         inline auto operator==( const subscription_container& other ) const -> bool
         {
             return ( topic_filter == other.topic_filter ) && ( maximum_qos == other.maximum_qos ) &&
-                   ( client_id == other.client_id );
+                   ( subscriber == other.subscriber );
         }
 
         /// \brief Test if supplied \c topic matches this \c topic \c filter.
@@ -46,6 +49,9 @@ namespace io_wally::dispatch
         /// \return \c true if \c topic matches this \c topic \c filter, \c false otherwise
         ///
         /// \pre \c topic is a well-formed topic string
+        [[nodiscard]] auto matches( const protocol::topic_name& topic ) const -> bool;
+
+        /// \brief Test if supplied \c topic matches this \c topic \c filter, interning \c topic first.
         [[nodiscard]] auto matches( const std::string& topic ) const -> bool;
 
         /// \brief Test if this \c subscription's topic filter matches one of the \c topic_filters.
@@ -57,29 +63,29 @@ namespace io_wally::dispatch
        public:
         const std::string topic_filter;
         const protocol::packet::QoS maximum_qos;
-        const std::string client_id;
+        const session_handle subscriber;
     };  // struct subscription_container
 
-    /// \brief Hash functor. Needed for \c subscription_container to be usable in \c std::unordered_set.
-    struct subscription_container_hash
-    {
-        auto operator( )( const subscription_container& subscr ) const -> std::size_t
-        {
-            return std::hash<std::string>( )( subscr.topic_filter ) ^ static_cast<std::size_t>( subscr.maximum_qos ) ^
-                   std::hash<std::string>( )( subscr.client_id );
-        }
-    };  // struct subscription_container_hash
-
     /// \brief Manager for \c topic \c subscriptions.
     ///
     /// Manages all \c protocol::subscription (topic subscription) instances received from clients:
     ///
     /// - Will be forwarded all \c protocol::subscribe packets received from clients and add its \c
-    /// protocol::subscriptions (topic subscriptions) to an internally managed set containing all such
-    /// subscriptions.
+    /// protocol::subscriptions (topic subscriptions) to an internally managed \c subscription_trie containing all
+    /// such subscriptions.
     /// - Will be forwarded all \c protocol::publish packets received from clients and will respond with the set of
     /// \c mqtt_client_session instances that subscribe to the topic the packet has been published to.
     ///
+    /// Additionally, keeps an index of each client's topic filters, so that all of a client's subscriptions may be
+    /// cancelled at a cost proportional to that client's number of subscriptions.
+    ///
+    /// Clients are identified by their \c session_handle. Since session handles are dense, per client state - the
+    /// index of topic filters just mentioned, and the stamps used for removing duplicate subscribers when resolving
+    /// a PUBLISH's subscribers - is kept in vectors indexed by session handle.
+    ///
+    /// Resolved subscribers are cached per topic, holding at most \c context::PUB_SUBSCRIBER_CACHE_SIZE topics.
+    /// Whenever subscriptions to a topic filter change, cached topics matching that topic filter are invalidated.
+    ///
     class topic_subscriptions final
     {
        public:
@@ -89,36 +95,73 @@ namespace io_wally::dispatch
 
         auto operator=( topic_subscriptions ) -> topic_subscriptions& = delete;
 
-        /// \brief Register all subscriptions contained in \c subscribe for client \c client_id.
+        /// \brief Register all subscriptions contained in \c subscribe for client \c subscriber.
         ///
-        /// \param client_id ID of client that wants to subscribe
+        /// \param subscriber Session handle of client that wants to subscribe
         /// \param subscribe SUBSCRIBE packet
         /// \return SUBACK packet
-        auto subscribe( const std::string& client_id, const std::shared_ptr<const protocol::subscribe>& subscribe )
+        auto subscribe( const session_handle subscriber, const std::shared_ptr<const protocol::subscribe>& subscribe )
             -> std::shared_ptr<const protocol::suback>;
 
-        /// \brief Unsubscribe client \c client_id from all topic filters in \c unsubscribe.
+        /// \brief Unsubscribe client \c subscriber from all topic filters in \c unsubscribe.
         ///
-        /// \param client_id ID of client that wants to cancel subscriptions
+        /// \param subscriber Session handle of client that wants to cancel subscriptions
         /// \param unsubscribe UNSUBSCRIBE packet containing topic filters to cancel
         /// \return UNSUBACK packet
-        auto unsubscribe( const std::string& client_id,
+        auto unsubscribe( const session_handle subscriber,
                           const std::shared_ptr<const protocol::unsubscribe>& unsubscribe )
             -> std::shared_ptr<const protocol::unsuback>;
 
+        /// \brief Cancel all subscriptions of client \c subscriber, e.g. when its clean session ends.
+        ///
+        /// \param subscriber Session handle of client whose subscriptions to cancel
+        /// \return Number of cancelled subscriptions
+        auto unsubscribe_all( const session_handle subscriber ) -> std::size_t;
+
+        /// \brief Number of subscriptions client \c subscriber currently holds.
+        [[nodiscard]] auto subscription_count( const session_handle subscriber ) const -> std::size_t;
+
+        /// \brief Number of subscriptions (topic filter/client pairs) currently registered.
+        [[nodiscard]] auto size( ) const -> std::size_t
+        {
+            return subscriptions_.size( );
+        }
+
         /// \brief Determine set of clients subscribed to \c topic packet \c publish is published to.
         ///
         /// \param publish PUBLISH packet for which we want to determine all subscribers
-        ///
-        /// TODO: Investigate if returning a std::vector by value has negative performance impacts, and if so, fix
-        /// this.
+        /// \return Resolved subscribers, valid until this \c topic_subscriptions is next called
         auto resolve_subscribers( const std::shared_ptr<const protocol::publish>& publish ) const
-            -> const std::vector<resolved_subscriber_t>;
+            -> const std::vector<resolved_subscriber_t>&;
+
+        /// \brief Statistics of our cache of resolved subscribers.
+        [[nodiscard]] auto cache_stats( ) const -> const resolved_subscriber_cache::statistics&
+        {
+            return resolved_cache_.stats( );
+        }
+
+       private:
+        /// Marks a subscriber as already resolved for the PUBLISH identified by \c epoch
+        struct resolved_stamp final
+        {
+            std::uint32_t epoch{0};
+            /// Position of this subscriber in the list of resolved subscribers
+            std::uint32_t position{0};
+        };  // struct resolved_stamp
 
        private:
-        // Set of subscriptions we manage (cannot be <const subscription_container> since members of std containers
-        // in C++ need to be copy assignable or movable, which is incompatible with const)
-        std::unordered_set<subscription_container, subscription_container_hash> subscriptions_{1000};
+        /// Index of all subscriptions we manage
+        subscription_trie subscriptions_{};
+        /// Topic filters subscribed to by each client, in no particular order, indexed by session handle
+        std::vector<std::vector<std::string>> client_topic_filters_{};
+        /// Stamps for removing duplicate subscribers, indexed by session handle
+        mutable std::vector<resolved_stamp> resolved_stamps_{};
+        /// Incremented for each resolved PUBLISH
+        mutable std::uint32_t resolve_epoch_{0};
+        /// Resolved subscribers of hot topics
+        mutable resolved_subscriber_cache resolved_cache_;
+        /// Resolved subscribers of the last PUBLISH, if our cache is disabled
+        mutable std::vector<resolved_subscriber_t> uncached_{};
         /// Our logger
         std::unique_ptr<spdlog::logger> logger_;
     };  // class topic_subscriptions
@@ -1,11 +1,12 @@
 #include "io_wally/dispatch/tx_in_flight_publications.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <cstdint>
+#include <deque>
 #include <memory>
-#include <tuple>
-#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include <asio.hpp>
 
@@ -14,12 +15,16 @@
 #include "io_wally/context.hpp"
 #include "io_wally/dispatch/tx_publication.hpp"
 #include "io_wally/mqtt_packet_sender.hpp"
+#include "io_wally/persistence/spill_store.hpp"
 #include "io_wally/protocol/common.hpp"
+#include "io_wally/protocol/packet_pool.hpp"
 #include "io_wally/protocol/puback_packet.hpp"
 #include "io_wally/protocol/pubcomp_packet.hpp"
 #include "io_wally/protocol/publish_ack_packet.hpp"
 #include "io_wally/protocol/publish_packet.hpp"
 #include "io_wally/protocol/pubrec_packet.hpp"
+#include "io_wally/protocol/pubrel_packet.hpp"
+#include "io_wally/timing_wheel.hpp"
 
 namespace io_wally::dispatch
 {
@@ -29,9 +34,31 @@ namespace io_wally::dispatch
 
     tx_in_flight_publications::tx_in_flight_publications( const io_wally::context& context,
                                                           asio::io_service& io_service,
-                                                          std::weak_ptr<mqtt_packet_sender> sender )
-        : context_{context}, io_service_{io_service}, sender_{std::move( sender )}
+                                                          std::weak_ptr<mqtt_packet_sender> sender,
+                                                          persistence::spill_store* const spill_store )
+        : context_{context},
+          io_service_{io_service},
+          timing_wheel_{asio::use_service<timing_wheel>( io_service )},
+          ack_timeout_{context[io_wally::context::PUB_ACK_TIMEOUT].as<std::uint32_t>( )},
+          max_retries_{context[io_wally::context::PUB_MAX_RETRIES].as<std::size_t>( )},
+          max_in_flight_{
+              std::max<std::uint16_t>( 1, context[io_wally::context::PUB_MAX_IN_FLIGHT].as<std::uint16_t>( ) )},
+          max_queued_{context[io_wally::context::PUB_MAX_QUEUED].as<std::size_t>( )},
+          sender_{std::move( sender )},
+          spill_store_{spill_store},
+          publications_( max_in_flight_ ),
+          free_packet_identifiers_( ( max_in_flight_ + 63 ) / 64, ~std::uint64_t{0} )
     {
+        // Clear bits beyond max_in_flight_ so that we never hand out packet identifiers outside our window
+        if ( ( max_in_flight_ % 64 ) != 0 )
+            free_packet_identifiers_.back( ) = ( std::uint64_t{1} << ( max_in_flight_ % 64 ) ) - 1;
+    }
+
+    tx_in_flight_publications::~tx_in_flight_publications( )
+    {
+        timing_wheel_.cancel( retransmit_timeout_ );
+        for ( const auto& pending : pending_ )
+            drop( pending );
     }
 
     auto tx_in_flight_publications::context( ) const -> const io_wally::context&
@@ -48,23 +75,30 @@ namespace io_wally::dispatch
                                              const protocol::packet::QoS maximum_qos )
     {
         auto locked_sender = sender_.lock( );
-        if ( !locked_sender )
-        {
-            // Client connection has been closed. Nothing we can do right now.
-            return;
-        }
-
         if ( maximum_qos == protocol::packet::QoS::AT_MOST_ONCE )
         {
-            publish_using_qos0( incoming_publish, locked_sender );
-        }
-        else if ( maximum_qos == protocol::packet::QoS::AT_LEAST_ONCE )
-        {
-            publish_using_qos1( incoming_publish, locked_sender );
+            // QoS 0 publications are not part of an offline client's session state
+            if ( locked_sender )
+            {
+                incoming_publish->qos( protocol::packet::QoS::AT_MOST_ONCE );
+                locked_sender->send( incoming_publish );
+            }
         }
-        else if ( maximum_qos == protocol::packet::QoS::EXACTLY_ONCE )
+        else
         {
-            publish_using_qos2( incoming_publish, locked_sender );
+            const auto initial_state = ( maximum_qos == protocol::packet::QoS::AT_LEAST_ONCE )
+                                           ? tx_publication::state::waiting_for_ack
+                                           : tx_publication::state::waiting_for_rec;
+            if ( locked_sender && ( in_flight_ < max_in_flight_ ) )
+            {
+                start( incoming_publish, initial_state, locked_sender );
+            }
+            else
+            {
+                // Client is offline, or in flight window is full: wait for client to reconnect or to acknowledge an
+                // in flight publication
+                enqueue( incoming_publish, initial_state );
+            }
         }
     }
 
@@ -81,81 +115,328 @@ namespace io_wally::dispatch
             return;
         }
         const auto pktid = publish_ack->packet_identifier( );
-        if ( publications_.count( pktid ) > 0 )
-        {
-            publications_[pktid]->response_received( publish_ack, locked_sender );
-        }
-        else
+        auto* const publication = find( pktid );
+        if ( !publication )
         {
             locked_sender->stop(
                 "[MQTT-4.8.0-1] Protocol violation: client sent PUBACK/PUBREC/PUBCOMP without first sending "
                 "PUBLISH",
                 spdlog::level::level_enum::warn );
+            return;
+        }
+
+        // Any pending retransmit queue entry for this publication will become stale, either because we release
+        // this publication or because we restart its ack timeout
+        switch ( publication->current_state )
+        {
+            case tx_publication::state::waiting_for_ack:
+                if ( ack_type != protocol::packet::Type::PUBACK )
+                {
+                    locked_sender->stop( "Protocol violation: client did not send expected PUBACK",
+                                         spdlog::level::level_enum::warn );
+                    return;
+                }
+                release( *publication, locked_sender );
+                break;
+            case tx_publication::state::waiting_for_rec:
+                if ( ack_type != protocol::packet::Type::PUBREC )
+                {
+                    // Protocol violation: client did not send PUBREC but one of PUBCOMP or even PUBACK
+                    locked_sender->stop(
+                        "Protocol violation: client did not send expected PUBREC but one of PUBCOMP or PUBACK",
+                        spdlog::level::level_enum::warn );
+                    return;
+                }
+                locked_sender->send_publish_ack( protocol::packet::Type::PUBREL, pktid );
+                publication->current_state = tx_publication::state::waiting_for_comp;
+                start_ack_timeout( *publication );
+                break;
+            case tx_publication::state::waiting_for_comp:
+                if ( ack_type == protocol::packet::Type::PUBREC )
+                {
+                    // Client re-sent PUBREC. This likely means it did not receive our PUBREL. Let's sent it again.
+                    locked_sender->send_publish_ack( protocol::packet::Type::PUBREL, pktid );
+                    start_ack_timeout( *publication );
+                    return;
+                }
+                assert( ack_type == protocol::packet::Type::PUBCOMP );
+                release( *publication, locked_sender );
+                break;
+            default:
+                assert( false );
+                break;
         }
     }
 
+    void tx_in_flight_publications::suspend( )
+    {
+        sender_.reset( );
+        if ( retransmit_timeout_scheduled_ )
+        {
+            timing_wheel_.cancel( retransmit_timeout_ );
+            retransmit_timeout_scheduled_ = false;
+        }
+    }
+
+    void tx_in_flight_publications::resume( std::weak_ptr<mqtt_packet_sender> sender )
+    {
+        sender_ = std::move( sender );
+        const auto locked_sender = sender_.lock( );
+        if ( !locked_sender )
+            return;
+
+        // [MQTT-4.4.0-1] Resend all unacknowledged PUBLISH and PUBREL packets, in the order they were last sent. This
+        // does not count as a retry.
+        auto resending = std::deque<retransmit_entry>{};
+        resending.swap( retransmit_queue_ );
+        for ( const auto& entry : resending )
+        {
+            auto* const publication = find( entry.packet_identifier );
+            if ( !publication || ( publication->retransmit_sequence != entry.sequence ) )
+                continue;
+            if ( publication->current_state != tx_publication::state::waiting_for_comp )
+                publication->publish->dup( true );
+            retransmit( *publication, locked_sender );
+        }
+
+        while ( ( in_flight_ < max_in_flight_ ) && !pending_.empty( ) )
+            start_pending( locked_sender );
+    }
+
     // ------------------------------------------------------------------------------------------------------------
     //  Private
     // ------------------------------------------------------------------------------------------------------------
 
-    auto tx_in_flight_publications::next_packet_identifier( ) -> std::uint16_t
+    auto tx_in_flight_publications::allocate_packet_identifier( ) -> std::uint16_t
     {
-        // For now, we don't need to be thread-safe
-        if ( next_packet_identifier_ == MAX_PACKET_IDENTIFIER )
+        assert( in_flight_ < max_in_flight_ );
+        auto slot = next_slot_;
+        // Visit first word twice, since we may have skipped free slots below next_slot_ on first visit
+        for ( auto visited = std::size_t{0}; visited <= free_packet_identifiers_.size( ); ++visited )
+        {
+            const auto word = ( slot / 64 ) % free_packet_identifiers_.size( );
+            const auto free_bits = free_packet_identifiers_[word] & ( ~std::uint64_t{0} << ( slot % 64 ) );
+            if ( free_bits != 0 )
+            {
+                const auto bit = static_cast<std::size_t>( __builtin_ctzll( free_bits ) );
+                free_packet_identifiers_[word] &= ~( std::uint64_t{1} << bit );
+                slot = word * 64 + bit;
+                next_slot_ = ( slot + 1 ) % max_in_flight_;
+                return static_cast<std::uint16_t>( slot + 1 );
+            }
+            slot = ( word + 1 ) * 64;
+        }
+        assert( false );  // Unreachable as long as in_flight_ < max_in_flight_
+        return 0;
+    }
+
+    void tx_in_flight_publications::enqueue( const std::shared_ptr<protocol::publish>& incoming_publish,
+                                             const tx_publication::state initial_state )
+    {
+        if ( ( max_queued_ > 0 ) && ( pending_.size( ) >= max_queued_ ) )
+        {
+            drop( pending_.front( ) );
+            pending_.pop_front( );
+            ++discarded_;
+        }
+        auto pending = pending_publication{incoming_publish, initial_state, incoming_publish->type_and_flags( ),
+                                           incoming_publish->remaining_length( ), {}};
+        if ( spill_store_ && !spill_store_->admit( protocol::packet::total_length( pending.remaining_length ) ) )
         {
-            next_packet_identifier_ = 0;
+            if ( const auto spilled = spill_store_->spill( incoming_publish->body( ) ); spilled )
+            {
+                pending.incoming_publish.reset( );
+                pending.spilled = *spilled;
+                ++spilled_;
+            }
+            else
+            {
+                // Could not write it to disk, so keep it in memory after all
+                spill_store_->charge( protocol::packet::total_length( pending.remaining_length ) );
+            }
         }
+        pending_.push_back( std::move( pending ) );
+    }
+
+    void tx_in_flight_publications::start_pending( const std::shared_ptr<mqtt_packet_sender>& locked_sender )
+    {
+        if ( !pending_.empty( ) && !pending_.front( ).incoming_publish )
+            load_spilled( );
+        if ( pending_.empty( ) )
+            return;
+
+        const auto next = std::move( pending_.front( ) );
+        pending_.pop_front( );
+        drop( next );
+        start( next.incoming_publish, next.initial_state, locked_sender );
+    }
+
+    void tx_in_flight_publications::load_spilled( )
+    {
+        auto pending = pending_.begin( );
+        for ( auto loaded = std::size_t{0};
+              ( pending != pending_.end( ) ) && ( loaded < persistence::spill_store::READ_AHEAD ); ++loaded )
+        {
+            if ( pending->incoming_publish )
+            {
+                ++pending;
+                continue;
+            }
+            auto body = spill_store_->load( pending->spilled );
+            spill_store_->release( pending->spilled );
+            --spilled_;
+            if ( !body )
+            {
+                // Lost: spill store has already logged why
+                pending = pending_.erase( pending );
+                ++discarded_;
+                continue;
+            }
+            pending->incoming_publish = protocol::make_packet<protocol::publish>(
+                pending->type_and_flags, pending->remaining_length, std::move( body ), 0 );
+            spill_store_->charge( protocol::packet::total_length( pending->remaining_length ) );
+            ++pending;
+        }
+
+        for ( auto prefetched = std::size_t{0};
+              ( pending != pending_.end( ) ) && ( prefetched < persistence::spill_store::READ_AHEAD ); ++pending )
+        {
+            if ( !pending->incoming_publish )
+            {
+                spill_store_->prefetch( pending->spilled );
+                ++prefetched;
+            }
+        }
+    }
+
+    void tx_in_flight_publications::drop( const pending_publication& pending )
+    {
+        if ( !spill_store_ )
+            return;
+        if ( pending.incoming_publish )
+            spill_store_->discharge( protocol::packet::total_length( pending.remaining_length ) );
         else
         {
-            ++next_packet_identifier_;
+            spill_store_->release( pending.spilled );
+            --spilled_;
         }
-        return next_packet_identifier_;
     }
 
-    void tx_in_flight_publications::publish_using_qos0( const std::shared_ptr<protocol::publish>& incoming_publish,
-                                                        const std::shared_ptr<mqtt_packet_sender>& locked_sender ) const
+    auto tx_in_flight_publications::find( const std::uint16_t packet_identifier ) -> tx_publication*
+    {
+        if ( ( packet_identifier == 0 ) || ( packet_identifier > max_in_flight_ ) )
+            return nullptr;
+        auto& publication = publications_[packet_identifier - 1];
+
+        return publication.publish ? &publication : nullptr;
+    }
+
+    void tx_in_flight_publications::release( tx_publication& publication,
+                                             const std::shared_ptr<mqtt_packet_sender>& locked_sender )
     {
-        incoming_publish->qos( protocol::packet::QoS::AT_MOST_ONCE );
-        locked_sender->send( incoming_publish );
+        // Now, this packet identifier may be re-used
+        const auto slot = std::size_t{publication.publish->packet_identifier( )} - 1U;
+        publication = tx_publication{};
+        free_packet_identifiers_[slot / 64] |= std::uint64_t{1} << ( slot % 64 );
+        --in_flight_;
+
+        start_pending( locked_sender );
     }
 
-    void tx_in_flight_publications::publish_using_qos1( const std::shared_ptr<protocol::publish>& incoming_publish,
-                                                        const std::shared_ptr<mqtt_packet_sender>& locked_sender )
+    void tx_in_flight_publications::start( const std::shared_ptr<protocol::publish>& incoming_publish,
+                                           tx_publication::state initial_state,
+                                           const std::shared_ptr<mqtt_packet_sender>& locked_sender )
     {
         // Need to copy incoming PUBLISH packet since we now start a new, unrelated OUTGOING publication we need a
         // packet identifier for that is unique for THIS client, not the client that sent this incoming PUBLISH.
-        const auto outgoing_publish = incoming_publish->with_new_packet_identifier( next_packet_identifier( ) );
-        auto publish_itr = std::unordered_map<std::uint16_t, std::shared_ptr<tx_publication>>::iterator{};
-        auto inserted = false;
-        std::tie( publish_itr, inserted ) =
-            publications_.emplace( std::make_pair( outgoing_publish->packet_identifier( ),
-                                                   std::make_shared<qos1_tx_publication>( *this, outgoing_publish ) ) );
+        const auto outgoing_publish = incoming_publish->with_new_packet_identifier( allocate_packet_identifier( ) );
+        outgoing_publish->qos( initial_state == tx_publication::state::waiting_for_ack
+                                   ? protocol::packet::QoS::AT_LEAST_ONCE
+                                   : protocol::packet::QoS::EXACTLY_ONCE );
+        auto& publication = publications_[outgoing_publish->packet_identifier( ) - 1U];
+        publication = tx_publication{outgoing_publish, initial_state};
+        ++in_flight_;
 
-        assert( inserted );  // Could only happen if we have more than 65535 in flight publications
+        locked_sender->send( outgoing_publish );
+        start_ack_timeout( publication );
+    }
 
-        ( *publish_itr ).second->start( locked_sender );
+    void tx_in_flight_publications::start_ack_timeout( tx_publication& publication )
+    {
+        publication.retransmit_sequence = next_retransmit_sequence_++;
+        retransmit_queue_.push_back( retransmit_entry{timing_wheel_.now( ) + ack_timeout_,
+                                                      publication.publish->packet_identifier( ),
+                                                      publication.retransmit_sequence} );
+        if ( !retransmit_timeout_scheduled_ )
+            schedule_retransmit_timeout( );
     }
 
-    void tx_in_flight_publications::publish_using_qos2( const std::shared_ptr<protocol::publish>& incoming_publish,
-                                                        const std::shared_ptr<mqtt_packet_sender>& locked_sender )
+    void tx_in_flight_publications::schedule_retransmit_timeout( )
     {
-        // Need to copy incoming PUBLISH packet since we now start a new, unrelated OUTGOING publication we need a
-        // packet identifier for that is unique for THIS client, not the client that sent this incoming PUBLISH.
-        const auto outgoing_publish = incoming_publish->with_new_packet_identifier( next_packet_identifier( ) );
-        auto publish_itr = std::unordered_map<std::uint16_t, std::shared_ptr<tx_publication>>::iterator{};
-        auto inserted = false;
-        std::tie( publish_itr, inserted ) =
-            publications_.emplace( std::make_pair( outgoing_publish->packet_identifier( ),
-                                                   std::make_shared<qos2_tx_publication>( *this, outgoing_publish ) ) );
+        assert( !retransmit_queue_.empty( ) );
+        retransmit_timeout_scheduled_ = true;
+        retransmit_timeout_ = timing_wheel_.schedule( retransmit_queue_.front( ).deadline - timing_wheel_.now( ),
+                                                      [this]( ) { retransmit_timeout_expired( ); } );
+    }
 
-        assert( inserted );  // Could only happen if we have more than 65535 in flight publications
+    void tx_in_flight_publications::retransmit_timeout_expired( )
+    {
+        const auto locked_sender = sender_.lock( );
+        if ( !locked_sender )
+        {
+            // Client connection has gone away. No point in retransmitting anything until our client reconnects.
+            retransmit_timeout_scheduled_ = false;
+            return;
+        }
+
+        // Retransmit all publications due within the current tick as one batch. Keep retransmit_timeout_scheduled_
+        // set while doing so, since each retransmission will append a new entry to our queue.
+        const auto due = timing_wheel_.now( ) + timing_wheel::TICK;
+        while ( !retransmit_queue_.empty( ) && ( retransmit_queue_.front( ).deadline <= due ) )
+        {
+            const auto entry = retransmit_queue_.front( );
+            retransmit_queue_.pop_front( );
+            auto* const publication = find( entry.packet_identifier );
+            if ( !publication || ( publication->retransmit_sequence != entry.sequence ) )
+            {
+                // Stale: publication has been acknowledged, or its ack timeout has been restarted
+                continue;
+            }
 
-        ( *publish_itr ).second->start( locked_sender );
+            if ( ++publication->retry_count > max_retries_ )
+            {
+                // Terminally failed
+                release( *publication, locked_sender );
+                continue;
+            }
+            retransmit( *publication, locked_sender );
+        }
+
+        retransmit_timeout_scheduled_ = false;
+        if ( !retransmit_queue_.empty( ) )
+            schedule_retransmit_timeout( );
     }
 
-    void tx_in_flight_publications::release( const std::shared_ptr<tx_publication>& publication )
+    void tx_in_flight_publications::retransmit( tx_publication& publication,
+                                                const std::shared_ptr<mqtt_packet_sender>& locked_sender )
     {
-        const auto erase_count = publications_.erase( publication->packet_identifier( ) );
-        assert( erase_count == 1 );
+        switch ( publication.current_state )
+        {
+            case tx_publication::state::waiting_for_ack:
+                locked_sender->send( publication.publish );
+                break;
+            case tx_publication::state::waiting_for_rec:
+                publication.publish->dup( true );  // Mark this a duplicate publish
+                locked_sender->send( publication.publish );
+                break;
+            case tx_publication::state::waiting_for_comp:
+                locked_sender->send_publish_ack( protocol::packet::Type::PUBREL,
+                                                 publication.publish->packet_identifier( ) );
+                break;
+            default:
+                assert( false );
+                break;
+        }
+        start_ack_timeout( publication );
     }
 }  // namespace io_wally::dispatch
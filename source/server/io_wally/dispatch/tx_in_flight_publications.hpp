@@ -1,34 +1,65 @@
 #pragma once
 
+#include <chrono>
 #include <cstdint>
+#include <deque>
 #include <memory>
-#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include <asio.hpp>
 
 #include "io_wally/context.hpp"
 #include "io_wally/dispatch/tx_publication.hpp"
 #include "io_wally/mqtt_packet_sender.hpp"
+#include "io_wally/persistence/spill_store.hpp"
 #include "io_wally/protocol/common.hpp"
 #include "io_wally/protocol/publish_ack_packet.hpp"
 #include "io_wally/protocol/publish_packet.hpp"
+#include "io_wally/timing_wheel.hpp"
 
 namespace io_wally::dispatch
 {
-    class tx_in_flight_publications final : public std::enable_shared_from_this<tx_in_flight_publications>
+    /// \brief All outgoing QoS 1 and QoS 2 publications of a single client session that still await
+    /// acknowledgement.
+    ///
+    /// Since all publications use the same acknowledgement timeout, publications waiting for an acknowledgement
+    /// form a queue ordered by deadline simply by appending them in the order they were sent. A single timeout,
+    /// scheduled for this queue's head, drives all retransmissions, and all publications due at the same time are
+    /// retransmitted as one batch. Acknowledged publications are not removed from this queue right away, but
+    /// skipped once they reach its head.
+    ///
+    /// At most \c context::PUB_MAX_IN_FLIGHT publications may be in flight at any time, keeping fast publishers
+    /// from overrunning slow subscribers. Any further publications are queued until an in flight publication is
+    /// released. In flight publications thus only need packet identifiers 1 to \c context::PUB_MAX_IN_FLIGHT, and
+    /// are kept in an array indexed by packet identifier. Free packet identifiers are tracked in a bitmap.
+    ///
+    /// While its client is offline, a persistent session's publications are \c suspended: QoS 1 and QoS 2
+    /// publications are queued along with those waiting for a free packet identifier, and nothing is retransmitted.
+    /// At most \c context::PUB_MAX_QUEUED publications are queued, discarding the oldest ones first. Once its client
+    /// reconnects, \c resume resends all publications still in flight and then starts as many queued publications as
+    /// fit into the in flight window, all in one go, so that they leave in as few socket writes as possible.
+    ///
+    /// Given a \c persistence::spill_store, queued publications that would push all sessions' queues beyond its memory
+    /// threshold are spilled to disk, keeping only their location and fixed header in memory. Once a spilled
+    /// publication reaches our queue's head, it is loaded back along with up to \c
+    /// persistence::spill_store::READ_AHEAD spilled publications following it, and the kernel is asked to read ahead
+    /// those following these.
+    ///
+    /// NOTE: This class is not thread safe. It must only be used from the thread running its \c io_service.
+    class tx_in_flight_publications final
     {
-        friend class tx_publication;
-        friend class qos1_tx_publication;
-        friend class qos2_tx_publication;
-
-       private:  // static
-        static constexpr const std::uint16_t MAX_PACKET_IDENTIFIER = 0xFFFF;
-
        public:
         tx_in_flight_publications( const context& context,
                                    asio::io_service& io_service,
-                                   std::weak_ptr<mqtt_packet_sender> sender );
+                                   std::weak_ptr<mqtt_packet_sender> sender,
+                                   persistence::spill_store* spill_store = nullptr );
+
+        tx_in_flight_publications( const tx_in_flight_publications& ) = delete;
+
+        auto operator=( const tx_in_flight_publications& ) -> tx_in_flight_publications& = delete;
+
+        ~tx_in_flight_publications( );
 
         auto context( ) const -> const io_wally::context&;
 
@@ -39,25 +70,119 @@ namespace io_wally::dispatch
 
         void response_received( const std::shared_ptr<protocol::publish_ack>& publish_ack );
 
+        /// \brief Stop sending anything, since our client has gone offline, queueing all publications from now on.
+        void suspend( );
+
+        /// \brief Send to \c sender from now on, resending all publications still in flight and starting queued
+        /// publications.
+        void resume( std::weak_ptr<mqtt_packet_sender> sender );
+
+        /// \brief Number of publications still awaiting acknowledgement.
+        [[nodiscard]] auto size( ) const -> std::size_t
+        {
+            return in_flight_;
+        }
+
+        /// \brief Number of publications waiting for a free slot in this session's in flight window.
+        [[nodiscard]] auto pending( ) const -> std::size_t
+        {
+            return pending_.size( );
+        }
+
+        /// \brief Number of queued publications currently spilled to disk.
+        [[nodiscard]] auto spilled( ) const -> std::size_t
+        {
+            return spilled_;
+        }
+
+        /// \brief Number of queued publications discarded since too many publications were queued.
+        [[nodiscard]] auto discarded( ) const -> std::uint64_t
+        {
+            return discarded_;
+        }
+
+       private:
+        struct retransmit_entry final
+        {
+            timing_wheel::clock::time_point deadline;
+            std::uint16_t packet_identifier;
+            std::uint32_t sequence;
+        };  // struct retransmit_entry
+
+        struct pending_publication final
+        {
+            /// Empty while spilled to disk
+            std::shared_ptr<protocol::publish> incoming_publish;
+            tx_publication::state initial_state;
+            /// incoming_publish's fixed header, as of being queued
+            std::uint8_t type_and_flags;
+            std::uint32_t remaining_length;
+            /// Where incoming_publish has been spilled to, if it has
+            persistence::spill_store::location spilled;
+        };  // struct pending_publication
+
        private:
-        auto next_packet_identifier( ) -> std::uint16_t;
+        auto allocate_packet_identifier( ) -> std::uint16_t;
+
+        void enqueue( const std::shared_ptr<protocol::publish>& incoming_publish,
+                      tx_publication::state initial_state );
+
+        /// \brief Start publication at our queue's head, if any, loading it from disk if it has been spilled.
+        void start_pending( const std::shared_ptr<mqtt_packet_sender>& locked_sender );
+
+        /// \brief Load spilled publications at our queue's head, and have the kernel read ahead those following them.
+        void load_spilled( );
+
+        /// \brief Give back memory or disk space held by queued publication \c pending.
+        void drop( const pending_publication& pending );
+
+        /// \brief Return publication using \c packet_identifier, or \c nullptr if there is none.
+        auto find( std::uint16_t packet_identifier ) -> tx_publication*;
+
+        void release( tx_publication& publication, const std::shared_ptr<mqtt_packet_sender>& locked_sender );
+
+        void start( const std::shared_ptr<protocol::publish>& incoming_publish,
+                    tx_publication::state initial_state,
+                    const std::shared_ptr<mqtt_packet_sender>& locked_sender );
 
-        void publish_using_qos0( const std::shared_ptr<protocol::publish>& incoming_publish,
-                                 const std::shared_ptr<mqtt_packet_sender>& locked_sender ) const;
+        void start_ack_timeout( tx_publication& publication );
 
-        void publish_using_qos1( const std::shared_ptr<protocol::publish>& incoming_publish,
-                                 const std::shared_ptr<mqtt_packet_sender>& locked_sender );
+        void schedule_retransmit_timeout( );
 
-        void publish_using_qos2( const std::shared_ptr<protocol::publish>& incoming_publish,
-                                 const std::shared_ptr<mqtt_packet_sender>& locked_sender );
+        void retransmit_timeout_expired( );
 
-        void release( const std::shared_ptr<tx_publication>& publication );
+        void retransmit( tx_publication& publication, const std::shared_ptr<mqtt_packet_sender>& locked_sender );
 
        private:
         const io_wally::context& context_;
         asio::io_service& io_service_;
+        timing_wheel& timing_wheel_;
+        const std::chrono::milliseconds ack_timeout_;
+        const std::size_t max_retries_;
+        const std::uint16_t max_in_flight_;
+        /// Maximum number of pending publications, 0 if unlimited
+        const std::size_t max_queued_;
         std::weak_ptr<mqtt_packet_sender> sender_;
-        std::unordered_map<std::uint16_t, std::shared_ptr<tx_publication>> publications_{};
-        std::uint16_t next_packet_identifier_{0};
+        /// Where to spill queued publications to, if anywhere
+        persistence::spill_store* const spill_store_;
+        /// In flight publications, indexed by packet identifier - 1
+        std::vector<tx_publication> publications_;
+        /// One bit per packet identifier, set if that packet identifier is free
+        std::vector<std::uint64_t> free_packet_identifiers_;
+        std::size_t in_flight_{0};
+        /// Publications waiting for a free packet identifier or for our client to reconnect, in order of arrival
+        std::deque<pending_publication> pending_{};
+        std::size_t spilled_{0};
+        std::uint64_t discarded_{0};
+        /// Publications waiting for acknowledgement, ordered by deadline. May contain stale entries.
+        std::deque<retransmit_entry> retransmit_queue_{};
+        std::uint32_t next_retransmit_sequence_{0};
+        /// Single timeout, scheduled for retransmit_queue_'s head
+        timing_wheel::timer_id retransmit_timeout_{};
+        /// Whether retransmit_timeout_ is scheduled, which is the case while retransmit_queue_ is not empty
+        bool retransmit_timeout_scheduled_{false};
+        /// Slot to start searching for a free packet identifier at, so that we do not immediately re-use packet
+        /// identifiers just released
+        std::size_t next_slot_{0};
     };  // class tx_in_flight_publications
 }  // namespace io_wally::dispatch
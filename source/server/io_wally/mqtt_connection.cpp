@@ -1,7 +1,9 @@
 #include "io_wally/mqtt_connection.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <chrono>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <system_error>
@@ -79,10 +81,11 @@ namespace io_wally
           connection_manager_{connection_manager},
           context_{context},
           dispatcher_{dispatcher},
-          read_buffer_( context[context::READ_BUFFER_SIZE].as<size_t>( ) ),
-          write_buffer_( context[context::WRITE_BUFFER_SIZE].as<size_t>( ) ),
-          close_on_connection_timeout_{socket.get_io_service( )},
-          close_on_keep_alive_timeout_{socket.get_io_service( )}
+          frame_buffer_{context[context::READ_BUFFER_SIZE].as<size_t>( ),
+                        context[context::READ_SHARE_THRESHOLD].as<size_t>( )},
+          outbound_queue_{context[context::WRITE_BUFFER_SIZE].as<size_t>( ),
+                          context[context::WRITE_FLUSH_THRESHOLD].as<size_t>( )},
+          timing_wheel_{asio::use_service<timing_wheel>( socket.get_io_service( ) )}
     {
         return;
     }
@@ -95,16 +98,28 @@ namespace io_wally
     {
         logger_->info( "START: {}", *this );
 
-        close_on_connect_timeout( );
+        // We are called on our acceptor's thread, yet need to be confined to our own strand
+        auto self = shared_from_this( );
+        strand_.post( [self]( ) {
+            self->close_on_connect_timeout( );
 
-        read_frame( );
+            self->read_frames( );
+        } );
     }
 
     void mqtt_connection::send( mqtt_packet::ptr packet )
     {
+        // We may be called from any thread, and our caller may modify packet once we return. Encode it right
+        // away, and leave writing it to our strand.
         write_packet( *packet );
     }
 
+    void mqtt_connection::send_publish_ack( const protocol::packet::Type type, const std::uint16_t packet_identifier )
+    {
+        logger_->debug( ">>> SEND: publish_ack[type:{}|pktid:{}] ...", static_cast<int>( type ), packet_identifier );
+        write_encoded_packet( encoder::encode_publish_ack( type, packet_identifier ) );
+    }
+
     void mqtt_connection::stop( const string& message, const spdlog::level::level_enum log_level )
     {
         logger_->log( log_level, message );
@@ -118,8 +133,8 @@ namespace io_wally
 
     void mqtt_connection::do_stop( )
     {
-        close_on_connection_timeout_.cancel( );
-        close_on_keep_alive_timeout_.cancel( );
+        timing_wheel_.cancel( connect_timeout_ );
+        timing_wheel_.cancel( keep_alive_timeout_ );
 
         auto ignored_ec = std::error_code{};
         socket_.shutdown( socket_.shutdown_both, ignored_ec );
@@ -136,71 +151,71 @@ namespace io_wally
         // request
         auto self = shared_from_this( );
         const auto conn_to = chrono::milliseconds{context_[context::CONNECT_TIMEOUT].as<uint32_t>( )};
-        close_on_connection_timeout_.expires_from_now( conn_to );
-        close_on_connection_timeout_.async_wait( strand_.wrap( [self]( const std::error_code& ec ) {
-            if ( !ec )
-            {
+        connect_timeout_ = timing_wheel_.schedule( conn_to, [self]( ) {
+            self->strand_.dispatch( [self]( ) {
+                self->connect_timeout_ = timing_wheel::timer_id{};
                 auto msg = ostringstream{};
                 msg << "CONNECTION TIMEOUT EXPIRED after [" << self->context_[context::CONNECT_TIMEOUT].as<uint32_t>( )
                     << "] ms";
-                self->connection_close_requested( msg.str( ), dispatch::disconnect_reason::protocol_violation, ec,
-                                                  spdlog::level::level_enum::warn );
-            }
-        } ) );
+                self->connection_close_requested( msg.str( ), dispatch::disconnect_reason::protocol_violation,
+                                                  std::error_code{}, spdlog::level::level_enum::warn );
+            } );
+        } );
     }
 
     // Reading incoming messages
 
-    void mqtt_connection::read_frame( )
+    void mqtt_connection::read_frames( )
     {
         if ( !socket_.is_open( ) )  // Socket was closed
             return;
 
-        logger_->debug( "<<< READ: next frame ..." );
+        logger_->debug( "<<< READ: next frames ..." );
         auto self = shared_from_this( );
-        asio::async_read(
-            socket_, asio::buffer( read_buffer_ ),
-            [self]( const std::error_code& ec, const size_t bytes_transferred ) -> size_t {
-                return self->frame_reader_( ec, bytes_transferred );
-            },
+        socket_.async_read_some(
+            asio::buffer( frame_buffer_.free_space_begin( ), frame_buffer_.free_space( ) ),
             strand_.wrap( [self]( const std::error_code& ec, const std::size_t bytes_transferred ) -> void {
-                self->on_frame_read( ec, bytes_transferred );
+                self->on_frames_read( ec, bytes_transferred );
             } ) );
     }
 
-    void mqtt_connection::on_frame_read( const std::error_code& ec, const size_t bytes_transferred )
+    void mqtt_connection::on_frames_read( const std::error_code& ec, const size_t bytes_transferred )
     {
-        // We received a packet, so let's cancel keep alive timer
-        close_on_keep_alive_timeout_.cancel( );
+        // We received data: just take note, our keep alive timeout will check
+        last_activity_ = timing_wheel_.now( );
         if ( ec )
         {
             on_read_failed( ec, bytes_transferred );
             return;
         }
 
-        decode_packet( bytes_transferred );
+        frame_buffer_.commit( bytes_transferred );
+        decode_packets( bytes_transferred );
     }
 
-    void mqtt_connection::decode_packet( const size_t bytes_transferred )
+    void mqtt_connection::decode_packets( const size_t bytes_transferred )
     {
         try
         {
-            const std::optional<const frame> frame = frame_reader_.get_frame( );
-            assert( frame );
-            const auto parsed_packet = packet_decoder_.decode( *frame );
-            logger_->info( "<<< DECODED [res:{}|bytes:{}]", *parsed_packet, bytes_transferred );
-
-            frame_reader_.reset( );
-            // TODO: Think about better resizing strategy - maybe using a max buffer capacity
-            read_buffer_.resize( context_[context::READ_BUFFER_SIZE].as<size_t>( ) );
+            // Decode every complete frame we have received so far before going back to our socket
+            while ( const auto frame = frame_buffer_.next_frame( ) )
+            {
+                const auto parsed_packet = packet_decoder_.decode( *frame );
+                logger_->info( "<<< DECODED [res:{}|bytes:{}]", *parsed_packet, bytes_transferred );
 
-            process_decoded_packet( parsed_packet );
+                if ( !process_decoded_packet( parsed_packet ) || !socket_.is_open( ) )
+                    return;
+            }
         }
         catch ( const error::malformed_mqtt_packet& e )
         {
             connection_close_requested( "<<< Malformed control packet header: " + string{e.what( )},
                                         dispatch::disconnect_reason::protocol_violation );
+            return;
         }
+
+        // Keep us in the loop!
+        read_frames( );
     }
 
     void mqtt_connection::on_read_failed( const std::error_code& ec, const size_t bytes_transferred )
@@ -219,45 +234,62 @@ namespace io_wally
 
     // Processing and dispatching decoded messages
 
-    void mqtt_connection::process_decoded_packet( const shared_ptr<protocol::mqtt_packet>& packet )
+    auto mqtt_connection::process_decoded_packet( const shared_ptr<protocol::mqtt_packet>& packet ) -> bool
     {
         logger_->debug( "--- PROCESSING: {} ...", *packet );
+        if ( !session_binding_ && ( packet->type( ) != packet::Type::CONNECT ) )
+        {
+            // [MQTT-3.1.0-1]: After a network connection is established by a client to a server, the first packet
+            // sent from the client to the server MUST be a CONNECT packet
+            connection_close_requested( "--- [MQTT-3.1.0-1] Received packet other than CONNECT before CONNECT",
+                                        dispatch::disconnect_reason::protocol_violation );
+            return false;
+        }
         switch ( packet->type( ) )
         {
             case packet::Type::CONNECT:
             {
-                process_connect_packet( dynamic_pointer_cast<protocol::connect>( packet ) );
-                // Keep us in the loop!
-                read_frame( );
+                process_connect_packet( static_pointer_cast<protocol::connect>( packet ) );
             }
             break;
             case packet::Type::PINGREQ:
             {
-                write_packet( pingresp( ) );
+                write_encoded_packet( encoder::PINGRESP );
                 logger_->info( "--- PROCESSED: {}", *packet );
-                // Keep us in the loop!
-                read_frame( );
             }
             break;
             case packet::Type::DISCONNECT:
             {
-                process_disconnect_packet( dynamic_pointer_cast<protocol::disconnect>( packet ) );
+                process_disconnect_packet( static_pointer_cast<protocol::disconnect>( packet ) );
                 // Terminate loop
+                return false;
             }
-            break;
+            // Packet types have been checked by our decoder, so we may safely skip RTTI
             case packet::Type::SUBSCRIBE:
+                dispatcher_.client_subscribed( session_binding_, static_pointer_cast<protocol::subscribe>( packet ) );
+                break;
             case packet::Type::UNSUBSCRIBE:
+                dispatcher_.client_unsubscribed( session_binding_,
+                                                 static_pointer_cast<protocol::unsubscribe>( packet ) );
+                break;
             case packet::Type::PUBLISH:
+                dispatcher_.client_published( session_binding_, static_pointer_cast<protocol::publish>( packet ) );
+                break;
             case packet::Type::PUBACK:
+                dispatcher_.client_acked_publish( session_binding_, static_pointer_cast<protocol::puback>( packet ) );
+                break;
             case packet::Type::PUBREC:
+                dispatcher_.client_received_publish( session_binding_,
+                                                     static_pointer_cast<protocol::pubrec>( packet ) );
+                break;
             case packet::Type::PUBREL:
+                dispatcher_.client_released_publish( session_binding_,
+                                                     static_pointer_cast<protocol::pubrel>( packet ) );
+                break;
             case packet::Type::PUBCOMP:
-            {
-                dispatch_packet( packet );
-                // Keep us in the loop!
-                read_frame( );
-            }
-            break;
+                dispatcher_.client_completed_publish( session_binding_,
+                                                      static_pointer_cast<protocol::pubcomp>( packet ) );
+                break;
             case packet::Type::CONNACK:
             case packet::Type::PINGRESP:
             case packet::Type::SUBACK:
@@ -268,6 +300,8 @@ namespace io_wally
                 assert( false );
                 break;
         }
+
+        return true;
     }
 
     void mqtt_connection::process_connect_packet( const shared_ptr<protocol::connect>& connect )
@@ -289,7 +323,7 @@ namespace io_wally
         }
         else
         {
-            close_on_connection_timeout_.cancel( );
+            timing_wheel_.cancel( connect_timeout_ );
             client_id_.emplace( connect->client_id( ) );  // use emplace() to preserve string constness
             description_ = connection_description( socket_, *client_id_ );
 
@@ -307,11 +341,10 @@ namespace io_wally
     void mqtt_connection::dispatch_connect_packet( const shared_ptr<protocol::connect>& connect )
     {
         logger_->debug( "--- DISPATCHING: {} ...", *connect );
-        const auto connect_container = packet_container_t::contain( connect->client_id( ), shared_from_this( ), connect,
-                                                                    dispatch::disconnect_reason::client_disconnect );
-        dispatcher_.handle_packet_received( connect_container );
+        session_binding_ = make_shared<dispatch::session_binding>( );
+        dispatcher_.client_connected( connect, shared_from_this( ), session_binding_ );
+        // Our session manager sends CONNACK, since only it knows whether a persistent session is present
         logger_->debug( "--- DISPATCHED:  {}", *connect );
-        write_packet( connack{false, connect_return_code::CONNECTION_ACCEPTED} );
     }
 
     void mqtt_connection::process_disconnect_packet( const shared_ptr<protocol::disconnect>& disconnect )
@@ -323,9 +356,7 @@ namespace io_wally
                                                       const dispatch::disconnect_reason disconnect_reason )
     {
         logger_->debug( "--- DISPATCHING: {} [rsn:{}] ...", *disconnect, disconnect_reason );
-        const auto disconnect_container =
-            packet_container_t::contain( *client_id_, shared_from_this( ), disconnect, disconnect_reason );
-        dispatcher_.handle_packet_received( disconnect_container );
+        dispatcher_.client_disconnected( session_binding_, disconnect_reason );
         logger_->info( "--- DISPATCHED:  {} [rsn:{}]", *disconnect, disconnect_reason );
 
         auto msg = ostringstream{};
@@ -333,39 +364,79 @@ namespace io_wally
         stop( msg.str( ), spdlog::level::level_enum::info );
     }
 
-    void mqtt_connection::dispatch_packet( const shared_ptr<protocol::mqtt_packet>& packet )
+    // Sending messages
+
+    void mqtt_connection::write_packet( const protocol::mqtt_packet& packet )
+    {
+        logger_->debug( ">>> SEND: {} ...", packet );
+        auto start_writing = false;
+        if ( packet.type( ) == protocol::packet::Type::PUBLISH )
+        {
+            // PUBLISH packets are usually sent to many subscribers: reference their shared topic and application
+            // message instead of copying them into each connection's outbound_queue_
+            const auto& publish = static_cast<const protocol::publish&>( packet );
+            start_writing = outbound_queue_.push_parts(
+                publish.body( ), [&publish]( outbound_queue::packet_writer& writer ) {
+                    encoder::encode_publish_parts( publish, writer );
+                } );
+        }
+        else
+        {
+            start_writing = outbound_queue_.push(
+                packet.total_length( ), [this, &packet]( buf_iter buf_start, buf_iter buf_end ) {
+                    packet_encoder_.encode( packet, buf_start, buf_end );
+                } );
+        }
+        if ( start_writing )
+            this->start_writing( );
+    }
+
+    template <std::size_t N>
+    void mqtt_connection::write_encoded_packet( const encoder::encoded_packet<N>& encoded )
     {
-        logger_->debug( "--- DISPATCHING: {} ...", *packet );
-        const auto subscribe_container = packet_container_t::contain( *client_id_, shared_from_this( ), packet );
-        dispatcher_.handle_packet_received( subscribe_container );
-        logger_->debug( "--- DISPATCHED:  {}", *packet );
+        // Fixed size packets are copied as is, sparing us creating a packet object and running it through our encoder
+        if ( outbound_queue_.push( N, [&encoded]( buf_iter buf_start, buf_iter /* buf_end */ ) {
+                 std::copy( encoded.begin( ), encoded.end( ), buf_start );
+             } ) )
+            start_writing( );
     }
 
-    // Sending messages
+    void mqtt_connection::start_writing( )
+    {
+        // Always post, even when called on our strand, giving packets sent in quick succession a chance to pile up in
+        // outbound_queue_
+        auto self = shared_from_this( );
+        strand_.post( [self]( ) { self->write_next( ); } );
+    }
 
-    void mqtt_connection::write_packet( const protocol::mqtt_packet& packet )
+    void mqtt_connection::write_next( )
     {
         if ( !socket_.is_open( ) )  // Socket was asynchronously closed
             return;
 
-        logger_->debug( ">>> SEND: {} ...", packet );
-        write_buffer_.clear( );
-        write_buffer_.resize( packet.total_length( ) );
-        packet_encoder_.encode( packet, write_buffer_.begin( ), write_buffer_.begin( ) + packet.total_length( ) );
+        const auto& buffers = outbound_queue_.next_write( );
+        if ( buffers.empty( ) )
+        {
+            if ( close_when_flushed_ )
+            {
+                connection_close_requested( ">>> SENT", *close_when_flushed_, std::error_code{},
+                                            spdlog::level::level_enum::debug );
+            }
+            return;
+        }
 
         auto self = shared_from_this( );
-        asio::async_write( socket_, asio::buffer( write_buffer_.data( ), packet.total_length( ) ),
-                           strand_.wrap( [self]( const std::error_code& ec, size_t bytes_written ) {
+        asio::async_write( socket_, buffers, strand_.wrap( [self]( const std::error_code& ec, size_t bytes_written ) {
                                if ( ec )
                                {
                                    self->connection_close_requested(
-                                       "Failed to send packet", dispatch::disconnect_reason::network_or_server_failure,
-                                       ec, spdlog::level::level_enum::err );
-                               }
-                               else
-                               {
-                                   self->logger_->debug( ">>> SENT: [{}] bytes", bytes_written );
+                                       ">>> Failed to send packet",
+                                       dispatch::disconnect_reason::network_or_server_failure, ec,
+                                       spdlog::level::level_enum::err );
+                                   return;
                                }
+                               self->logger_->debug( ">>> SENT: [{}] bytes", bytes_written );
+                               self->write_next( );
                            } ) );
     }
 
@@ -377,24 +448,8 @@ namespace io_wally
             return;
 
         logger_->debug( ">>> SEND: {} - {} ...", packet, message );
-        write_buffer_.clear( );
-        write_buffer_.resize( packet.total_length( ) );
-        packet_encoder_.encode( packet, write_buffer_.begin( ), write_buffer_.begin( ) + packet.total_length( ) );
-
-        auto self = shared_from_this( );
-        asio::async_write( socket_, asio::buffer( write_buffer_.data( ), packet.total_length( ) ),
-                           strand_.wrap( [self, reason]( const std::error_code& ec, size_t /* bytes_written */ ) {
-                               if ( ec )
-                               {
-                                   self->connection_close_requested( ">>> Failed to send packet", reason, ec,
-                                                                     spdlog::level::level_enum::err );
-                               }
-                               else
-                               {
-                                   self->connection_close_requested( ">>> SENT", reason, ec,
-                                                                     spdlog::level::level_enum::debug );
-                               }
-                           } ) );
+        close_when_flushed_ = reason;
+        write_packet( packet );
     }
 
     // Closing this connection
@@ -403,33 +458,33 @@ namespace io_wally
     {
         if ( keep_alive_ )
         {
+            // Rather than re-arming this timeout on every packet received, we arm it once and, when it expires,
+            // check if we have received anything since
             auto self = shared_from_this( );
-            close_on_keep_alive_timeout_.expires_from_now( *keep_alive_ );
-            close_on_keep_alive_timeout_.async_wait(
-                strand_.wrap( [self]( const std::error_code& ec ) { self->handle_keep_alive_timeout( ec ); } ) );
+            const auto idle = timing_wheel_.now( ) - last_activity_;
+            keep_alive_timeout_ = timing_wheel_.schedule( *keep_alive_ - idle, [self]( ) {
+                self->strand_.dispatch( [self]( ) { self->handle_keep_alive_timeout( ); } );
+            } );
         }
     }
 
-    void mqtt_connection::handle_keep_alive_timeout( const std::error_code& ec )
+    void mqtt_connection::handle_keep_alive_timeout( )
     {
-        if ( !ec )
-        {
-            auto msg = ostringstream{};
-            msg << "Keep alive timeout expired after [" << ( keep_alive_ )->count( ) << "] s";
-            connection_close_requested( msg.str( ), dispatch::disconnect_reason::keep_alive_timeout_expired, ec,
-                                        spdlog::level::level_enum::warn );
-        }
-        else if ( ec == asio::error::operation_aborted )
+        keep_alive_timeout_ = timing_wheel::timer_id{};
+        if ( !socket_.is_open( ) )
+            return;
+
+        if ( timing_wheel_.now( ) - last_activity_ < *keep_alive_ )
         {
-            if ( socket_.is_open( ) )
-            {
-                // Received packet and thus cancelled this timer - start next to keep us in the loop
-                close_on_keep_alive_timeout( );
-            }
+            // Received packet in the meantime - start next timeout to keep us in the loop
+            close_on_keep_alive_timeout( );
         }
         else
         {
-            assert( false );  // We should never get here
+            auto msg = ostringstream{};
+            msg << "Keep alive timeout expired after [" << ( keep_alive_ )->count( ) << "] s";
+            connection_close_requested( msg.str( ), dispatch::disconnect_reason::keep_alive_timeout_expired,
+                                        std::error_code{}, spdlog::level::level_enum::warn );
         }
     }
 
@@ -454,7 +509,7 @@ namespace io_wally
                 case dispatch::disconnect_reason::protocol_violation:
                 case dispatch::disconnect_reason::keep_alive_timeout_expired:
                 {
-                    dispatcher_.client_disconnected_ungracefully( *client_id_, reason );
+                    dispatcher_.client_disconnected_ungracefully( session_binding_, reason );
 
                     auto msg = ostringstream{};
                     msg << "--- Connection disconnected ungracefully: " << reason;
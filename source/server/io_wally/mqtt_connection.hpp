@@ -1,25 +1,28 @@
 #pragma once
 
 #include <chrono>
+#include <cstdint>
 #include <memory>
 #include <vector>
 
 #include <system_error>
 
 #include <asio.hpp>
-#include <asio/steady_timer.hpp>
 
 #include <optional>
 
 #include "io_wally/context.hpp"
 #include "io_wally/logging_support.hpp"
 #include "io_wally/mqtt_packet_sender.hpp"
+#include "io_wally/outbound_queue.hpp"
+#include "io_wally/timing_wheel.hpp"
 
 #include "io_wally/logging/logging.hpp"
 
 #include "io_wally/protocol/protocol.hpp"
 
 #include "io_wally/codec/decoder.hpp"
+#include "io_wally/codec/fixed_size_packet_encoder.hpp"
 #include "io_wally/codec/mqtt_packet_decoder.hpp"
 #include "io_wally/codec/mqtt_packet_encoder.hpp"
 
@@ -27,6 +30,7 @@
 
 #include "io_wally/dispatch/common.hpp"
 #include "io_wally/dispatch/dispatcher.hpp"
+#include "io_wally/dispatch/session_binding.hpp"
 
 namespace io_wally
 {
@@ -74,8 +78,17 @@ namespace io_wally
         }
 
         /// \brief Send an \c mqtt_packet to connected client.
+        ///
+        /// Thread safe: \c packet will be encoded onto this connection's \c outbound_queue on the calling thread, yet
+        /// written on this connection's strand.
         void send( protocol::mqtt_packet::ptr packet ) override;
 
+        /// \brief Send a PUBACK, PUBREC, PUBREL or PUBCOMP packet to connected client.
+        ///
+        /// Thread safe: patches \c packet_identifier into a pre-encoded packet that is copied onto this connection's
+        /// \c outbound_queue on the calling thread, without allocating anything.
+        void send_publish_ack( protocol::packet::Type type, std::uint16_t packet_identifier ) override;
+
         /// \brief Stop this connection, closing its \c tcp::socket.
         void stop( const std::string& message = "",
                    const spdlog::level::level_enum log_level = spdlog::level::level_enum::info ) override;
@@ -96,17 +109,18 @@ namespace io_wally
 
         // Receiving MQTT packets
 
-        void read_frame( );
+        void read_frames( );
 
-        void on_frame_read( const std::error_code& ec, const size_t bytes_transferred );
+        void on_frames_read( const std::error_code& ec, const size_t bytes_transferred );
 
-        void decode_packet( const size_t bytes_transferred );
+        void decode_packets( const size_t bytes_transferred );
 
         void on_read_failed( const std::error_code& ec, const size_t bytes_transferred );
 
         // Processing decoded packets
 
-        void process_decoded_packet( const std::shared_ptr<protocol::mqtt_packet>& packet );
+        /// \return \c false if we should stop reading from this connection, \c true otherwise
+        auto process_decoded_packet( const std::shared_ptr<protocol::mqtt_packet>& packet ) -> bool;
 
         // Dealing with CONNECT packets
 
@@ -122,14 +136,17 @@ namespace io_wally
             const std::shared_ptr<protocol::disconnect>& disconnect,
             const dispatch::disconnect_reason disconnect_reason = dispatch::disconnect_reason::client_disconnect );
 
-        // Dealing with non-connection managing packets
-
-        void dispatch_packet( const std::shared_ptr<protocol::mqtt_packet>& packet );
-
         // Sending MQTT packets
 
         void write_packet( const protocol::mqtt_packet& packet );
 
+        template <std::size_t N>
+        void write_encoded_packet( const encoder::encoded_packet<N>& encoded );
+
+        void start_writing( );
+
+        void write_next( );
+
         void write_packet_and_close_connection( const protocol::mqtt_packet& packet,
                                                 const std::string& message,
                                                 const dispatch::disconnect_reason reason );
@@ -141,7 +158,7 @@ namespace io_wally
 
         void close_on_keep_alive_timeout( );
 
-        void handle_keep_alive_timeout( const std::error_code& ec );
+        void handle_keep_alive_timeout( );
 
         // Dealing with protocol violations and network/server failures
 
@@ -153,6 +170,8 @@ namespace io_wally
        private:
         /// Connected client's client_id. Only assigned once successful authenticated.
         std::optional<const std::string> client_id_ = std::nullopt;
+        /// Binding to our client's session, created upon CONNECT and only ever dereferenced on dispatcher's thread
+        std::shared_ptr<dispatch::session_binding> session_binding_{};
         /// This connection's current string represenation, used in log output
         std::string description_;
         /// Encode outgoing packets
@@ -167,20 +186,24 @@ namespace io_wally
         const context& context_;
         /// dispatcher for publishing messages
         dispatch::dispatcher& dispatcher_;
-        /// Buffer incoming data
-        std::vector<uint8_t> read_buffer_;
-        /// Read entire MQTT frame
-        decoder::frame_reader frame_reader_{read_buffer_};
+        /// Buffer incoming data, handing out every complete MQTT frame received so far
+        decoder::frame_buffer frame_buffer_;
         /// For decoding mqtt packets, you know
         const decoder::mqtt_packet_decoder packet_decoder_{};
-        /// Buffer outgoing data
-        std::vector<uint8_t> write_buffer_;
-        /// Timer, will fire if connection timeout expires without receiving a CONNECT request
-        asio::steady_timer close_on_connection_timeout_;
+        /// Queue outgoing packets, allowing for only one write in flight at any time
+        outbound_queue outbound_queue_;
+        /// Set if this connection should be closed once outbound_queue_ has been flushed
+        std::optional<dispatch::disconnect_reason> close_when_flushed_ = std::nullopt;
+        /// Timing wheel shared by all connections on our io_service, used for connect and keep alive timeouts
+        timing_wheel& timing_wheel_;
+        /// Timeout, will expire if we do not receive a CONNECT request in time
+        timing_wheel::timer_id connect_timeout_{};
         /// Keep alive duration (seconds)
         std::optional<std::chrono::duration<uint16_t>> keep_alive_ = std::nullopt;
-        /// Timer, will fire if keep alive timeout expires without receiving a message
-        asio::steady_timer close_on_keep_alive_timeout_;
+        /// Timeout, will check if keep alive duration has expired without receiving a message
+        timing_wheel::timer_id keep_alive_timeout_{};
+        /// When we last received data
+        timing_wheel::clock::time_point last_activity_{};
         /// Our logger
         std::unique_ptr<spdlog::logger> logger_ =
             context_.logger_factory( ).logger( mqtt_connection::endpoint_description( socket_ ) );
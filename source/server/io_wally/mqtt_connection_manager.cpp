@@ -14,23 +14,35 @@ namespace io_wally
 
     void mqtt_connection_manager::start( mqtt_connection::ptr connection )
     {
-        connections_.insert( connection );
+        {
+            const auto lock = std::lock_guard<std::mutex>{connections_mutex_};
+            connections_.insert( connection );
+        }
         connection->start( );
         logger_->debug( "STARTED: {}", *connection );
     }
 
     void mqtt_connection_manager::stop( mqtt_connection::ptr connection )
     {
-        connections_.erase( connection );
+        // Called on connection's strand
+        {
+            const auto lock = std::lock_guard<std::mutex>{connections_mutex_};
+            connections_.erase( connection );
+        }
         connection->do_stop( );
         logger_->debug( "STOPPED: {}", *connection );
     }
 
     void mqtt_connection_manager::stop_all( )
     {
-        for ( const auto& c : connections_ )
-            c->do_stop( );
-        connections_.clear( );
+        auto connections = std::set<mqtt_connection::ptr>{};
+        {
+            const auto lock = std::lock_guard<std::mutex>{connections_mutex_};
+            connections.swap( connections_ );
+        }
+        // Each connection needs to be stopped on its own strand, which is in general not the calling thread's
+        for ( const auto& c : connections )
+            c->strand_.dispatch( [c]( ) { c->do_stop( ); } );
         logger_->debug( "All connections stopped" );
     }
 }  // namespace io_wally
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <mutex>
 #include <set>
 
 #include <spdlog/spdlog.h>
@@ -14,6 +15,8 @@ namespace io_wally
     /// Manages open \c mqtt_connections so that they may be cleanly stopped when the server
     /// needs to shut down.
     ///
+    /// Thread safe: connections served by different network threads will be started and stopped concurrently.
+    ///
     /// Rather unabashed copy:
     /// \see http://www.boost.org/doc/libs/1_58_0/doc/html/boost_asio/example/cpp11/http/server/connection_manager.hpp
     class mqtt_connection_manager final
@@ -37,6 +40,8 @@ namespace io_wally
         void stop_all( );
 
        private:
+        /// Guards connections_
+        std::mutex connections_mutex_{};
         /// The managed connections.
         std::set<mqtt_connection::ptr> connections_{};
         /// Our logger
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <optional>
 #include <ostream>
@@ -20,9 +21,6 @@ namespace io_wally
         /// Shared pointer
         using ptr = std::shared_ptr<mqtt_packet_sender>;
 
-        /// A container for protocol packets
-        using packet_container_t = dispatch::packet_container<mqtt_packet_sender>;
-
        public:
         virtual ~mqtt_packet_sender( ) = default;
 
@@ -30,9 +28,22 @@ namespace io_wally
         [[nodiscard]] virtual auto client_id( ) const -> const std::optional<const std::string>& = 0;
 
         /// \brief Send an \c mqtt_packet to connected client.
+        ///
+        /// Implementations need to be thread safe.
         virtual void send( protocol::mqtt_packet::ptr packet ) = 0;
 
+        /// \brief Send a PUBACK, PUBREC, PUBREL or PUBCOMP packet to connected client, without creating a packet
+        /// object.
+        ///
+        /// Implementations need to be thread safe.
+        ///
+        /// \param type              Type of packet to send, one of PUBACK, PUBREC, PUBREL or PUBCOMP
+        /// \param packet_identifier Packet identifier of packet to send
+        virtual void send_publish_ack( protocol::packet::Type type, std::uint16_t packet_identifier ) = 0;
+
         /// \brief Stop this connection, closing its \c tcp::socket.
+        ///
+        /// Implementations need to be thread safe.
         virtual void stop( const std::string& message = "",
                            const spdlog::level::level_enum log_level = spdlog::level::level_enum::info ) = 0;
 
@@ -44,6 +44,7 @@ namespace io_wally
 
         do_accept( );
 
+        dispatcher_.run( );
         network_service_pool_.run( );
         logger_->info( "STARTED: MQTT server ({})", acceptor_ );
 
@@ -75,6 +76,7 @@ namespace io_wally
     void mqtt_server::stop( const std::string& message )
     {
         network_service_pool_.stop( );
+        dispatcher_.stop( message );
 
         logger_->debug( message );
     }
@@ -91,8 +93,11 @@ namespace io_wally
     void mqtt_server::do_accept( )
     {
         auto self = shared_from_this( );
-        acceptor_.async_accept( socket_, [self]( const std::error_code& ec ) {
-            self->logger_->debug( "ACCEPTED: {}", self->socket_ );
+        // Socket is bound to next io_service in our pool, thus distributing client connections across all network
+        // threads
+        auto socket = std::make_shared<asio::ip::tcp::socket>( network_service_pool_.io_service( ) );
+        acceptor_.async_accept( *socket, [self, socket]( const std::error_code& ec ) {
+            self->logger_->debug( "ACCEPTED: {}", *socket );
 
             // Check whether the mqtt_server was stopped by a signal before this
             // completion handler had a chance to run.
@@ -103,7 +108,7 @@ namespace io_wally
             if ( !ec )
             {
                 mqtt_connection::ptr session = mqtt_connection::create(
-                    move( self->socket_ ), self->connection_manager_, self->context_, self->dispatcher_ );
+                    move( *socket ), self->connection_manager_, self->context_, self->dispatcher_ );
                 self->connection_manager_.start( session );
             }
 
@@ -90,18 +90,18 @@ namespace io_wally
         std::condition_variable conn_closed_{};
         /// Our session manager that manages all connections
         mqtt_connection_manager connection_manager_{context_};
-        /// Pool of io_service objects used for all things networking (just one io_service object for now)
-        concurrency::io_service_pool network_service_pool_{context_, "network", 1};
-        /// The io_service used to perform asynchronous operations.
+        /// Pool of io_service objects used for all things networking. Each accepted client connection is owned by
+        /// one of these io_service objects, assigned round-robin.
+        concurrency::io_service_pool network_service_pool_{
+            context_, "network", context_[context::NETWORK_THREADS].as<std::size_t>( )};
+        /// The io_service used for accepting connections and handling signals.
         asio::io_service& io_service_{network_service_pool_.io_service( )};
         /// Dispatcher: dispatch received packets to dispatcher subsystem
-        dispatch::dispatcher dispatcher_{context_, io_service_};
+        dispatch::dispatcher dispatcher_{context_};
         /// The signal_set is used to register for process termination notifications
         asio::signal_set termination_signals_{io_service_, SIGINT, SIGTERM, SIGQUIT};
         /// Acceptor used to listen for incoming connections.
         asio::ip::tcp::acceptor acceptor_{io_service_};
-        /// The next socket to be accepted.
-        asio::ip::tcp::socket socket_{io_service_};
         /// Our logger
         std::unique_ptr<spdlog::logger> logger_ = context_.logger_factory( ).logger( "server" );
     };
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <asio.hpp>
+
+namespace io_wally
+{
+    /// \brief Queue of encoded MQTT packets waiting to be written to a client connection.
+    ///
+    /// Any number of threads may \c push packets onto an \c outbound_queue, while a single writer - an \c
+    /// mqtt_connection's strand - takes them off again via \c next_write. Packets pushed while a write is in flight
+    /// accumulate and will be handed to the writer as one batch of buffers, to be written using a single
+    /// scatter-gather write. Small packets are coalesced into contiguous buffers. Parts of packets shared between
+    /// several connections, like a PUBLISH packet's application message, may be referenced instead of copied (see \c
+    /// push_parts).
+    ///
+    /// Internally, an \c outbound_queue uses two generations of buffers, one collecting pushed packets and one being
+    /// written, that are swapped once the latter has been fully written. Since both generations retain their
+    /// capacity, a queue will eventually stop allocating memory.
+    class outbound_queue final
+    {
+       public:
+        /// \brief Create a new \c outbound_queue.
+        ///
+        /// \param initial_capacity Number of bytes to initially reserve for each buffer generation
+        /// \param flush_threshold Maximum number of bytes handed to a single write, unless a single packet exceeds
+        ///        this threshold
+        outbound_queue( std::size_t initial_capacity, std::size_t flush_threshold )
+            : flush_threshold_{flush_threshold > 0 ? flush_threshold : 1}
+        {
+            pending_.bytes.reserve( initial_capacity );
+            in_flight_.bytes.reserve( initial_capacity );
+        }
+
+        outbound_queue( const outbound_queue& ) = delete;
+
+        auto operator=( const outbound_queue& ) -> outbound_queue& = delete;
+
+        /// \brief Appends the parts of a single packet to an \c outbound_queue.
+        ///
+        /// Passed to the callable given to \c outbound_queue::push_parts, and only valid during that call.
+        class packet_writer final
+        {
+           public:
+            /// \brief Append \c length bytes, to be encoded by \c encode, to the current packet.
+            ///
+            /// \param length Number of bytes to append
+            /// \param encode Callable taking an iterator range of \c length bytes to encode into
+            template <typename ENCODE>
+            auto append( std::size_t length, ENCODE&& encode ) -> void
+            {
+                auto& gen = queue_.pending_;
+                const auto offset = gen.bytes.size( );
+                gen.bytes.resize( offset + length );
+                encode( gen.bytes.begin( ) + offset, gen.bytes.end( ) );
+                if ( !gen.segments.empty( ) && ( gen.segments.back( ).shared == nullptr ) &&
+                     ( gen.segments.back( ).length < queue_.flush_threshold_ ) )
+                    gen.segments.back( ).length += length;
+                else
+                    gen.segments.push_back( segment{offset, length, nullptr} );
+                gen.length += length;
+            }
+
+            /// \brief Append \c length bytes starting at \c data to the current packet, without copying them.
+            ///
+            /// \c data needs to remain valid until the packet has been written, which is what the \c keep_alive
+            /// argument to \c outbound_queue::push_parts is for.
+            ///
+            /// \param data Start of externally owned bytes to append
+            /// \param length Number of bytes to append
+            auto append_shared( const std::uint8_t* data, std::size_t length ) -> void
+            {
+                auto& gen = queue_.pending_;
+                gen.segments.push_back( segment{0, length, data} );
+                gen.length += length;
+            }
+
+           private:
+            friend class outbound_queue;
+
+            explicit packet_writer( outbound_queue& queue ) : queue_{queue}
+            {
+            }
+
+           private:
+            outbound_queue& queue_;
+        };  // class packet_writer
+
+        /// \brief Push a packet of size \c length, to be encoded by \c encode, onto this queue.
+        ///
+        /// Thread safe.
+        ///
+        /// \param length Encoded packet's length in bytes
+        /// \param encode Callable taking an iterator range of \c length bytes to encode the packet into
+        /// \return \c true if this queue was idle before, and the caller thus needs to start writing, \c false
+        ///         otherwise
+        template <typename ENCODE>
+        auto push( std::size_t length, ENCODE&& encode ) -> bool
+        {
+            return push_parts( nullptr, [length, &encode]( packet_writer& writer ) {
+                writer.append( length, std::forward<ENCODE>( encode ) );
+            } );
+        }
+
+        /// \brief Push a packet assembled by \c build from encoded and externally owned parts onto this queue.
+        ///
+        /// This allows for writing a packet's immutable parts, e.g. a PUBLISH packet's application message, from
+        /// memory shared with other connections instead of copying them into this queue.
+        ///
+        /// Thread safe.
+        ///
+        /// \param keep_alive Owner of all externally owned parts, retained until this packet has been written
+        /// \param build Callable taking a \c packet_writer& to append this packet's parts to
+        /// \return \c true if this queue was idle before, and the caller thus needs to start writing, \c false
+        ///         otherwise
+        template <typename BUILD>
+        auto push_parts( std::shared_ptr<const void> keep_alive, BUILD&& build ) -> bool
+        {
+            const auto lock = std::lock_guard<std::mutex>{mutex_};
+            auto writer = packet_writer{*this};
+            build( writer );
+            if ( keep_alive )
+                pending_.keep_alive.push_back( std::move( keep_alive ) );
+
+            const auto start_writing = !writing_;
+            writing_ = true;
+            return start_writing;
+        }
+
+        /// \brief Take next batch of buffers to write off this queue, releasing the previous batch.
+        ///
+        /// Must only be called by the single writer, once after \c push returned \c true and then once after each
+        /// completed write. The returned buffers remain valid until the next call.
+        ///
+        /// \return Buffers to write in a single scatter-gather write, or an empty vector if there is nothing left to
+        ///         write, in which case this queue has become idle
+        auto next_write( ) -> const std::vector<asio::const_buffer>&
+        {
+            const auto lock = std::lock_guard<std::mutex>{mutex_};
+            buffers_.clear( );
+            if ( next_segment_ == in_flight_.segments.size( ) )
+            {
+                in_flight_.clear( );
+                next_segment_ = 0;
+                if ( pending_.segments.empty( ) )
+                {
+                    writing_ = false;
+                    return buffers_;
+                }
+                std::swap( pending_, in_flight_ );
+            }
+
+            auto batch_length = std::size_t{0};
+            while ( ( next_segment_ < in_flight_.segments.size( ) ) && ( batch_length < flush_threshold_ ) )
+            {
+                const auto& seg = in_flight_.segments[next_segment_++];
+                buffers_.emplace_back( seg.shared != nullptr ? seg.shared : in_flight_.bytes.data( ) + seg.offset,
+                                       seg.length );
+                batch_length += seg.length;
+            }
+            assert( !buffers_.empty( ) );
+
+            return buffers_;
+        }
+
+        /// \brief Number of bytes pushed, but not yet handed to the writer.
+        ///
+        /// Thread safe.
+        [[nodiscard]] auto pending_bytes( ) -> std::size_t
+        {
+            const auto lock = std::lock_guard<std::mutex>{mutex_};
+            return pending_.length;
+        }
+
+       private:
+        struct segment final
+        {
+            /// Offset into its generation's bytes, if not shared
+            std::size_t offset;
+            std::size_t length;
+            /// Start of externally owned bytes, or \c nullptr
+            const std::uint8_t* shared;
+        };  // struct segment
+
+        struct generation final
+        {
+            std::vector<std::uint8_t> bytes{};
+            std::vector<segment> segments{};
+            /// Owners of all externally owned segments
+            std::vector<std::shared_ptr<const void>> keep_alive{};
+            /// Total number of bytes in all segments
+            std::size_t length{0};
+
+            void clear( )
+            {
+                bytes.clear( );
+                segments.clear( );
+                keep_alive.clear( );
+                length = 0;
+            }
+        };  // struct generation
+
+       private:
+        const std::size_t flush_threshold_;
+        std::mutex mutex_{};
+        /// Packets pushed, but not yet handed to the writer
+        generation pending_{};
+        /// Packets handed to the writer
+        generation in_flight_{};
+        /// Index of first segment in in_flight_ not yet handed to the writer
+        std::size_t next_segment_{0};
+        /// Buffers currently being written
+        std::vector<asio::const_buffer> buffers_{};
+        /// Whether a write is currently in flight or about to be started
+        bool writing_{false};
+    };  // class outbound_queue
+}  // namespace io_wally
@@ -0,0 +1,171 @@
+#include "io_wally/persistence/append_log.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <spdlog/spdlog.h>
+
+#include "io_wally/persistence/record_file.hpp"
+
+namespace io_wally::persistence
+{
+    namespace
+    {
+        auto open_for_append( const std::filesystem::path& path ) -> int
+        {
+            const auto fd = ::open( path.c_str( ), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644 );
+            if ( fd < 0 )
+                throw std::system_error{errno, std::generic_category( ), "Failed to open " + path.string( )};
+            sync_directory( path.has_parent_path( ) ? path.parent_path( ) : std::filesystem::path{"."} );
+
+            return fd;
+        }
+    }  // namespace
+
+    // ------------------------------------------------------------------------------------------------------------
+    // Public
+    // ------------------------------------------------------------------------------------------------------------
+
+    append_log::append_log( const std::filesystem::path& path,
+                            std::unique_ptr<spdlog::logger> logger,
+                            durable_handler on_durable )
+        : logger_{std::move( logger )}, on_durable_{std::move( on_durable )}, fd_{open_for_append( path )}
+    {
+        writer_ = std::thread{[this]( ) { run( ); }};
+    }
+
+    append_log::~append_log( )
+    {
+        {
+            const auto lock = std::lock_guard<std::mutex>{mutex_};
+            stopped_ = true;
+        }
+        appended_cv_.notify_one( );
+        writer_.join( );
+        ::close( fd_ );
+    }
+
+    auto append_log::append( const std::uint8_t* data, const std::size_t size ) -> sequence_t
+    {
+        const auto lock = std::lock_guard<std::mutex>{mutex_};
+        const auto was_idle = pending_.empty( );
+        if ( was_idle )
+            pending_.emplace_back( );
+        auto& appending = pending_.back( );
+        frame_record( appending.bytes, data, size );
+        appending.last = ++appended_;
+        ++appending.records;
+        if ( was_idle )
+            appended_cv_.notify_one( );
+
+        return appended_;
+    }
+
+    void append_log::rotate( const std::filesystem::path& path )
+    {
+        const auto lock = std::lock_guard<std::mutex>{mutex_};
+        pending_.emplace_back( );
+        pending_.back( ).rotate_to = path;
+        appended_cv_.notify_one( );
+    }
+
+    auto append_log::sync( ) -> bool
+    {
+        auto lock = std::unique_lock<std::mutex>{mutex_};
+        const auto target = appended_;
+        durable_cv_.wait( lock, [this, target]( ) { return ( durable_ >= target ) || failed_; } );
+
+        return durable_ >= target;
+    }
+
+    auto append_log::stats( ) const -> statistics
+    {
+        const auto lock = std::lock_guard<std::mutex>{mutex_};
+        return stats_;
+    }
+
+    // ------------------------------------------------------------------------------------------------------------
+    // Private
+    // ------------------------------------------------------------------------------------------------------------
+
+    void append_log::run( )
+    {
+        auto writing = std::vector<batch>{};
+        for ( ;; )
+        {
+            {
+                auto lock = std::unique_lock<std::mutex>{mutex_};
+                appended_cv_.wait( lock, [this]( ) { return stopped_ || !pending_.empty( ); } );
+                if ( pending_.empty( ) )
+                    return;
+                writing.swap( pending_ );
+            }
+            write( writing );
+            writing.clear( );
+        }
+    }
+
+    void append_log::write( std::vector<batch>& batches )
+    {
+        auto written = statistics{};
+        auto last = sequence_t{0};
+        auto failed = false;
+        try
+        {
+            for ( const auto& writing : batches )
+            {
+                if ( !writing.rotate_to.empty( ) )
+                    reopen( writing.rotate_to );
+                write_fully( fd_, writing.bytes.data( ), writing.bytes.size( ) );
+                written.records += writing.records;
+                written.bytes += writing.bytes.size( );
+                last = std::max( last, writing.last );
+            }
+            if ( ::fdatasync( fd_ ) < 0 )
+                throw std::system_error{errno, std::generic_category( ), "Failed to sync"};
+            written.syncs = 1;
+        }
+        catch ( const std::exception& e )
+        {
+            logger_->error( "Failed to write [{}] batch(es) to append log: {}", batches.size( ), e.what( ) );
+            failed = true;
+        }
+
+        auto durable = false;
+        {
+            const auto lock = std::lock_guard<std::mutex>{mutex_};
+            stats_.records += written.records;
+            stats_.bytes += written.bytes;
+            stats_.syncs += written.syncs;
+            if ( failed )
+                failed_ = true;
+            durable = !failed_ && ( last > 0 );
+            if ( durable )
+                durable_ = last;
+        }
+        durable_cv_.notify_all( );
+        if ( on_durable_ && durable )
+            on_durable_( last );
+    }
+
+    void append_log::reopen( const std::filesystem::path& path )
+    {
+        if ( ::fdatasync( fd_ ) < 0 )
+            throw std::system_error{errno, std::generic_category( ), "Failed to sync"};
+        ::close( fd_ );
+        fd_ = -1;
+        fd_ = open_for_append( path );
+    }
+}  // namespace io_wally::persistence
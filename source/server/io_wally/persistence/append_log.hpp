@@ -0,0 +1,121 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+namespace io_wally::persistence
+{
+    /// \brief Append-only log of records, written and synced to disk by a background thread using group commit.
+    ///
+    /// Callers on any thread \c append records, which merely copies them into an in-memory batch and never blocks on
+    /// disk I/O. Our writer thread repeatedly takes all records appended since its last turn, writes them, and makes
+    /// them durable using a single \c fdatasync. The slower the disk, the more records share each \c fdatasync.
+    ///
+    /// Each record is identified by a sequence number, increasing by one with each appended record. Whenever a batch
+    /// of records has become durable, our writer thread passes the highest durable sequence number to our \c
+    /// durable_handler, if any. Once writing a batch has failed, no record appended later is ever reported durable,
+    /// since records of that batch may be missing from disk.
+    ///
+    /// An \c append_log may be \c rotated to a new file. Records appended before rotating go to the old file, those
+    /// appended after rotating go to the new file.
+    class append_log final
+    {
+       public:
+        using sequence_t = std::uint64_t;
+
+        /// \brief Called on our writer thread whenever all records up to and including \c durable are on disk.
+        using durable_handler = std::function<void( sequence_t durable )>;
+
+        /// \brief What an \c append_log has written so far.
+        struct statistics final
+        {
+            /// Number of records appended
+            std::uint64_t records{0};
+            /// Number of bytes written, record headers included
+            std::uint64_t bytes{0};
+            /// Number of times records were synced to disk
+            std::uint64_t syncs{0};
+        };  // struct statistics
+
+       public:
+        /// \brief Create a new \c append_log appending to file \c path, and start its writer thread.
+        ///
+        /// \param path File to append to, created if necessary
+        /// \param logger Logger for errors our writer thread encounters
+        /// \param on_durable Called whenever records have become durable, may be empty
+        ///
+        /// \throws std::system_error If \c path cannot be opened
+        append_log( const std::filesystem::path& path,
+                    std::unique_ptr<spdlog::logger> logger,
+                    durable_handler on_durable = {} );
+
+        append_log( const append_log& ) = delete;
+
+        auto operator=( const append_log& ) -> append_log& = delete;
+
+        /// \brief Write and sync all records appended so far, and stop our writer thread.
+        ~append_log( );
+
+        /// \brief Append a record containing \c size bytes starting at \c data. Never waits for disk I/O.
+        ///
+        /// \return Sequence number of appended record
+        auto append( const std::uint8_t* data, std::size_t size ) -> sequence_t;
+
+        /// \brief Append all records appended from now on to file \c path instead.
+        void rotate( const std::filesystem::path& path );
+
+        /// \brief Wait until all records appended so far are on disk.
+        ///
+        /// \return \c false if writing failed and not all records could be made durable
+        auto sync( ) -> bool;
+
+        /// \brief This log's statistics, accumulated since it has been created.
+        [[nodiscard]] auto stats( ) const -> statistics;
+
+       private:
+        /// Records appended to the same file, written by our writer thread in a single turn
+        struct batch final
+        {
+            /// If not empty, the file to switch to before writing this batch
+            std::filesystem::path rotate_to{};
+            /// Framed records
+            std::vector<std::uint8_t> bytes{};
+            /// Sequence number of last record in this batch, 0 if none
+            sequence_t last{0};
+            std::uint64_t records{0};
+        };  // struct batch
+
+       private:
+        void run( );
+
+        void write( std::vector<batch>& batches );
+
+        void reopen( const std::filesystem::path& path );
+
+       private:
+        std::unique_ptr<spdlog::logger> logger_;
+        const durable_handler on_durable_;
+        /// File currently appended to, only ever touched by our writer thread once started
+        int fd_{-1};
+        mutable std::mutex mutex_{};
+        std::condition_variable appended_cv_{};
+        std::condition_variable durable_cv_{};
+        /// Batches waiting to be written, the last one receiving newly appended records
+        std::vector<batch> pending_{};
+        sequence_t appended_{0};
+        sequence_t durable_{0};
+        bool failed_{false};
+        bool stopped_{false};
+        statistics stats_{};
+        std::thread writer_{};
+    };  // class append_log
+}  // namespace io_wally::persistence
@@ -0,0 +1,256 @@
+#include "io_wally/persistence/record_file.hpp"
+
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace io_wally::persistence
+{
+    namespace
+    {
+        /// Largest record we are willing to believe in, guarding against garbage posing as a record's size
+        constexpr std::uint32_t MAX_RECORD_SIZE = 512 * 1024 * 1024;
+
+        [[noreturn]] void throw_system_error( const std::string& what, const std::filesystem::path& path )
+        {
+            throw std::system_error{errno, std::generic_category( ), what + " " + path.string( )};
+        }
+
+        constexpr auto make_crc32c_table( ) -> std::array<std::uint32_t, 256>
+        {
+            auto table = std::array<std::uint32_t, 256>{};
+            for ( auto byte = std::uint32_t{0}; byte < 256; ++byte )
+            {
+                auto crc = byte;
+                for ( auto bit = 0; bit < 8; ++bit )
+                    crc = ( crc & 1 ) ? ( crc >> 1 ) ^ 0x82F63B78 : crc >> 1;
+                table[byte] = crc;
+            }
+            return table;
+        }
+
+        constexpr auto CRC32C_TABLE = make_crc32c_table( );
+
+        auto crc32c_scalar( std::uint32_t crc, const std::uint8_t* data, std::size_t size ) -> std::uint32_t
+        {
+            for ( auto i = std::size_t{0}; i < size; ++i )
+                crc = CRC32C_TABLE[( crc ^ data[i] ) & 0xFF] ^ ( crc >> 8 );
+            return crc;
+        }
+
+        __attribute__( ( target( "sse4.2" ) ) ) auto crc32c_sse42( std::uint32_t crc,
+                                                                   const std::uint8_t* data,
+                                                                   std::size_t size ) -> std::uint32_t
+        {
+            auto crc64 = std::uint64_t{crc};
+            for ( ; size >= 8; data += 8, size -= 8 )
+            {
+                auto word = std::uint64_t{0};
+                std::memcpy( &word, data, sizeof( word ) );
+                crc64 = __builtin_ia32_crc32di( crc64, word );
+            }
+            crc = static_cast<std::uint32_t>( crc64 );
+            for ( ; size > 0; ++data, --size )
+                crc = __builtin_ia32_crc32qi( crc, *data );
+            return crc;
+        }
+
+        auto header_of( const std::uint32_t size, const std::uint32_t crc )
+            -> std::array<std::uint8_t, RECORD_HEADER_SIZE>
+        {
+            auto header = std::array<std::uint8_t, RECORD_HEADER_SIZE>{};
+            std::memcpy( header.data( ), &size, sizeof( size ) );
+            std::memcpy( header.data( ) + sizeof( size ), &crc, sizeof( crc ) );
+            return header;
+        }
+
+        /// Unmaps a memory mapped file when going out of scope
+        class mapped_file final
+        {
+           public:
+            explicit mapped_file( const std::filesystem::path& path )
+            {
+                const auto fd = ::open( path.c_str( ), O_RDONLY | O_CLOEXEC );
+                if ( fd < 0 )
+                    throw_system_error( "Failed to open", path );
+                struct stat status
+                {
+                };
+                if ( ::fstat( fd, &status ) < 0 )
+                {
+                    ::close( fd );
+                    throw_system_error( "Failed to stat", path );
+                }
+                size_ = static_cast<std::size_t>( status.st_size );
+                if ( size_ > 0 )
+                {
+                    data_ = ::mmap( nullptr, size_, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0 );
+                    if ( data_ == MAP_FAILED )
+                    {
+                        ::close( fd );
+                        throw_system_error( "Failed to map", path );
+                    }
+                    ::madvise( data_, size_, MADV_SEQUENTIAL );
+                }
+                ::close( fd );
+            }
+
+            mapped_file( const mapped_file& ) = delete;
+
+            auto operator=( const mapped_file& ) -> mapped_file& = delete;
+
+            ~mapped_file( )
+            {
+                if ( size_ > 0 )
+                    ::munmap( data_, size_ );
+            }
+
+            [[nodiscard]] auto data( ) const -> const std::uint8_t*
+            {
+                return static_cast<const std::uint8_t*>( data_ );
+            }
+
+            [[nodiscard]] auto size( ) const -> std::size_t
+            {
+                return size_;
+            }
+
+           private:
+            void* data_{nullptr};
+            std::size_t size_{0};
+        };  // class mapped_file
+    }  // namespace
+
+    // ------------------------------------------------------------------------------------------------------------
+    // Public
+    // ------------------------------------------------------------------------------------------------------------
+
+    auto crc32c( const std::uint8_t* data, const std::size_t size ) -> std::uint32_t
+    {
+        static const auto has_sse42 = __builtin_cpu_supports( "sse4.2" );
+
+        const auto crc = has_sse42 ? crc32c_sse42( ~std::uint32_t{0}, data, size )
+                                   : crc32c_scalar( ~std::uint32_t{0}, data, size );
+        return ~crc;
+    }
+
+    void frame_record( std::vector<std::uint8_t>& to, const std::uint8_t* data, const std::size_t size )
+    {
+        const auto header = header_of( static_cast<std::uint32_t>( size ), crc32c( data, size ) );
+        to.insert( to.end( ), header.begin( ), header.end( ) );
+        to.insert( to.end( ), data, data + size );
+    }
+
+    auto read_records( const std::filesystem::path& path, const record_handler& on_record ) -> read_result
+    {
+        const auto file = mapped_file{path};
+        auto result = read_result{0, 0, file.size( )};
+
+        auto pos = std::size_t{0};
+        while ( file.size( ) - pos >= RECORD_HEADER_SIZE )
+        {
+            auto size = std::uint32_t{0};
+            auto crc = std::uint32_t{0};
+            std::memcpy( &size, file.data( ) + pos, sizeof( size ) );
+            std::memcpy( &crc, file.data( ) + pos + sizeof( size ), sizeof( crc ) );
+            if ( ( size > MAX_RECORD_SIZE ) || ( file.size( ) - pos - RECORD_HEADER_SIZE < size ) )
+                break;
+            const auto* record = file.data( ) + pos + RECORD_HEADER_SIZE;
+            if ( crc32c( record, size ) != crc )
+                break;
+
+            on_record( record, size );
+            pos += RECORD_HEADER_SIZE + size;
+            ++result.records;
+        }
+        result.valid_bytes = pos;
+
+        return result;
+    }
+
+    void sync_directory( const std::filesystem::path& dir )
+    {
+        const auto fd = ::open( dir.c_str( ), O_RDONLY | O_DIRECTORY | O_CLOEXEC );
+        if ( fd < 0 )
+            throw_system_error( "Failed to open", dir );
+        const auto rc = ::fsync( fd );
+        ::close( fd );
+        if ( rc < 0 )
+            throw_system_error( "Failed to sync", dir );
+    }
+
+    void write_fully( const int fd, const std::uint8_t* data, std::size_t size )
+    {
+        while ( size > 0 )
+        {
+            const auto written = ::write( fd, data, size );
+            if ( written < 0 )
+            {
+                if ( errno == EINTR )
+                    continue;
+                throw std::system_error{errno, std::generic_category( ), "Failed to write"};
+            }
+            data += written;
+            size -= static_cast<std::size_t>( written );
+        }
+    }
+
+    record_file_writer::record_file_writer( std::filesystem::path path )
+        : path_{std::move( path )}, tmp_path_{path_.string( ) + ".tmp"}
+    {
+        fd_ = ::open( tmp_path_.c_str( ), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644 );
+        if ( fd_ < 0 )
+            throw_system_error( "Failed to create", tmp_path_ );
+        buffer_.reserve( BUFFER_SIZE );
+    }
+
+    record_file_writer::~record_file_writer( )
+    {
+        if ( fd_ >= 0 )
+        {
+            ::close( fd_ );
+            ::unlink( tmp_path_.c_str( ) );
+        }
+    }
+
+    void record_file_writer::write( const std::uint8_t* data, const std::size_t size )
+    {
+        frame_record( buffer_, data, size );
+        if ( buffer_.size( ) >= BUFFER_SIZE )
+            flush( );
+    }
+
+    void record_file_writer::commit( )
+    {
+        flush( );
+        if ( ::fdatasync( fd_ ) < 0 )
+            throw_system_error( "Failed to sync", tmp_path_ );
+        ::close( fd_ );
+        fd_ = -1;
+        if ( ::rename( tmp_path_.c_str( ), path_.c_str( ) ) < 0 )
+            throw_system_error( "Failed to rename", tmp_path_ );
+        sync_directory( path_.has_parent_path( ) ? path_.parent_path( ) : std::filesystem::path{"."} );
+    }
+
+    // ------------------------------------------------------------------------------------------------------------
+    // Private
+    // ------------------------------------------------------------------------------------------------------------
+
+    void record_file_writer::flush( )
+    {
+        write_fully( fd_, buffer_.data( ), buffer_.size( ) );
+        buffer_.clear( );
+    }
+}  // namespace io_wally::persistence
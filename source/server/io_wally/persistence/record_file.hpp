@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <vector>
+
+namespace io_wally::persistence
+{
+    /// \brief Size of the header preceding each record on disk: its size and its CRC-32C, both 32 bit unsigned integers
+    /// in host byte order.
+    static constexpr std::size_t RECORD_HEADER_SIZE = 8;
+
+    /// \brief Callback receiving a record's contents, valid only for the duration of that call.
+    using record_handler = std::function<void( const std::uint8_t* data, std::size_t size )>;
+
+    /// \brief What reading a file of records found.
+    struct read_result final
+    {
+        /// Number of intact records read
+        std::uint64_t records{0};
+        /// Number of bytes occupied by intact records: a file may end in a record torn by a crash
+        std::size_t valid_bytes{0};
+        /// Size of the file read
+        std::size_t file_bytes{0};
+    };  // struct read_result
+
+    /// \brief CRC-32C (Castagnoli) of \c size bytes starting at \c data, computed using SSE 4.2 if available.
+    [[nodiscard]] auto crc32c( const std::uint8_t* data, std::size_t size ) -> std::uint32_t;
+
+    /// \brief Append a record containing \c size bytes starting at \c data, preceded by its header, to \c to.
+    void frame_record( std::vector<std::uint8_t>& to, const std::uint8_t* data, std::size_t size );
+
+    /// \brief Memory map file \c path and pass each intact record in it to \c on_record, in order.
+    ///
+    /// Stops at the first record that is truncated or fails its checksum, as is to be expected at the end of a file
+    /// whose writer crashed.
+    ///
+    /// \throws std::system_error If \c path cannot be opened or mapped
+    auto read_records( const std::filesystem::path& path, const record_handler& on_record ) -> read_result;
+
+    /// \brief Flush directory \c dir to disk, making files just created, renamed or removed in it durable.
+    ///
+    /// \throws std::system_error If \c dir cannot be opened or synced
+    void sync_directory( const std::filesystem::path& dir );
+
+    /// \brief Write all \c size bytes starting at \c data to file descriptor \c fd, retrying partial writes.
+    ///
+    /// \throws std::system_error If writing fails
+    void write_fully( int fd, const std::uint8_t* data, std::size_t size );
+
+    /// \brief Writes records to a file that only comes into existence once all records have been written and synced.
+    ///
+    /// Records go to a temporary file first, which \c commit syncs and renames to its final path. Thus, readers of
+    /// that path will either see all records or none.
+    ///
+    /// NOTE: This class is not thread safe.
+    class record_file_writer final
+    {
+       public:
+        /// \brief Create a new \c record_file_writer for file \c path.
+        ///
+        /// \throws std::system_error If \c path's temporary file cannot be created
+        explicit record_file_writer( std::filesystem::path path );
+
+        record_file_writer( const record_file_writer& ) = delete;
+
+        auto operator=( const record_file_writer& ) -> record_file_writer& = delete;
+
+        /// \brief Remove our temporary file, unless already committed.
+        ~record_file_writer( );
+
+        /// \brief Write a record containing \c size bytes starting at \c data.
+        ///
+        /// \throws std::system_error If writing fails
+        void write( const std::uint8_t* data, std::size_t size );
+
+        /// \brief Flush all records written so far to disk, and atomically move them to our final path.
+        ///
+        /// \throws std::system_error If flushing or renaming fails
+        void commit( );
+
+       private:
+        void flush( );
+
+       private:
+        static constexpr std::size_t BUFFER_SIZE = 1024 * 1024;
+
+        const std::filesystem::path path_;
+        const std::filesystem::path tmp_path_;
+        int fd_{-1};
+        std::vector<std::uint8_t> buffer_{};
+    };  // class record_file_writer
+}  // namespace io_wally::persistence
@@ -0,0 +1,323 @@
+#include "io_wally/persistence/retained_store.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include "io_wally/logging/logging.hpp"
+#include "io_wally/persistence/append_log.hpp"
+#include "io_wally/persistence/record_file.hpp"
+#include "io_wally/protocol/common.hpp"
+#include "io_wally/protocol/publish_packet.hpp"
+#include "io_wally/protocol/topic_name.hpp"
+
+namespace io_wally::persistence
+{
+    namespace
+    {
+        constexpr const char* FILE_PREFIX = "retained-";
+
+        constexpr const char* LOG_EXTENSION = ".log";
+
+        constexpr const char* SNAPSHOT_EXTENSION = ".snapshot";
+
+        /// Number of hex digits in a file's generation
+        constexpr std::size_t GENERATION_DIGITS = 16;
+
+        /// Record types
+        constexpr std::uint8_t RETAIN = 1;
+
+        constexpr std::uint8_t REMOVE = 2;
+
+        /// RETAIN record: type, type and flags, topic size, retained at (ms since epoch), payload size
+        constexpr std::size_t RETAIN_HEADER_SIZE = 1 + 1 + 2 + 8 + 4;
+
+        /// REMOVE record: type, unused, topic size
+        constexpr std::size_t REMOVE_HEADER_SIZE = 1 + 1 + 2;
+
+        template <typename T>
+        void put( std::vector<std::uint8_t>& to, const T value )
+        {
+            const auto pos = to.size( );
+            to.resize( pos + sizeof( T ) );
+            std::memcpy( to.data( ) + pos, &value, sizeof( T ) );
+        }
+
+        template <typename T>
+        auto get( const std::uint8_t* from ) -> T
+        {
+            auto value = T{};
+            std::memcpy( &value, from, sizeof( T ) );
+            return value;
+        }
+
+        void encode_retain( std::vector<std::uint8_t>& to,
+                            const protocol::publish& message,
+                            const std::uint8_t type_and_flags,
+                            const retained_store::clock::time_point retained_at )
+        {
+            const auto& topic = message.topic( ).name( );
+            const auto& payload = message.application_message( );
+            const auto retained_at_ms =
+                std::chrono::duration_cast<std::chrono::milliseconds>( retained_at.time_since_epoch( ) ).count( );
+            put( to, RETAIN );
+            put( to, type_and_flags );
+            put( to, static_cast<std::uint16_t>( topic.size( ) ) );
+            put( to, static_cast<std::int64_t>( retained_at_ms ) );
+            put( to, static_cast<std::uint32_t>( payload.size( ) ) );
+            to.insert( to.end( ), topic.begin( ), topic.end( ) );
+            to.insert( to.end( ), payload.begin( ), payload.end( ) );
+        }
+
+        /// Generation of file \c path if it is named like one of our files using \c extension, 0 otherwise
+        auto generation_of( const std::filesystem::path& path, const std::string_view extension ) -> std::uint64_t
+        {
+            const auto name = path.filename( ).string( );
+            const auto prefix = std::string_view{FILE_PREFIX};
+            if ( ( name.size( ) != prefix.size( ) + GENERATION_DIGITS + extension.size( ) ) ||
+                 ( name.compare( 0, prefix.size( ), prefix ) != 0 ) ||
+                 ( name.compare( prefix.size( ) + GENERATION_DIGITS, extension.size( ), extension ) != 0 ) )
+                return 0;
+            const auto digits = name.substr( prefix.size( ), GENERATION_DIGITS );
+            if ( digits.find_first_not_of( "0123456789abcdef" ) != std::string::npos )
+                return 0;
+
+            return std::stoull( digits, nullptr, 16 );
+        }
+    }  // namespace
+
+    // ------------------------------------------------------------------------------------------------------------
+    // Public
+    // ------------------------------------------------------------------------------------------------------------
+
+    retained_store::retained_store( std::filesystem::path dir, const logging::logger_factory& logger_factory )
+        : dir_{std::move( dir )}, logger_{logger_factory.logger( "retained-store" )}
+    {
+        std::filesystem::create_directories( dir_ );
+        auto latest = std::uint64_t{0};
+        for ( const auto& file : std::filesystem::directory_iterator{dir_} )
+        {
+            if ( file.path( ).extension( ) == ".tmp" )
+            {
+                // Left behind by a compaction that did not finish
+                std::filesystem::remove( file.path( ) );
+            }
+            else if ( const auto snapshot = generation_of( file.path( ), SNAPSHOT_EXTENSION ); snapshot > 0 )
+            {
+                snapshot_generation_ = std::max( snapshot_generation_, snapshot );
+                latest = std::max( latest, snapshot );
+            }
+            else if ( const auto log = generation_of( file.path( ), LOG_EXTENSION ); log > 0 )
+            {
+                log_generations_.push_back( log );
+                latest = std::max( latest, log );
+            }
+        }
+        std::sort( log_generations_.begin( ), log_generations_.end( ) );
+
+        // Never append to a log we found: its last record may have been torn by a crash
+        generation_ = latest + 1;
+        log_ = std::make_unique<append_log>( path_of( generation_, LOG_EXTENSION ),
+                                             logger_factory.logger( "retained-store-log" ) );
+    }
+
+    retained_store::~retained_store( )
+    {
+        await_compaction( );
+    }
+
+    auto retained_store::load( const message_handler& on_message, const removal_handler& on_removal ) -> std::uint64_t
+    {
+        auto replayed = std::uint64_t{0};
+        auto malformed = std::uint64_t{0};
+        const auto replay = [&]( const std::uint8_t* data, const std::size_t size ) {
+            if ( ( size >= RETAIN_HEADER_SIZE ) && ( data[0] == RETAIN ) )
+            {
+                const auto type_and_flags = data[1];
+                const auto topic_size = std::size_t{get<std::uint16_t>( data + 2 )};
+                const auto retained_at = clock::time_point{
+                    std::chrono::duration_cast<clock::duration>( std::chrono::milliseconds{get<std::int64_t>( data + 4 )} )};
+                const auto payload_size = std::size_t{get<std::uint32_t>( data + 12 )};
+                if ( size != RETAIN_HEADER_SIZE + topic_size + payload_size )
+                {
+                    ++malformed;
+                    return;
+                }
+
+                const auto* topic = reinterpret_cast<const char*>( data + RETAIN_HEADER_SIZE );
+                const auto* payload = data + RETAIN_HEADER_SIZE + topic_size;
+                const auto qos = protocol::packet::qos_of( type_and_flags, 1 );
+                const auto remaining_length = static_cast<std::uint32_t>(
+                    2 + topic_size + ( qos == protocol::packet::QoS::AT_MOST_ONCE ? 0 : 2 ) + payload_size );
+                on_message( std::make_shared<protocol::publish>(
+                                type_and_flags, remaining_length,
+                                protocol::topic_name::intern( std::string_view{topic, topic_size} ), 0,
+                                std::vector<std::uint8_t>{payload, payload + payload_size} ),
+                            retained_at );
+            }
+            else if ( ( size >= REMOVE_HEADER_SIZE ) && ( data[0] == REMOVE ) )
+            {
+                const auto topic_size = std::size_t{get<std::uint16_t>( data + 2 )};
+                if ( size != REMOVE_HEADER_SIZE + topic_size )
+                {
+                    ++malformed;
+                    return;
+                }
+                const auto* topic = reinterpret_cast<const char*>( data + REMOVE_HEADER_SIZE );
+                on_removal( protocol::topic_name::intern( std::string_view{topic, topic_size} ) );
+            }
+            else
+            {
+                ++malformed;
+                return;
+            }
+            ++replayed;
+        };
+
+        if ( snapshot_generation_ > 0 )
+        {
+            const auto path = path_of( snapshot_generation_, SNAPSHOT_EXTENSION );
+            const auto result = read_records( path, replay );
+            logger_->info( "LOADED: snapshot {} - [records:{}|bytes:{}]", path.string( ), result.records,
+                           result.valid_bytes );
+        }
+        for ( const auto generation : log_generations_ )
+        {
+            if ( generation < snapshot_generation_ )
+                continue;
+            const auto path = path_of( generation, LOG_EXTENSION );
+            const auto result = read_records( path, replay );
+            if ( result.valid_bytes < result.file_bytes )
+                logger_->warn( "Log {} ends in [{}] bytes of torn or corrupt records, ignored", path.string( ),
+                               result.file_bytes - result.valid_bytes );
+            logger_->info( "LOADED: log {} - [records:{}|bytes:{}]", path.string( ), result.records,
+                           result.valid_bytes );
+            log_bytes_ += result.valid_bytes;
+        }
+        if ( malformed > 0 )
+            logger_->warn( "Skipped [{}] malformed record(s)", malformed );
+
+        return replayed;
+    }
+
+    void retained_store::retain( const protocol::publish& message, const clock::time_point retained_at )
+    {
+        record_.clear( );
+        encode_retain( record_, message, message.type_and_flags( ), retained_at );
+        append_record( );
+    }
+
+    void retained_store::remove( const protocol::topic_name& topic )
+    {
+        record_.clear( );
+        put( record_, REMOVE );
+        put( record_, std::uint8_t{0} );
+        put( record_, static_cast<std::uint16_t>( topic.name( ).size( ) ) );
+        record_.insert( record_.end( ), topic.name( ).begin( ), topic.name( ).end( ) );
+        append_record( );
+    }
+
+    auto retained_store::compaction_due( const std::size_t live_bytes ) const -> bool
+    {
+        return !compacting_ && ( log_bytes_ > std::max( MIN_COMPACTION_LOG_BYTES, 2 * live_bytes ) );
+    }
+
+    void retained_store::compact( std::vector<entry> retained )
+    {
+        await_compaction( );
+
+        // Everything appended from now on goes to the next generation's log, and our snapshot will hold everything
+        // appended before
+        ++generation_;
+        log_->rotate( path_of( generation_, LOG_EXTENSION ) );
+        log_bytes_ = 0;
+
+        compacting_ = true;
+        compactor_ = std::thread{[this, generation = generation_, retained = std::move( retained )]( ) {
+            try
+            {
+                const auto started = std::chrono::steady_clock::now( );
+                write_snapshot( generation, retained );
+                remove_older_than( generation );
+                logger_->info( "COMPACTED: [{}] retained message(s) into snapshot {} in [{}] ms", retained.size( ),
+                               generation,
+                               std::chrono::duration_cast<std::chrono::milliseconds>(
+                                   std::chrono::steady_clock::now( ) - started )
+                                   .count( ) );
+            }
+            catch ( const std::exception& e )
+            {
+                logger_->error( "Failed to compact retained messages into snapshot {}: {}", generation, e.what( ) );
+            }
+            compacting_ = false;
+        }};
+    }
+
+    auto retained_store::sync( ) -> bool
+    {
+        await_compaction( );
+        return log_->sync( );
+    }
+
+    // ------------------------------------------------------------------------------------------------------------
+    // Private
+    // ------------------------------------------------------------------------------------------------------------
+
+    auto retained_store::path_of( const std::uint64_t generation, const char* extension ) const
+        -> std::filesystem::path
+    {
+        char name[64];
+        std::snprintf( name, sizeof( name ), "%s%016" PRIx64 "%s", FILE_PREFIX, generation, extension );
+
+        return dir_ / name;
+    }
+
+    void retained_store::append_record( )
+    {
+        log_->append( record_.data( ), record_.size( ) );
+        log_bytes_ += RECORD_HEADER_SIZE + record_.size( );
+    }
+
+    void retained_store::write_snapshot( const std::uint64_t generation, const std::vector<entry>& retained )
+    {
+        auto writer = record_file_writer{path_of( generation, SNAPSHOT_EXTENSION )};
+        auto record = std::vector<std::uint8_t>{};
+        for ( const auto& current : retained )
+        {
+            record.clear( );
+            encode_retain( record, *current.message, current.type_and_flags, current.retained_at );
+            writer.write( record.data( ), record.size( ) );
+        }
+        writer.commit( );
+    }
+
+    void retained_store::remove_older_than( const std::uint64_t generation )
+    {
+        for ( const auto& file : std::filesystem::directory_iterator{dir_} )
+        {
+            const auto snapshot = generation_of( file.path( ), SNAPSHOT_EXTENSION );
+            const auto log = generation_of( file.path( ), LOG_EXTENSION );
+            if ( ( ( snapshot > 0 ) && ( snapshot < generation ) ) || ( ( log > 0 ) && ( log < generation ) ) )
+                std::filesystem::remove( file.path( ) );
+        }
+    }
+
+    void retained_store::await_compaction( )
+    {
+        if ( compactor_.joinable( ) )
+            compactor_.join( );
+    }
+}  // namespace io_wally::persistence
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include "io_wally/logging/logging.hpp"
+#include "io_wally/persistence/append_log.hpp"
+#include "io_wally/protocol/publish_packet.hpp"
+#include "io_wally/protocol/topic_name.hpp"
+
+namespace io_wally::persistence
+{
+    /// \brief On-disk store for retained messages, surviving broker restarts.
+    ///
+    /// Every change to the set of retained messages is appended to a log, written and synced by an \c append_log's
+    /// background thread. Callers thus never wait for disk I/O. From time to time, a log is \c compacted: a snapshot of
+    /// all messages retained at that point is written by another background thread, replacing that log and all
+    /// older ones.
+    ///
+    /// Logs and snapshots are numbered by generation. Snapshot N holds all messages retained before the first
+    /// record of log N was appended. On startup, we \c load the most recent snapshot N, followed by logs N, N + 1 and
+    /// so forth, memory mapping each file in turn.
+    ///
+    /// NOTE: This class is not thread safe: call all its methods from the same thread.
+    class retained_store final
+    {
+       public:
+        using clock = std::chrono::system_clock;
+
+        /// \brief A retained message to include in a snapshot
+        struct entry final
+        {
+            /// Read by our compaction thread: only its topic and application message are safe to touch
+            std::shared_ptr<const protocol::publish> message;
+            /// \c message's type and flags, which may change while our compaction thread is running
+            std::uint8_t type_and_flags;
+            clock::time_point retained_at;
+        };  // struct entry
+
+        /// \brief Receives each retained message \c load finds, in the order it has been retained.
+        using message_handler =
+            std::function<void( std::shared_ptr<protocol::publish> message, clock::time_point retained_at )>;
+
+        /// \brief Receives the topic of each retained message \c load finds to have been removed.
+        using removal_handler = std::function<void( const protocol::topic_name& topic )>;
+
+        /// Logs smaller than this are never compacted
+        static constexpr std::size_t MIN_COMPACTION_LOG_BYTES = 64 * 1024 * 1024;
+
+       public:
+        /// \brief Create a new \c retained_store in directory \c dir, creating \c dir if necessary, and start a new
+        /// log.
+        ///
+        /// \throws std::system_error If \c dir cannot be created, or our log cannot be opened
+        retained_store( std::filesystem::path dir, const logging::logger_factory& logger_factory );
+
+        retained_store( const retained_store& ) = delete;
+
+        auto operator=( const retained_store& ) -> retained_store& = delete;
+
+        /// \brief Wait for any running compaction, and write and sync everything appended to our log.
+        ~retained_store( );
+
+        /// \brief Replay the most recent snapshot and all logs written since, passing each retained message found to
+        /// \c on_message and each removal found to \c on_removal.
+        ///
+        /// \return Number of records replayed
+        auto load( const message_handler& on_message, const removal_handler& on_removal ) -> std::uint64_t;
+
+        /// \brief Record that \c message has been retained at \c retained_at.
+        void retain( const protocol::publish& message, clock::time_point retained_at );
+
+        /// \brief Record that the message retained for \c topic has been removed.
+        void remove( const protocol::topic_name& topic );
+
+        /// \brief Whether our log has grown large enough to be \c compacted, given that all currently retained
+        /// messages take up \c live_bytes.
+        [[nodiscard]] auto compaction_due( std::size_t live_bytes ) const -> bool;
+
+        /// \brief Start a new log and write a snapshot of \c retained in the background, replacing all older logs and
+        /// snapshots.
+        ///
+        /// \param retained All currently retained messages, least recently retained first
+        void compact( std::vector<entry> retained );
+
+        /// \brief Wait for any running compaction, and until everything appended to our log is on disk.
+        ///
+        /// \return \c false if writing failed
+        auto sync( ) -> bool;
+
+        /// \brief Number of bytes appended to our log since it has last been compacted.
+        [[nodiscard]] auto log_bytes( ) const -> std::size_t
+        {
+            return log_bytes_;
+        }
+
+       private:
+        [[nodiscard]] auto path_of( std::uint64_t generation, const char* extension ) const -> std::filesystem::path;
+
+        void append_record( );
+
+        void write_snapshot( std::uint64_t generation, const std::vector<entry>& retained );
+
+        void remove_older_than( std::uint64_t generation );
+
+        void await_compaction( );
+
+       private:
+        const std::filesystem::path dir_;
+        std::unique_ptr<spdlog::logger> logger_;
+        /// Most recent snapshot found on startup, 0 if none
+        std::uint64_t snapshot_generation_{0};
+        /// Logs found on startup, oldest first
+        std::vector<std::uint64_t> log_generations_{};
+        /// Generation of log currently appended to
+        std::uint64_t generation_{0};
+        std::unique_ptr<append_log> log_{};
+        std::size_t log_bytes_{0};
+        /// Scratch buffer for encoding records
+        std::vector<std::uint8_t> record_{};
+        std::thread compactor_{};
+        std::atomic<bool> compacting_{false};
+    };  // class retained_store
+}  // namespace io_wally::persistence
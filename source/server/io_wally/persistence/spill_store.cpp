@@ -0,0 +1,300 @@
+#include "io_wally/persistence/spill_store.hpp"
+
+#include <cassert>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <spdlog/spdlog.h>
+
+#include "io_wally/logging/logging.hpp"
+#include "io_wally/persistence/record_file.hpp"
+#include "io_wally/protocol/packet_pool.hpp"
+#include "io_wally/protocol/publish_packet.hpp"
+#include "io_wally/protocol/topic_name.hpp"
+
+namespace io_wally::persistence
+{
+    namespace
+    {
+        constexpr const char* FILE_PREFIX = "spill-";
+
+        constexpr const char* SEGMENT_EXTENSION = ".seg";
+
+        /// Record: topic size, followed by topic and application message
+        constexpr std::size_t SPILL_HEADER_SIZE = 2;
+    }  // namespace
+
+    // ------------------------------------------------------------------------------------------------------------
+    // Public
+    // ------------------------------------------------------------------------------------------------------------
+
+    spill_store::spill_store( std::filesystem::path dir,
+                              const std::size_t memory_threshold,
+                              const logging::logger_factory& logger_factory,
+                              const std::size_t segment_size )
+        : dir_{std::move( dir )},
+          memory_threshold_{memory_threshold},
+          segment_size_{segment_size},
+          logger_{logger_factory.logger( "spill-store" )}
+    {
+        std::filesystem::create_directories( dir_ );
+        for ( const auto& file : std::filesystem::directory_iterator{dir_} )
+        {
+            const auto name = file.path( ).filename( ).string( );
+            if ( ( name.rfind( FILE_PREFIX, 0 ) == 0 ) && ( file.path( ).extension( ) == SEGMENT_EXTENSION ) )
+                std::filesystem::remove( file.path( ) );
+        }
+        buffer_.reserve( BUFFER_SIZE );
+        open_segment( );
+    }
+
+    spill_store::~spill_store( )
+    {
+        for ( const auto& [id, spilled_segment] : segments_ )
+        {
+            ::close( spilled_segment.fd );
+            auto ignored = std::error_code{};
+            std::filesystem::remove( path_of( id ), ignored );
+        }
+    }
+
+    auto spill_store::admit( const std::size_t bytes ) -> bool
+    {
+        if ( resident_bytes_ + bytes > memory_threshold_ )
+            return false;
+        resident_bytes_ += bytes;
+
+        return true;
+    }
+
+    void spill_store::charge( const std::size_t bytes )
+    {
+        resident_bytes_ += bytes;
+    }
+
+    void spill_store::discharge( const std::size_t bytes )
+    {
+        assert( resident_bytes_ >= bytes );
+        resident_bytes_ -= bytes;
+    }
+
+    auto spill_store::spill( const std::shared_ptr<const protocol::publish_body>& body ) -> std::optional<location>
+    {
+        if ( const auto previous = spilled_.find( body.get( ) ); previous != spilled_.end( ) )
+        {
+            if ( previous->second.body.lock( ) == body )
+            {
+                ++segments_[previous->second.where.segment].references;
+                return previous->second.where;
+            }
+            spilled_.erase( previous );
+        }
+
+        const auto& topic = body->topic.name( );
+        const auto& message = body->application_message;
+        record_.clear( );
+        const auto topic_size = static_cast<std::uint16_t>( topic.size( ) );
+        record_.resize( SPILL_HEADER_SIZE );
+        std::memcpy( record_.data( ), &topic_size, sizeof( topic_size ) );
+        record_.insert( record_.end( ), topic.begin( ), topic.end( ) );
+        record_.insert( record_.end( ), message.begin( ), message.end( ) );
+
+        if ( ( buffer_.size( ) + RECORD_HEADER_SIZE + record_.size( ) > BUFFER_SIZE ) && !flush( ) )
+            return std::nullopt;
+
+        const auto where =
+            location{active_, static_cast<std::uint32_t>( record_.size( ) ), buffer_offset_ + buffer_.size( )};
+        frame_record( buffer_, record_.data( ), record_.size( ) );
+        buffered_.emplace_back( where, body );
+        active_size_ += RECORD_HEADER_SIZE + record_.size( );
+        ++records_written_;
+        ++segments_[active_].references;
+        spilled_.emplace( body.get( ), spilled_body{body, where} );
+
+        if ( active_size_ >= segment_size_ )
+            roll_segment( );
+
+        return where;
+    }
+
+    auto spill_store::load( const location& where ) -> std::shared_ptr<const protocol::publish_body>
+    {
+        const auto* record = static_cast<const std::uint8_t*>( nullptr );
+        auto read = std::vector<std::uint8_t>{};
+        if ( ( where.segment == active_ ) && ( where.offset >= buffer_offset_ ) )
+        {
+            // Still in our write buffer
+            record = buffer_.data( ) + ( where.offset - buffer_offset_ );
+        }
+        else
+        {
+            const auto spilled_segment = segments_.find( where.segment );
+            if ( spilled_segment == segments_.end( ) )
+            {
+                logger_->error( "Failed to load spilled publication: segment {} is gone", where.segment );
+                return nullptr;
+            }
+            if ( const auto unwritten = spilled_segment->second.unwritten.find( where.offset );
+                 unwritten != spilled_segment->second.unwritten.end( ) )
+                return unwritten->second;
+            read.resize( RECORD_HEADER_SIZE + where.size );
+            const auto bytes_read = ::pread( spilled_segment->second.fd, read.data( ), read.size( ),
+                                             static_cast<off_t>( where.offset ) );
+            if ( bytes_read != static_cast<ssize_t>( read.size( ) ) )
+            {
+                logger_->error( "Failed to read {}: {}", path_of( where.segment ).string( ),
+                                ( bytes_read < 0 ) ? std::strerror( errno ) : "short read" );
+                return nullptr;
+            }
+            record = read.data( );
+        }
+
+        auto size = std::uint32_t{0};
+        auto crc = std::uint32_t{0};
+        std::memcpy( &size, record, sizeof( size ) );
+        std::memcpy( &crc, record + sizeof( size ), sizeof( crc ) );
+        const auto* data = record + RECORD_HEADER_SIZE;
+        if ( ( size != where.size ) || ( size < SPILL_HEADER_SIZE ) || ( crc32c( data, size ) != crc ) )
+        {
+            logger_->error( "Corrupt record at offset {} in {}", where.offset, path_of( where.segment ).string( ) );
+            return nullptr;
+        }
+        auto topic_size = std::uint16_t{0};
+        std::memcpy( &topic_size, data, sizeof( topic_size ) );
+        if ( SPILL_HEADER_SIZE + topic_size > size )
+        {
+            logger_->error( "Corrupt record at offset {} in {}", where.offset, path_of( where.segment ).string( ) );
+            return nullptr;
+        }
+        const auto* topic = reinterpret_cast<const char*>( data + SPILL_HEADER_SIZE );
+        const auto* message = data + SPILL_HEADER_SIZE + topic_size;
+
+        return protocol::make_packet<protocol::publish_body>(
+            protocol::topic_name::intern( std::string_view{topic, topic_size} ),
+            std::vector<std::uint8_t>{message, data + size} );
+    }
+
+    void spill_store::prefetch( const location& where )
+    {
+        if ( ( where.segment == active_ ) && ( where.offset >= buffer_offset_ ) )
+            return;
+        const auto spilled_segment = segments_.find( where.segment );
+        if ( ( spilled_segment != segments_.end( ) ) &&
+             ( spilled_segment->second.unwritten.count( where.offset ) == 0 ) )
+            ::posix_fadvise( spilled_segment->second.fd, static_cast<off_t>( where.offset ),
+                             static_cast<off_t>( RECORD_HEADER_SIZE + where.size ), POSIX_FADV_WILLNEED );
+    }
+
+    void spill_store::release( const location& where )
+    {
+        const auto spilled_segment = segments_.find( where.segment );
+        assert( spilled_segment != segments_.end( ) );
+        assert( spilled_segment->second.references > 0 );
+        if ( ( --spilled_segment->second.references == 0 ) && ( where.segment != active_ ) )
+            remove_segment( where.segment );
+    }
+
+    // ------------------------------------------------------------------------------------------------------------
+    // Private
+    // ------------------------------------------------------------------------------------------------------------
+
+    auto spill_store::path_of( const std::uint32_t segment ) const -> std::filesystem::path
+    {
+        char name[32];
+        std::snprintf( name, sizeof( name ), "%s%08" PRIx32 "%s", FILE_PREFIX, segment, SEGMENT_EXTENSION );
+
+        return dir_ / name;
+    }
+
+    void spill_store::open_segment( )
+    {
+        ++active_;
+        const auto path = path_of( active_ );
+        const auto fd = ::open( path.c_str( ), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644 );
+        if ( fd < 0 )
+            throw std::system_error{errno, std::generic_category( ), "Failed to open " + path.string( )};
+        segments_[active_] = segment{fd, 0};
+        active_size_ = 0;
+        buffer_offset_ = 0;
+    }
+
+    void spill_store::roll_segment( )
+    {
+        flush( );
+        spilled_.clear( );
+        const auto previous = active_;
+        try
+        {
+            open_segment( );
+        }
+        catch ( const std::system_error& e )
+        {
+            // Keep appending to our current segment, retrying with our next spilled publication
+            --active_;
+            logger_->error( "Failed to roll segment: {}", e.what( ) );
+            return;
+        }
+        logger_->debug( "Rolled segment {} -> {} [segments:{}|resident:{}]", previous, active_, segments_.size( ),
+                        resident_bytes_ );
+        if ( segments_[previous].references == 0 )
+            remove_segment( previous );
+    }
+
+    auto spill_store::flush( ) -> bool
+    {
+        if ( buffer_.empty( ) )
+            return true;
+        const auto written = buffer_.size( );
+        auto ok = true;
+        try
+        {
+            write_fully( segments_[active_].fd, buffer_.data( ), buffer_.size( ) );
+        }
+        catch ( const std::system_error& e )
+        {
+            // Keep publications in our buffer in memory instead. Keep offsets of records to come in line with their
+            // locations.
+            logger_->error( "Failed to write {}, keeping {} spilled publication(s) in memory: {}",
+                            path_of( active_ ).string( ), buffered_.size( ), e.what( ) );
+            auto& active_segment = segments_[active_];
+            for ( auto& [where, body] : buffered_ )
+            {
+                active_segment.unwritten.emplace( where.offset, std::move( body ) );
+                active_segment.unwritten_bytes += where.size;
+                resident_bytes_ += where.size;
+            }
+            ::lseek( active_segment.fd, static_cast<off_t>( buffer_offset_ + written ), SEEK_SET );
+            ok = false;
+        }
+        buffer_.clear( );
+        buffered_.clear( );
+        buffer_offset_ += written;
+
+        return ok;
+    }
+
+    void spill_store::remove_segment( const std::uint32_t id )
+    {
+        const auto spilled_segment = segments_.find( id );
+        ::close( spilled_segment->second.fd );
+        discharge( spilled_segment->second.unwritten_bytes );
+        segments_.erase( spilled_segment );
+        auto error = std::error_code{};
+        if ( !std::filesystem::remove( path_of( id ), error ) && error )
+            logger_->warn( "Failed to remove {}: {}", path_of( id ).string( ), error.message( ) );
+    }
+}  // namespace io_wally::persistence
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include "io_wally/logging/logging.hpp"
+#include "io_wally/protocol/publish_packet.hpp"
+
+namespace io_wally::persistence
+{
+    /// \brief Disk space for queued publications that do not fit into memory, shared by all client sessions.
+    ///
+    /// Client sessions keep queued publications in memory for as long as all queues together hold at most \c
+    /// memory_threshold bytes, see \c admit. Beyond that, sessions \c spill each further publication's topic and
+    /// application message to this store, keeping only its \c location. Publications fanned out to many sessions share
+    /// their \c protocol::publish_body, which is written only once: all sessions spilling it receive the same \c
+    /// location.
+    ///
+    /// Spilled publications are appended to segment files of roughly \c segment_size bytes each, through an in-memory
+    /// write buffer. A segment file is removed as soon as no session references any publication in it anymore. Since
+    /// spilled publications are merely evicted from memory and not meant to survive a broker restart, nothing is ever
+    /// synced, and all segment files left behind by an earlier run are removed on startup.
+    ///
+    /// Should writing our buffer fail, we keep the publications it held in memory instead, charged to memory until
+    /// their segment is removed, and \c load them from there.
+    ///
+    /// NOTE: This class is not thread safe: call all its methods from the same thread.
+    class spill_store final
+    {
+       public:
+        /// \brief Where a spilled publication's topic and application message are stored.
+        struct location final
+        {
+            std::uint32_t segment;
+            /// Size of its record, not including record header
+            std::uint32_t size;
+            /// Offset of its record header within its segment
+            std::uint64_t offset;
+        };  // struct location
+
+        /// Default size of a segment file
+        static constexpr std::size_t DEFAULT_SEGMENT_SIZE = 64 * 1024 * 1024;
+
+        /// Number of spilled publications to load in one go when a session's queue reaches them, and number of
+        /// spilled publications following those to advise the kernel to read ahead
+        static constexpr std::size_t READ_AHEAD = 64;
+
+       public:
+        /// \brief Create a new \c spill_store in directory \c dir, creating \c dir if necessary and removing all
+        /// segment files found therein.
+        ///
+        /// \throws std::system_error If \c dir cannot be created or cleaned up
+        spill_store( std::filesystem::path dir,
+                     std::size_t memory_threshold,
+                     const logging::logger_factory& logger_factory,
+                     std::size_t segment_size = DEFAULT_SEGMENT_SIZE );
+
+        spill_store( const spill_store& ) = delete;
+
+        auto operator=( const spill_store& ) -> spill_store& = delete;
+
+        /// \brief Close and remove all our segment files.
+        ~spill_store( );
+
+        /// \brief Charge a queued publication of \c bytes to memory if that does not exceed our memory threshold.
+        ///
+        /// \return \c true if that publication may be kept in memory, \c false if it should be spilled
+        [[nodiscard]] auto admit( std::size_t bytes ) -> bool;
+
+        /// \brief Charge a queued publication of \c bytes to memory, regardless of our memory threshold.
+        void charge( std::size_t bytes );
+
+        /// \brief Return \c bytes previously charged to memory.
+        void discharge( std::size_t bytes );
+
+        /// \brief Spill \c body to disk, unless it has been spilled before and is still referenced, and add a
+        /// reference to it.
+        ///
+        /// \return Where \c body has been spilled to, or nothing if writing it failed
+        auto spill( const std::shared_ptr<const protocol::publish_body>& body ) -> std::optional<location>;
+
+        /// \brief Read spilled publication at \c where.
+        ///
+        /// \return Its topic and application message, or an empty pointer if reading it failed
+        auto load( const location& where ) -> std::shared_ptr<const protocol::publish_body>;
+
+        /// \brief Advise the kernel that we will soon \c load spilled publication at \c where.
+        void prefetch( const location& where );
+
+        /// \brief Drop a reference to spilled publication at \c where, removing its segment file if no longer
+        /// referenced.
+        void release( const location& where );
+
+        /// \brief Number of bytes currently charged to memory.
+        [[nodiscard]] auto resident_bytes( ) const -> std::size_t
+        {
+            return resident_bytes_;
+        }
+
+        /// \brief Number of segment files currently in use.
+        [[nodiscard]] auto segments( ) const -> std::size_t
+        {
+            return segments_.size( );
+        }
+
+        /// \brief Number of records written since we have been created.
+        [[nodiscard]] auto records_written( ) const -> std::uint64_t
+        {
+            return records_written_;
+        }
+
+       private:
+        struct segment final
+        {
+            int fd{-1};
+            /// Number of references to publications spilled to this segment
+            std::size_t references{0};
+            /// Publications we failed to write to this segment, by offset
+            std::unordered_map<std::uint64_t, std::shared_ptr<const protocol::publish_body>> unwritten{};
+            /// Bytes charged to memory for unwritten publications
+            std::size_t unwritten_bytes{0};
+        };  // struct segment
+
+        /// A publication spilled to our active segment, which may be shared by further sessions spilling it
+        struct spilled_body final
+        {
+            /// Guards against another body being allocated at the same address once this one is gone
+            std::weak_ptr<const protocol::publish_body> body;
+            location where;
+        };  // struct spilled_body
+
+       private:
+        [[nodiscard]] auto path_of( std::uint32_t segment ) const -> std::filesystem::path;
+
+        void open_segment( );
+
+        void roll_segment( );
+
+        /// \brief Write our buffer to our active segment.
+        ///
+        /// \return \c false if writing failed
+        auto flush( ) -> bool;
+
+        void remove_segment( std::uint32_t id );
+
+       private:
+        static constexpr std::size_t BUFFER_SIZE = 256 * 1024;
+
+        const std::filesystem::path dir_;
+        const std::size_t memory_threshold_;
+        const std::size_t segment_size_;
+        std::unique_ptr<spdlog::logger> logger_;
+        std::size_t resident_bytes_{0};
+        std::unordered_map<std::uint32_t, segment> segments_{};
+        std::uint32_t active_{0};
+        /// Size of our active segment, including what is still in our buffer
+        std::uint64_t active_size_{0};
+        /// Records appended to our active segment, but not yet written
+        std::vector<std::uint8_t> buffer_{};
+        /// Offset of our buffer's first byte within our active segment
+        std::uint64_t buffer_offset_{0};
+        /// Publications in our buffer, kept until it has been written
+        std::vector<std::pair<location, std::shared_ptr<const protocol::publish_body>>> buffered_{};
+        /// Publications spilled to our active segment, by body. Cleared whenever we roll our active segment.
+        std::unordered_map<const protocol::publish_body*, spilled_body> spilled_{};
+        /// Scratch buffer for encoding records
+        std::vector<std::uint8_t> record_{};
+        std::uint64_t records_written_{0};
+    };  // class spill_store
+}  // namespace io_wally::persistence
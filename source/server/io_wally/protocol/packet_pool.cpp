@@ -0,0 +1,237 @@
+#include "io_wally/protocol/packet_pool.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace io_wally::protocol
+{
+    struct packet_pool::block_header final
+    {
+        /// Pool this block has been allocated from, or \c nullptr if it has been allocated by \c ::operator new
+        packet_pool* owner{nullptr};
+        std::size_t size_class{0};
+    };  // struct packet_pool::block_header
+
+    namespace
+    {
+        /// Blocks start with their header, padded so that what follows it is suitably aligned for any type
+        constexpr std::size_t HEADER_SIZE =
+            ( ( sizeof( void* ) * 2 + alignof( std::max_align_t ) - 1 ) / alignof( std::max_align_t ) ) *
+            alignof( std::max_align_t );
+
+        /// Pools whose threads have exited, waiting to be adopted by new threads
+        struct orphaned_pools final
+        {
+            std::mutex mutex{};
+            std::vector<packet_pool*> pools{};
+        };  // struct orphaned_pools
+
+        auto orphans( ) -> orphaned_pools&
+        {
+            // Never destroyed, since threads may still exit while static objects are being destroyed
+            static auto* const orphans = new orphaned_pools{};
+            return *orphans;
+        }
+
+        /// Calling thread's pool, if it has one
+        thread_local packet_pool* current_pool = nullptr;
+
+        /// Set once calling thread's pool has been orphaned, i.e. calling thread is exiting
+        thread_local bool current_pool_orphaned = false;
+    }  // namespace
+
+    /// Owns a thread's \c packet_pool, orphaning it once that thread exits
+    class local_packet_pool final
+    {
+       public:
+        local_packet_pool( )
+        {
+            auto& parked = orphans( );
+            {
+                const auto lock = std::lock_guard<std::mutex>{parked.mutex};
+                if ( !parked.pools.empty( ) )
+                {
+                    pool = parked.pools.back( );
+                    parked.pools.pop_back( );
+                }
+            }
+            if ( pool == nullptr )
+                pool = new packet_pool{};
+            pool->orphaned_.store( false );
+            current_pool = pool;
+        }
+
+        local_packet_pool( const local_packet_pool& ) = delete;
+
+        auto operator=( const local_packet_pool& ) -> local_packet_pool& = delete;
+
+        ~local_packet_pool( )
+        {
+            current_pool = nullptr;
+            current_pool_orphaned = true;
+            pool->orphan( );
+
+            auto& parked = orphans( );
+            const auto lock = std::lock_guard<std::mutex>{parked.mutex};
+            parked.pools.push_back( pool );
+        }
+
+       public:
+        packet_pool* pool{nullptr};
+    };  // class local_packet_pool
+
+    // ------------------------------------------------------------------------------------------------------------
+    // Public
+    // ------------------------------------------------------------------------------------------------------------
+
+    auto packet_pool::allocate( const std::size_t size ) -> void*
+    {
+        static_assert( sizeof( block_header ) <= HEADER_SIZE, "Block header does not fit" );
+
+        const auto block_size = HEADER_SIZE + size;
+        auto* block = static_cast<block_header*>( nullptr );
+        if ( ( block_size > MAX_BLOCK_SIZE ) || current_pool_orphaned )
+        {
+            block = static_cast<block_header*>( ::operator new( block_size ) );
+            block->owner = nullptr;
+        }
+        else
+        {
+            block = local( ).allocate_block( ( block_size - 1 ) / GRANULE );
+        }
+
+        return reinterpret_cast<std::byte*>( block ) + HEADER_SIZE;
+    }
+
+    void packet_pool::deallocate( void* ptr ) noexcept
+    {
+        if ( ptr == nullptr )
+            return;
+
+        auto* block = reinterpret_cast<block_header*>( static_cast<std::byte*>( ptr ) - HEADER_SIZE );
+        if ( block->owner == nullptr )
+            ::operator delete( block );
+        else if ( block->owner == current_pool )
+            block->owner->push_local( block );
+        else
+            block->owner->push_remote( block );
+    }
+
+    auto packet_pool::local( ) -> packet_pool&
+    {
+        thread_local auto local_pool = local_packet_pool{};
+
+        return *local_pool.pool;
+    }
+
+    auto packet_pool::cached_blocks( ) const -> std::size_t
+    {
+        auto cached = std::size_t{0};
+        for ( const auto& list : free_lists_ )
+            cached += list.length;
+
+        return cached;
+    }
+
+    // ------------------------------------------------------------------------------------------------------------
+    // Private
+    // ------------------------------------------------------------------------------------------------------------
+
+    auto packet_pool::as_free_block( block_header* block ) noexcept -> free_block*
+    {
+        // A free block keeps its header, and links to the next free block right behind it
+        return new ( reinterpret_cast<std::byte*>( block ) + HEADER_SIZE ) free_block{};
+    }
+
+    auto packet_pool::header_of( free_block* free ) noexcept -> block_header*
+    {
+        return reinterpret_cast<block_header*>( reinterpret_cast<std::byte*>( free ) - HEADER_SIZE );
+    }
+
+    auto packet_pool::allocate_block( const std::size_t size_class ) -> block_header*
+    {
+        auto& list = free_lists_[size_class];
+        if ( list.head == nullptr )
+            reclaim_remote( );
+
+        auto* block = static_cast<block_header*>( nullptr );
+        if ( list.head != nullptr )
+        {
+            auto* free = list.head;
+            list.head = free->next;
+            --list.length;
+            block = header_of( free );
+        }
+        else
+        {
+            block = static_cast<block_header*>( ::operator new( ( size_class + 1 ) * GRANULE ) );
+        }
+        block->owner = this;
+        block->size_class = size_class;
+
+        return block;
+    }
+
+    void packet_pool::push_local( block_header* block ) noexcept
+    {
+        auto& list = free_lists_[block->size_class];
+        if ( list.length >= MAX_CACHED_BLOCKS )
+        {
+            ::operator delete( block );
+            return;
+        }
+
+        auto* free = as_free_block( block );
+        free->next = list.head;
+        list.head = free;
+        ++list.length;
+    }
+
+    void packet_pool::push_remote( block_header* block ) noexcept
+    {
+        auto* free = as_free_block( block );
+        free->next = remote_.load( );
+        while ( !remote_.compare_exchange_weak( free->next, free ) )
+        {
+        }
+
+        // Our owner may have exited before seeing this block: in that case, it is up to us to release it
+        if ( orphaned_.load( ) )
+            release_all( remote_.exchange( nullptr ) );
+    }
+
+    void packet_pool::reclaim_remote( ) noexcept
+    {
+        auto* free = remote_.exchange( nullptr );
+        while ( free != nullptr )
+        {
+            auto* next = free->next;
+            push_local( header_of( free ) );
+            free = next;
+        }
+    }
+
+    void packet_pool::orphan( ) noexcept
+    {
+        orphaned_.store( true );
+        for ( auto& list : free_lists_ )
+        {
+            release_all( list.head );
+            list = free_list{};
+        }
+        release_all( remote_.exchange( nullptr ) );
+    }
+
+    void packet_pool::release_all( free_block* head ) noexcept
+    {
+        while ( head != nullptr )
+        {
+            auto* next = head->next;
+            ::operator delete( header_of( head ) );
+            head = next;
+        }
+    }
+}  // namespace io_wally::protocol
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace io_wally::protocol
+{
+    /// \brief Per-thread pool of small memory blocks, used for allocating MQTT packets and their control blocks.
+    ///
+    /// Each thread allocates from its own \c packet_pool, without any synchronization. Blocks are handed out in a
+    /// few size classes and are returned to the \c packet_pool they have been allocated from, even when released on
+    /// another thread: packets are routinely created on one thread and released on another, e.g. PUBACKs created on
+    /// our dispatcher thread are released on a network thread once they have been written. Blocks released on their
+    /// owning thread go straight back onto that thread's free lists, while blocks released on any other thread are
+    /// pushed onto their owner's lock free "remote" list, which their owner reclaims once its free lists run dry. In a
+    /// steady state, allocating and releasing packets thus no longer calls into \c malloc.
+    ///
+    /// Requests larger than \c MAX_BLOCK_SIZE are passed on to <tt>::operator new</tt>.
+    ///
+    /// NOTE: A thread's \c packet_pool is created on first use and never destroyed. Once its thread exits it releases
+    /// all cached blocks and is parked, to be adopted by the next thread that starts allocating. Until then, blocks
+    /// still in use are released to \c ::operator delete when they come back.
+    class packet_pool final
+    {
+       public:
+        /// Size classes are multiples of this size
+        static constexpr std::size_t GRANULE = 64;
+
+        /// Largest block size served from a \c packet_pool, including its header
+        static constexpr std::size_t MAX_BLOCK_SIZE = 512;
+
+        /// Maximum number of free blocks cached per size class
+        static constexpr std::size_t MAX_CACHED_BLOCKS = 4096;
+
+       public:
+        packet_pool( const packet_pool& ) = delete;
+
+        auto operator=( const packet_pool& ) -> packet_pool& = delete;
+
+        /// \brief Allocate \c size bytes, suitably aligned for any type, from calling thread's \c packet_pool.
+        [[nodiscard]] static auto allocate( std::size_t size ) -> void*;
+
+        /// \brief Release memory previously returned by \c allocate, on any thread.
+        static void deallocate( void* ptr ) noexcept;
+
+        /// \brief Calling thread's \c packet_pool.
+        [[nodiscard]] static auto local( ) -> packet_pool&;
+
+        /// \brief Number of free blocks cached by this pool, not counting those released by other threads and not
+        /// yet reclaimed.
+        [[nodiscard]] auto cached_blocks( ) const -> std::size_t;
+
+       private:
+        struct block_header;
+
+        struct free_block final
+        {
+            free_block* next{nullptr};
+        };  // struct free_block
+
+        static constexpr std::size_t SIZE_CLASS_COUNT = MAX_BLOCK_SIZE / GRANULE;
+
+        struct free_list final
+        {
+            free_block* head{nullptr};
+            std::size_t length{0};
+        };  // struct free_list
+
+        friend class local_packet_pool;
+
+       private:
+        packet_pool( ) = default;
+
+        ~packet_pool( ) = default;
+
+        auto allocate_block( std::size_t size_class ) -> block_header*;
+
+        void push_local( block_header* block ) noexcept;
+
+        void push_remote( block_header* block ) noexcept;
+
+        void reclaim_remote( ) noexcept;
+
+        void orphan( ) noexcept;
+
+        static void release_all( free_block* head ) noexcept;
+
+        static auto as_free_block( block_header* block ) noexcept -> free_block*;
+
+        static auto header_of( free_block* free ) noexcept -> block_header*;
+
+       private:
+        std::array<free_list, SIZE_CLASS_COUNT> free_lists_{};
+        /// Blocks released by other threads, pushed by those and reclaimed by us
+        std::atomic<free_block*> remote_{nullptr};
+        /// Set once our thread has exited
+        std::atomic<bool> orphaned_{false};
+    };  // class packet_pool
+
+    /// \brief Standard allocator backed by \c packet_pool, meant to be used with \c std::allocate_shared.
+    template <typename T>
+    class pool_allocator final
+    {
+       public:
+        using value_type = T;
+
+        pool_allocator( ) noexcept = default;
+
+        template <typename U>
+        pool_allocator( const pool_allocator<U>& /* other */ ) noexcept
+        {
+        }
+
+        [[nodiscard]] auto allocate( std::size_t n ) -> T*
+        {
+            return static_cast<T*>( packet_pool::allocate( n * sizeof( T ) ) );
+        }
+
+        void deallocate( T* ptr, std::size_t /* n */ ) noexcept
+        {
+            packet_pool::deallocate( ptr );
+        }
+
+        template <typename U>
+        friend auto operator==( const pool_allocator& /* lhs */, const pool_allocator<U>& /* rhs */ ) -> bool
+        {
+            return true;
+        }
+
+        template <typename U>
+        friend auto operator!=( const pool_allocator& /* lhs */, const pool_allocator<U>& /* rhs */ ) -> bool
+        {
+            return false;
+        }
+    };  // class pool_allocator
+
+    /// \brief Create a \c PACKET, allocating it and its control block in one block from calling thread's \c
+    /// packet_pool.
+    ///
+    /// \param args Arguments to pass to \c PACKET's constructor
+    /// \return Newly created \c PACKET
+    template <typename PACKET, typename... ARGS>
+    auto make_packet( ARGS&&... args ) -> std::shared_ptr<PACKET>
+    {
+        return std::allocate_shared<PACKET>( pool_allocator<PACKET>{}, std::forward<ARGS>( args )... );
+    }
+}  // namespace io_wally::protocol
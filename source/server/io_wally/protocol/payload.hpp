@@ -0,0 +1,103 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace io_wally::protocol
+{
+    /// \brief An immutable, ref-counted byte sequence, used for a PUBLISH packet's \c application \c message.
+    ///
+    /// A \c payload either owns its bytes, or references bytes owned by someone else, typically a connection's
+    /// receive buffer. In the latter case it keeps that owner alive for as long as it exists itself, allowing large
+    /// application messages to pass through this broker without ever being copied.
+    class payload final
+    {
+       public:
+        using const_iterator = const uint8_t*;
+
+       public:
+        /// \brief Create an empty \c payload.
+        payload( ) = default;
+
+        /// \brief Create a \c payload owning \c bytes.
+        ///
+        /// \param bytes Bytes to take ownership of
+        explicit payload( std::vector<uint8_t> bytes )
+        {
+            auto owned = std::make_shared<const std::vector<uint8_t>>( std::move( bytes ) );
+            data_ = owned->data( );
+            size_ = owned->size( );
+            owner_ = std::move( owned );
+        }
+
+        /// \brief Create a \c payload referencing \c size bytes starting at \c data, owned by \c owner.
+        ///
+        /// \param owner Owner of referenced bytes, retained by this \c payload
+        /// \param data  Start of referenced bytes
+        /// \param size  Number of referenced bytes
+        payload( std::shared_ptr<const void> owner, const uint8_t* data, const std::size_t size )
+            : owner_{std::move( owner )}, data_{data}, size_{size}
+        {
+        }
+
+        [[nodiscard]] auto data( ) const -> const uint8_t*
+        {
+            return data_;
+        }
+
+        [[nodiscard]] auto size( ) const -> std::size_t
+        {
+            return size_;
+        }
+
+        [[nodiscard]] auto empty( ) const -> bool
+        {
+            return size_ == 0;
+        }
+
+        [[nodiscard]] auto begin( ) const -> const_iterator
+        {
+            return data_;
+        }
+
+        [[nodiscard]] auto end( ) const -> const_iterator
+        {
+            return data_ + size_;
+        }
+
+        /// \brief Copy this \c payload's bytes into a vector.
+        [[nodiscard]] auto to_vector( ) const -> std::vector<uint8_t>
+        {
+            return std::vector<uint8_t>{begin( ), end( )};
+        }
+
+        friend auto operator==( const payload& lhs, const payload& rhs ) -> bool
+        {
+            return std::equal( lhs.begin( ), lhs.end( ), rhs.begin( ), rhs.end( ) );
+        }
+
+        friend auto operator==( const payload& lhs, const std::vector<uint8_t>& rhs ) -> bool
+        {
+            return std::equal( lhs.begin( ), lhs.end( ), rhs.begin( ), rhs.end( ) );
+        }
+
+        friend auto operator==( const std::vector<uint8_t>& lhs, const payload& rhs ) -> bool
+        {
+            return rhs == lhs;
+        }
+
+        friend auto operator!=( const payload& lhs, const payload& rhs ) -> bool
+        {
+            return !( lhs == rhs );
+        }
+
+       private:
+        std::shared_ptr<const void> owner_{};
+        const uint8_t* data_{nullptr};
+        std::size_t size_{0};
+    };  // class payload
+}  // namespace io_wally::protocol
@@ -10,9 +10,35 @@
 #include <optional>
 
 #include "io_wally/protocol/common.hpp"
+#include "io_wally/protocol/packet_pool.hpp"
+#include "io_wally/protocol/payload.hpp"
+#include "io_wally/protocol/topic_name.hpp"
 
 namespace io_wally::protocol
 {
+    /// \brief A PUBLISH packet's \c topic and \c application \c message.
+    ///
+    /// Immutable and shared by all copies of a PUBLISH packet created when fanning it out to subscribers. Since topic
+    /// and application message are already kept in their wire format, encoders may send them without copying them.
+    /// The application message may in turn reference the receive buffer it was decoded from (see \c payload).
+    struct publish_body final
+    {
+       public:
+        publish_body( topic_name topicp, std::vector<uint8_t> application_messagep )
+            : topic{std::move( topicp )}, application_message{std::move( application_messagep )}
+        {
+        }
+
+        publish_body( topic_name topicp, payload application_messagep )
+            : topic{std::move( topicp )}, application_message{std::move( application_messagep )}
+        {
+        }
+
+       public:
+        const topic_name topic;
+        const payload application_message;
+    };  // struct publish_body
+
     /// \brief PUBLISH control packet, sent by a client to publish an application message to a \c topic.
     ///
     /// In a PUBLISH control packet the \c fixed \c packet::header shared by all MQTT control packet's is
@@ -50,8 +76,8 @@ namespace io_wally::protocol
             remaining_length += ( 2 + topic.length( ) );
             remaining_length += application_message.size( );
 
-            return std::make_unique<publish>( type_and_flags, remaining_length, topic, packet_identifier,
-                                              std::move( application_message ) );
+            return std::make_unique<publish>( type_and_flags, remaining_length, topic_name::intern( topic ),
+                                              packet_identifier, std::move( application_message ) );
         }
 
         /**
@@ -59,18 +85,58 @@ namespace io_wally::protocol
          *
          * @param type_and_flags       Fixed header type and flags
          * @param remaining_length     Remaining length of packet
+         * @param topic                Interned topic this packet is published to
          * @param packet_identifier    Unsigned 16 bit integer identifying this packet (IGNORED IF QoS = 0)
          * @param application_message  The message payload, an opaque byte array
          */
         publish( uint8_t type_and_flags,
                  uint32_t remaining_length,
-                 std::string topic,
+                 topic_name topic,
                  const uint16_t packet_identifier,
                  std::vector<uint8_t> application_message )
             : mqtt_packet{type_and_flags, remaining_length},
-              topic_{std::move( topic )},
-              packet_identifier_{packet_identifier},
-              application_message_{std::move( application_message )}
+              body_{make_packet<publish_body>( std::move( topic ), std::move( application_message ) )},
+              packet_identifier_{packet_identifier}
+        {
+            assert( packet::type_of( type_and_flags ) == packet::Type::PUBLISH );
+        }
+
+        /**
+         * @brief Create a new @c publish instance whose application message possibly references memory it does not own
+         *
+         * @param type_and_flags       Fixed header type and flags
+         * @param remaining_length     Remaining length of packet
+         * @param topic                Interned topic this packet is published to
+         * @param packet_identifier    Unsigned 16 bit integer identifying this packet (IGNORED IF QoS = 0)
+         * @param application_message  The message payload, an opaque byte array
+         */
+        publish( uint8_t type_and_flags,
+                 uint32_t remaining_length,
+                 topic_name topic,
+                 const uint16_t packet_identifier,
+                 payload application_message )
+            : mqtt_packet{type_and_flags, remaining_length},
+              body_{make_packet<publish_body>( std::move( topic ), std::move( application_message ) )},
+              packet_identifier_{packet_identifier}
+        {
+            assert( packet::type_of( type_and_flags ) == packet::Type::PUBLISH );
+        }
+
+        /**
+         * @brief Create a new @c publish instance sharing its topic and application message with other instances
+         *
+         * @param type_and_flags       Fixed header type and flags
+         * @param remaining_length     Remaining length of packet
+         * @param body                 Shared topic and application message
+         * @param packet_identifier    Unsigned 16 bit integer identifying this packet (IGNORED IF QoS = 0)
+         */
+        publish( uint8_t type_and_flags,
+                 uint32_t remaining_length,
+                 std::shared_ptr<const publish_body> body,
+                 const uint16_t packet_identifier )
+            : mqtt_packet{type_and_flags, remaining_length},
+              body_{std::move( body )},
+              packet_identifier_{packet_identifier}
         {
             assert( packet::type_of( type_and_flags ) == packet::Type::PUBLISH );
         }
@@ -149,9 +215,9 @@ namespace io_wally::protocol
         /// \brief Return \c topic to publish this message to.
         ///
         /// \returm topic to publish this message to
-        [[nodiscard]] auto topic( ) const -> const std::string&
+        [[nodiscard]] auto topic( ) const -> const topic_name&
         {
-            return topic_;
+            return body_->topic;
         }
 
         /// \brief Test if this PUBLISH packet contains a \c packet \c identifier, i.e. if QoS is NOT QoS 0 (at most
@@ -175,9 +241,17 @@ namespace io_wally::protocol
         /// \brief Return message payload.
         ///
         /// \return message payload, i.e. \c application \c message
-        [[nodiscard]] auto application_message( ) const -> const std::vector<uint8_t>&
+        [[nodiscard]] auto application_message( ) const -> const payload&
         {
-            return application_message_;
+            return body_->application_message;
+        }
+
+        /// \brief Return topic and message payload, shared with all copies of this packet.
+        ///
+        /// \return This packet's \c publish_body
+        [[nodiscard]] auto body( ) const -> const std::shared_ptr<const publish_body>&
+        {
+            return body_;
         }
 
         /// \brief Return a string representation to be used in log output.
@@ -189,23 +263,27 @@ namespace io_wally::protocol
             output << "publish[";
             if ( ( qos( ) == packet::QoS::AT_LEAST_ONCE ) || ( qos( ) == packet::QoS::EXACTLY_ONCE ) )
                 output << "pktid:" << packet_identifier_ << "|";
-            output << "dup:" << dup( ) << "|qos:" << qos( ) << "|ret:" << retain( ) << "|topic:" << topic_
-                   << "|msg-size:" << application_message_.size( ) << "]";
+            output << "dup:" << dup( ) << "|qos:" << qos( ) << "|ret:" << retain( ) << "|topic:" << body_->topic
+                   << "|msg-size:" << body_->application_message.size( ) << "]";
 
             return output.str( );
         }
 
+        /// \brief Copy this packet, assigning it a new \c packet \c identifier.
+        ///
+        /// Topic and application message will not be copied, but shared with this packet.
+        ///
+        /// \param new_packet_identifier Packet identifier to assign to the copy
+        /// \return A copy of this packet using \c new_packet_identifier
         [[nodiscard]] auto with_new_packet_identifier( const std::uint16_t new_packet_identifier ) const
             -> std::shared_ptr<publish>
         {
-            return std::make_shared<publish>( type_and_flags_, remaining_length_, topic_, new_packet_identifier,
-                                              application_message_ );
+            return make_packet<publish>( type_and_flags_, remaining_length_, body_, new_packet_identifier );
         }
 
        private:
-        const std::string topic_;
+        const std::shared_ptr<const publish_body> body_;
         const uint16_t packet_identifier_;
-        const std::vector<uint8_t> application_message_;
     };  // struct publish
 
 }  // namespace io_wally::protocol
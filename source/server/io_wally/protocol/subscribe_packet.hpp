@@ -9,6 +9,7 @@
 #include <optional>
 
 #include "io_wally/protocol/common.hpp"
+#include "io_wally/protocol/packet_pool.hpp"
 #include "io_wally/protocol/suback_packet.hpp"
 #include "io_wally/protocol/subscription.hpp"
 
@@ -73,7 +74,7 @@ namespace io_wally::protocol
             std::vector<suback_return_code> rcs{};
             rcs.assign( subscriptions_.size( ), suback_return_code::FAILURE );
 
-            return std::make_shared<const suback>( packet_identifier_, rcs );
+            return make_packet<suback>( packet_identifier_, rcs );
         }
 
         /// \brief Return a \c suback packet representing complete success to process this \c subscribe packet.
@@ -107,7 +108,7 @@ namespace io_wally::protocol
                 }
             }
 
-            return std::make_shared<const suback>( packet_identifier_, rcs );
+            return make_packet<suback>( packet_identifier_, rcs );
         }
 
         /// \brief Return a string representation to be used in log output.
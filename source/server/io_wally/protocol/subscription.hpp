@@ -5,6 +5,7 @@
 
 #include "io_wally/error/protocol.hpp"
 #include "io_wally/protocol/common.hpp"
+#include "io_wally/protocol/utf8.hpp"
 
 namespace io_wally::protocol
 {
@@ -38,7 +39,7 @@ namespace io_wally::protocol
         subscription( std::string topic_filter, packet::QoS maximum_qos )
             : topic_filter_{std::move( topic_filter )}, maximum_qos_{maximum_qos}
         {
-            assert_well_formed_topic_filter( topic_filter_ );
+            utf8::check_topic_filter( topic_filter_ );
         }
 
         /// \brief Copy constructor.
@@ -90,79 +91,6 @@ namespace io_wally::protocol
             return output;
         }
 
-       private:
-        static void assert_well_formed_topic_filter( const std::string& topic_filter )
-        {
-            const char EMPTY = '\0';
-
-            std::string mqtt_ref( "" );
-            bool valid = true;
-
-            // topic filter needs to be at least 1 character in length
-            if ( topic_filter.size( ) < 1 )
-            {
-                valid = false;
-                mqtt_ref = "4.7.3-1";
-            }
-
-            // yet it must not exceed 65535 characters in length
-            else if ( topic_filter.size( ) > 65535 )
-            {
-                valid = false;
-                mqtt_ref = "4.7.3-3";
-            }
-
-            const char* previous_char = &EMPTY;
-            for ( size_t i = 0; ( i < topic_filter.size( ) ) && valid; ++i )
-            {
-                const char& cur_char = topic_filter[i];
-
-                // NULL byte not allowed in topic filter
-                if ( cur_char == '\0' )
-                {
-                    valid = false;  // [MQTT-4.7.3-2]
-                    mqtt_ref = "4.7.3-2";
-                }
-
-                // "#" must be the last character in a topic filter
-                else if ( *previous_char == '#' )
-                {
-                    valid = false;
-                    mqtt_ref = "4.7.1-2";
-                }
-
-                // "+" must either be the first character in a topic filter, or it must be immediately preceded by a
-                // "/"
-                else if ( ( cur_char == '+' ) && ( *previous_char != EMPTY ) && ( *previous_char != '/' ) )
-                {
-                    valid = false;  //  [MQTT-4.7.1-1]
-                    mqtt_ref = "4.7.1-1";
-                }
-
-                // "#" must either be the first character in a topic filter, or it must be immediately preceded by a
-                // "/"
-                else if ( ( cur_char == '#' ) && ( *previous_char != EMPTY ) && ( *previous_char != '/' ) )
-                {
-                    valid = false;  //  [MQTT-4.7.1-1]
-                    mqtt_ref = "4.7.1-2";
-                }
-
-                // A regular character - not one of "#", "+" and "/" - must not follow a "+" or "#"
-                else if ( ( cur_char != '/' ) && ( cur_char != '+' ) && ( cur_char != '#' ) &&
-                          ( ( *previous_char == '+' ) || ( *previous_char == '#' ) ) )
-                {
-                    valid = false;  //  [MQTT-4.7.1-3]
-                    mqtt_ref = "4.7.1-3";
-                }
-
-                previous_char = &cur_char;
-            }
-
-            if ( !valid )
-                throw error::malformed_mqtt_packet( "[MQTT-" + mqtt_ref +
-                                                    "] Not a well-formed topic filter: " + topic_filter );
-        }
-
        private:
         const std::string topic_filter_;
         const packet::QoS maximum_qos_;
@@ -0,0 +1,110 @@
+#include "io_wally/protocol/topic_name.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace io_wally::protocol
+{
+    namespace
+    {
+        /// Interned topics are spread across this many shards, each guarded by its own mutex, to keep network threads
+        /// decoding PUBLISH packets from contending for a single lock
+        constexpr std::size_t SHARD_COUNT = 16;
+
+        template <typename INTERNED>
+        struct shard final
+        {
+            std::mutex mutex{};
+            /// Keys refer to their interned topic's name
+            std::unordered_map<std::string_view, std::weak_ptr<const INTERNED>> topics{};
+        };  // struct shard
+
+        template <typename INTERNED>
+        auto shards( ) -> std::array<shard<INTERNED>, SHARD_COUNT>&
+        {
+            // Never destroyed, since topic names may still be released while static objects are being destroyed
+            static auto* const shards = new std::array<shard<INTERNED>, SHARD_COUNT>{};
+            return *shards;
+        }
+
+        std::atomic<std::uint64_t> next_id{1};
+    }  // namespace
+
+    // ------------------------------------------------------------------------------------------------------------
+    // Public/static
+    // ------------------------------------------------------------------------------------------------------------
+
+    auto topic_name::intern( const std::string_view name ) -> topic_name
+    {
+        const auto hash = std::hash<std::string_view>{}( name );
+        auto& shrd = shards<interned>( )[hash % SHARD_COUNT];
+
+        const auto lock = std::lock_guard<std::mutex>{shrd.mutex};
+        const auto existing = shrd.topics.find( name );
+        if ( existing != shrd.topics.end( ) )
+        {
+            if ( auto data = existing->second.lock( ) )
+                return topic_name{std::move( data )};
+            // Last topic_name is gone, yet it has not been released: leave it to release( ) to only free its memory
+            shrd.topics.erase( existing );
+        }
+
+        auto* const data = new interned{std::string{name}, hash, next_id++, {}};
+        data->levels.reserve( static_cast<std::size_t>( std::count( name.begin( ), name.end( ), '/' ) ) + 1 );
+        auto offset = std::size_t{0};
+        while ( true )
+        {
+            const auto level_end = name.find( '/', offset );
+            const auto length = ( level_end == std::string_view::npos ? name.size( ) : level_end ) - offset;
+            data->levels.push_back( level_info{static_cast<std::uint32_t>( offset ),
+                                               static_cast<std::uint32_t>( length ),
+                                               hash_level( name.substr( offset, length ) )} );
+            if ( level_end == std::string_view::npos )
+                break;
+            offset = level_end + 1;
+        }
+
+        auto shared = std::shared_ptr<const interned>{data, []( const interned* released ) { release( released ); }};
+        shrd.topics.emplace( std::string_view{data->name}, shared );
+
+        return topic_name{std::move( shared )};
+    }
+
+    auto topic_name::interned_count( ) -> std::size_t
+    {
+        auto count = std::size_t{0};
+        for ( auto& shrd : shards<interned>( ) )
+        {
+            const auto lock = std::lock_guard<std::mutex>{shrd.mutex};
+            count += shrd.topics.size( );
+        }
+
+        return count;
+    }
+
+    // ------------------------------------------------------------------------------------------------------------
+    // Private/static
+    // ------------------------------------------------------------------------------------------------------------
+
+    auto topic_name::release( const interned* data ) -> void
+    {
+        {
+            auto& shrd = shards<interned>( )[data->hash % SHARD_COUNT];
+            const auto lock = std::lock_guard<std::mutex>{shrd.mutex};
+            const auto existing = shrd.topics.find( data->name );
+            // This topic may since have been interned anew, using a new representation
+            if ( ( existing != shrd.topics.end( ) ) && ( existing->first.data( ) == data->name.data( ) ) )
+                shrd.topics.erase( existing );
+        }
+        delete data;
+    }
+}  // namespace io_wally::protocol
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace io_wally::protocol
+{
+    /// \brief An interned, pre-tokenized topic name, the topic a PUBLISH packet is published to.
+    ///
+    /// Topic names are decoded and split into their '/'-separated topic levels once, when a PUBLISH packet is
+    /// received. Each \c topic_name keeps its levels' boundaries and hashes alongside its name, so that matching it
+    /// against topic filters needs neither scan it character by character nor hash its levels again.
+    ///
+    /// Topic names are interned: all \c topic_name instances alive at the same time and sharing the same name also
+    /// share the same representation. Copying a \c topic_name is thus cheap, comparing two \c topic_names for
+    /// equality compares pointers, and publishing repeatedly to the same topic does not allocate anything once that
+    /// topic is interned. An interned topic is released once its last \c topic_name is gone. While alive, it carries a
+    /// unique \c id.
+    ///
+    /// Interning a topic name is thread safe.
+    ///
+    /// \see http://docs.oasis-open.org/mqtt/mqtt/v3.1.1/os/mqtt-v3.1.1-os.html#_Toc398718106
+    class topic_name final
+    {
+       public:  // static
+        /// \brief Return the interned \c topic_name for \c name, interning it if necessary.
+        ///
+        /// \param name Well-formed topic name
+        /// \return Interned \c topic_name
+        [[nodiscard]] static auto intern( std::string_view name ) -> topic_name;
+
+        /// \brief Hash function used for topic levels, shared with everyone that needs to compare level hashes.
+        [[nodiscard]] static auto hash_level( std::string_view level ) -> std::size_t
+        {
+            return std::hash<std::string_view>{}( level );
+        }
+
+        /// \brief Number of distinct topic names currently interned.
+        [[nodiscard]] static auto interned_count( ) -> std::size_t;
+
+       public:
+        /// \brief This topic name as a string.
+        [[nodiscard]] auto name( ) const -> const std::string&
+        {
+            return data_->name;
+        }
+
+        /// \brief ID unique among all topic names interned at the same time.
+        [[nodiscard]] auto id( ) const -> std::uint64_t
+        {
+            return data_->id;
+        }
+
+        /// \brief Hash of this topic name as a whole.
+        [[nodiscard]] auto hash( ) const -> std::size_t
+        {
+            return data_->hash;
+        }
+
+        /// \brief Number of topic levels, at least one.
+        [[nodiscard]] auto level_count( ) const -> std::size_t
+        {
+            return data_->levels.size( );
+        }
+
+        /// \brief Topic level at position \c index.
+        [[nodiscard]] auto level( std::size_t index ) const -> std::string_view
+        {
+            const auto& lvl = data_->levels[index];
+            return std::string_view{data_->name}.substr( lvl.offset, lvl.length );
+        }
+
+        /// \brief Offset of topic level at position \c index within \c name.
+        [[nodiscard]] auto level_offset( std::size_t index ) const -> std::size_t
+        {
+            return data_->levels[index].offset;
+        }
+
+        /// \brief Hash of topic level at position \c index, as computed by \c hash_level.
+        [[nodiscard]] auto level_hash( std::size_t index ) const -> std::size_t
+        {
+            return data_->levels[index].hash;
+        }
+
+        friend auto operator==( const topic_name& lhs, const topic_name& rhs ) -> bool
+        {
+            return lhs.data_ == rhs.data_;
+        }
+
+        friend auto operator!=( const topic_name& lhs, const topic_name& rhs ) -> bool
+        {
+            return !( lhs == rhs );
+        }
+
+        friend auto operator==( const topic_name& lhs, std::string_view rhs ) -> bool
+        {
+            return lhs.data_->name == rhs;
+        }
+
+        friend auto operator!=( const topic_name& lhs, std::string_view rhs ) -> bool
+        {
+            return !( lhs == rhs );
+        }
+
+        friend auto operator<<( std::ostream& output, const topic_name& topic ) -> std::ostream&
+        {
+            return output << topic.data_->name;
+        }
+
+       private:
+        struct level_info final
+        {
+            std::uint32_t offset;
+            std::uint32_t length;
+            std::size_t hash;
+        };  // struct level_info
+
+        struct interned final
+        {
+            std::string name;
+            std::size_t hash;
+            std::uint64_t id;
+            std::vector<level_info> levels;
+        };  // struct interned
+
+       private:
+        explicit topic_name( std::shared_ptr<const interned> data ) : data_{std::move( data )}
+        {
+        }
+
+        static auto release( const interned* data ) -> void;
+
+       private:
+        std::shared_ptr<const interned> data_;
+    };  // class topic_name
+}  // namespace io_wally::protocol
+
+namespace std
+{
+    template <>
+    struct hash<io_wally::protocol::topic_name>
+    {
+        auto operator( )( const io_wally::protocol::topic_name& topic ) const noexcept -> std::size_t
+        {
+            return topic.hash( );
+        }
+    };
+}  // namespace std
@@ -9,6 +9,7 @@
 #include <optional>
 
 #include "io_wally/protocol/common.hpp"
+#include "io_wally/protocol/packet_pool.hpp"
 #include "io_wally/protocol/unsuback_packet.hpp"
 
 namespace io_wally::protocol
@@ -65,7 +66,7 @@ namespace io_wally::protocol
         /// \return An \c unsuback packet with packet identifier taken from this \c unsubscribe packet
         [[nodiscard]] auto ack( ) const -> std::shared_ptr<const unsuback>
         {
-            return std::make_shared<const unsuback>( packet_identifier_ );
+            return make_packet<unsuback>( packet_identifier_ );
         }
 
         /// \brief Return a string representation to be used in log output.
@@ -0,0 +1,349 @@
+#include "io_wally/protocol/utf8.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+#include <immintrin.h>
+#endif
+
+#include "io_wally/error/protocol.hpp"
+
+namespace io_wally::protocol::utf8
+{
+    namespace
+    {
+        constexpr unsigned NULL_FLAG = 0x01;
+
+        constexpr unsigned WILDCARD_FLAG = 0x02;
+
+        /// Returned by validate_sequences if it encounters an ill-formed sequence
+        constexpr std::size_t ILL_FORMED = std::string_view::npos;
+
+        /// Flags to set for each ASCII character, so that the scalar path need not branch on ASCII characters either
+        constexpr auto ASCII_FLAGS = []( ) {
+            auto flags = std::array<std::uint8_t, 0x80>{};
+            flags['\0'] = NULL_FLAG;
+            flags['+'] = WILDCARD_FLAG;
+            flags['#'] = WILDCARD_FLAG;
+            return flags;
+        }( );
+
+        /// Validate UTF-8 sequences starting at \c pos, at least up to \c until, following Unicode's table of
+        /// well-formed UTF-8 byte sequences (The Unicode Standard, table 3-7). Return position following the last
+        /// sequence validated, or \c ILL_FORMED.
+        auto validate_sequences( const std::uint8_t* bytes,
+                                 const std::size_t size,
+                                 std::size_t pos,
+                                 const std::size_t until,
+                                 unsigned& flags ) -> std::size_t
+        {
+            while ( pos < until )
+            {
+                const auto lead = bytes[pos];
+                if ( lead < 0x80 )
+                {
+                    flags |= ASCII_FLAGS[lead];
+                    ++pos;
+                    continue;
+                }
+
+                // Valid range of a sequence's second byte depends on its lead byte, ruling out overlong encodings,
+                // surrogates and code points beyond U+10FFFF
+                auto length = std::size_t{0};
+                auto lower = std::uint8_t{0x80};
+                auto upper = std::uint8_t{0xBF};
+                if ( ( lead >= 0xC2 ) && ( lead <= 0xDF ) )
+                {
+                    length = 2;
+                }
+                else if ( lead == 0xE0 )
+                {
+                    length = 3;
+                    lower = 0xA0;
+                }
+                else if ( lead == 0xED )
+                {
+                    length = 3;
+                    upper = 0x9F;
+                }
+                else if ( ( lead >= 0xE1 ) && ( lead <= 0xEF ) )
+                {
+                    length = 3;
+                }
+                else if ( lead == 0xF0 )
+                {
+                    length = 4;
+                    lower = 0x90;
+                }
+                else if ( ( lead >= 0xF1 ) && ( lead <= 0xF3 ) )
+                {
+                    length = 4;
+                }
+                else if ( lead == 0xF4 )
+                {
+                    length = 4;
+                    upper = 0x8F;
+                }
+                else
+                {
+                    return ILL_FORMED;
+                }
+
+                if ( ( size - pos < length ) || ( bytes[pos + 1] < lower ) || ( bytes[pos + 1] > upper ) )
+                    return ILL_FORMED;
+                for ( auto i = std::size_t{2}; i < length; ++i )
+                {
+                    if ( ( bytes[pos + i] & 0xC0 ) != 0x80 )
+                        return ILL_FORMED;
+                }
+                pos += length;
+            }
+
+            return pos;
+        }
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+        /// Check ASCII characters 16 bytes at a time, stopping at the first chunk that contains a non-ASCII byte.
+        /// Return number of bytes checked.
+        auto scan_ascii_sse2( const char* data, const std::size_t size, unsigned& flags ) -> std::size_t
+        {
+            const auto zeros = _mm_setzero_si128( );
+            const auto pluses = _mm_set1_epi8( '+' );
+            const auto hashes = _mm_set1_epi8( '#' );
+            auto nulls = _mm_setzero_si128( );
+            auto wildcards = _mm_setzero_si128( );
+            auto pos = std::size_t{0};
+            while ( pos < size )
+            {
+                const auto remaining = size - pos;
+                auto chunk = __m128i{};
+                if ( remaining >= sizeof( chunk ) )
+                {
+                    chunk = _mm_loadu_si128( reinterpret_cast<const __m128i*>( data + pos ) );
+                }
+                else
+                {
+                    // Pad our last chunk with a character that is neither special nor non-ASCII
+                    alignas( __m128i ) char tail[sizeof( chunk )];
+                    std::memset( tail, 'a', sizeof( tail ) );
+                    std::memcpy( tail, data + pos, remaining );
+                    chunk = _mm_load_si128( reinterpret_cast<const __m128i*>( tail ) );
+                }
+                if ( _mm_movemask_epi8( chunk ) != 0 )
+                    break;
+                nulls = _mm_or_si128( nulls, _mm_cmpeq_epi8( chunk, zeros ) );
+                wildcards = _mm_or_si128(
+                    wildcards, _mm_or_si128( _mm_cmpeq_epi8( chunk, pluses ), _mm_cmpeq_epi8( chunk, hashes ) ) );
+                pos += std::min( remaining, sizeof( chunk ) );
+            }
+            if ( _mm_movemask_epi8( nulls ) != 0 )
+                flags |= NULL_FLAG;
+            if ( _mm_movemask_epi8( wildcards ) != 0 )
+                flags |= WILDCARD_FLAG;
+
+            return pos;
+        }
+
+        /// Same as scan_ascii_sse2, yet checking 32 bytes at a time
+        __attribute__( ( target( "avx2" ) ) ) auto scan_ascii_avx2( const char* data,
+                                                                  const std::size_t size,
+                                                                  unsigned& flags ) -> std::size_t
+        {
+            const auto zeros = _mm256_setzero_si256( );
+            const auto pluses = _mm256_set1_epi8( '+' );
+            const auto hashes = _mm256_set1_epi8( '#' );
+            auto nulls = _mm256_setzero_si256( );
+            auto wildcards = _mm256_setzero_si256( );
+            auto pos = std::size_t{0};
+            while ( pos < size )
+            {
+                const auto remaining = size - pos;
+                auto chunk = __m256i{};
+                if ( remaining >= sizeof( chunk ) )
+                {
+                    chunk = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( data + pos ) );
+                }
+                else
+                {
+                    alignas( __m256i ) char tail[sizeof( chunk )];
+                    std::memset( tail, 'a', sizeof( tail ) );
+                    std::memcpy( tail, data + pos, remaining );
+                    chunk = _mm256_load_si256( reinterpret_cast<const __m256i*>( tail ) );
+                }
+                if ( _mm256_movemask_epi8( chunk ) != 0 )
+                    break;
+                nulls = _mm256_or_si256( nulls, _mm256_cmpeq_epi8( chunk, zeros ) );
+                wildcards = _mm256_or_si256( wildcards, _mm256_or_si256( _mm256_cmpeq_epi8( chunk, pluses ),
+                                                                         _mm256_cmpeq_epi8( chunk, hashes ) ) );
+                pos += std::min( remaining, sizeof( chunk ) );
+            }
+            if ( _mm256_movemask_epi8( nulls ) != 0 )
+                flags |= NULL_FLAG;
+            if ( _mm256_movemask_epi8( wildcards ) != 0 )
+                flags |= WILDCARD_FLAG;
+
+            return pos;
+        }
+#endif
+
+        auto detect_instruction_set( ) -> instruction_set
+        {
+#if defined( __x86_64__ ) || defined( __i386__ )
+            __builtin_cpu_init( );
+            if ( __builtin_cpu_supports( "avx2" ) )
+                return instruction_set::avx2;
+            if ( __builtin_cpu_supports( "sse2" ) )
+                return instruction_set::sse2;
+#endif
+            return instruction_set::scalar;
+        }
+
+        /// Check leading ASCII characters using \c isa, returning number of bytes checked
+        auto scan_ascii( [[maybe_unused]] const instruction_set isa,
+                         [[maybe_unused]] const char* data,
+                         [[maybe_unused]] const std::size_t size,
+                         [[maybe_unused]] unsigned& flags ) -> std::size_t
+        {
+#if defined( __x86_64__ ) || defined( __i386__ )
+            switch ( isa )
+            {
+                case instruction_set::avx2:
+                    return scan_ascii_avx2( data, size, flags );
+                case instruction_set::sse2:
+                    return scan_ascii_sse2( data, size, flags );
+                case instruction_set::scalar:
+                default:
+                    break;
+            }
+#endif
+            // Leave everything to validate_sequences
+            return 0;
+        }
+
+        [[noreturn]] void throw_malformed( const std::string& reason )
+        {
+            throw error::malformed_mqtt_packet( reason );
+        }
+    }  // namespace
+
+    // ------------------------------------------------------------------------------------------------------------
+    // Public
+    // ------------------------------------------------------------------------------------------------------------
+
+    auto supported_instruction_set( ) -> instruction_set
+    {
+        static const auto supported = detect_instruction_set( );
+
+        return supported;
+    }
+
+    auto scan( const std::string_view str ) -> scan_result
+    {
+        return scan( str, supported_instruction_set( ) );
+    }
+
+    auto scan( const std::string_view str, const instruction_set isa ) -> scan_result
+    {
+        assert( isa <= supported_instruction_set( ) );
+
+        // Once a chunk contains a non-ASCII byte we validate at least that chunk byte by byte, before trying our luck
+        // with the next chunk
+        const auto chunk_size = ( isa == instruction_set::avx2 ) ? std::size_t{32} : std::size_t{16};
+        const auto* bytes = reinterpret_cast<const std::uint8_t*>( str.data( ) );
+        auto flags = 0u;
+        auto result = scan_result{};
+        auto pos = std::size_t{0};
+        while ( pos < str.size( ) )
+        {
+            pos += scan_ascii( isa, str.data( ) + pos, str.size( ) - pos, flags );
+            if ( pos == str.size( ) )
+                break;
+            const auto until = ( isa == instruction_set::scalar ) ? str.size( )
+                                                                  : std::min( str.size( ), pos + chunk_size );
+            pos = validate_sequences( bytes, str.size( ), pos, until, flags );
+            if ( pos == ILL_FORMED )
+            {
+                result.well_formed = false;
+                break;
+            }
+        }
+        result.contains_null = ( flags & NULL_FLAG ) != 0;
+        result.contains_wildcard = ( flags & WILDCARD_FLAG ) != 0;
+
+        return result;
+    }
+
+    void check_string( const std::string_view str )
+    {
+        const auto result = scan( str );
+        if ( !result.well_formed )
+            throw_malformed( "[MQTT-1.5.3-1] String is not well-formed UTF-8" );
+        if ( result.contains_null )
+            throw_malformed( "[MQTT-1.5.3-2] String MUST NOT include null character (U+0000)" );
+    }
+
+    void check_topic_name( const std::string_view topic_name )
+    {
+        if ( topic_name.empty( ) )
+            throw_malformed( "[MQTT-4.7.3-1] Topic name MUST be at least one character long" );
+        if ( topic_name.size( ) > 65535 )
+            throw_malformed( "[MQTT-4.7.3-3] Topic name MUST NOT be longer than 65535 characters" );
+
+        const auto result = scan( topic_name );
+        if ( !result.well_formed )
+            throw_malformed( "[MQTT-1.5.3-1] Topic name is not well-formed UTF-8" );
+        if ( result.contains_null )
+            throw_malformed( "[MQTT-4.7.3-2] Topic name MUST NOT include null character (U+0000)" );
+        if ( result.contains_wildcard )
+            throw_malformed( "[MQTT-4.7.1-1] Topic name MUST NOT include wildcard characters '+' or '#'" );
+    }
+
+    void check_topic_filter( const std::string_view topic_filter )
+    {
+        const auto malformed = [topic_filter]( const char* mqtt_ref ) {
+            throw_malformed( std::string{"[MQTT-"} + mqtt_ref +
+                             "] Not a well-formed topic filter: " + std::string{topic_filter} );
+        };
+
+        if ( topic_filter.empty( ) )
+            malformed( "4.7.3-1" );
+        if ( topic_filter.size( ) > 65535 )
+            malformed( "4.7.3-3" );
+
+        const auto result = scan( topic_filter );
+        if ( !result.well_formed )
+            malformed( "1.5.3-1" );
+        if ( result.contains_null )
+            malformed( "4.7.3-2" );
+        if ( !result.contains_wildcard )
+            return;
+
+        // Wildcards need to occupy an entire topic level, and "#" needs to be the last one
+        auto pos = std::size_t{0};
+        while ( true )
+        {
+            const auto level_end = topic_filter.find( '/', pos );
+            const auto level = topic_filter.substr(
+                pos, level_end == std::string_view::npos ? std::string_view::npos : level_end - pos );
+            if ( level == "#" )
+            {
+                if ( level_end != std::string_view::npos )
+                    malformed( "4.7.1-2" );
+            }
+            else if ( ( level != "+" ) && ( level.find_first_of( "+#" ) != std::string_view::npos ) )
+            {
+                malformed( level.find( '#' ) != std::string_view::npos ? "4.7.1-2" : "4.7.1-1" );
+            }
+            if ( level_end == std::string_view::npos )
+                break;
+            pos = level_end + 1;
+        }
+    }
+}  // namespace io_wally::protocol::utf8
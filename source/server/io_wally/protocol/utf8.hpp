@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+namespace io_wally::protocol::utf8
+{
+    /// \brief Instruction sets \c scan knows how to use, ordered by preference.
+    enum class instruction_set : std::uint8_t
+    {
+        scalar = 0,
+        sse2,
+        avx2
+    };
+
+    /// \brief What a single pass over a string found out about it.
+    struct scan_result final
+    {
+        /// Whether the string is well-formed UTF-8, i.e. contains neither ill-formed sequences nor overlong encodings
+        /// nor encodings of UTF-16 surrogates U+D800 to U+DFFF [MQTT-1.5.3-1]
+        bool well_formed{true};
+        /// Whether the string contains U+0000 [MQTT-1.5.3-2]
+        bool contains_null{false};
+        /// Whether the string contains one of the wildcard characters '+' and '#'
+        bool contains_wildcard{false};
+    };  // struct scan_result
+
+    /// \brief Best instruction set supported by the CPU we are running on, determined once at runtime.
+    [[nodiscard]] auto supported_instruction_set( ) -> instruction_set;
+
+    /// \brief Scan \c str in a single pass, using the best instruction set supported by our CPU.
+    ///
+    /// Runs of ASCII characters are checked in chunks of 16 or 32 bytes at a time, without branching per byte. Only
+    /// once a chunk contains a non-ASCII byte does \c scan fall back to validating the rest of \c str byte by byte.
+    [[nodiscard]] auto scan( std::string_view str ) -> scan_result;
+
+    /// \brief Scan \c str in a single pass, using instruction set \c isa.
+    ///
+    /// \pre \c isa is not better than \c supported_instruction_set( )
+    [[nodiscard]] auto scan( std::string_view str, instruction_set isa ) -> scan_result;
+
+    /// \brief Check that \c str is a well-formed UTF-8 encoded string as defined by MQTT 3.1.1.
+    ///
+    /// \throws error::malformed_mqtt_packet If \c str is not well-formed
+    ///
+    /// \see http://docs.oasis-open.org/mqtt/mqtt/v3.1.1/os/mqtt-v3.1.1-os.html#_Toc398718016
+    void check_string( std::string_view str );
+
+    /// \brief Check that \c topic_name is a well-formed topic name: a well-formed string, at least one character
+    /// long and without wildcard characters.
+    ///
+    /// \throws error::malformed_mqtt_packet If \c topic_name is not well-formed
+    ///
+    /// \see http://docs.oasis-open.org/mqtt/mqtt/v3.1.1/os/mqtt-v3.1.1-os.html#_Toc398718106
+    void check_topic_name( std::string_view topic_name );
+
+    /// \brief Check that \c topic_filter is a well-formed topic filter: a well-formed string, at least one character
+    /// long and using wildcard characters only where allowed.
+    ///
+    /// \throws error::malformed_mqtt_packet If \c topic_filter is not well-formed
+    ///
+    /// \see http://docs.oasis-open.org/mqtt/mqtt/v3.1.1/os/mqtt-v3.1.1-os.html#_Toc398718106
+    void check_topic_filter( std::string_view topic_filter );
+}  // namespace io_wally::protocol::utf8
@@ -0,0 +1,190 @@
+#include "io_wally/timing_wheel.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <asio.hpp>
+
+namespace io_wally
+{
+    asio::io_service::id timing_wheel::id;
+
+    // --------------------------------------------------------------------------------
+    // Public
+    // --------------------------------------------------------------------------------
+
+    timing_wheel::timing_wheel( asio::io_service& io_service )
+        : asio::io_service::service{io_service}, ticker_{io_service}
+    {
+        static_assert( ( SLOT_COUNT & ( SLOT_COUNT - 1 ) ) == 0, "SLOT_COUNT must be a power of 2" );
+    }
+
+    auto timing_wheel::schedule( clock::duration timeout, callback cb ) -> timer_id
+    {
+        if ( !ticking_ )
+        {
+            // We have been idle, and our notion of current time is outdated. Since there are no pending timeouts we
+            // may simply skip all ticks since then.
+            now_ = clock::now( );
+            current_tick_ = tick_of( now_ );
+        }
+        // Round up to the tick our deadline falls into, measured from now_, not from current_tick_'s start
+        const auto deadline = now_ - epoch_ + std::max( timeout, clock::duration::zero( ) );
+        const auto deadline_tick = static_cast<std::uint64_t>( ( deadline + TICK - clock::duration{1} ) / TICK );
+
+        auto index = free_entries_;
+        if ( index != NO_ENTRY )
+        {
+            free_entries_ = entries_[index].next;
+        }
+        else
+        {
+            index = static_cast<std::uint32_t>( entries_.size( ) );
+            entries_.emplace_back( );
+        }
+        auto& ent = entries_[index];
+        ent.cb = std::move( cb );
+        ent.deadline_tick = std::max( current_tick_ + 1, deadline_tick );
+        link( index );
+        ++size_;
+        start_ticking( );
+
+        return timer_id{index, ent.generation};
+    }
+
+    auto timing_wheel::cancel( timer_id& timer ) -> bool
+    {
+        const auto index = timer.index;
+        const auto generation = timer.generation;
+        timer = timer_id{};
+        if ( ( index >= entries_.size( ) ) || ( entries_[index].generation != generation ) )
+            return false;
+
+        unlink( index );
+        release( index );
+
+        return true;
+    }
+
+    // --------------------------------------------------------------------------------
+    // Private
+    // --------------------------------------------------------------------------------
+
+    void timing_wheel::shutdown_service( )
+    {
+        auto ignored_ec = std::error_code{};
+        ticker_.cancel( ignored_ec );
+        ticking_ = false;
+        // Destroying callbacks may destroy objects that in turn try to cancel their timeouts: leave ourselves in a
+        // consistent state before doing so
+        auto entries = std::vector<entry>{};
+        entries.swap( entries_ );
+        std::fill( slots_.begin( ), slots_.end( ), NO_ENTRY );
+        free_entries_ = NO_ENTRY;
+        size_ = 0;
+    }
+
+    void timing_wheel::link( std::uint32_t index )
+    {
+        auto& ent = entries_[index];
+        auto& head = slots_[ent.deadline_tick & ( SLOT_COUNT - 1 )];
+        ent.prev = NO_ENTRY;
+        ent.next = head;
+        if ( head != NO_ENTRY )
+            entries_[head].prev = index;
+        head = index;
+    }
+
+    void timing_wheel::unlink( std::uint32_t index )
+    {
+        auto& ent = entries_[index];
+        if ( ent.prev != NO_ENTRY )
+            entries_[ent.prev].next = ent.next;
+        else
+            slots_[ent.deadline_tick & ( SLOT_COUNT - 1 )] = ent.next;
+        if ( ent.next != NO_ENTRY )
+            entries_[ent.next].prev = ent.prev;
+    }
+
+    void timing_wheel::release( std::uint32_t index )
+    {
+        auto& ent = entries_[index];
+        ent.cb = nullptr;
+        ++ent.generation;  // Invalidate all outstanding timer_ids for this entry
+        ent.prev = NO_ENTRY;
+        ent.next = free_entries_;
+        free_entries_ = index;
+        --size_;
+    }
+
+    void timing_wheel::start_ticking( )
+    {
+        if ( ticking_ )
+            return;
+
+        ticking_ = true;
+        ticker_.expires_at( epoch_ + TICK * ( current_tick_ + 1 ) );
+        ticker_.async_wait( [this]( const std::error_code& ec ) { on_tick( ec ); } );
+    }
+
+    void timing_wheel::on_tick( const std::error_code& ec )
+    {
+        if ( ec )
+        {
+            ticking_ = false;
+            return;
+        }
+
+        now_ = clock::now( );
+        advance_to( tick_of( now_ ) );
+        if ( size_ > 0 )
+        {
+            ticker_.expires_at( epoch_ + TICK * ( current_tick_ + 1 ) );
+            ticker_.async_wait( [this]( const std::error_code& ec ) { on_tick( ec ); } );
+        }
+        else
+        {
+            ticking_ = false;
+        }
+    }
+
+    void timing_wheel::advance_to( std::uint64_t tick )
+    {
+        if ( tick <= current_tick_ )
+            return;
+
+        // Collect expired callbacks first, since invoking them may schedule or cancel other timeouts. If we fell
+        // behind by more than one revolution, visiting each slot once suffices.
+        auto expired = std::vector<callback>{};
+        const auto first_tick = tick - std::min<std::uint64_t>( tick - current_tick_, SLOT_COUNT ) + 1;
+        for ( auto t = first_tick; t <= tick; ++t )
+        {
+            auto index = slots_[t & ( SLOT_COUNT - 1 )];
+            while ( index != NO_ENTRY )
+            {
+                const auto next = entries_[index].next;
+                if ( entries_[index].deadline_tick <= tick )
+                {
+                    expired.push_back( std::move( entries_[index].cb ) );
+                    unlink( index );
+                    release( index );
+                }
+                index = next;
+            }
+        }
+        current_tick_ = tick;
+
+        for ( auto& cb : expired )
+            cb( );
+    }
+
+    auto timing_wheel::tick_of( clock::time_point time_point ) const -> std::uint64_t
+    {
+        return static_cast<std::uint64_t>( ( time_point - epoch_ ) / TICK );
+    }
+}  // namespace io_wally
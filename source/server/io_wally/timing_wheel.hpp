@@ -0,0 +1,131 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <vector>
+
+#include <asio.hpp>
+#include <asio/steady_timer.hpp>
+
+namespace io_wally
+{
+    /// \brief Hashed timing wheel, scheduling large numbers of coarse grained timeouts at O(1) cost.
+    ///
+    /// Each connection needs a connect timeout and a keep alive timeout, and each in-flight publication needs a
+    /// retransmit timeout. Giving each of these its own \c asio::steady_timer means every (re-)arm and cancel
+    /// operation touches the reactor's timer heap. A \c timing_wheel instead keeps its timeouts in a fixed number of
+    /// slots, each covering one \c TICK, and uses a single \c asio::steady_timer to advance from slot to slot while
+    /// there are pending timeouts. Timeouts farther away than one revolution simply stay in their slot for another
+    /// round.
+    ///
+    /// A \c timing_wheel is an \c asio service: obtain the one instance belonging to an \c asio::io_service via
+    /// <tt>asio::use_service<timing_wheel>( io_service )</tt>. Callbacks are invoked on one of that \c io_service's
+    /// threads.
+    ///
+    /// NOTE: This class is not thread safe. It must only be used from the thread running its \c io_service. This is
+    /// why we run every \c io_service in a dedicated thread.
+    class timing_wheel final : public asio::io_service::service
+    {
+       public:
+        using clock = std::chrono::steady_clock;
+
+        using callback = std::function<void( )>;
+
+        /// \brief Identifies a scheduled timeout. A default constructed \c timer_id identifies no timeout at all.
+        struct timer_id final
+        {
+            std::uint32_t index{std::numeric_limits<std::uint32_t>::max( )};
+            std::uint32_t generation{0};
+        };  // struct timer_id
+
+        /// Granularity of all timeouts
+        static constexpr std::chrono::milliseconds TICK{10};
+
+        /// Number of slots, must be a power of 2
+        static constexpr std::size_t SLOT_COUNT = 1024;
+
+        /// Identifies this service in an \c asio::io_service
+        static asio::io_service::id id;
+
+       public:
+        explicit timing_wheel( asio::io_service& io_service );
+
+        timing_wheel( const timing_wheel& ) = delete;
+
+        auto operator=( const timing_wheel& ) -> timing_wheel& = delete;
+
+        /// \brief Invoke \c cb once \c timeout has expired, rounded up to the next \c TICK.
+        ///
+        /// \param timeout Timeout to wait for
+        /// \param cb Callback to invoke
+        /// \return ID of scheduled timeout, to be used for cancelling it
+        auto schedule( clock::duration timeout, callback cb ) -> timer_id;
+
+        /// \brief Cancel timeout identified by \c timer, unless it has already expired or been cancelled, and reset \c
+        /// timer.
+        ///
+        /// \param timer ID of timeout to cancel
+        /// \return \c true if timeout was cancelled, \c false otherwise
+        auto cancel( timer_id& timer ) -> bool;
+
+        /// \brief Time of this wheel's most recent tick, or current time if this wheel is idle.
+        ///
+        /// Accurate to within one \c TICK while there are pending timeouts, and far cheaper than asking the clock.
+        /// Meant to be used for stamping events like received packets, which are later checked by a timeout.
+        [[nodiscard]] auto now( ) const -> clock::time_point
+        {
+            return ticking_ ? now_ : clock::now( );
+        }
+
+        /// \brief Number of pending timeouts.
+        [[nodiscard]] auto size( ) const -> std::size_t
+        {
+            return size_;
+        }
+
+       private:
+        static constexpr std::uint32_t NO_ENTRY = std::numeric_limits<std::uint32_t>::max( );
+
+        struct entry final
+        {
+            callback cb{};
+            std::uint64_t deadline_tick{0};
+            std::uint32_t generation{0};
+            /// Previous and next entry in our slot's list, or in free list (next only)
+            std::uint32_t prev{NO_ENTRY};
+            std::uint32_t next{NO_ENTRY};
+        };  // struct entry
+
+       private:
+        void shutdown_service( ) override;
+
+        void link( std::uint32_t index );
+
+        void unlink( std::uint32_t index );
+
+        void release( std::uint32_t index );
+
+        void start_ticking( );
+
+        void on_tick( const std::error_code& ec );
+
+        void advance_to( std::uint64_t tick );
+
+        [[nodiscard]] auto tick_of( clock::time_point time_point ) const -> std::uint64_t;
+
+       private:
+        const clock::time_point epoch_{clock::now( )};
+        clock::time_point now_{epoch_};
+        /// Most recent tick whose slot has been processed
+        std::uint64_t current_tick_{0};
+        std::vector<entry> entries_{};
+        std::uint32_t free_entries_{NO_ENTRY};
+        std::vector<std::uint32_t> slots_ = std::vector<std::uint32_t>( SLOT_COUNT, NO_ENTRY );
+        std::size_t size_{0};
+        asio::steady_timer ticker_;
+        bool ticking_{false};
+    };  // class timing_wheel
+}  // namespace io_wally
@@ -83,15 +83,6 @@ namespace framework
         return std::make_shared<io_wally::protocol::unsubscribe>( remaining_length, pktid, topic_filters );
     }
 
-    io_wally::mqtt_packet_sender::packet_container_t::ptr create_subscribe_container(
-        const std::vector<io_wally::protocol::subscription> subscriptions )
-    {
-        auto subscribe_ptr = create_subscribe_packet( subscriptions );
-        auto sender_ptr = framework::packet_sender_mock::create( );
-
-        return io_wally::mqtt_packet_sender::packet_container_t::contain( "client_mock", sender_ptr, subscribe_ptr );
-    }
-
     std::shared_ptr<io_wally::protocol::publish> create_publish_packet( const std::string& topic,
                                                                         bool retain,
                                                                         const std::vector<uint8_t> msg )
@@ -106,29 +97,33 @@ namespace framework
         const auto remaining_length = uint32_t{20};  // 20 is just some number
         const auto pktid = std::uint16_t{7};
 
-        return std::make_shared<io_wally::protocol::publish>( type_and_flags, remaining_length, topic, pktid, msg );
+        return std::make_shared<io_wally::protocol::publish>(
+            type_and_flags, remaining_length, io_wally::protocol::topic_name::intern( topic ), pktid, msg );
     }
 
-    io_wally::mqtt_packet_sender::packet_container_t::ptr create_publish_container( const std::string& topic )
+    cxxopts::ParseResult create_parse_result( )
     {
-        auto publish_ptr = create_publish_packet( topic );
-        auto sender_ptr = framework::packet_sender_mock::create( );
-
-        return io_wally::mqtt_packet_sender::packet_container_t::contain( "client_mock", sender_ptr, publish_ptr );
+        return create_parse_result( {} );
     }
 
-    cxxopts::ParseResult create_parse_result( )
+    cxxopts::ParseResult create_parse_result( const std::vector<const char*>& options )
     {
-        const char* command_line_args[]{"executable"};
-        auto argc = static_cast<int>( sizeof( command_line_args ) / sizeof( *command_line_args ) );
-        auto argv = const_cast<char**>( command_line_args );
+        auto command_line_args = std::vector<const char*>{"executable"};
+        command_line_args.insert( command_line_args.end( ), options.begin( ), options.end( ) );
+        auto argc = static_cast<int>( command_line_args.size( ) );
+        auto argv = const_cast<char**>( command_line_args.data( ) );
 
         return PROGRAM_OPTIONS.parse( argc, argv );
     }
 
     io_wally::context create_context( )
     {
-        return io_wally::context( create_parse_result( ),
+        return create_context( {} );
+    }
+
+    io_wally::context create_context( const std::vector<const char*>& options )
+    {
+        return io_wally::context( create_parse_result( options ),
                                   std::unique_ptr<io_wally::spi::authentication_service>(
                                       new io_wally::impl::accept_all_authentication_service{} ),
                                   io_wally::logging::logger_factory::disabled( ) );
@@ -42,17 +42,17 @@ namespace framework
     std::shared_ptr<io_wally::protocol::unsubscribe> create_unsubscribe_packet(
         const std::vector<std::string> topic_filters );
 
-    io_wally::mqtt_packet_sender::packet_container_t::ptr create_subscribe_container(
-        const std::vector<io_wally::protocol::subscription> subscriptions );
-
     std::shared_ptr<io_wally::protocol::publish> create_publish_packet( const std::string& topic,
                                                                         bool retain = false,
                                                                         const std::vector<std::uint8_t> msg = {
                                                                             't', 'e', 's', 't'} );
 
-    io_wally::mqtt_packet_sender::packet_container_t::ptr create_publish_container( const std::string& topic );
-
     cxxopts::ParseResult create_parse_result( );
 
+    /// Parse \c options as if passed on the command line, e.g. {"--pub-max-in-flight", "8"}
+    cxxopts::ParseResult create_parse_result( const std::vector<const char*>& options );
+
     io_wally::context create_context( );
+
+    io_wally::context create_context( const std::vector<const char*>& options );
 }  // namespace framework
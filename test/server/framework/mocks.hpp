@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cassert>
+#include <cstdint>
 #include <memory>
 #include <optional>
 #include <string>
@@ -9,6 +11,10 @@
 
 #include "io_wally/mqtt_packet_sender.hpp"
 #include "io_wally/protocol/common.hpp"
+#include "io_wally/protocol/puback_packet.hpp"
+#include "io_wally/protocol/pubcomp_packet.hpp"
+#include "io_wally/protocol/pubrec_packet.hpp"
+#include "io_wally/protocol/pubrel_packet.hpp"
 
 namespace framework
 {
@@ -45,6 +51,45 @@ namespace framework
             sent_packets_.push_back( packet );
         }
 
+        /// \brief Send a PUBACK, PUBREC, PUBREL or PUBCOMP packet to connected client.
+        ///
+        /// Records an equivalent packet object, so that tests may inspect it just like any other sent packet.
+        virtual void send_publish_ack( io_wally::protocol::packet::Type type,
+                                       std::uint16_t packet_identifier ) override
+        {
+            using namespace io_wally::protocol;
+            switch ( type )
+            {
+                case packet::Type::PUBACK:
+                    sent_packets_.push_back( std::make_shared<puback>( packet_identifier ) );
+                    break;
+                case packet::Type::PUBREC:
+                    sent_packets_.push_back( std::make_shared<pubrec>( packet_identifier ) );
+                    break;
+                case packet::Type::PUBREL:
+                    sent_packets_.push_back( std::make_shared<pubrel>( packet_identifier ) );
+                    break;
+                case packet::Type::PUBCOMP:
+                    sent_packets_.push_back( std::make_shared<pubcomp>( packet_identifier ) );
+                    break;
+                case packet::Type::RESERVED1:
+                case packet::Type::CONNECT:
+                case packet::Type::CONNACK:
+                case packet::Type::PUBLISH:
+                case packet::Type::SUBSCRIBE:
+                case packet::Type::SUBACK:
+                case packet::Type::UNSUBSCRIBE:
+                case packet::Type::UNSUBACK:
+                case packet::Type::PINGREQ:
+                case packet::Type::PINGRESP:
+                case packet::Type::DISCONNECT:
+                case packet::Type::RESERVED2:
+                default:
+                    assert( false );
+                    break;
+            }
+        }
+
         /// \brief Stop this connection, closing its \c tcp::socket.
         virtual void stop( const std::string& /* /message */, const spdlog::level::level_enum /* log_level */ ) override
         {
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cerrno>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <system_error>
+
+namespace framework
+{
+    /// \brief A fresh, empty temporary directory, removed along with all its contents when going out of scope.
+    class temp_directory final
+    {
+       public:
+        temp_directory( )
+        {
+            auto pattern = ( std::filesystem::temp_directory_path( ) / "wally-io-test-XXXXXX" ).string( );
+            if ( ::mkdtemp( pattern.data( ) ) == nullptr )
+                throw std::system_error{errno, std::generic_category( ), "Failed to create " + pattern};
+            path_ = pattern;
+        }
+
+        temp_directory( const temp_directory& ) = delete;
+
+        auto operator=( const temp_directory& ) -> temp_directory& = delete;
+
+        ~temp_directory( )
+        {
+            auto ignored = std::error_code{};
+            std::filesystem::remove_all( path_, ignored );
+        }
+
+        [[nodiscard]] auto path( ) const -> const std::filesystem::path&
+        {
+            return path_;
+        }
+
+       private:
+        std::filesystem::path path_{};
+    };  // class temp_directory
+}  // namespace framework
@@ -34,18 +34,44 @@ SCENARIO( "options_factory", "[options]" )
                 CHECK( config[io_wally::context::SERVER_ADDRESS].as<std::string>( ) ==
                        io_wally::defaults::DEFAULT_SERVER_ADDRESS );
                 CHECK( config[io_wally::context::SERVER_PORT].as<int>( ) == io_wally::defaults::DEFAULT_SERVER_PORT );
+                CHECK( config[io_wally::context::NETWORK_THREADS].as<std::size_t>( ) ==
+                       io_wally::defaults::DEFAULT_NETWORK_THREADS );
+                CHECK( config[io_wally::context::DISPATCHER_THREADS].as<std::size_t>( ) ==
+                       io_wally::defaults::DEFAULT_DISPATCHER_THREADS );
                 CHECK( config[io_wally::context::AUTHENTICATION_SERVICE_FACTORY].as<std::string>( ) ==
                        io_wally::defaults::DEFAULT_AUTHENTICATION_SERVICE_FACTORY );
                 CHECK( config[io_wally::context::CONNECT_TIMEOUT].as<std::uint32_t>( ) ==
                        io_wally::defaults::DEFAULT_CONNECT_TIMEOUT_MS );
                 CHECK( config[io_wally::context::READ_BUFFER_SIZE].as<std::size_t>( ) ==
                        io_wally::defaults::DEFAULT_INITIAL_READ_BUFFER_SIZE );
+                CHECK( config[io_wally::context::READ_SHARE_THRESHOLD].as<std::size_t>( ) ==
+                       io_wally::defaults::DEFAULT_READ_SHARE_THRESHOLD );
                 CHECK( config[io_wally::context::WRITE_BUFFER_SIZE].as<std::size_t>( ) ==
                        io_wally::defaults::DEFAULT_INITIAL_WRITE_BUFFER_SIZE );
+                CHECK( config[io_wally::context::WRITE_FLUSH_THRESHOLD].as<std::size_t>( ) ==
+                       io_wally::defaults::DEFAULT_WRITE_FLUSH_THRESHOLD );
                 CHECK( config[io_wally::context::PUB_ACK_TIMEOUT].as<std::uint32_t>( ) ==
                        io_wally::defaults::DEFAULT_PUB_ACK_TIMEOUT_MS );
-                REQUIRE( config[io_wally::context::PUB_MAX_RETRIES].as<std::size_t>( ) ==
-                         io_wally::defaults::DEFAULT_PUB_MAX_RETRIES );
+                CHECK( config[io_wally::context::PUB_MAX_RETRIES].as<std::size_t>( ) ==
+                       io_wally::defaults::DEFAULT_PUB_MAX_RETRIES );
+                CHECK( config[io_wally::context::PUB_MAX_IN_FLIGHT].as<std::uint16_t>( ) ==
+                       io_wally::defaults::DEFAULT_PUB_MAX_IN_FLIGHT );
+                CHECK( config[io_wally::context::PUB_MAX_QUEUED].as<std::size_t>( ) ==
+                       io_wally::defaults::DEFAULT_PUB_MAX_QUEUED );
+                CHECK( config[io_wally::context::PUB_SPILL_DIR].as<std::string>( ) ==
+                       io_wally::defaults::DEFAULT_PUB_SPILL_DIR );
+                CHECK( config[io_wally::context::PUB_SPILL_THRESHOLD].as<std::size_t>( ) ==
+                       io_wally::defaults::DEFAULT_PUB_SPILL_THRESHOLD );
+                CHECK( config[io_wally::context::PUB_SUBSCRIBER_CACHE_SIZE].as<std::size_t>( ) ==
+                       io_wally::defaults::DEFAULT_PUB_SUBSCRIBER_CACHE_SIZE );
+                CHECK( config[io_wally::context::RETAIN_MAX_BYTES].as<std::size_t>( ) ==
+                       io_wally::defaults::DEFAULT_RETAIN_MAX_BYTES );
+                CHECK( config[io_wally::context::RETAIN_EVICTION].as<std::string>( ) ==
+                       io_wally::defaults::DEFAULT_RETAIN_EVICTION );
+                CHECK( config[io_wally::context::RETAIN_TTL].as<std::uint32_t>( ) ==
+                       io_wally::defaults::DEFAULT_RETAIN_TTL_SECS );
+                REQUIRE( config[io_wally::context::RETAIN_STORE_DIR].as<std::string>( ) ==
+                         io_wally::defaults::DEFAULT_RETAIN_STORE_DIR );
             }
         }
     }
@@ -56,12 +82,25 @@ SCENARIO( "options_factory", "[options]" )
         const auto log_level = "error";
         const auto server_address = std::string{"8.9.10.11"};
         const auto server_port = int{1234};
+        const auto network_threads = std::size_t{8};
+        const auto dispatcher_threads = std::size_t{4};
         const auto auth_service_factory = std::string{"test_auth_srvc_factory"};
         const auto connect_timeout_ms = std::uint32_t{3456};
         const auto read_buffer_size = std::size_t{1024};
+        const auto read_share_threshold = std::size_t{2048};
         const auto write_buffer_size = std::size_t{4096};
+        const auto write_flush_threshold = std::size_t{16384};
         const auto pub_ack_timeout_ms = std::uint32_t{1234};
         const auto pub_max_retries = std::size_t{5};
+        const auto pub_max_in_flight = std::uint16_t{32};
+        const auto pub_max_queued = std::size_t{500};
+        const auto pub_spill_dir = std::string{"/var/spool/wally"};
+        const auto pub_spill_threshold = std::size_t{4096};
+        const auto pub_subscriber_cache_size = std::size_t{128};
+        const auto retain_max_bytes = std::size_t{1048576};
+        const auto retain_eviction = std::string{"oldest"};
+        const auto retain_ttl = std::uint32_t{3600};
+        const auto retain_store_dir = std::string{"/var/lib/wally/retained"};
 
         const char* command_line_args[]{"executable",
                                         "--log-file",
@@ -74,18 +113,44 @@ SCENARIO( "options_factory", "[options]" )
                                         "8.9.10.11",
                                         "--server-port",
                                         "1234",
+                                        "--network-threads",
+                                        "8",
+                                        "--dispatcher-threads",
+                                        "4",
                                         "--auth-service-factory",
                                         "test_auth_srvc_factory",
                                         "--conn-timeout",
                                         "3456",
                                         "--conn-rbuf-size",
                                         "1024",
+                                        "--conn-rbuf-share-threshold",
+                                        "2048",
                                         "--conn-wbuf-size",
                                         "4096",
+                                        "--conn-wbuf-flush-threshold",
+                                        "16384",
                                         "--pub-ack-timeout",
                                         "1234",
                                         "--pub-max-retries",
-                                        "5"};
+                                        "5",
+                                        "--pub-max-in-flight",
+                                        "32",
+                                        "--pub-max-queued",
+                                        "500",
+                                        "--pub-spill-dir",
+                                        "/var/spool/wally",
+                                        "--pub-spill-threshold",
+                                        "4096",
+                                        "--pub-subscriber-cache-size",
+                                        "128",
+                                        "--retain-max-bytes",
+                                        "1048576",
+                                        "--retain-eviction",
+                                        "oldest",
+                                        "--retain-ttl",
+                                        "3600",
+                                        "--retain-store-dir",
+                                        "/var/lib/wally/retained"};
 
         WHEN( "parsing that command line" )
         {
@@ -102,13 +167,63 @@ SCENARIO( "options_factory", "[options]" )
                 CHECK( config[io_wally::context::LOG_DISABLE].as<bool>( ) == true );
                 CHECK( config[io_wally::context::SERVER_ADDRESS].as<std::string>( ) == server_address );
                 CHECK( config[io_wally::context::SERVER_PORT].as<int>( ) == server_port );
+                CHECK( config[io_wally::context::NETWORK_THREADS].as<std::size_t>( ) == network_threads );
+                CHECK( config[io_wally::context::DISPATCHER_THREADS].as<std::size_t>( ) == dispatcher_threads );
                 CHECK( config[io_wally::context::AUTHENTICATION_SERVICE_FACTORY].as<std::string>( ) ==
                        auth_service_factory );
                 CHECK( config[io_wally::context::CONNECT_TIMEOUT].as<std::uint32_t>( ) == connect_timeout_ms );
                 CHECK( config[io_wally::context::READ_BUFFER_SIZE].as<std::size_t>( ) == read_buffer_size );
+                CHECK( config[io_wally::context::READ_SHARE_THRESHOLD].as<std::size_t>( ) == read_share_threshold );
                 CHECK( config[io_wally::context::WRITE_BUFFER_SIZE].as<std::size_t>( ) == write_buffer_size );
+                CHECK( config[io_wally::context::WRITE_FLUSH_THRESHOLD].as<std::size_t>( ) == write_flush_threshold );
                 CHECK( config[io_wally::context::PUB_ACK_TIMEOUT].as<std::uint32_t>( ) == pub_ack_timeout_ms );
-                REQUIRE( config[io_wally::context::PUB_MAX_RETRIES].as<std::size_t>( ) == pub_max_retries );
+                CHECK( config[io_wally::context::PUB_MAX_RETRIES].as<std::size_t>( ) == pub_max_retries );
+                CHECK( config[io_wally::context::PUB_MAX_IN_FLIGHT].as<std::uint16_t>( ) == pub_max_in_flight );
+                CHECK( config[io_wally::context::PUB_MAX_QUEUED].as<std::size_t>( ) == pub_max_queued );
+                CHECK( config[io_wally::context::PUB_SPILL_DIR].as<std::string>( ) == pub_spill_dir );
+                CHECK( config[io_wally::context::PUB_SPILL_THRESHOLD].as<std::size_t>( ) == pub_spill_threshold );
+                CHECK( config[io_wally::context::PUB_SUBSCRIBER_CACHE_SIZE].as<std::size_t>( ) ==
+                       pub_subscriber_cache_size );
+                CHECK( config[io_wally::context::RETAIN_MAX_BYTES].as<std::size_t>( ) == retain_max_bytes );
+                CHECK( config[io_wally::context::RETAIN_EVICTION].as<std::string>( ) == retain_eviction );
+                CHECK( config[io_wally::context::RETAIN_TTL].as<std::uint32_t>( ) == retain_ttl );
+                REQUIRE( config[io_wally::context::RETAIN_STORE_DIR].as<std::string>( ) == retain_store_dir );
+            }
+        }
+    }
+
+    GIVEN( "a command line asking for no network threads" )
+    {
+        const char* command_line_args[]{"executable", "--network-threads", "0"};
+
+        WHEN( "parsing that command line" )
+        {
+            auto argc = static_cast<int>( sizeof( command_line_args ) / sizeof( *command_line_args ) );
+            auto argv = const_cast<char**>( command_line_args );
+            auto opts = under_test.create( );
+            auto config = opts.parse( argc, argv );
+
+            THEN( "validating its options should reject it" )
+            {
+                REQUIRE_THROWS_AS( io_wally::app::options_factory::validate( config ), cxxopts::OptionParseException );
+            }
+        }
+    }
+
+    GIVEN( "a command line asking for no dispatcher threads" )
+    {
+        const char* command_line_args[]{"executable", "--dispatcher-threads", "0"};
+
+        WHEN( "parsing that command line" )
+        {
+            auto argc = static_cast<int>( sizeof( command_line_args ) / sizeof( *command_line_args ) );
+            auto argv = const_cast<char**>( command_line_args );
+            auto opts = under_test.create( );
+            auto config = opts.parse( argc, argv );
+
+            THEN( "validating its options should reject it" )
+            {
+                REQUIRE_THROWS_AS( io_wally::app::options_factory::validate( config ), cxxopts::OptionParseException );
             }
         }
     }
@@ -5,6 +5,7 @@
 #include <cstdint>
 #include <string>
 #include <tuple>
+#include <vector>
 
 #include <system_error>
 
@@ -432,6 +433,173 @@ SCENARIO( "frame_reader", "[packets]" )
     }
 }
 
+namespace
+{
+    void receive( decoder::frame_buffer& buffer, const std::vector<uint8_t>& bytes )
+    {
+        REQUIRE( bytes.size( ) <= buffer.free_space( ) );
+        std::copy( std::begin( bytes ), std::end( bytes ), buffer.free_space_begin( ) );
+        buffer.commit( bytes.size( ) );
+    }
+}  // namespace
+
+SCENARIO( "frame_buffer", "[packets]" )
+{
+    auto under_test = decoder::frame_buffer{16};
+
+    GIVEN( "a frame_buffer that received several complete frames in one read" )
+    {
+        receive( under_test, {0xC0, 0x00, 0x40, 0x02, 0x00, 0x07, 0xE0, 0x00} );
+
+        WHEN( "a caller repeatedly calls next_frame()" )
+        {
+            const auto pingreq = under_test.next_frame( );
+            REQUIRE( pingreq );
+            const auto pingreq_type = pingreq->type( );
+            const auto puback = under_test.next_frame( );
+            REQUIRE( puback );
+            const auto puback_type = puback->type( );
+            const auto puback_remaining_length = puback->remaining_length( );
+            const auto puback_packet_id_lsb = *( puback->begin + 1 );
+            const auto disconnect = under_test.next_frame( );
+            REQUIRE( disconnect );
+            const auto disconnect_type = disconnect->type( );
+            const auto none = under_test.next_frame( );
+
+            THEN( "it should receive all those frames in order" )
+            {
+                REQUIRE( pingreq_type == protocol::packet::Type::PINGREQ );
+                REQUIRE( puback_type == protocol::packet::Type::PUBACK );
+                REQUIRE( puback_remaining_length == 2 );
+                REQUIRE( puback_packet_id_lsb == 0x07 );
+                REQUIRE( disconnect_type == protocol::packet::Type::DISCONNECT );
+            }
+
+            AND_THEN( "it should finally receive std::nullopt" )
+            {
+                REQUIRE( !none );
+                REQUIRE( under_test.buffered( ) == 0 );
+                REQUIRE( under_test.free_space( ) == 16 );
+            }
+        }
+    }
+
+    GIVEN( "a frame_buffer that received a complete frame followed by a partial frame" )
+    {
+        receive( under_test, {0xC0, 0x00, 0x40, 0x02, 0x00} );
+
+        WHEN( "a caller calls next_frame() until it receives std::nullopt" )
+        {
+            const auto pingreq = under_test.next_frame( );
+            const auto none = under_test.next_frame( );
+
+            THEN( "it should only receive the complete frame" )
+            {
+                REQUIRE( pingreq );
+                REQUIRE( !none );
+            }
+
+            AND_THEN( "it should retain the partial frame until the next read completes it" )
+            {
+                REQUIRE( under_test.buffered( ) == 3 );
+                receive( under_test, {0x07} );
+                const auto puback = under_test.next_frame( );
+                REQUIRE( puback );
+                REQUIRE( puback->type( ) == protocol::packet::Type::PUBACK );
+                REQUIRE( *( puback->begin + 1 ) == 0x07 );
+            }
+        }
+    }
+
+    GIVEN( "a frame_buffer that received the start of a frame larger than its initial size" )
+    {
+        auto frame_start = std::vector<uint8_t>{0x30, 0x20};
+        frame_start.insert( std::end( frame_start ), 14, 'a' );
+        receive( under_test, frame_start );
+
+        WHEN( "a caller calls next_frame()" )
+        {
+            const auto none = under_test.next_frame( );
+
+            THEN( "it should receive std::nullopt, and see the frame_buffer grow to accommodate that frame" )
+            {
+                REQUIRE( !none );
+                REQUIRE( under_test.size( ) == 34 );
+                REQUIRE( under_test.free_space( ) == 18 );
+            }
+
+            AND_WHEN( "that frame has been received and taken off the frame_buffer" )
+            {
+                receive( under_test, std::vector<uint8_t>( 18, 'b' ) );
+                const auto publish = under_test.next_frame( );
+                REQUIRE( publish );
+                REQUIRE( publish->remaining_length( ) == 32 );
+                REQUIRE( !under_test.next_frame( ) );
+
+                THEN( "it should shrink back to its initial size" )
+                {
+                    REQUIRE( under_test.size( ) == 16 );
+                }
+            }
+        }
+    }
+
+    GIVEN( "a frame_buffer that received a mal-formed packet header" )
+    {
+        receive( under_test, {0x07 << 4, 0xFF, 0xFF, 0xFF, 0xFF, 0x01} );
+
+        WHEN( "a caller calls next_frame()" )
+        {
+            THEN( "it should see an error::malformed_mqtt_packet being thrown" )
+            {
+                REQUIRE_THROWS_AS( under_test.next_frame( ), error::malformed_mqtt_packet );
+            }
+        }
+    }
+}
+
+SCENARIO( "frame_buffer sharing its chunks", "[packets]" )
+{
+    auto under_test = decoder::frame_buffer{16, 4};
+
+    GIVEN( "a frame_buffer that received a frame below and a frame at its share threshold" )
+    {
+        receive( under_test, {0x40, 0x02, 0x00, 0x07, 0x30, 0x04, 0x00, 0x01, 't', 'x', 0x40} );
+
+        WHEN( "a caller calls next_frame() for both" )
+        {
+            const auto puback = under_test.next_frame( );
+            REQUIRE( puback );
+            const auto puback_chunk = puback->chunk;
+            const auto publish = under_test.next_frame( );
+            REQUIRE( publish );
+
+            THEN( "it should only share its chunk with the frame at its share threshold" )
+            {
+                REQUIRE( !puback_chunk );
+                REQUIRE( publish->chunk );
+            }
+
+            AND_WHEN( "the caller retains that frame's chunk while receiving more data" )
+            {
+                const auto chunk = publish->chunk;
+                const auto chunk_copy = *chunk;
+                REQUIRE( !under_test.next_frame( ) );
+                receive( under_test, {0x02, 0x00, 0x08} );
+                const auto next_puback = under_test.next_frame( );
+
+                THEN( "it should leave that chunk untouched, and continue using a fresh chunk" )
+                {
+                    REQUIRE( *chunk == chunk_copy );
+                    REQUIRE( next_puback );
+                    REQUIRE( next_puback->type( ) == protocol::packet::Type::PUBACK );
+                    REQUIRE( *( next_puback->begin + 1 ) == 0x08 );
+                }
+            }
+        }
+    }
+}
+
 SCENARIO( "parsing a 16 bit unsigned integer", "[packets]" )
 {
 
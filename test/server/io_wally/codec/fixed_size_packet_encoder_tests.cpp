@@ -0,0 +1,73 @@
+#include "catch.hpp"
+
+#include <array>
+#include <cstdint>
+
+#include "io_wally/codec/fixed_size_packet_encoder.hpp"
+#include "io_wally/codec/mqtt_packet_encoder.hpp"
+#include "io_wally/protocol/protocol.hpp"
+
+using namespace io_wally;
+
+namespace
+{
+    auto encode( const protocol::mqtt_packet& packet ) -> std::array<std::uint8_t, 4>
+    {
+        auto result = std::array<std::uint8_t, 4>{{0x00, 0x00, 0x00, 0x00}};
+        encoder::mqtt_packet_encoder<std::uint8_t*>{}.encode( packet, result.begin( ), result.end( ) );
+
+        return result;
+    }
+}  // namespace
+
+SCENARIO( "fixed_size_packet_encoder", "[encoder]" )
+{
+    GIVEN( "a packet identifier" )
+    {
+        const auto pktid = std::uint16_t{0xA1B2};
+
+        WHEN( "a client encodes a PUBACK, PUBREC, PUBREL and PUBCOMP using encode_publish_ack" )
+        {
+            const auto puback = encoder::encode_publish_ack( protocol::packet::Type::PUBACK, pktid );
+            const auto pubrec = encoder::encode_publish_ack( protocol::packet::Type::PUBREC, pktid );
+            const auto pubrel = encoder::encode_publish_ack( protocol::packet::Type::PUBREL, pktid );
+            const auto pubcomp = encoder::encode_publish_ack( protocol::packet::Type::PUBCOMP, pktid );
+
+            THEN( "it should see the same bytes as mqtt_packet_encoder produces for equivalent packets" )
+            {
+                REQUIRE( puback == encode( protocol::puback{pktid} ) );
+                REQUIRE( pubrec == encode( protocol::pubrec{pktid} ) );
+                REQUIRE( pubrel == encode( protocol::pubrel{pktid} ) );
+                REQUIRE( pubcomp == encode( protocol::pubcomp{pktid} ) );
+            }
+        }
+    }
+
+    GIVEN( "a session present flag and a return code" )
+    {
+        WHEN( "a client encodes a CONNACK using encode_connack" )
+        {
+            const auto accepted = encoder::encode_connack( false, protocol::connect_return_code::CONNECTION_ACCEPTED );
+            const auto rejected = encoder::encode_connack( true, protocol::connect_return_code::NOT_AUTHORIZED );
+
+            THEN( "it should see the same bytes as mqtt_packet_encoder produces for equivalent packets" )
+            {
+                REQUIRE( accepted ==
+                         encode( protocol::connack{false, protocol::connect_return_code::CONNECTION_ACCEPTED} ) );
+                REQUIRE( rejected == encode( protocol::connack{true, protocol::connect_return_code::NOT_AUTHORIZED} ) );
+            }
+        }
+    }
+
+    GIVEN( "a pre-encoded PINGRESP" )
+    {
+        THEN( "it should equal what mqtt_packet_encoder produces for a pingresp" )
+        {
+            auto result = std::array<std::uint8_t, 2>{{0xFF, 0xFF}};
+            encoder::mqtt_packet_encoder<std::uint8_t*>{}.encode( protocol::pingresp{}, result.begin( ),
+                                                                  result.end( ) );
+
+            REQUIRE( result == encoder::PINGRESP );
+        }
+    }
+}
@@ -1,6 +1,8 @@
 #include "catch.hpp"
 
+#include <array>
 #include <cstdint>
+#include <memory>
 #include <vector>
 
 #include "io_wally/codec/mqtt_packet_decoder.hpp"
@@ -8,6 +10,29 @@
 
 using namespace io_wally;
 
+namespace
+{
+    /// Packet body decoder dispatched the way mqtt_packet_decoder used to: through a virtual call. Serves as a
+    /// baseline for our benchmark.
+    struct virtual_body_decoder
+    {
+        virtual ~virtual_body_decoder( ) = default;
+
+        [[nodiscard]] virtual auto decode( const decoder::frame& frame ) const
+            -> std::shared_ptr<protocol::mqtt_packet> = 0;
+    };
+
+    template <typename DECODER>
+    struct virtual_body_decoder_for final : public virtual_body_decoder
+    {
+        [[nodiscard]] auto decode( const decoder::frame& frame ) const
+            -> std::shared_ptr<protocol::mqtt_packet> override
+        {
+            return DECODER{}.decode( frame );
+        }
+    };
+}  // namespace
+
 SCENARIO( "mqtt_packet_decoder", "[decoder]" )
 {
     const auto under_test = decoder::mqtt_packet_decoder{};
@@ -381,3 +406,50 @@ SCENARIO( "mqtt_packet_decoder", "[decoder]" )
         }
     }
 }
+
+TEST_CASE( "mqtt_packet_decoder vs. virtual dispatch", "[.][benchmark]" )
+{
+    // The packets a broker receives most: PUBLISH and its acknowledgements
+    auto publish_buffer = std::vector<std::uint8_t>{0, 20, '/', 's', 'i', 't', 'e', '-', '7', '/', 'd', 'e', 'v',
+                                                    'i',  'c', 'e', '-', '3', '5', '7', '/', 't', 0,   7};
+    publish_buffer.resize( publish_buffer.size( ) + 64, 'x' );
+    const auto ack_buffer = std::vector<std::uint8_t>{0, 7};
+    const auto frames = std::vector<decoder::frame>{
+        decoder::frame{std::uint8_t{3 << 4 | 0x02}, publish_buffer.begin( ), publish_buffer.end( )},
+        decoder::frame{std::uint8_t{4 << 4}, ack_buffer.begin( ), ack_buffer.end( )},
+        decoder::frame{std::uint8_t{5 << 4}, ack_buffer.begin( ), ack_buffer.end( )},
+        decoder::frame{std::uint8_t{6 << 4 | 0x02}, ack_buffer.begin( ), ack_buffer.end( )},
+        decoder::frame{std::uint8_t{7 << 4}, ack_buffer.begin( ), ack_buffer.end( )}};
+
+    const auto publish_decoder = virtual_body_decoder_for<decoder::publish_packet_decoder_impl>{};
+    const auto puback_decoder = virtual_body_decoder_for<decoder::puback_packet_decoder_impl>{};
+    const auto pubrec_decoder = virtual_body_decoder_for<decoder::pubrec_packet_decoder_impl>{};
+    const auto pubrel_decoder = virtual_body_decoder_for<decoder::pubrel_packet_decoder_impl>{};
+    const auto pubcomp_decoder = virtual_body_decoder_for<decoder::pubcomp_packet_decoder_impl>{};
+    auto virtual_decoders = std::array<const virtual_body_decoder*, 16>{};
+    virtual_decoders[static_cast<std::size_t>( protocol::packet::Type::PUBLISH )] = &publish_decoder;
+    virtual_decoders[static_cast<std::size_t>( protocol::packet::Type::PUBACK )] = &puback_decoder;
+    virtual_decoders[static_cast<std::size_t>( protocol::packet::Type::PUBREC )] = &pubrec_decoder;
+    virtual_decoders[static_cast<std::size_t>( protocol::packet::Type::PUBREL )] = &pubrel_decoder;
+    virtual_decoders[static_cast<std::size_t>( protocol::packet::Type::PUBCOMP )] = &pubcomp_decoder;
+
+    BENCHMARK( "virtual dispatch" )
+    {
+        auto decoded = std::size_t{0};
+        for ( const auto& frame : frames )
+        {
+            const auto& body_decoder = *virtual_decoders[static_cast<std::size_t>( frame.type( ) )];
+            decoded += body_decoder.decode( frame )->remaining_length( );
+        }
+        return decoded;
+    };
+
+    BENCHMARK( "mqtt_packet_decoder" )
+    {
+        const auto under_test = decoder::mqtt_packet_decoder{};
+        auto decoded = std::size_t{0};
+        for ( const auto& frame : frames )
+            decoded += under_test.decode( frame )->remaining_length( );
+        return decoded;
+    };
+}
@@ -2,6 +2,8 @@
 
 #include <array>
 #include <cstdint>
+#include <memory>
+#include <vector>
 
 #include "io_wally/codec/mqtt_packet_encoder.hpp"
 #include "io_wally/protocol/protocol.hpp"
@@ -10,6 +12,27 @@ using namespace io_wally;
 
 using out_iter = std::array<const std::uint8_t, 4>::iterator;
 
+namespace
+{
+    /// Packet body encoder dispatched the way mqtt_packet_encoder used to: through a virtual call, followed by a
+    /// dynamic_cast to the concrete packet type. Serves as a baseline for our benchmark.
+    struct virtual_body_encoder
+    {
+        virtual ~virtual_body_encoder( ) = default;
+
+        virtual auto encode( const protocol::mqtt_packet& packet, std::uint8_t* buf_start ) const -> std::uint8_t* = 0;
+    };
+
+    template <typename ENCODER>
+    struct virtual_body_encoder_for final : public virtual_body_encoder
+    {
+        auto encode( const protocol::mqtt_packet& packet, std::uint8_t* buf_start ) const -> std::uint8_t* override
+        {
+            return ENCODER{}.encode( dynamic_cast<const typename ENCODER::packet_type&>( packet ), buf_start );
+        }
+    };
+}  // namespace
+
 SCENARIO( "mqtt_packet_encoder", "[encoder]" )
 {
     encoder::mqtt_packet_encoder<std::uint8_t*> under_test;
@@ -94,8 +117,8 @@ SCENARIO( "mqtt_packet_encoder", "[encoder]" )
         const auto packet_identifier = uint16_t{7};
         const auto topic = "surgemq";
         auto application_message = std::vector<uint8_t>{'s', 'e', 'n', 'd', ' ', 'm', 'e', ' ', 'h', 'o', 'm', 'e'};
-        const auto publish =
-            protocol::publish{type_and_flags, remaining_length, topic, packet_identifier, application_message};
+        const auto publish = protocol::publish{type_and_flags, remaining_length, protocol::topic_name::intern( topic ),
+                                               packet_identifier, application_message};
 
         auto result =
             std::array<std::uint8_t, 25>{{0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
@@ -264,3 +287,59 @@ SCENARIO( "mqtt_packet_encoder", "[encoder]" )
         }
     }
 }
+
+TEST_CASE( "mqtt_packet_encoder vs. virtual dispatch", "[.][benchmark]" )
+{
+    // The packets a broker sends most: PUBLISH and its acknowledgements
+    const auto message = std::vector<std::uint8_t>( 64, 'x' );
+    const auto packets = std::vector<std::shared_ptr<protocol::mqtt_packet>>{
+        std::make_shared<protocol::publish>( std::uint8_t{3 << 4 | 0x02}, 2 + 19 + 2 + 64,
+                                             protocol::topic_name::intern( "/site-7/device-357/t" ), std::uint16_t{7},
+                                             message ),
+        std::make_shared<protocol::puback>( 7 ),
+        std::make_shared<protocol::pubrec>( 8 ),
+        std::make_shared<protocol::pubrel>( 8 ),
+        std::make_shared<protocol::pubcomp>( 8 ),
+        std::make_shared<protocol::suback>( 9, std::vector<protocol::suback_return_code>{
+                                                   protocol::suback_return_code::MAXIMUM_QOS1} )};
+    auto buffer = std::vector<std::uint8_t>( 256 );
+
+    const auto puback_encoder = virtual_body_encoder_for<encoder::puback_packet_encoder<std::uint8_t*>>{};
+    const auto pubrec_encoder = virtual_body_encoder_for<encoder::pubrec_packet_encoder<std::uint8_t*>>{};
+    const auto pubrel_encoder = virtual_body_encoder_for<encoder::pubrel_packet_encoder<std::uint8_t*>>{};
+    const auto pubcomp_encoder = virtual_body_encoder_for<encoder::pubcomp_packet_encoder<std::uint8_t*>>{};
+    const auto publish_encoder = virtual_body_encoder_for<encoder::publish_packet_encoder<std::uint8_t*>>{};
+    const auto suback_encoder = virtual_body_encoder_for<encoder::suback_packet_encoder<std::uint8_t*>>{};
+    auto virtual_encoders = std::array<const virtual_body_encoder*, 16>{};
+    virtual_encoders[static_cast<std::size_t>( protocol::packet::Type::PUBLISH )] = &publish_encoder;
+    virtual_encoders[static_cast<std::size_t>( protocol::packet::Type::PUBACK )] = &puback_encoder;
+    virtual_encoders[static_cast<std::size_t>( protocol::packet::Type::PUBREC )] = &pubrec_encoder;
+    virtual_encoders[static_cast<std::size_t>( protocol::packet::Type::PUBREL )] = &pubrel_encoder;
+    virtual_encoders[static_cast<std::size_t>( protocol::packet::Type::PUBCOMP )] = &pubcomp_encoder;
+    virtual_encoders[static_cast<std::size_t>( protocol::packet::Type::SUBACK )] = &suback_encoder;
+
+    BENCHMARK( "virtual dispatch" )
+    {
+        auto encoded = std::size_t{0};
+        for ( const auto& packet : packets )
+        {
+            auto buf_start =
+                encoder::encode_fixed_header( packet->type_and_flags( ), packet->remaining_length( ), buffer.data( ) );
+            buf_start = virtual_encoders[static_cast<std::size_t>( packet->type( ) )]->encode( *packet, buf_start );
+            encoded += static_cast<std::size_t>( buf_start - buffer.data( ) );
+        }
+        return encoded;
+    };
+
+    BENCHMARK( "mqtt_packet_encoder" )
+    {
+        const auto under_test = encoder::mqtt_packet_encoder<std::uint8_t*>{};
+        auto encoded = std::size_t{0};
+        for ( const auto& packet : packets )
+        {
+            const auto buf_end = under_test.encode( *packet, buffer.data( ), buffer.data( ) + buffer.size( ) );
+            encoded += static_cast<std::size_t>( buf_end - buffer.data( ) );
+        }
+        return encoded;
+    };
+}
@@ -320,4 +320,38 @@ SCENARIO( "publish_packet_decoder_impl", "[decoder]" )
             }
         }
     }
+
+    GIVEN( "a PUBLISH packet body in a frame carrying the chunk of memory it lives in" )
+    {
+        const auto type_and_flags = std::uint8_t{( 3 << 4 ) | 2};  // PUBLISH + DUP 0, QoS 1, RETAIN 0
+        const auto message = std::vector<uint8_t>{'s', 'e', 'n', 'd', ' ', 'm', 'e', ' ', 'h', 'o', 'm', 'e'};
+        const auto chunk = std::make_shared<const std::vector<std::uint8_t>>( std::vector<std::uint8_t>{
+            0,  // topic name MSB (0)
+            7,  // topic name LSB (7)
+            's', 'u', 'r', 'g', 'e', 'm', 'q',
+            0,  // packet ID MSB (0)
+            7,  // packet ID LSB (7)
+            's', 'e', 'n', 'd', ' ', 'm', 'e', ' ', 'h', 'o', 'm', 'e',
+        } );
+        const auto frame = decoder::frame{type_and_flags, chunk->begin( ), chunk->end( ), chunk};
+
+        WHEN( "a client passes that frame into publish_packet_decoder::decode" )
+        {
+            auto result = under_test.decode( frame );
+            const auto& publish_packet = static_cast<const protocol::publish&>( *result );
+
+            THEN( "it should receive a 'publish' instance referencing its application message in that chunk" )
+            {
+                CHECK( publish_packet.topic( ) == "surgemq" );
+                CHECK( publish_packet.packet_identifier( ) == 7 );
+                CHECK( publish_packet.application_message( ) == message );
+                REQUIRE( publish_packet.application_message( ).data( ) == chunk->data( ) + 11 );
+            }
+
+            AND_THEN( "that 'publish' instance should keep that chunk alive" )
+            {
+                REQUIRE( chunk.use_count( ) > 1 );
+            }
+        }
+    }
 }
@@ -2,8 +2,10 @@
 
 #include <array>
 #include <cstdint>
+#include <string>
 #include <vector>
 
+#include "io_wally/codec/mqtt_packet_encoder.hpp"
 #include "io_wally/codec/publish_packet_encoder.hpp"
 #include "io_wally/protocol/publish_packet.hpp"
 
@@ -23,8 +25,8 @@ SCENARIO( "publish_packet_encoder", "[encoder]" )
         const auto topic = "surgemq";
         const auto application_message =
             std::vector<uint8_t>{'s', 'e', 'n', 'd', ' ', 'm', 'e', ' ', 'h', 'o', 'm', 'e'};
-        const auto publish =
-            protocol::publish{type_and_flags, remaining_length, topic, packet_identifier, application_message};
+        const auto publish = protocol::publish{type_and_flags, remaining_length, protocol::topic_name::intern( topic ),
+                                               packet_identifier, application_message};
 
         auto result =
             std::array<std::uint8_t, 23>{{0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
@@ -58,8 +60,8 @@ SCENARIO( "publish_packet_encoder", "[encoder]" )
         const auto topic = "surgemq";
         const auto application_message =
             std::vector<uint8_t>{'s', 'e', 'n', 'd', ' ', 'm', 'e', ' ', 'h', 'o', 'm', 'e'};
-        const auto publish =
-            protocol::publish{type_and_flags, remaining_length, topic, packet_identifier, application_message};
+        const auto publish = protocol::publish{type_and_flags, remaining_length, protocol::topic_name::intern( topic ),
+                                               packet_identifier, application_message};
 
         auto result = std::array<std::uint8_t, 21>{{0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
                                                     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}};
@@ -83,3 +85,100 @@ SCENARIO( "publish_packet_encoder", "[encoder]" )
         }
     }
 }
+
+namespace
+{
+    /// Collects all parts passed to it by encode_publish_parts, counting those that were shared
+    struct parts_collector final
+    {
+        std::vector<std::uint8_t> bytes{};
+        std::size_t shared_parts{0};
+
+        template <typename ENCODE>
+        void append( std::size_t length, ENCODE&& encode )
+        {
+            auto part = std::vector<std::uint8_t>( length );
+            encode( part.begin( ), part.end( ) );
+            bytes.insert( bytes.end( ), part.begin( ), part.end( ) );
+        }
+
+        void append_shared( const std::uint8_t* data, std::size_t length )
+        {
+            bytes.insert( bytes.end( ), data, data + length );
+            ++shared_parts;
+        }
+    };  // struct parts_collector
+
+    auto encode_whole( const protocol::publish& publish ) -> std::vector<std::uint8_t>
+    {
+        auto result = std::vector<std::uint8_t>( publish.total_length( ) );
+        encoder::mqtt_packet_encoder<std::vector<std::uint8_t>::iterator>{}.encode( publish, result.begin( ),
+                                                                                    result.end( ) );
+        return result;
+    }
+}  // namespace
+
+SCENARIO( "encode_publish_parts", "[encoder]" )
+{
+    GIVEN( "a PUBLISH packet with QoS 1, a long topic and a long application message" )
+    {
+        const auto publish = protocol::publish::create( false, protocol::packet::QoS::AT_LEAST_ONCE, false,
+                                                        std::string( 100, 't' ), 7, std::vector<uint8_t>( 300, 'm' ) );
+
+        WHEN( "a client passes that packet into encode_publish_parts" )
+        {
+            auto collector = parts_collector{};
+            encoder::encode_publish_parts( *publish, collector );
+
+            THEN( "it should share topic and application message instead of copying them" )
+            {
+                REQUIRE( collector.shared_parts == 2 );
+            }
+
+            AND_THEN( "all parts taken together should equal that packet encoded in one go" )
+            {
+                REQUIRE( collector.bytes == encode_whole( *publish ) );
+            }
+        }
+    }
+
+    GIVEN( "a PUBLISH packet with QoS 0, a short topic and a long application message" )
+    {
+        const auto publish = protocol::publish::create( false, protocol::packet::QoS::AT_MOST_ONCE, true, "surgemq",
+                                                        0, std::vector<uint8_t>( 300, 'm' ) );
+
+        WHEN( "a client passes that packet into encode_publish_parts" )
+        {
+            auto collector = parts_collector{};
+            encoder::encode_publish_parts( *publish, collector );
+
+            THEN( "it should only share that packet's application message" )
+            {
+                REQUIRE( collector.shared_parts == 1 );
+            }
+
+            AND_THEN( "all parts taken together should equal that packet encoded in one go" )
+            {
+                REQUIRE( collector.bytes == encode_whole( *publish ) );
+            }
+        }
+    }
+
+    GIVEN( "a PUBLISH packet with QoS 2, a long topic and a short application message" )
+    {
+        const auto publish = protocol::publish::create( false, protocol::packet::QoS::EXACTLY_ONCE, false,
+                                                        std::string( 100, 't' ), 4711, std::vector<uint8_t>{'m'} );
+
+        WHEN( "a client passes that packet into encode_publish_parts" )
+        {
+            auto collector = parts_collector{};
+            encoder::encode_publish_parts( *publish, collector );
+
+            THEN( "all parts taken together should equal that packet encoded in one go" )
+            {
+                REQUIRE( collector.shared_parts == 1 );
+                REQUIRE( collector.bytes == encode_whole( *publish ) );
+            }
+        }
+    }
+}
@@ -0,0 +1,80 @@
+#include "catch.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "io_wally/concurrency/mpsc_queue.hpp"
+
+using io_wally::concurrency::mpsc_queue;
+
+SCENARIO( "mpsc_queue", "[concurrency]" )
+{
+    GIVEN( "an empty mpsc_queue" )
+    {
+        auto under_test = mpsc_queue<std::unique_ptr<std::string>>{};
+
+        THEN( "it should return nothing when popped" )
+        {
+            REQUIRE( !under_test.pop( ) );
+        }
+
+        WHEN( "a caller pushes three values" )
+        {
+            under_test.push( std::make_unique<std::string>( "first" ) );
+            under_test.push( std::make_unique<std::string>( "second" ) );
+            under_test.push( std::make_unique<std::string>( "third" ) );
+
+            THEN( "it should return them in the order they have been pushed, and then nothing" )
+            {
+                REQUIRE( **under_test.pop( ) == "first" );
+                REQUIRE( **under_test.pop( ) == "second" );
+                REQUIRE( **under_test.pop( ) == "third" );
+                REQUIRE( !under_test.pop( ) );
+            }
+        }
+    }
+
+    GIVEN( "an mpsc_queue fed by four producer threads" )
+    {
+        constexpr auto producer_count = std::size_t{4};
+        constexpr auto values_per_producer = std::size_t{20000};
+        auto under_test = mpsc_queue<std::pair<std::size_t, std::size_t>>{};
+
+        WHEN( "a consumer pops until it has received all values pushed" )
+        {
+            auto producers = std::vector<std::thread>{};
+            for ( auto producer = std::size_t{0}; producer < producer_count; ++producer )
+                producers.emplace_back( [&under_test, producer]( ) {
+                    for ( auto value = std::size_t{0}; value < values_per_producer; ++value )
+                        under_test.push( {producer, value} );
+                } );
+
+            auto next_expected = std::vector<std::size_t>( producer_count, 0 );
+            auto out_of_order = std::size_t{0};
+            for ( auto received = std::size_t{0}; received < producer_count * values_per_producer; )
+            {
+                if ( const auto popped = under_test.pop( ) )
+                {
+                    if ( popped->second != next_expected[popped->first] )
+                        ++out_of_order;
+                    next_expected[popped->first] = popped->second + 1;
+                    ++received;
+                }
+            }
+            for ( auto& producer : producers )
+                producer.join( );
+
+            THEN( "it should have received each producer's values in the order that producer pushed them" )
+            {
+                REQUIRE( out_of_order == 0 );
+                for ( const auto next : next_expected )
+                    REQUIRE( next == values_per_producer );
+                REQUIRE( !under_test.pop( ) );
+            }
+        }
+    }
+}
@@ -1,6 +1,7 @@
 #include "catch.hpp"
 
 #include "io_wally/dispatch/common.hpp"
+#include "io_wally/protocol/topic_name.hpp"
 
 using namespace io_wally::protocol;
 
@@ -187,4 +188,18 @@ SCENARIO( "topic_filter_matches_topic", "[dispatch]" )
             }
         }
     }
+
+    GIVEN( "topic filter \"sport/+\" and interned topic \"sport/\"" )
+    {
+        const auto topic_filter = "sport/+";
+        const auto topic = topic_name::intern( "sport/" );
+
+        WHEN( "a caller matches topic against topic filter" )
+        {
+            THEN( "it should see the match succeed (since \"+\" also matches an empty topic level)" )
+            {
+                REQUIRE( io_wally::dispatch::topic_filter_matches_topic( topic_filter, topic ) == true );
+            }
+        }
+    }
 }
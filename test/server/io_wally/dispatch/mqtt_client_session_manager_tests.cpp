@@ -11,6 +11,7 @@
 #include "io_wally/dispatch/common.hpp"
 #include "io_wally/dispatch/mqtt_client_session_manager.hpp"
 #include "io_wally/protocol/common.hpp"
+#include "io_wally/protocol/connack_packet.hpp"
 #include "io_wally/protocol/publish_packet.hpp"
 
 using namespace std::string_literals;
@@ -120,26 +121,28 @@ SCENARIO( "mqtt_client_session_manager::session_store#remove", "[dispatch]" )
 
         const auto client_id = "test-client"s;
 
-        WHEN( "client code calls under_test.insert(...)" )
+        WHEN( "client code calls under_test.remove(...) for a client_id it does not know" )
         {
-            const auto connect = framework::create_connect_packet( client_id );
-            auto client_connection_ptr = std::make_shared<framework::packet_sender_mock>( client_id );
-
-            const auto inserted = under_test.insert( connect, client_connection_ptr );
+            under_test.remove( client_id );
 
-            THEN( "that client code should see true being returned" )
+            THEN( "that client code should see a nullptr being returned from under_test[...]" )
             {
-                REQUIRE( inserted );
+                REQUIRE( !under_test[client_id] );
             }
         }
 
-        AND_WHEN( "client code calls under_test.remove(...) with the same client_id" )
+        WHEN( "client code inserts a persistent session and then calls under_test.remove(...) with its client_id" )
         {
+            under_test.insert( framework::create_connect_packet( client_id ),
+                               std::make_shared<framework::packet_sender_mock>( client_id ) );
             under_test.remove( client_id );
 
-            THEN( "that client code should see a nullptr being returned from under_test[...]" )
+            THEN( "that client code should see that session being kept, but no longer connected" )
             {
-                REQUIRE( !under_test[client_id] );
+                REQUIRE( under_test[client_id] );
+                REQUIRE( !under_test[client_id]->connected( ) );
+                REQUIRE( under_test.size( ) == 0 );
+                REQUIRE( under_test.offline_size( ) == 1 );
             }
         }
     }
@@ -232,21 +235,21 @@ SCENARIO( "mqtt_client_session_manager#client_published", "[dispatch]" )
         const auto subscriber_id = "test-subscriber"s;
         const auto subscriber_connect = framework::create_connect_packet( subscriber_id );
         auto subscriber_ptr = std::make_shared<framework::packet_sender_mock>( subscriber_id );
-        under_test.client_connected( subscriber_connect, subscriber_ptr );
+        const auto subscriber_session = under_test.client_connected( subscriber_connect, subscriber_ptr );
 
         const auto topic = "/topic/mqtt_client_session_manager/test"s;
         const auto subscribe_packet = framework::create_subscribe_packet( {{topic, packet::QoS::AT_MOST_ONCE}} );
-        under_test.client_subscribed( *subscriber_ptr->client_id( ), subscribe_packet );
+        under_test.client_subscribed( subscriber_session, subscribe_packet );
 
         const auto publisher_id = "test-publisher"s;
         const auto publisher_connect = framework::create_connect_packet( publisher_id );
         auto publisher_ptr = std::make_shared<framework::packet_sender_mock>( publisher_id );
-        under_test.client_connected( publisher_connect, publisher_ptr );
+        const auto publisher_session = under_test.client_connected( publisher_connect, publisher_ptr );
 
         WHEN( "client code calls client_published() with a PUBLISH packet WITHOUT retained flag" )
         {
             auto publish_packet = framework::create_publish_packet( topic, false );
-            under_test.client_published( publisher_id, publish_packet );
+            under_test.client_published( publisher_session, publish_packet );
 
             THEN( "that PUBLISH packet should be sent to the connected client" )
             {
@@ -259,7 +262,7 @@ SCENARIO( "mqtt_client_session_manager#client_published", "[dispatch]" )
         WHEN( "client code calls client_published() with a PUBLISH packet WITH retained flag" )
         {
             auto publish_packet = framework::create_publish_packet( topic, true );
-            under_test.client_published( publisher_id, publish_packet );
+            under_test.client_published( publisher_session, publish_packet );
 
             THEN( "that PUBLISH packet should be sent to the connected client" )
             {
@@ -272,7 +275,7 @@ SCENARIO( "mqtt_client_session_manager#client_published", "[dispatch]" )
         WHEN( "client code calls client_published() with a PUBLISH packet of size 0 WITH retained flag" )
         {
             auto publish_packet = framework::create_publish_packet( topic, true, {} );
-            under_test.client_published( publisher_id, publish_packet );
+            under_test.client_published( publisher_session, publish_packet );
 
             THEN( "that PUBLISH packet should be sent to the connected client" )
             {
@@ -287,21 +290,28 @@ SCENARIO( "mqtt_client_session_manager#client_published", "[dispatch]" )
             "connects and subscribes to the same topic" )
         {
             auto publish_packet = framework::create_publish_packet( topic, true );
-            under_test.client_published( publisher_id, publish_packet );
+            under_test.client_published( publisher_session, publish_packet );
 
             const auto new_subscriber_id = "new-test-subscriber"s;
             const auto new_subscriber_connect = framework::create_connect_packet( new_subscriber_id );
             auto new_subscriber_ptr = std::make_shared<framework::packet_sender_mock>( new_subscriber_id );
-            under_test.client_connected( new_subscriber_connect, new_subscriber_ptr );
+            const auto new_subscriber_session =
+                under_test.client_connected( new_subscriber_connect, new_subscriber_ptr );
 
             const auto new_subscribe_packet =
                 framework::create_subscribe_packet( {{topic, packet::QoS::AT_MOST_ONCE}} );
-            under_test.client_subscribed( *new_subscriber_ptr->client_id( ), new_subscribe_packet );
+            under_test.client_subscribed( new_subscriber_session, new_subscribe_packet );
 
             THEN( "that PUBLISH packet should be sent to the new connected client" )
             {
+                // Retained messages are stored as compact copies
                 const auto& sent_packets = new_subscriber_ptr->sent_packets( );
-                const auto pos = std::find( std::begin( sent_packets ), std::end( sent_packets ), publish_packet );
+                const auto pos =
+                    std::find_if( std::begin( sent_packets ), std::end( sent_packets ), [&publish_packet]( auto sent ) {
+                        const auto sent_publish = std::dynamic_pointer_cast<const publish>( sent );
+                        return sent_publish && ( sent_publish->topic( ) == publish_packet->topic( ) ) &&
+                               ( sent_publish->application_message( ) == publish_packet->application_message( ) );
+                    } );
                 REQUIRE( pos != std::end( sent_packets ) );
             }
         }
@@ -311,16 +321,17 @@ SCENARIO( "mqtt_client_session_manager#client_published", "[dispatch]" )
             "connects and subscribes to the same topic" )
         {
             auto publish_packet = framework::create_publish_packet( topic, false );
-            under_test.client_published( publisher_id, publish_packet );
+            under_test.client_published( publisher_session, publish_packet );
 
             const auto new_subscriber_id = "new-test-subscriber"s;
             const auto new_subscriber_connect = framework::create_connect_packet( new_subscriber_id );
             auto new_subscriber_ptr = std::make_shared<framework::packet_sender_mock>( new_subscriber_id );
-            under_test.client_connected( new_subscriber_connect, new_subscriber_ptr );
+            const auto new_subscriber_session =
+                under_test.client_connected( new_subscriber_connect, new_subscriber_ptr );
 
             const auto new_subscribe_packet =
                 framework::create_subscribe_packet( {{topic, packet::QoS::AT_MOST_ONCE}} );
-            under_test.client_subscribed( *new_subscriber_ptr->client_id( ), new_subscribe_packet );
+            under_test.client_subscribed( new_subscriber_session, new_subscribe_packet );
 
             THEN( "that PUBLISH packet should NOT be sent to the new connected client" )
             {
@@ -336,19 +347,20 @@ SCENARIO( "mqtt_client_session_manager#client_published", "[dispatch]" )
             "topic" )
         {
             auto regular_publish_packet = framework::create_publish_packet( topic, true );
-            under_test.client_published( publisher_id, regular_publish_packet );
+            under_test.client_published( publisher_session, regular_publish_packet );
 
             auto delete_publish_packet = framework::create_publish_packet( topic, true, {} );
-            under_test.client_published( publisher_id, delete_publish_packet );
+            under_test.client_published( publisher_session, delete_publish_packet );
 
             const auto new_subscriber_id = "new-test-subscriber"s;
             const auto new_subscriber_connect = framework::create_connect_packet( new_subscriber_id );
             auto new_subscriber_ptr = std::make_shared<framework::packet_sender_mock>( new_subscriber_id );
-            under_test.client_connected( new_subscriber_connect, new_subscriber_ptr );
+            const auto new_subscriber_session =
+                under_test.client_connected( new_subscriber_connect, new_subscriber_ptr );
 
             const auto new_subscribe_packet =
                 framework::create_subscribe_packet( {{topic, packet::QoS::AT_MOST_ONCE}} );
-            under_test.client_subscribed( *new_subscriber_ptr->client_id( ), new_subscribe_packet );
+            under_test.client_subscribed( new_subscriber_session, new_subscribe_packet );
 
             THEN( "NO PUBLISH packet should be sent to the new connected client" )
             {
@@ -375,11 +387,11 @@ SCENARIO( "mqtt_client_session_manager#client_disconnected_ungracefully", "[disp
         const auto client_id = "test-client"s;
         const auto connect = framework::create_connect_packet( client_id );
         auto client_ptr = std::make_shared<framework::packet_sender_mock>( client_id );
-        under_test.client_connected( connect, client_ptr );
+        const auto session = under_test.client_connected( connect, client_ptr );
 
         WHEN( "client code calls under_test.client_disconnected_ungracefully(...)" )
         {
-            under_test.client_disconnected_ungracefully( client_id,
+            under_test.client_disconnected_ungracefully( session,
                                                          io_wally::dispatch::disconnect_reason::protocol_violation );
 
             THEN( "under_test.connected_clients_count() should return 0" )
@@ -404,21 +416,21 @@ SCENARIO( "mqtt_client_session_manager#client_disconnected_ungracefully", "[disp
         const auto lwt_client_connect = framework::create_connect_packet_with_lwt(
             lwt_client_id, false, lwt_topic, lwt_message, io_wally::protocol::packet::QoS::AT_MOST_ONCE, false );
         auto lwt_client_ptr = std::make_shared<framework::packet_sender_mock>( lwt_client_id );
-        under_test.client_connected( lwt_client_connect, lwt_client_ptr );
+        const auto lwt_client_session = under_test.client_connected( lwt_client_connect, lwt_client_ptr );
 
         const auto lwt_subscriber_id = "unretained-lwt-subscriber"s;
         const auto lwt_subscriber_connect = framework::create_connect_packet( lwt_subscriber_id );
         auto lwt_subscriber_ptr = std::make_shared<framework::packet_sender_mock>( lwt_subscriber_id );
-        under_test.client_connected( lwt_subscriber_connect, lwt_subscriber_ptr );
+        const auto lwt_subscriber_session = under_test.client_connected( lwt_subscriber_connect, lwt_subscriber_ptr );
 
         const auto subscribe_packet = framework::create_subscribe_packet( {{lwt_topic, packet::QoS::AT_MOST_ONCE}} );
-        under_test.client_subscribed( *lwt_client_ptr->client_id( ), subscribe_packet );
-        under_test.client_subscribed( *lwt_subscriber_ptr->client_id( ), subscribe_packet );
+        under_test.client_subscribed( lwt_client_session, subscribe_packet );
+        under_test.client_subscribed( lwt_subscriber_session, subscribe_packet );
 
         WHEN( "client code calls client_disconnected_ungracefully() for the connected client with LWT message" )
         {
             under_test.client_disconnected_ungracefully(
-                lwt_client_id, io_wally::dispatch::disconnect_reason::network_or_server_failure );
+                lwt_client_session, io_wally::dispatch::disconnect_reason::network_or_server_failure );
 
             THEN( "LWT message should be sent to subscribed client" )
             {
@@ -450,3 +462,173 @@ SCENARIO( "mqtt_client_session_manager#client_disconnected_ungracefully", "[disp
         }
     }
 }
+
+SCENARIO( "mqtt_client_session_manager::session_store#release", "[dispatch]" )
+{
+    GIVEN( "a session_store containing one session" )
+    {
+        const auto context = framework::create_context( );
+        auto io_service = asio::io_service{};
+        auto parent = io_wally::dispatch::mqtt_client_session_manager{context, io_service};
+
+        auto under_test = io_wally::dispatch::mqtt_client_session_manager::session_store{parent};
+
+        const auto client_id = "test-client"s;
+        under_test.insert( framework::create_connect_packet( client_id ),
+                           std::make_shared<framework::packet_sender_mock>( client_id ) );
+        const auto handle = under_test.handle_of( client_id );
+
+        WHEN( "client code removes that session and its client reconnects" )
+        {
+            under_test.remove( client_id );
+            const auto connection = std::make_shared<framework::packet_sender_mock>( client_id );
+            under_test.insert( framework::create_connect_packet( client_id ), connection );
+
+            THEN( "the new session should re-use the old session's handle" )
+            {
+                REQUIRE( under_test.handle_of( client_id ) == handle );
+                REQUIRE( under_test[handle] );
+            }
+        }
+
+        WHEN( "client code releases that session" )
+        {
+            under_test.release( client_id );
+
+            THEN( "that session's handle should be stale" )
+            {
+                REQUIRE( !under_test[handle] );
+                REQUIRE( !under_test.handle_of( client_id ).valid( ) );
+                REQUIRE( under_test.size( ) == 0 );
+            }
+        }
+    }
+}
+
+SCENARIO( "mqtt_client_session_manager with a persistent session", "[dispatch]" )
+{
+    GIVEN( "mqtt_client_session_manager holding a disconnected persistent session that missed a QoS 1 PUBLISH" )
+    {
+        const auto context = framework::create_context( );
+        auto io_service = asio::io_service{};
+        auto under_test = io_wally::dispatch::mqtt_client_session_manager{context, io_service};
+
+        const auto subscriber_id = "test-subscriber"s;
+        const auto subscriber_session = under_test.client_connected(
+            framework::create_connect_packet( subscriber_id ),
+            std::make_shared<framework::packet_sender_mock>( subscriber_id ) );
+
+        const auto topic = "/topic/mqtt_client_session_manager/persistent"s;
+        under_test.client_subscribed( subscriber_session,
+                                      framework::create_subscribe_packet( {{topic, packet::QoS::AT_LEAST_ONCE}} ) );
+        under_test.client_disconnected( subscriber_session, io_wally::dispatch::disconnect_reason::client_disconnect );
+
+        const auto publisher_id = "test-publisher"s;
+        const auto publisher_session =
+            under_test.client_connected( framework::create_connect_packet( publisher_id, true ),
+                                         std::make_shared<framework::packet_sender_mock>( publisher_id ) );
+        under_test.client_published( publisher_session, framework::create_publish_packet( topic ) );
+
+        REQUIRE( under_test.connected_clients_count( ) == 1 );
+
+        WHEN( "that client reconnects asking for its persistent session" )
+        {
+            auto subscriber_ptr = std::make_shared<framework::packet_sender_mock>( subscriber_id );
+            const auto resumed =
+                under_test.client_connected( framework::create_connect_packet( subscriber_id ), subscriber_ptr );
+
+            THEN( "it should be sent a CONNACK with session present, followed by the missed PUBLISH" )
+            {
+                REQUIRE( resumed == subscriber_session );
+                const auto& sent_packets = subscriber_ptr->sent_packets( );
+                REQUIRE( sent_packets.size( ) == 2 );
+                REQUIRE( sent_packets[0]->type( ) == packet::Type::CONNACK );
+                REQUIRE( std::static_pointer_cast<const connack>( sent_packets[0] )->is_session_present( ) );
+                REQUIRE( sent_packets[1]->type( ) == packet::Type::PUBLISH );
+                REQUIRE( std::static_pointer_cast<const publish>( sent_packets[1] )->topic( ) == topic );
+            }
+        }
+
+        WHEN( "another client connects using the client id of a client still connected" )
+        {
+            auto impostor_ptr = std::make_shared<framework::packet_sender_mock>( publisher_id );
+            const auto impostor_session =
+                under_test.client_connected( framework::create_connect_packet( publisher_id ), impostor_ptr );
+
+            THEN( "it should not be given a session, nor be sent a CONNACK" )
+            {
+                REQUIRE( !impostor_session );
+                REQUIRE( impostor_ptr->sent_packets( ).empty( ) );
+            }
+        }
+
+        WHEN( "that client reconnects asking for a clean session" )
+        {
+            auto subscriber_ptr = std::make_shared<framework::packet_sender_mock>( subscriber_id );
+            under_test.client_connected( framework::create_connect_packet( subscriber_id, true ), subscriber_ptr );
+
+            THEN( "it should be sent a CONNACK without session present, and nothing else" )
+            {
+                const auto& sent_packets = subscriber_ptr->sent_packets( );
+                REQUIRE( sent_packets.size( ) == 1 );
+                REQUIRE( sent_packets[0]->type( ) == packet::Type::CONNACK );
+                REQUIRE( !std::static_pointer_cast<const connack>( sent_packets[0] )->is_session_present( ) );
+            }
+
+            AND_WHEN( "another PUBLISH to its former subscription arrives" )
+            {
+                under_test.client_published( publisher_session, framework::create_publish_packet( topic ) );
+
+                THEN( "it should not be sent to that client" )
+                {
+                    REQUIRE( subscriber_ptr->sent_packets( ).size( ) == 1 );
+                }
+            }
+        }
+    }
+
+    GIVEN( "mqtt_client_session_manager holding a disconnected persistent session whose client sent a QoS 2 PUBLISH "
+           "to a topic another client subscribed to" )
+    {
+        const auto context = framework::create_context( );
+        auto io_service = asio::io_service{};
+        auto under_test = io_wally::dispatch::mqtt_client_session_manager{context, io_service};
+
+        const auto topic = "/topic/mqtt_client_session_manager/persistent"s;
+        const auto subscriber_id = "test-subscriber"s;
+        auto subscriber_ptr = std::make_shared<framework::packet_sender_mock>( subscriber_id );
+        const auto subscriber_session =
+            under_test.client_connected( framework::create_connect_packet( subscriber_id, true ), subscriber_ptr );
+        under_test.client_subscribed( subscriber_session,
+                                      framework::create_subscribe_packet( {{topic, packet::QoS::AT_MOST_ONCE}} ) );
+        subscriber_ptr->reset( );
+
+        const auto publisher_id = "test-publisher"s;
+        auto publisher_ptr = std::make_shared<framework::packet_sender_mock>( publisher_id );
+        const auto publisher_session =
+            under_test.client_connected( framework::create_connect_packet( publisher_id ), publisher_ptr );
+        auto publish_packet = framework::create_publish_packet( topic );
+        publish_packet->qos( packet::QoS::EXACTLY_ONCE );
+        under_test.client_published( publisher_session, publish_packet );
+        under_test.client_disconnected( publisher_session, io_wally::dispatch::disconnect_reason::client_disconnect );
+
+        WHEN( "that client reconnects and re-sends that PUBLISH" )
+        {
+            auto reconnected_ptr = std::make_shared<framework::packet_sender_mock>( publisher_id );
+            const auto resumed =
+                under_test.client_connected( framework::create_connect_packet( publisher_id ), reconnected_ptr );
+            auto resent_packet = framework::create_publish_packet( topic );
+            resent_packet->qos( packet::QoS::EXACTLY_ONCE );
+            resent_packet->dup( true );
+            under_test.client_published( resumed, resent_packet );
+
+            THEN( "that PUBLISH should be delivered exactly once" )
+            {
+                REQUIRE( resumed == publisher_session );
+                REQUIRE( publisher_ptr->sent_packets( ).size( ) == 2 );
+                REQUIRE( publisher_ptr->sent_packets( )[1]->type( ) == packet::Type::PUBREC );
+                REQUIRE( subscriber_ptr->sent_packets( ).size( ) == 1 );
+            }
+        }
+    }
+}
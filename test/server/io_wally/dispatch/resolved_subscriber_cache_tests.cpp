@@ -0,0 +1,111 @@
+#include "catch.hpp"
+
+#include "io_wally/dispatch/common.hpp"
+#include "io_wally/dispatch/resolved_subscriber_cache.hpp"
+#include "io_wally/protocol/common.hpp"
+#include "io_wally/protocol/topic_name.hpp"
+
+using namespace io_wally::protocol;
+using io_wally::dispatch::resolved_subscriber_cache;
+using io_wally::dispatch::session_handle;
+
+SCENARIO( "resolved_subscriber_cache", "[dispatch]" )
+{
+    const auto subscribers =
+        resolved_subscriber_cache::subscribers_t{{session_handle{0, 0}, packet::QoS::AT_LEAST_ONCE}};
+
+    GIVEN( "a resolved_subscriber_cache holding subscribers for two topics" )
+    {
+        auto under_test = resolved_subscriber_cache{2};
+        const auto temperature = topic_name::intern( "/site-1/device-1/temperature" );
+        const auto humidity = topic_name::intern( "/site-1/device-1/humidity" );
+        under_test.insert( temperature, subscribers );
+        under_test.insert( humidity, subscribers );
+
+        WHEN( "a caller looks up a cached topic" )
+        {
+            const auto* cached = under_test.find( temperature );
+
+            THEN( "it should receive that topic's subscribers and count a hit" )
+            {
+                REQUIRE( cached != nullptr );
+                REQUIRE( *cached == subscribers );
+                REQUIRE( under_test.stats( ).hits == 1 );
+                REQUIRE( under_test.stats( ).misses == 0 );
+            }
+        }
+
+        WHEN( "a caller looks up a topic that is not cached" )
+        {
+            const auto* cached = under_test.find( topic_name::intern( "/site-1/device-2/temperature" ) );
+
+            THEN( "it should receive nullptr and count a miss" )
+            {
+                REQUIRE( cached == nullptr );
+                REQUIRE( under_test.stats( ).misses == 1 );
+                REQUIRE( under_test.stats( ).hit_rate( ) == 0.0 );
+            }
+        }
+
+        WHEN( "a caller caches a third topic" )
+        {
+            REQUIRE( under_test.find( temperature ) != nullptr );
+            under_test.insert( topic_name::intern( "/site-1/device-2/temperature" ), subscribers );
+
+            THEN( "it should evict the least recently used topic" )
+            {
+                REQUIRE( under_test.size( ) == 2 );
+                REQUIRE( under_test.stats( ).evictions == 1 );
+                REQUIRE( under_test.find( humidity ) == nullptr );
+                REQUIRE( under_test.find( temperature ) != nullptr );
+            }
+        }
+
+        WHEN( "a caller invalidates a topic filter without wildcards" )
+        {
+            const auto invalidated = under_test.invalidate( "/site-1/device-1/temperature" );
+
+            THEN( "it should invalidate exactly that topic" )
+            {
+                REQUIRE( invalidated == 1 );
+                REQUIRE( under_test.stats( ).invalidations == 1 );
+                REQUIRE( under_test.find( temperature ) == nullptr );
+                REQUIRE( under_test.find( humidity ) != nullptr );
+            }
+        }
+
+        WHEN( "a caller invalidates a topic filter with wildcards" )
+        {
+            const auto invalidated = under_test.invalidate( "/site-1/+/humidity" );
+
+            THEN( "it should invalidate exactly those topics matching that topic filter" )
+            {
+                REQUIRE( invalidated == 1 );
+                REQUIRE( under_test.find( temperature ) != nullptr );
+                REQUIRE( under_test.find( humidity ) == nullptr );
+            }
+        }
+
+        WHEN( "a caller invalidates a topic filter matching all topics" )
+        {
+            const auto invalidated = under_test.invalidate( "/site-1/#" );
+
+            THEN( "it should invalidate all topics" )
+            {
+                REQUIRE( invalidated == 2 );
+                REQUIRE( under_test.size( ) == 0 );
+            }
+        }
+
+        WHEN( "a caller invalidates a topic filter matching no topic" )
+        {
+            const auto invalidated = under_test.invalidate( "/site-2/#" );
+
+            THEN( "it should invalidate nothing" )
+            {
+                REQUIRE( invalidated == 0 );
+                REQUIRE( under_test.size( ) == 2 );
+            }
+        }
+    }
+}
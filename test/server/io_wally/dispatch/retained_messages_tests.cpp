@@ -1,11 +1,19 @@
 #include "catch.hpp"
 
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "framework/factories.hpp"
 
 #include "io_wally/dispatch/common.hpp"
 #include "io_wally/dispatch/retained_messages.hpp"
 #include "io_wally/protocol/common.hpp"
+#include "io_wally/protocol/payload.hpp"
 #include "io_wally/protocol/publish_packet.hpp"
+#include "io_wally/protocol/topic_name.hpp"
 
 using namespace io_wally::protocol;
 
@@ -13,7 +21,7 @@ SCENARIO( "retained_messages#retain", "[dispatch]" )
 {
     GIVEN( "a PUBLISH packet with retain flag set" )
     {
-        io_wally::dispatch::retained_messages under_test{};
+        io_wally::dispatch::retained_messages under_test{framework::create_context( )};
 
         const auto topic = "/test/retain";
         const auto publish = framework::create_publish_packet( topic, true );
@@ -50,7 +58,7 @@ SCENARIO( "retained_messages#retain", "[dispatch]" )
 
     GIVEN( "a PUBLISH packet with retain flag set and zero-length payload" )
     {
-        io_wally::dispatch::retained_messages under_test{};
+        io_wally::dispatch::retained_messages under_test{framework::create_context( )};
 
         const auto topic = "/test/retain";
         const auto publish_non_zero =
@@ -68,6 +76,27 @@ SCENARIO( "retained_messages#retain", "[dispatch]" )
             {
                 REQUIRE( under_test.size( ) == 0 );
             }
+
+            AND_THEN( "it should release all nodes no longer needed" )
+            {
+                REQUIRE( under_test.node_count( ) == 1 );
+            }
+        }
+
+        WHEN( "a caller removes a retained message whose topic is a prefix of another retained message's topic" )
+        {
+            under_test.retain( publish_non_zero );
+            under_test.retain( framework::create_publish_packet( "/test/retain/child", true ) );
+            under_test.retain( publish_zero );
+
+            THEN( "it should keep the other retained message" )
+            {
+                REQUIRE( under_test.size( ) == 1 );
+                const auto matches = under_test.messages_for(
+                    framework::create_subscribe_packet( {{"/test/#", packet::QoS::AT_MOST_ONCE}} ) );
+                REQUIRE( matches.size( ) == 1 );
+                REQUIRE( matches[0].first->topic( ) == "/test/retain/child" );
+            }
         }
     }
 }
@@ -76,7 +105,7 @@ SCENARIO( "retained_messages#messages_for", "[dispatch]" )
 {
     GIVEN( "a retained_messages instance containing 5 retained messages" )
     {
-        io_wally::dispatch::retained_messages under_test{};
+        io_wally::dispatch::retained_messages under_test{framework::create_context( )};
 
         under_test.retain( framework::create_publish_packet( "/test/retain1/topic1", true ) );
         under_test.retain( framework::create_publish_packet( "/test/retain2/topic2", true ) );
@@ -100,7 +129,7 @@ SCENARIO( "retained_messages#messages_for", "[dispatch]" )
 
     GIVEN( "a retained_messages instance containing 1 retained message" )
     {
-        io_wally::dispatch::retained_messages under_test{};
+        io_wally::dispatch::retained_messages under_test{framework::create_context( )};
 
         under_test.retain( framework::create_publish_packet( "/test/retain1/topic1", true ) );
 
@@ -119,4 +148,219 @@ SCENARIO( "retained_messages#messages_for", "[dispatch]" )
             }
         }
     }
+
+    GIVEN( "a retained_messages instance containing retained messages on several topic levels" )
+    {
+        io_wally::dispatch::retained_messages under_test{framework::create_context( )};
+
+        under_test.retain( framework::create_publish_packet( "sport", true ) );
+        under_test.retain( framework::create_publish_packet( "sport/tennis", true ) );
+        under_test.retain( framework::create_publish_packet( "sport/tennis/player1", true ) );
+        under_test.retain( framework::create_publish_packet( "sport/tennis/player2", true ) );
+        under_test.retain( framework::create_publish_packet( "sport/golf/player1", true ) );
+        under_test.retain( framework::create_publish_packet( "sport//player1", true ) );
+        under_test.retain( framework::create_publish_packet( "news/tennis/player1", true ) );
+
+        const auto matches_for = [&under_test]( const std::string& topic_filter ) {
+            return under_test
+                .messages_for( framework::create_subscribe_packet( {{topic_filter, packet::QoS::AT_MOST_ONCE}} ) )
+                .size( );
+        };
+
+        WHEN( "a caller subscribes using topic filters without wildcards" )
+        {
+            THEN( "it should return exactly the retained message for that topic" )
+            {
+                CHECK( matches_for( "sport" ) == 1 );
+                CHECK( matches_for( "sport/tennis/player1" ) == 1 );
+                CHECK( matches_for( "sport/tennis/player3" ) == 0 );
+                REQUIRE( matches_for( "sport/tennis/player1/ranking" ) == 0 );
+            }
+        }
+
+        WHEN( "a caller subscribes using topic filters containing single level wildcards" )
+        {
+            THEN( "it should return retained messages for all topics matching exactly one level" )
+            {
+                CHECK( matches_for( "+" ) == 1 );
+                CHECK( matches_for( "sport/+" ) == 1 );
+                CHECK( matches_for( "sport/+/player1" ) == 3 );
+                REQUIRE( matches_for( "+/tennis/+" ) == 3 );
+            }
+        }
+
+        WHEN( "a caller subscribes using topic filters ending in a multi level wildcard" )
+        {
+            THEN( "it should return retained messages for all topics in that subtree, including its parent" )
+            {
+                CHECK( matches_for( "#" ) == 7 );
+                CHECK( matches_for( "sport/#" ) == 6 );
+                CHECK( matches_for( "sport/tennis/#" ) == 3 );
+                CHECK( matches_for( "sport/tennis/player1/#" ) == 1 );
+                REQUIRE( matches_for( "+/tennis/#" ) == 4 );
+            }
+        }
+    }
+}
+
+SCENARIO( "retained_messages memory budget", "[dispatch]" )
+{
+    using io_wally::dispatch::retained_messages;
+
+    // Each of these messages has a footprint of 2 + 100 + MESSAGE_OVERHEAD bytes: our budget fits two of them
+    const auto payload = std::vector<uint8_t>( 100, 'x' );
+    const auto footprint = 2 + payload.size( ) + retained_messages::MESSAGE_OVERHEAD;
+    const auto budget = std::to_string( 2 * footprint + 1 );
+    const auto subscribe_to = []( const std::string& topic_filter ) {
+        return framework::create_subscribe_packet( {{topic_filter, packet::QoS::AT_MOST_ONCE}} );
+    };
+
+    GIVEN( "a retained_messages instance evicting least recently used messages" )
+    {
+        retained_messages under_test{framework::create_context( {"--retain-max-bytes", budget.c_str( )} )};
+
+        under_test.retain( framework::create_publish_packet( "/a", true, payload ) );
+        under_test.retain( framework::create_publish_packet( "/b", true, payload ) );
+
+        WHEN( "a caller retains a third message after the first one has been delivered" )
+        {
+            REQUIRE( under_test.messages_for( subscribe_to( "/a" ) ).size( ) == 1 );
+            under_test.retain( framework::create_publish_packet( "/c", true, payload ) );
+
+            THEN( "it should evict the message least recently delivered" )
+            {
+                CHECK( under_test.size( ) == 2 );
+                CHECK( under_test.footprint( ) == 2 * footprint );
+                CHECK( under_test.evicted_count( ) == 1 );
+                CHECK( under_test.messages_for( subscribe_to( "/a" ) ).size( ) == 1 );
+                REQUIRE( under_test.messages_for( subscribe_to( "/b" ) ).empty( ) );
+            }
+        }
+
+        WHEN( "a caller retains a message larger than the entire budget" )
+        {
+            under_test.retain(
+                framework::create_publish_packet( "/a", true, std::vector<uint8_t>( 4 * footprint, 'x' ) ) );
+
+            THEN( "it should not retain it, and drop the message previously retained for its topic" )
+            {
+                CHECK( under_test.size( ) == 1 );
+                CHECK( under_test.footprint( ) == footprint );
+                REQUIRE( under_test.messages_for( subscribe_to( "/a" ) ).empty( ) );
+            }
+        }
+
+        WHEN( "a caller removes a retained message" )
+        {
+            under_test.retain( framework::create_publish_packet( "/a", true, std::vector<uint8_t>{} ) );
+
+            THEN( "it should no longer account for that message's footprint" )
+            {
+                CHECK( under_test.size( ) == 1 );
+                REQUIRE( under_test.footprint( ) == footprint );
+            }
+        }
+    }
+
+    GIVEN( "a retained_messages instance evicting oldest messages" )
+    {
+        retained_messages under_test{
+            framework::create_context( {"--retain-max-bytes", budget.c_str( ), "--retain-eviction", "oldest"} )};
+
+        under_test.retain( framework::create_publish_packet( "/a", true, payload ) );
+        under_test.retain( framework::create_publish_packet( "/b", true, payload ) );
+
+        WHEN( "a caller retains a third message after the first one has been delivered" )
+        {
+            REQUIRE( under_test.messages_for( subscribe_to( "/a" ) ).size( ) == 1 );
+            under_test.retain( framework::create_publish_packet( "/c", true, payload ) );
+
+            THEN( "it should evict the message least recently retained" )
+            {
+                CHECK( under_test.size( ) == 2 );
+                CHECK( under_test.evicted_count( ) == 1 );
+                CHECK( under_test.messages_for( subscribe_to( "/b" ) ).size( ) == 1 );
+                REQUIRE( under_test.messages_for( subscribe_to( "/a" ) ).empty( ) );
+            }
+        }
+    }
+
+    GIVEN( "a retained_messages instance expiring messages after 60 seconds" )
+    {
+        retained_messages under_test{framework::create_context( {"--retain-ttl", "60"} )};
+        const auto start = retained_messages::clock::now( );
+
+        under_test.retain( framework::create_publish_packet( "/a", true, payload ), start );
+        under_test.retain( framework::create_publish_packet( "/b", true, payload ), start + std::chrono::seconds{30} );
+
+        WHEN( "a caller resolves retained messages 45 seconds later" )
+        {
+            const auto matches = under_test.messages_for( subscribe_to( "#" ), start + std::chrono::seconds{45} );
+
+            THEN( "it should return all retained messages" )
+            {
+                CHECK( matches.size( ) == 2 );
+                REQUIRE( under_test.expired_count( ) == 0 );
+            }
+        }
+
+        WHEN( "a caller resolves retained messages 75 seconds later" )
+        {
+            const auto matches = under_test.messages_for( subscribe_to( "#" ), start + std::chrono::seconds{75} );
+
+            THEN( "it should only return the message retained less than 60 seconds ago" )
+            {
+                CHECK( matches.size( ) == 1 );
+                CHECK( under_test.size( ) == 1 );
+                CHECK( under_test.footprint( ) == footprint );
+                REQUIRE( under_test.expired_count( ) == 1 );
+            }
+        }
+    }
+
+    GIVEN( "a PUBLISH packet whose application message references a larger buffer" )
+    {
+        retained_messages under_test{framework::create_context( )};
+        const auto buffer = std::make_shared<std::vector<uint8_t>>( 4096, 'x' );
+        const auto publish = std::make_shared<io_wally::protocol::publish>(
+            std::uint8_t{( 3 << 4 ) | 0x01}, 20, topic_name::intern( "/a" ), 0,
+            io_wally::protocol::payload{buffer, buffer->data( ), 100} );
+
+        WHEN( "a caller retains that PUBLISH packet" )
+        {
+            under_test.retain( publish );
+
+            THEN( "it should retain a compact copy no longer referencing that buffer" )
+            {
+                const auto matches = under_test.messages_for( subscribe_to( "/a" ) );
+                REQUIRE( matches.size( ) == 1 );
+                CHECK( matches[0].first->application_message( ).size( ) == 100 );
+                REQUIRE( matches[0].first->application_message( ).data( ) != buffer->data( ) );
+            }
+        }
+    }
+}
+
+TEST_CASE( "retained_messages lookup", "[.][benchmark]" )
+{
+    // 100 sites, each retaining the state of 1000 devices
+    io_wally::dispatch::retained_messages under_test{framework::create_context( )};
+    for ( auto device = 0; device < 100000; ++device )
+    {
+        under_test.retain( framework::create_publish_packet(
+            "/site-" + std::to_string( device % 100 ) + "/device-" + std::to_string( device ) + "/state", true ) );
+    }
+    const auto literal =
+        framework::create_subscribe_packet( {{"/site-7/device-357/state", packet::QoS::AT_MOST_ONCE}} );
+    const auto site = framework::create_subscribe_packet( {{"/site-7/#", packet::QoS::AT_MOST_ONCE}} );
+
+    BENCHMARK( "topic filter without wildcards" )
+    {
+        return under_test.messages_for( literal ).size( );
+    };
+
+    BENCHMARK( "topic filter matching a single site" )
+    {
+        return under_test.messages_for( site ).size( );
+    };
 }
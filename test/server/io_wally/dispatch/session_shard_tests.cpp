@@ -0,0 +1,150 @@
+#include "catch.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <asio.hpp>
+
+#include "framework/factories.hpp"
+#include "framework/mocks.hpp"
+
+#include "io_wally/dispatch/mqtt_client_session_manager.hpp"
+#include "io_wally/dispatch/session_shard.hpp"
+#include "io_wally/protocol/common.hpp"
+#include "io_wally/protocol/publish_packet.hpp"
+
+using namespace std::string_literals;
+using namespace io_wally::protocol;
+using io_wally::dispatch::session_shard;
+
+namespace
+{
+    /// Records whether a PUBLISH it received had already been retained by the time it received it
+    class retained_checking_sender final : public framework::packet_sender_mock
+    {
+       public:
+        retained_checking_sender( const std::string& client_id,
+                                  std::shared_ptr<io_wally::dispatch::shared_retained_messages> retained_messages )
+            : packet_sender_mock{client_id}, retained_messages_{std::move( retained_messages )}
+        {
+        }
+
+        void send( mqtt_packet::ptr packet ) override
+        {
+            if ( packet->type( ) == packet::Type::PUBLISH )
+                retained_on_receipt.push_back( retained_messages_->messages.size( ) > 0 );
+            packet_sender_mock::send( packet );
+        }
+
+        std::vector<bool> retained_on_receipt{};
+
+       private:
+        const std::shared_ptr<io_wally::dispatch::shared_retained_messages> retained_messages_;
+    };  // class retained_checking_sender
+}  // namespace
+
+SCENARIO( "session_shard", "[dispatch]" )
+{
+    const auto context = framework::create_context( );
+    auto io_service_0 = asio::io_service{};
+    auto io_service_1 = asio::io_service{};
+    const auto retained_messages = std::make_shared<io_wally::dispatch::shared_retained_messages>( context );
+    auto shards = std::vector<std::unique_ptr<session_shard>>{};
+    shards.push_back( std::make_unique<session_shard>( context, io_service_0, 0, 2, shards, retained_messages ) );
+    shards.push_back( std::make_unique<session_shard>( context, io_service_1, 1, 2, shards, retained_messages ) );
+    auto& publisher_shard = shards[0]->session_manager( );
+    auto& subscriber_shard = shards[1]->session_manager( );
+
+    const auto topic = "/topic/session_shard/test"s;
+    const auto publisher_id = "test-publisher"s;
+    auto publisher_ptr = std::make_shared<framework::packet_sender_mock>( publisher_id );
+    const auto publisher_session =
+        publisher_shard.client_connected( framework::create_connect_packet( publisher_id, true ), publisher_ptr );
+
+    GIVEN( "two shards, one with a client subscribed to a topic, the other with a client publishing to it" )
+    {
+        const auto subscriber_id = "test-subscriber"s;
+        auto subscriber_ptr = std::make_shared<framework::packet_sender_mock>( subscriber_id );
+        const auto subscriber_session = subscriber_shard.client_connected(
+            framework::create_connect_packet( subscriber_id, true ), subscriber_ptr );
+        subscriber_shard.client_subscribed(
+            subscriber_session, framework::create_subscribe_packet( {{topic, packet::QoS::AT_MOST_ONCE}} ) );
+        subscriber_ptr->reset( );
+
+        WHEN( "the publishing client sends three PUBLISH packets" )
+        {
+            for ( const std::uint8_t message : {'1', '2', '3'} )
+                publisher_shard.client_published( publisher_session,
+                                                  framework::create_publish_packet( topic, false, {message} ) );
+            io_service_0.poll( );
+            io_service_1.poll( );
+
+            THEN( "the subscribed client should receive them in the order they were sent, forwarded in one batch" )
+            {
+                const auto& sent_packets = subscriber_ptr->sent_packets( );
+                REQUIRE( sent_packets.size( ) == 3 );
+                for ( auto i = 0; i < 3; ++i )
+                {
+                    const auto forwarded = std::dynamic_pointer_cast<const publish>( sent_packets[i] );
+                    REQUIRE( forwarded->application_message( ) == std::vector<std::uint8_t>{std::uint8_t( '1' + i )} );
+                }
+                REQUIRE( shards[1]->received_batches( ) == 1 );
+                REQUIRE( shards[0]->received_batches( ) == 0 );
+            }
+        }
+    }
+
+    GIVEN( "two shards, one with a client subscribed to a topic, and a client publishing to it on the same shard" )
+    {
+        const auto subscriber_id = "test-local-subscriber"s;
+        auto subscriber_ptr = std::make_shared<retained_checking_sender>( subscriber_id, retained_messages );
+        const auto subscriber_session = publisher_shard.client_connected(
+            framework::create_connect_packet( subscriber_id, true ), subscriber_ptr );
+        publisher_shard.client_subscribed(
+            subscriber_session, framework::create_subscribe_packet( {{topic, packet::QoS::AT_MOST_ONCE}} ) );
+
+        WHEN( "the publishing client sends a retained PUBLISH that fills up the batch for the other shard" )
+        {
+            for ( auto i = std::size_t{1}; i < session_shard::MAX_BATCH_SIZE; ++i )
+                publisher_shard.client_published( publisher_session, framework::create_publish_packet( topic ) );
+            publisher_shard.client_published( publisher_session, framework::create_publish_packet( topic, true ) );
+            io_service_1.poll( );
+
+            THEN( "that PUBLISH should have been retained before it was handed to the other shard" )
+            {
+                // Each PUBLISH is handed to other shards before it is delivered to its own shard's subscribers
+                REQUIRE( shards[1]->received_batches( ) == 1 );
+                REQUIRE( subscriber_ptr->retained_on_receipt.size( ) == session_shard::MAX_BATCH_SIZE );
+                REQUIRE( subscriber_ptr->retained_on_receipt.back( ) );
+            }
+        }
+    }
+
+    GIVEN( "two shards, one with a client having published a retained message" )
+    {
+        publisher_shard.client_published( publisher_session, framework::create_publish_packet( topic, true ) );
+
+        WHEN( "a client connected to the other shard subscribes to that retained message's topic" )
+        {
+            const auto subscriber_id = "test-late-subscriber"s;
+            auto subscriber_ptr = std::make_shared<framework::packet_sender_mock>( subscriber_id );
+            const auto subscriber_session = subscriber_shard.client_connected(
+                framework::create_connect_packet( subscriber_id, true ), subscriber_ptr );
+            subscriber_ptr->reset( );
+            subscriber_shard.client_subscribed(
+                subscriber_session, framework::create_subscribe_packet( {{topic, packet::QoS::AT_MOST_ONCE}} ) );
+
+            THEN( "that client should receive that retained message" )
+            {
+                const auto& sent_packets = subscriber_ptr->sent_packets( );
+                REQUIRE( sent_packets.size( ) == 2 );
+                REQUIRE( sent_packets[1]->type( ) == packet::Type::PUBLISH );
+                REQUIRE( std::dynamic_pointer_cast<const publish>( sent_packets[1] )->retain( ) );
+            }
+        }
+    }
+}
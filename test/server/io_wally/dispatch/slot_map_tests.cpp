@@ -0,0 +1,67 @@
+#include "catch.hpp"
+
+#include <string>
+
+#include "io_wally/dispatch/slot_map.hpp"
+
+SCENARIO( "slot_map", "[dispatch]" )
+{
+    GIVEN( "a slot_map containing two values" )
+    {
+        auto under_test = io_wally::dispatch::slot_map<std::string>{};
+        const auto first = under_test.insert( "first" );
+        const auto second = under_test.insert( "second" );
+
+        THEN( "it should return each value via its handle" )
+        {
+            REQUIRE( under_test.size( ) == 2 );
+            REQUIRE( *under_test.get( first ) == "first" );
+            REQUIRE( *under_test.get( second ) == "second" );
+        }
+
+        WHEN( "a caller erases one value and inserts another one" )
+        {
+            const auto erased = under_test.erase( first );
+            const auto third = under_test.insert( "third" );
+
+            THEN( "it should re-use the erased value's slot" )
+            {
+                REQUIRE( erased );
+                REQUIRE( third.index == first.index );
+                REQUIRE( under_test.capacity( ) == 2 );
+            }
+
+            AND_THEN( "the erased value's handle should be stale" )
+            {
+                REQUIRE( under_test.get( first ) == nullptr );
+                REQUIRE( !under_test.erase( first ) );
+                REQUIRE( *under_test.get( third ) == "third" );
+            }
+        }
+
+        WHEN( "a caller clears it" )
+        {
+            under_test.clear( );
+
+            THEN( "all handles should be stale" )
+            {
+                REQUIRE( under_test.size( ) == 0 );
+                REQUIRE( under_test.get( first ) == nullptr );
+                REQUIRE( under_test.get( second ) == nullptr );
+            }
+        }
+    }
+
+    GIVEN( "a default constructed handle" )
+    {
+        auto under_test = io_wally::dispatch::slot_map<std::string>{};
+        under_test.insert( "first" );
+        const auto handle = io_wally::dispatch::slot_handle{};
+
+        THEN( "it should refer to nothing" )
+        {
+            REQUIRE( !handle.valid( ) );
+            REQUIRE( under_test.get( handle ) == nullptr );
+        }
+    }
+}
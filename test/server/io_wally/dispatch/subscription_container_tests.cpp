@@ -30,7 +30,7 @@ namespace
 SCENARIO( "subscription_container#matches", "[dispatch]" )
 {
     static const packet::QoS MAX_QOS = packet::QoS::AT_LEAST_ONCE;
-    static const std::string CLIENT_ID = "subscription_container_tests";
+    static const io_wally::dispatch::session_handle CLIENT_ID{0, 0};
 
     GIVEN( "topic filter \"#\" and a random topic" )
     {
@@ -203,7 +203,7 @@ SCENARIO( "subscription_container#matches", "[dispatch]" )
 SCENARIO( "subscription_container#topic_filter_matches_one_of", "[dispatch]" )
 {
     static const packet::QoS MAX_QOS = packet::QoS::AT_LEAST_ONCE;
-    static const std::string CLIENT_ID = "subscription_container_tests";
+    static const io_wally::dispatch::session_handle CLIENT_ID{0, 0};
 
     GIVEN( "topic filter \"/test\" and topic filters {\"/a\", \"b\", \"/test\"}" )
     {
@@ -0,0 +1,248 @@
+#include "catch.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "framework/factories.hpp"
+
+#include "io_wally/dispatch/common.hpp"
+#include "io_wally/dispatch/subscription_trie.hpp"
+#include "io_wally/dispatch/topic_subscriptions.hpp"
+#include "io_wally/protocol/common.hpp"
+#include "io_wally/protocol/subscription.hpp"
+#include "io_wally/protocol/topic_name.hpp"
+
+using namespace io_wally::protocol;
+
+namespace
+{
+    /// Names of subscribers, indexed by their session handle's index
+    auto subscriber_names = std::vector<std::string>{};
+
+    /// Return session handle standing in for subscriber \c name
+    auto id( const std::string& name ) -> io_wally::dispatch::session_handle
+    {
+        auto pos = std::find( subscriber_names.begin( ), subscriber_names.end( ), name );
+        if ( pos == subscriber_names.end( ) )
+            pos = subscriber_names.insert( pos, name );
+        return io_wally::dispatch::session_handle{static_cast<std::uint32_t>( pos - subscriber_names.begin( ) ), 0};
+    }
+
+    auto matching_subscribers( const io_wally::dispatch::subscription_trie& trie, const std::string& topic )
+        -> std::vector<std::string>
+    {
+        auto result = std::vector<std::string>{};
+        trie.match( topic_name::intern( topic ),
+                    [&result]( const io_wally::dispatch::subscription_trie::subscriber& subscr ) {
+                        result.push_back( subscriber_names[subscr.id.index] );
+                    } );
+        std::sort( result.begin( ), result.end( ) );
+
+        return result;
+    }
+}  // namespace
+
+SCENARIO( "subscription_trie#match", "[dispatch]" )
+{
+    GIVEN( "a subscription_trie with literal and wildcard topic filters" )
+    {
+        auto under_test = io_wally::dispatch::subscription_trie{};
+        under_test.insert( "sport/tennis/player1", id( "literal" ), packet::QoS::AT_MOST_ONCE );
+        under_test.insert( "sport/tennis/+", id( "single" ), packet::QoS::AT_MOST_ONCE );
+        under_test.insert( "sport/#", id( "multi" ), packet::QoS::AT_MOST_ONCE );
+        under_test.insert( "#", id( "all" ), packet::QoS::AT_MOST_ONCE );
+        under_test.insert( "+/+", id( "two-levels" ), packet::QoS::AT_MOST_ONCE );
+        under_test.insert( "/finance", id( "leading-slash" ), packet::QoS::AT_MOST_ONCE );
+
+        WHEN( "a caller matches a topic matched by literal, '+' and '#' filters" )
+        {
+            const auto subscribers = matching_subscribers( under_test, "sport/tennis/player1" );
+
+            THEN( "it should visit all of them" )
+            {
+                REQUIRE( subscribers == std::vector<std::string>{"all", "literal", "multi", "single"} );
+            }
+        }
+
+        WHEN( "a caller matches a topic equal to the parent level of a '#' filter" )
+        {
+            const auto subscribers = matching_subscribers( under_test, "sport" );
+
+            THEN( "it should visit that '#' filter's subscriber" )
+            {
+                REQUIRE( subscribers == std::vector<std::string>{"all", "multi"} );
+            }
+        }
+
+        WHEN( "a caller matches a topic starting with an empty level" )
+        {
+            const auto subscribers = matching_subscribers( under_test, "/finance" );
+
+            THEN( "it should treat that empty level as a regular level" )
+            {
+                REQUIRE( subscribers == std::vector<std::string>{"all", "leading-slash", "two-levels"} );
+            }
+        }
+
+        WHEN( "a caller matches a topic that shares only a prefix with a compressed node" )
+        {
+            const auto subscribers = matching_subscribers( under_test, "sport/tennis/player2/ranking" );
+
+            THEN( "it should only visit matching filters" )
+            {
+                REQUIRE( subscribers == std::vector<std::string>{"all", "multi"} );
+            }
+        }
+    }
+}
+
+SCENARIO( "subscription_trie#insert", "[dispatch]" )
+{
+    GIVEN( "an empty subscription_trie" )
+    {
+        auto under_test = io_wally::dispatch::subscription_trie{};
+
+        WHEN( "a caller inserts the same topic filter twice for the same subscriber" )
+        {
+            const auto first = under_test.insert( "a/b/c", id( "client" ), packet::QoS::AT_MOST_ONCE );
+            const auto second = under_test.insert( "a/b/c", id( "client" ), packet::QoS::EXACTLY_ONCE );
+
+            THEN( "it should replace that subscriber's maximum QoS" )
+            {
+                REQUIRE( first );
+                REQUIRE( !second );
+                REQUIRE( under_test.size( ) == 1 );
+
+                auto qos = packet::QoS::RESERVED;
+                under_test.match( topic_name::intern( "a/b/c" ),
+                                  [&qos]( const io_wally::dispatch::subscription_trie::subscriber& subscr ) {
+                                      qos = subscr.maximum_qos;
+                                  } );
+                REQUIRE( qos == packet::QoS::EXACTLY_ONCE );
+            }
+        }
+
+        WHEN( "a caller inserts a long literal topic filter" )
+        {
+            under_test.insert( "a/b/c/d/e/f", id( "client" ), packet::QoS::AT_MOST_ONCE );
+
+            THEN( "it should store it in a single compressed node" )
+            {
+                REQUIRE( under_test.node_count( ) == 2 );
+            }
+        }
+
+        WHEN( "a caller inserts a topic filter diverging from an existing compressed node" )
+        {
+            under_test.insert( "a/b/c/d", id( "first" ), packet::QoS::AT_MOST_ONCE );
+            under_test.insert( "a/b/x/y", id( "second" ), packet::QoS::AT_MOST_ONCE );
+
+            THEN( "it should split that node and still match both topic filters" )
+            {
+                REQUIRE( under_test.node_count( ) == 4 );
+                REQUIRE( matching_subscribers( under_test, "a/b/c/d" ) == std::vector<std::string>{"first"} );
+                REQUIRE( matching_subscribers( under_test, "a/b/x/y" ) == std::vector<std::string>{"second"} );
+                REQUIRE( matching_subscribers( under_test, "a/b" ).empty( ) );
+            }
+        }
+    }
+}
+
+SCENARIO( "subscription_trie#erase", "[dispatch]" )
+{
+    GIVEN( "a subscription_trie with overlapping topic filters" )
+    {
+        auto under_test = io_wally::dispatch::subscription_trie{};
+        under_test.insert( "a/b/c/d", id( "first" ), packet::QoS::AT_MOST_ONCE );
+        under_test.insert( "a/b/x/y", id( "second" ), packet::QoS::AT_MOST_ONCE );
+        under_test.insert( "a/+/c/d", id( "third" ), packet::QoS::AT_MOST_ONCE );
+
+        WHEN( "a caller erases a topic filter for a subscriber that did not register it" )
+        {
+            const auto erased = under_test.erase( "a/b/c/d", id( "second" ) );
+
+            THEN( "it should not remove anything" )
+            {
+                REQUIRE( !erased );
+                REQUIRE( under_test.size( ) == 3 );
+            }
+        }
+
+        WHEN( "a caller erases all topic filters but one" )
+        {
+            under_test.erase( "a/b/x/y", id( "second" ) );
+            under_test.erase( "a/+/c/d", id( "third" ) );
+
+            THEN( "it should prune and re-compress its nodes" )
+            {
+                REQUIRE( under_test.size( ) == 1 );
+                REQUIRE( under_test.node_count( ) == 2 );
+                REQUIRE( matching_subscribers( under_test, "a/b/c/d" ) == std::vector<std::string>{"first"} );
+            }
+        }
+
+        WHEN( "a caller erases all topic filters" )
+        {
+            under_test.erase( "a/b/x/y", id( "second" ) );
+            under_test.erase( "a/+/c/d", id( "third" ) );
+            under_test.erase( "a/b/c/d", id( "first" ) );
+
+            THEN( "it should only retain its root node" )
+            {
+                REQUIRE( under_test.size( ) == 0 );
+                REQUIRE( under_test.node_count( ) == 1 );
+            }
+        }
+    }
+}
+
+TEST_CASE( "subscription_trie vs. linear scan", "[.][benchmark]" )
+{
+    // 100 clients, each subscribing to 10 device topics using literal and wildcard topic filters
+    auto subscriptions = std::vector<io_wally::dispatch::subscription_container>{};
+    auto under_test = io_wally::dispatch::topic_subscriptions{
+        framework::create_context( {"--pub-subscriber-cache-size", "0"} )};
+    auto cached = io_wally::dispatch::topic_subscriptions{framework::create_context( )};
+    for ( auto client = 0; client < 100; ++client )
+    {
+        const auto handle = io_wally::dispatch::session_handle{static_cast<std::uint32_t>( client ), 0};
+        auto client_subscriptions = std::vector<subscription>{};
+        for ( auto device = 0; device < 10; ++device )
+        {
+            const auto site = "site-" + std::to_string( ( client * 10 + device ) % 50 );
+            const auto device_id = "device-" + std::to_string( client * 10 + device );
+            const auto topic_filter = device % 3 == 0   ? "/" + site + "/+/temperature"
+                                      : device % 3 == 1 ? "/" + site + "/" + device_id + "/#"
+                                                        : "/" + site + "/" + device_id + "/temperature";
+            client_subscriptions.emplace_back( topic_filter, packet::QoS::AT_LEAST_ONCE );
+            subscriptions.emplace_back( topic_filter, packet::QoS::AT_LEAST_ONCE, handle );
+        }
+        under_test.subscribe( handle, framework::create_subscribe_packet( client_subscriptions ) );
+        cached.subscribe( handle, framework::create_subscribe_packet( client_subscriptions ) );
+    }
+    const auto publish = framework::create_publish_packet( "/site-7/device-357/temperature" );
+
+    BENCHMARK( "linear scan" )
+    {
+        auto resolved = std::vector<io_wally::dispatch::session_handle>{};
+        for ( const auto& subscr : subscriptions )
+        {
+            if ( subscr.matches( publish->topic( ) ) &&
+                 std::find( resolved.begin( ), resolved.end( ), subscr.subscriber ) == resolved.end( ) )
+                resolved.push_back( subscr.subscriber );
+        }
+        return resolved.size( );
+    };
+
+    BENCHMARK( "subscription_trie" )
+    {
+        return under_test.resolve_subscribers( publish ).size( );
+    };
+
+    BENCHMARK( "resolved_subscriber_cache" )
+    {
+        return cached.resolve_subscribers( publish ).size( );
+    };
+}
@@ -17,7 +17,7 @@ SCENARIO( "topic_subscriptions#resolve_subscribers", "[dispatch]" )
     {
         io_wally::dispatch::topic_subscriptions under_test{framework::create_context( )};
 
-        const auto client_id = "topic_subscription_tests";
+        const auto client_id = io_wally::dispatch::session_handle{0, 0};
         auto subscriptions = std::vector<subscription>{{"/topic/+/level", packet::QoS::AT_MOST_ONCE},
                                                        {"/topic/+/+", packet::QoS::AT_LEAST_ONCE},
                                                        {"/topic/#", packet::QoS::EXACTLY_ONCE}};
@@ -49,7 +49,7 @@ SCENARIO( "topic_subscriptions#unsubscribe", "[dispatch]" )
     {
         io_wally::dispatch::topic_subscriptions under_test{framework::create_context( )};
 
-        const auto client_id = "topic_subscription_tests";
+        const auto client_id = io_wally::dispatch::session_handle{0, 0};
         auto subscriptions = std::vector<subscription>{{"/first/+/level", packet::QoS::AT_MOST_ONCE},
                                                        {"/topic/+/+", packet::QoS::AT_LEAST_ONCE},
                                                        {"/topic/#", packet::QoS::EXACTLY_ONCE}};
@@ -71,3 +71,131 @@ SCENARIO( "topic_subscriptions#unsubscribe", "[dispatch]" )
         }
     }
 }
+
+SCENARIO( "topic_subscriptions#unsubscribe_all", "[dispatch]" )
+{
+    GIVEN( "topic_subscriptions with subscriptions from two clients, partly to the same topic filters" )
+    {
+        io_wally::dispatch::topic_subscriptions under_test{framework::create_context( )};
+
+        const auto client_id = io_wally::dispatch::session_handle{0, 0};
+        const auto other_client_id = io_wally::dispatch::session_handle{1, 0};
+        under_test.subscribe( client_id,
+                              framework::create_subscribe_packet( {{"/first/+/level", packet::QoS::AT_MOST_ONCE},
+                                                                   {"/topic/#", packet::QoS::EXACTLY_ONCE}} ) );
+        under_test.subscribe( other_client_id,
+                              framework::create_subscribe_packet( {{"/topic/#", packet::QoS::AT_LEAST_ONCE}} ) );
+
+        WHEN( "a caller cancels all subscriptions of one client" )
+        {
+            const auto cancelled = under_test.unsubscribe_all( client_id );
+
+            THEN( "it should cancel all that client's subscriptions, and only those" )
+            {
+                REQUIRE( cancelled == 2 );
+                REQUIRE( under_test.size( ) == 1 );
+            }
+
+            AND_THEN( "that client should no longer receive any publications" )
+            {
+                const auto publish = framework::create_publish_packet( "/topic/a" );
+                const auto subscribers = under_test.resolve_subscribers( publish );
+                REQUIRE( subscribers.size( ) == 1 );
+                REQUIRE( subscribers[0].first == other_client_id );
+            }
+
+            AND_THEN( "cancelling that client's subscriptions again should have no effect" )
+            {
+                REQUIRE( under_test.unsubscribe_all( client_id ) == 0 );
+            }
+        }
+
+        WHEN( "a client unsubscribes from some of its topic filters before all its subscriptions are cancelled" )
+        {
+            under_test.unsubscribe( client_id, framework::create_unsubscribe_packet( {"/topic/#"} ) );
+            const auto cancelled = under_test.unsubscribe_all( client_id );
+
+            THEN( "it should only cancel remaining subscriptions, leaving other clients' subscriptions alone" )
+            {
+                REQUIRE( cancelled == 1 );
+                REQUIRE( under_test.size( ) == 1 );
+            }
+        }
+    }
+}
+
+SCENARIO( "topic_subscriptions#resolve_subscribers using cached subscribers", "[dispatch]" )
+{
+    GIVEN( "topic_subscriptions that already resolved subscribers for a topic" )
+    {
+        io_wally::dispatch::topic_subscriptions under_test{framework::create_context( )};
+
+        const auto client_id = io_wally::dispatch::session_handle{0, 0};
+        const auto other_client_id = io_wally::dispatch::session_handle{1, 0};
+        under_test.subscribe( client_id,
+                              framework::create_subscribe_packet( {{"/topic/+", packet::QoS::AT_MOST_ONCE}} ) );
+        const auto publish = framework::create_publish_packet( "/topic/a" );
+        REQUIRE( under_test.resolve_subscribers( publish ).size( ) == 1 );
+
+        WHEN( "a caller resolves subscribers for that topic again" )
+        {
+            const auto subscribers = under_test.resolve_subscribers( publish );
+
+            THEN( "it should receive the same subscribers from cache" )
+            {
+                REQUIRE( subscribers.size( ) == 1 );
+                REQUIRE( under_test.cache_stats( ).hits == 1 );
+            }
+        }
+
+        WHEN( "another client subscribes to a topic filter matching that topic" )
+        {
+            under_test.subscribe( other_client_id,
+                                  framework::create_subscribe_packet( {{"/#", packet::QoS::AT_LEAST_ONCE}} ) );
+            const auto subscribers = under_test.resolve_subscribers( publish );
+
+            THEN( "it should invalidate that topic and resolve both subscribers" )
+            {
+                REQUIRE( under_test.cache_stats( ).invalidations == 1 );
+                REQUIRE( subscribers.size( ) == 2 );
+            }
+        }
+
+        WHEN( "a client subscribes again using a different QoS" )
+        {
+            under_test.subscribe( client_id,
+                                  framework::create_subscribe_packet( {{"/topic/+", packet::QoS::EXACTLY_ONCE}} ) );
+            const auto subscribers = under_test.resolve_subscribers( publish );
+
+            THEN( "it should resolve that client using its new QoS" )
+            {
+                REQUIRE( subscribers.size( ) == 1 );
+                REQUIRE( subscribers[0].second == packet::QoS::EXACTLY_ONCE );
+            }
+        }
+
+        WHEN( "another client subscribes to a topic filter not matching that topic" )
+        {
+            under_test.subscribe( other_client_id,
+                                  framework::create_subscribe_packet( {{"/other/#", packet::QoS::AT_LEAST_ONCE}} ) );
+            const auto subscribers = under_test.resolve_subscribers( publish );
+
+            THEN( "it should keep that topic cached" )
+            {
+                REQUIRE( under_test.cache_stats( ).invalidations == 0 );
+                REQUIRE( under_test.cache_stats( ).hits == 1 );
+                REQUIRE( subscribers.size( ) == 1 );
+            }
+        }
+
+        WHEN( "the only subscriber unsubscribes" )
+        {
+            under_test.unsubscribe( client_id, framework::create_unsubscribe_packet( {"/topic/+"} ) );
+
+            THEN( "it should no longer resolve any subscriber for that topic" )
+            {
+                REQUIRE( under_test.resolve_subscribers( publish ).empty( ) );
+            }
+        }
+    }
+}
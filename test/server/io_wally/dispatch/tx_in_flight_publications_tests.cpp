@@ -0,0 +1,237 @@
+#include "catch.hpp"
+
+#include <cstdint>
+#include <memory>
+
+#include <asio.hpp>
+
+#include "framework/factories.hpp"
+#include "framework/mocks.hpp"
+#include "framework/temp_directory.hpp"
+
+#include "io_wally/context.hpp"
+#include "io_wally/dispatch/tx_in_flight_publications.hpp"
+#include "io_wally/logging/logging.hpp"
+#include "io_wally/persistence/spill_store.hpp"
+#include "io_wally/protocol/common.hpp"
+#include "io_wally/protocol/puback_packet.hpp"
+#include "io_wally/protocol/publish_packet.hpp"
+#include "io_wally/protocol/pubrec_packet.hpp"
+#include "io_wally/protocol/pubrel_packet.hpp"
+
+using namespace io_wally::protocol;
+
+SCENARIO( "tx_in_flight_publications", "[dispatch]" )
+{
+    const auto context = framework::create_context( );
+    auto io_service = asio::io_service{};
+    const auto sender = std::make_shared<framework::packet_sender_mock>( );
+    auto under_test = std::make_unique<io_wally::dispatch::tx_in_flight_publications>( context, io_service, sender );
+
+    GIVEN( "a QoS 1 and a QoS 2 publication, both unacknowledged" )
+    {
+        under_test->publish( framework::create_publish_packet( "/test/topic/1" ), packet::QoS::AT_LEAST_ONCE );
+        under_test->publish( framework::create_publish_packet( "/test/topic/2" ), packet::QoS::EXACTLY_ONCE );
+
+        REQUIRE( sender->sent_packets( ).size( ) == 2 );
+        REQUIRE( under_test->size( ) == 2 );
+
+        WHEN( "their ack timeout expires" )
+        {
+            while ( sender->sent_packets( ).size( ) < 4 )
+                io_service.run_one( );
+
+            THEN( "it should retransmit both publications, the QoS 2 one flagged as duplicate" )
+            {
+                const auto& sent = sender->sent_packets( );
+                REQUIRE( sent[2]->type( ) == packet::Type::PUBLISH );
+                REQUIRE( sent[3]->type( ) == packet::Type::PUBLISH );
+                REQUIRE( std::static_pointer_cast<const publish>( sent[3] )->dup( ) );
+                REQUIRE( under_test->size( ) == 2 );
+            }
+        }
+
+        WHEN( "the client acknowledges both publications" )
+        {
+            const auto& sent = sender->sent_packets( );
+            const auto qos1_pktid = std::static_pointer_cast<const publish>( sent[0] )->packet_identifier( );
+            const auto qos2_pktid = std::static_pointer_cast<const publish>( sent[1] )->packet_identifier( );
+
+            under_test->response_received( std::make_shared<puback>( qos1_pktid ) );
+            under_test->response_received( std::make_shared<pubrec>( qos2_pktid ) );
+
+            THEN( "it should release the QoS 1 publication, and send PUBREL for the QoS 2 one" )
+            {
+                REQUIRE( under_test->size( ) == 1 );
+                REQUIRE( sent.size( ) == 3 );
+                REQUIRE( sent[2]->type( ) == packet::Type::PUBREL );
+            }
+
+            AND_WHEN( "their ack timeout expires" )
+            {
+                while ( sender->sent_packets( ).size( ) < 4 )
+                    io_service.run_one( );
+
+                THEN( "it should only retransmit PUBREL" )
+                {
+                    REQUIRE( sent[3]->type( ) == packet::Type::PUBREL );
+                    REQUIRE( std::static_pointer_cast<const pubrel>( sent[3] )->packet_identifier( ) == qos2_pktid );
+                }
+            }
+        }
+    }
+
+    under_test.reset( );
+}
+
+SCENARIO( "tx_in_flight_publications with a full in flight window", "[dispatch]" )
+{
+    const auto context = framework::create_context( );
+    const auto max_in_flight = context[io_wally::context::PUB_MAX_IN_FLIGHT].as<std::uint16_t>( );
+    auto io_service = asio::io_service{};
+    const auto sender = std::make_shared<framework::packet_sender_mock>( );
+    auto under_test = io_wally::dispatch::tx_in_flight_publications{context, io_service, sender};
+
+    GIVEN( "as many QoS 1 publications as fit into its in flight window, and one more" )
+    {
+        for ( auto i = 0; i <= max_in_flight; ++i )
+            under_test.publish( framework::create_publish_packet( "/test/topic" ), packet::QoS::AT_LEAST_ONCE );
+
+        THEN( "it should only send as many publications as fit into its window, and queue the remaining one" )
+        {
+            REQUIRE( sender->sent_packets( ).size( ) == max_in_flight );
+            REQUIRE( under_test.size( ) == max_in_flight );
+            REQUIRE( under_test.pending( ) == 1 );
+        }
+
+        AND_THEN( "it should only use packet identifiers within its window" )
+        {
+            for ( const auto& sent : sender->sent_packets( ) )
+            {
+                const auto pktid = std::static_pointer_cast<const publish>( sent )->packet_identifier( );
+                REQUIRE( pktid >= 1 );
+                REQUIRE( pktid <= max_in_flight );
+            }
+        }
+
+        WHEN( "the client acknowledges one of those publications" )
+        {
+            const auto acked_pktid =
+                std::static_pointer_cast<const publish>( sender->sent_packets( )[3] )->packet_identifier( );
+            under_test.response_received( std::make_shared<puback>( acked_pktid ) );
+
+            THEN( "it should send the queued publication, re-using the freed packet identifier" )
+            {
+                REQUIRE( sender->sent_packets( ).size( ) == max_in_flight + 1U );
+                REQUIRE( under_test.size( ) == max_in_flight );
+                REQUIRE( under_test.pending( ) == 0 );
+                const auto& last = sender->sent_packets( ).back( );
+                REQUIRE( std::static_pointer_cast<const publish>( last )->packet_identifier( ) == acked_pktid );
+            }
+        }
+    }
+}
+
+SCENARIO( "tx_in_flight_publications of a suspended session", "[dispatch]" )
+{
+    const auto context = framework::create_context( );
+    auto io_service = asio::io_service{};
+    const auto sender = std::make_shared<framework::packet_sender_mock>( );
+    auto under_test = io_wally::dispatch::tx_in_flight_publications{context, io_service, sender};
+
+    GIVEN( "an unacknowledged QoS 1 publication, and its client going offline" )
+    {
+        under_test.publish( framework::create_publish_packet( "/test/topic/1" ), packet::QoS::AT_LEAST_ONCE );
+        under_test.suspend( );
+
+        WHEN( "a QoS 0 and a QoS 1 publication arrive while offline" )
+        {
+            under_test.publish( framework::create_publish_packet( "/test/topic/2" ), packet::QoS::AT_MOST_ONCE );
+            under_test.publish( framework::create_publish_packet( "/test/topic/3" ), packet::QoS::AT_LEAST_ONCE );
+
+            THEN( "it should send nothing, drop the QoS 0 one and queue the QoS 1 one" )
+            {
+                REQUIRE( sender->sent_packets( ).size( ) == 1 );
+                REQUIRE( under_test.size( ) == 1 );
+                REQUIRE( under_test.pending( ) == 1 );
+            }
+
+            AND_WHEN( "its client comes back online" )
+            {
+                const auto new_sender = std::make_shared<framework::packet_sender_mock>( );
+                under_test.resume( new_sender );
+
+                THEN( "it should resend the in flight publication as duplicate, followed by the queued one" )
+                {
+                    const auto& sent = new_sender->sent_packets( );
+                    REQUIRE( sent.size( ) == 2 );
+                    const auto resent = std::static_pointer_cast<const publish>( sent[0] );
+                    REQUIRE( resent->dup( ) );
+                    REQUIRE( resent->topic( ) == "/test/topic/1" );
+                    REQUIRE( std::static_pointer_cast<const publish>( sent[1] )->topic( ) == "/test/topic/3" );
+                    REQUIRE( under_test.size( ) == 2 );
+                    REQUIRE( under_test.pending( ) == 0 );
+                }
+            }
+        }
+
+        WHEN( "more QoS 1 publications arrive than it may queue" )
+        {
+            const auto max_queued = context[io_wally::context::PUB_MAX_QUEUED].as<std::size_t>( );
+            for ( auto i = 0U; i <= max_queued; ++i )
+                under_test.publish( framework::create_publish_packet( "/test/topic" ), packet::QoS::AT_LEAST_ONCE );
+
+            THEN( "it should discard the oldest queued publication" )
+            {
+                REQUIRE( under_test.pending( ) == max_queued );
+                REQUIRE( under_test.discarded( ) == 1 );
+            }
+        }
+    }
+}
+
+SCENARIO( "tx_in_flight_publications spilling to disk", "[dispatch]" )
+{
+    const auto context = framework::create_context( );
+    const auto dir = framework::temp_directory{};
+    auto spill_store =
+        io_wally::persistence::spill_store{dir.path( ), 0, io_wally::logging::logger_factory::disabled( )};
+    auto io_service = asio::io_service{};
+    const auto sender = std::make_shared<framework::packet_sender_mock>( );
+    auto under_test = io_wally::dispatch::tx_in_flight_publications{context, io_service, sender, &spill_store};
+
+    GIVEN( "a suspended session, and a spill store not admitting anything into memory" )
+    {
+        under_test.suspend( );
+
+        WHEN( "three QoS 1 publications arrive while offline" )
+        {
+            for ( const auto* topic : {"/test/topic/1", "/test/topic/2", "/test/topic/3"} )
+                under_test.publish( framework::create_publish_packet( topic ), packet::QoS::AT_LEAST_ONCE );
+
+            THEN( "it should spill all of them" )
+            {
+                REQUIRE( under_test.pending( ) == 3 );
+                REQUIRE( under_test.spilled( ) == 3 );
+                REQUIRE( spill_store.records_written( ) == 3 );
+            }
+
+            AND_WHEN( "its client comes back online" )
+            {
+                const auto new_sender = std::make_shared<framework::packet_sender_mock>( );
+                under_test.resume( new_sender );
+
+                THEN( "it should load them back and send them in order" )
+                {
+                    const auto& sent = new_sender->sent_packets( );
+                    REQUIRE( sent.size( ) == 3 );
+                    REQUIRE( std::static_pointer_cast<const publish>( sent[0] )->topic( ) == "/test/topic/1" );
+                    REQUIRE( std::static_pointer_cast<const publish>( sent[1] )->topic( ) == "/test/topic/2" );
+                    REQUIRE( std::static_pointer_cast<const publish>( sent[2] )->topic( ) == "/test/topic/3" );
+                    REQUIRE( under_test.spilled( ) == 0 );
+                    REQUIRE( spill_store.resident_bytes( ) == 0 );
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,62 @@
+#include "catch.hpp"
+
+#include <array>
+#include <cstdint>
+#include <system_error>
+#include <vector>
+
+#include <asio.hpp>
+
+#include "framework/factories.hpp"
+
+#include "io_wally/mqtt_server.hpp"
+
+namespace
+{
+    auto connect_to_server( asio::io_service& io_service ) -> asio::ip::tcp::socket
+    {
+        auto socket = asio::ip::tcp::socket{io_service};
+        socket.connect( {asio::ip::address::from_string( "127.0.0.1" ), 18831} );
+        return socket;
+    }
+}  // namespace
+
+SCENARIO( "mqtt_server", "[server]" )
+{
+    auto under_test = io_wally::mqtt_server::create(
+        framework::create_context( {"--server-address", "127.0.0.1", "--server-port", "18831"} ) );
+    under_test->run( );
+    under_test->wait_until_bound( );
+    auto io_service = asio::io_service{};
+
+    GIVEN( "a client connected to a running mqtt_server, not having sent CONNECT" )
+    {
+        auto client = connect_to_server( io_service );
+
+        WHEN( "that client sends a SUBSCRIBE packet" )
+        {
+            asio::write( client,
+                         asio::buffer( std::vector<std::uint8_t>{0x82, 0x06, 0x00, 0x01, 0x00, 0x01, 'a', 0x00} ) );
+
+            THEN( "the server should close that connection, and still accept new clients" )
+            {
+                auto received = std::array<std::uint8_t, 4>{};
+                auto ec = std::error_code{};
+                client.read_some( asio::buffer( received ), ec );
+                REQUIRE( ec == asio::error::eof );
+
+                auto connecting_client = connect_to_server( io_service );
+                asio::write( connecting_client,
+                             asio::buffer( std::vector<std::uint8_t>{0x10, 0x0E, 0x00, 0x04, 'M', 'Q', 'T', 'T', 0x04,
+                                                                     0x02, 0x00, 0x3C, 0x00, 0x02, 'i', 'd'} ) );
+                asio::read( connecting_client, asio::buffer( received ) );
+                REQUIRE( received == std::array<std::uint8_t, 4>{0x20, 0x02, 0x00, 0x00} );
+            }
+        }
+    }
+
+    under_test->close_connections( );
+    under_test->wait_until_connections_closed( );
+    under_test->stop( );
+    under_test->wait_until_stopped( );
+}
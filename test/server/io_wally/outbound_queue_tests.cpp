@@ -0,0 +1,149 @@
+#include "catch.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <asio.hpp>
+
+#include "io_wally/outbound_queue.hpp"
+
+namespace
+{
+    auto push_bytes( io_wally::outbound_queue& queue, std::size_t length, std::uint8_t value ) -> bool
+    {
+        return queue.push( length, [value]( std::vector<std::uint8_t>::iterator begin,
+                                            std::vector<std::uint8_t>::iterator end ) {
+            std::fill( begin, end, value );
+        } );
+    }
+
+    auto total_length( const std::vector<asio::const_buffer>& buffers ) -> std::size_t
+    {
+        auto length = std::size_t{0};
+        for ( const auto& buffer : buffers )
+            length += asio::buffer_size( buffer );
+        return length;
+    }
+}  // namespace
+
+SCENARIO( "outbound_queue", "[connection]" )
+{
+    GIVEN( "an idle outbound_queue" )
+    {
+        auto under_test = io_wally::outbound_queue{16, 1024};
+
+        WHEN( "a caller pushes a packet" )
+        {
+            const auto start_writing = push_bytes( under_test, 4, 0x01 );
+
+            THEN( "it should ask the caller to start writing" )
+            {
+                REQUIRE( start_writing );
+            }
+
+            AND_WHEN( "the caller pushes further packets before taking the next write" )
+            {
+                const auto start_writing_again = push_bytes( under_test, 2, 0x02 );
+                push_bytes( under_test, 3, 0x03 );
+
+                THEN( "it should not ask the caller to start another write" )
+                {
+                    REQUIRE( !start_writing_again );
+                }
+
+                AND_THEN( "it should coalesce all packets into a single buffer" )
+                {
+                    const auto& buffers = under_test.next_write( );
+                    REQUIRE( buffers.size( ) == 1 );
+                    REQUIRE( total_length( buffers ) == 9 );
+                    const auto* data = asio::buffer_cast<const std::uint8_t*>( buffers[0] );
+                    REQUIRE( std::vector<std::uint8_t>( data, data + 9 ) ==
+                             std::vector<std::uint8_t>{1, 1, 1, 1, 2, 2, 3, 3, 3} );
+                }
+            }
+        }
+    }
+
+    GIVEN( "an outbound_queue with a write in flight" )
+    {
+        auto under_test = io_wally::outbound_queue{16, 1024};
+        push_bytes( under_test, 4, 0x01 );
+        under_test.next_write( );
+
+        WHEN( "a caller pushes packets while that write is in flight" )
+        {
+            push_bytes( under_test, 8, 0x02 );
+            push_bytes( under_test, 8, 0x03 );
+
+            THEN( "the next write should contain all those packets, and only those" )
+            {
+                const auto& buffers = under_test.next_write( );
+                REQUIRE( total_length( buffers ) == 16 );
+                REQUIRE( under_test.pending_bytes( ) == 0 );
+            }
+
+            AND_THEN( "the queue should become idle once all packets have been written" )
+            {
+                under_test.next_write( );
+                REQUIRE( under_test.next_write( ).empty( ) );
+                REQUIRE( push_bytes( under_test, 1, 0x04 ) );
+            }
+        }
+    }
+
+    GIVEN( "an outbound_queue with a small flush threshold" )
+    {
+        auto under_test = io_wally::outbound_queue{16, 10};
+
+        WHEN( "a caller pushes more bytes than that threshold" )
+        {
+            for ( auto i = 0; i < 6; ++i )
+                push_bytes( under_test, 4, 0x01 );
+
+            THEN( "it should split those bytes across several writes" )
+            {
+                const auto first = total_length( under_test.next_write( ) );
+                const auto second = total_length( under_test.next_write( ) );
+                REQUIRE( first == 12 );
+                REQUIRE( second == 12 );
+                REQUIRE( under_test.next_write( ).empty( ) );
+            }
+        }
+    }
+
+    GIVEN( "an idle outbound_queue and a buffer shared with other connections" )
+    {
+        auto under_test = io_wally::outbound_queue{16, 1024};
+        auto shared = std::make_shared<std::vector<std::uint8_t>>( 32, 0x05 );
+
+        WHEN( "a caller pushes a packet referencing that buffer" )
+        {
+            under_test.push_parts( shared, [&shared]( io_wally::outbound_queue::packet_writer& writer ) {
+                writer.append( 2, []( std::vector<std::uint8_t>::iterator begin,
+                                      std::vector<std::uint8_t>::iterator end ) { std::fill( begin, end, 0x01 ); } );
+                writer.append_shared( shared->data( ), shared->size( ) );
+            } );
+            push_bytes( under_test, 3, 0x02 );
+
+            THEN( "it should write that buffer in place, between encoded bytes" )
+            {
+                const auto& buffers = under_test.next_write( );
+                REQUIRE( buffers.size( ) == 3 );
+                REQUIRE( total_length( buffers ) == 37 );
+                REQUIRE( asio::buffer_cast<const std::uint8_t*>( buffers[1] ) == shared->data( ) );
+            }
+
+            AND_THEN( "it should keep that buffer alive until it has been written" )
+            {
+                const auto weak = std::weak_ptr<std::vector<std::uint8_t>>{shared};
+                shared.reset( );
+                under_test.next_write( );
+                REQUIRE( !weak.expired( ) );
+                under_test.next_write( );
+                REQUIRE( weak.expired( ) );
+            }
+        }
+    }
+}
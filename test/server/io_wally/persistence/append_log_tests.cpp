@@ -0,0 +1,93 @@
+#include "catch.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "framework/temp_directory.hpp"
+
+#include "io_wally/logging/logging.hpp"
+#include "io_wally/persistence/append_log.hpp"
+#include "io_wally/persistence/record_file.hpp"
+
+using namespace io_wally::persistence;
+
+namespace
+{
+    auto append( append_log& log, const std::string& record ) -> append_log::sequence_t
+    {
+        return log.append( reinterpret_cast<const std::uint8_t*>( record.data( ) ), record.size( ) );
+    }
+
+    auto records_in( const std::filesystem::path& path ) -> std::vector<std::string>
+    {
+        auto records = std::vector<std::string>{};
+        read_records( path, [&records]( const std::uint8_t* data, const std::size_t size ) {
+            records.emplace_back( reinterpret_cast<const char*>( data ), size );
+        } );
+        return records;
+    }
+}  // namespace
+
+SCENARIO( "append_log", "[persistence]" )
+{
+    const auto dir = framework::temp_directory{};
+    const auto path = dir.path( ) / "first.log";
+    const auto logger_factory = io_wally::logging::logger_factory::disabled( );
+
+    GIVEN( "an append_log" )
+    {
+        auto durable = std::atomic<append_log::sequence_t>{0};
+        auto under_test = append_log{path, logger_factory.logger( "append-log" ),
+                                     [&durable]( const append_log::sequence_t sequence ) { durable = sequence; }};
+
+        WHEN( "a caller appends three records and syncs" )
+        {
+            const auto first = append( under_test, "first" );
+            append( under_test, "second" );
+            const auto third = append( under_test, "third" );
+            const auto synced = under_test.sync( );
+
+            THEN( "all three records should be on disk, in order" )
+            {
+                CHECK( synced );
+                CHECK( third == first + 2 );
+                CHECK( durable == third );
+                CHECK( under_test.stats( ).records == 3 );
+                CHECK( under_test.stats( ).syncs >= 1 );
+                REQUIRE( records_in( path ) == std::vector<std::string>{"first", "second", "third"} );
+            }
+        }
+
+        WHEN( "a caller rotates that log after appending a record and appends another one" )
+        {
+            const auto rotated = dir.path( ) / "second.log";
+            append( under_test, "before" );
+            under_test.rotate( rotated );
+            append( under_test, "after" );
+            const auto synced = under_test.sync( );
+
+            THEN( "each record should go to its own file" )
+            {
+                CHECK( synced );
+                CHECK( records_in( path ) == std::vector<std::string>{"before"} );
+                REQUIRE( records_in( rotated ) == std::vector<std::string>{"after"} );
+            }
+        }
+    }
+
+    GIVEN( "an append_log that has been destroyed right after a record has been appended" )
+    {
+        {
+            auto under_test = append_log{path, logger_factory.logger( "append-log" )};
+            append( under_test, "last words" );
+        }
+
+        THEN( "that record should be on disk" )
+        {
+            REQUIRE( records_in( path ) == std::vector<std::string>{"last words"} );
+        }
+    }
+}
@@ -0,0 +1,146 @@
+#include "catch.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "framework/temp_directory.hpp"
+
+#include "io_wally/persistence/record_file.hpp"
+
+using namespace io_wally::persistence;
+
+namespace
+{
+    auto bytes_of( const std::string& str ) -> std::vector<std::uint8_t>
+    {
+        return std::vector<std::uint8_t>{str.begin( ), str.end( )};
+    }
+
+    auto read_all( const std::filesystem::path& path ) -> std::pair<std::vector<std::string>, read_result>
+    {
+        auto records = std::vector<std::string>{};
+        const auto result = read_records( path, [&records]( const std::uint8_t* data, const std::size_t size ) {
+            records.emplace_back( reinterpret_cast<const char*>( data ), size );
+        } );
+        return {records, result};
+    }
+}  // namespace
+
+SCENARIO( "crc32c", "[persistence]" )
+{
+    GIVEN( "the standard check input \"123456789\"" )
+    {
+        const auto input = bytes_of( "123456789" );
+
+        WHEN( "a caller computes its CRC-32C" )
+        {
+            const auto crc = crc32c( input.data( ), input.size( ) );
+
+            THEN( "it should receive the standard check value" )
+            {
+                REQUIRE( crc == 0xE3069283 );
+            }
+        }
+    }
+}
+
+SCENARIO( "read_records", "[persistence]" )
+{
+    const auto dir = framework::temp_directory{};
+    const auto path = dir.path( ) / "records";
+
+    GIVEN( "a file containing two framed records" )
+    {
+        auto framed = std::vector<std::uint8_t>{};
+        const auto first = bytes_of( "first" );
+        const auto second = bytes_of( "second record" );
+        frame_record( framed, first.data( ), first.size( ) );
+        frame_record( framed, second.data( ), second.size( ) );
+
+        WHEN( "a caller reads that file" )
+        {
+            std::ofstream{path, std::ios::binary}.write( reinterpret_cast<const char*>( framed.data( ) ),
+                                                         static_cast<std::streamsize>( framed.size( ) ) );
+            const auto [records, result] = read_all( path );
+
+            THEN( "it should receive both records in order" )
+            {
+                CHECK( records == std::vector<std::string>{"first", "second record"} );
+                CHECK( result.records == 2 );
+                REQUIRE( result.valid_bytes == result.file_bytes );
+            }
+        }
+
+        WHEN( "a caller reads that file after its last record has been torn" )
+        {
+            std::ofstream{path, std::ios::binary}.write( reinterpret_cast<const char*>( framed.data( ) ),
+                                                         static_cast<std::streamsize>( framed.size( ) - 3 ) );
+            const auto [records, result] = read_all( path );
+
+            THEN( "it should only receive the first record" )
+            {
+                CHECK( records == std::vector<std::string>{"first"} );
+                REQUIRE( result.valid_bytes == RECORD_HEADER_SIZE + first.size( ) );
+            }
+        }
+
+        WHEN( "a caller reads that file after its last record has been corrupted" )
+        {
+            framed.back( ) ^= 0x01;
+            std::ofstream{path, std::ios::binary}.write( reinterpret_cast<const char*>( framed.data( ) ),
+                                                         static_cast<std::streamsize>( framed.size( ) ) );
+            const auto [records, result] = read_all( path );
+
+            THEN( "it should only receive the first record" )
+            {
+                CHECK( records == std::vector<std::string>{"first"} );
+                REQUIRE( result.valid_bytes < result.file_bytes );
+            }
+        }
+    }
+}
+
+SCENARIO( "record_file_writer", "[persistence]" )
+{
+    const auto dir = framework::temp_directory{};
+    const auto path = dir.path( ) / "snapshot";
+    const auto record = bytes_of( "record" );
+
+    GIVEN( "a record_file_writer that has written a record" )
+    {
+        auto under_test = std::make_unique<record_file_writer>( path );
+        under_test->write( record.data( ), record.size( ) );
+
+        WHEN( "it has not yet been committed" )
+        {
+            THEN( "its file should not yet exist" )
+            {
+                REQUIRE( !std::filesystem::exists( path ) );
+            }
+        }
+
+        WHEN( "it is committed" )
+        {
+            under_test->commit( );
+
+            THEN( "its file should contain that record" )
+            {
+                const auto [records, result] = read_all( path );
+                REQUIRE( records == std::vector<std::string>{"record"} );
+            }
+        }
+
+        WHEN( "it is destroyed without having been committed" )
+        {
+            under_test.reset( );
+
+            THEN( "it should leave no file behind" )
+            {
+                REQUIRE( std::filesystem::is_empty( dir.path( ) ) );
+            }
+        }
+    }
+}
@@ -0,0 +1,197 @@
+#include "catch.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "framework/factories.hpp"
+#include "framework/temp_directory.hpp"
+
+#include "io_wally/dispatch/retained_messages.hpp"
+#include "io_wally/logging/logging.hpp"
+#include "io_wally/persistence/retained_store.hpp"
+#include "io_wally/protocol/common.hpp"
+#include "io_wally/protocol/publish_packet.hpp"
+#include "io_wally/protocol/topic_name.hpp"
+
+using namespace io_wally::protocol;
+using io_wally::persistence::retained_store;
+
+namespace
+{
+    struct loaded final
+    {
+        std::vector<std::shared_ptr<publish>> messages{};
+        std::vector<retained_store::clock::time_point> retained_at{};
+        std::vector<std::string> removed{};
+        std::uint64_t records{0};
+    };  // struct loaded
+
+    auto load( const std::filesystem::path& dir ) -> loaded
+    {
+        auto result = loaded{};
+        auto under_test = retained_store{dir, io_wally::logging::logger_factory::disabled( )};
+        result.records = under_test.load(
+            [&result]( auto message, const auto retained_at ) {
+                result.messages.push_back( std::move( message ) );
+                result.retained_at.push_back( retained_at );
+            },
+            [&result]( const auto& topic ) { result.removed.push_back( topic.name( ) ); } );
+        return result;
+    }
+
+    auto files_in( const std::filesystem::path& dir, const std::string& extension ) -> std::size_t
+    {
+        auto count = std::size_t{0};
+        for ( const auto& file : std::filesystem::directory_iterator{dir} )
+            count += file.path( ).extension( ) == extension ? 1 : 0;
+        return count;
+    }
+}  // namespace
+
+SCENARIO( "retained_store", "[persistence]" )
+{
+    const auto dir = framework::temp_directory{};
+    const auto logger_factory = io_wally::logging::logger_factory::disabled( );
+    const auto retained_at = std::chrono::time_point_cast<std::chrono::milliseconds>( retained_store::clock::now( ) );
+    const auto device_1 = framework::create_publish_packet( "/device-1/state", true, {'o', 'n'} );
+    const auto device_2 = framework::create_publish_packet( "/device-2/state", true, {'o', 'f', 'f'} );
+
+    GIVEN( "a retained_store that recorded two retained messages and a removal" )
+    {
+        {
+            auto under_test = retained_store{dir.path( ), logger_factory};
+            under_test.retain( *device_1, retained_at );
+            under_test.retain( *device_2, retained_at );
+            under_test.remove( device_1->topic( ) );
+        }
+
+        WHEN( "a new retained_store loads from the same directory" )
+        {
+            const auto result = load( dir.path( ) );
+
+            THEN( "it should replay all records, in order" )
+            {
+                REQUIRE( result.records == 3 );
+                REQUIRE( result.messages.size( ) == 2 );
+                CHECK( result.messages[0]->topic( ) == device_1->topic( ) );
+                CHECK( result.messages[1]->topic( ) == device_2->topic( ) );
+                CHECK( result.messages[1]->application_message( ) == device_2->application_message( ) );
+                CHECK( result.messages[1]->qos( ) == device_2->qos( ) );
+                CHECK( result.messages[1]->retain( ) );
+                CHECK( result.retained_at[1] == retained_at );
+                REQUIRE( result.removed == std::vector<std::string>{"/device-1/state"} );
+            }
+        }
+
+        WHEN( "a new retained_store loads from the same directory after its log has been torn" )
+        {
+            for ( const auto& file : std::filesystem::directory_iterator{dir.path( )} )
+                std::filesystem::resize_file( file.path( ), std::filesystem::file_size( file.path( ) ) - 1 );
+            const auto result = load( dir.path( ) );
+
+            THEN( "it should replay all records but the torn one" )
+            {
+                CHECK( result.records == 2 );
+                REQUIRE( result.removed.empty( ) );
+            }
+        }
+    }
+
+    GIVEN( "a retained_store that has been compacted" )
+    {
+        {
+            auto under_test = retained_store{dir.path( ), logger_factory};
+            under_test.retain( *device_1, retained_at );
+            under_test.retain( *device_2, retained_at );
+            under_test.retain( *device_2, retained_at );
+            under_test.compact( {{device_1, device_1->type_and_flags( ), retained_at},
+                                 {device_2, device_2->type_and_flags( ), retained_at}} );
+            under_test.remove( device_1->topic( ) );
+            REQUIRE( under_test.sync( ) );
+        }
+
+        WHEN( "a new retained_store loads from the same directory" )
+        {
+            const auto result = load( dir.path( ) );
+
+            THEN( "it should replay that snapshot followed by all records appended since" )
+            {
+                CHECK( files_in( dir.path( ), ".snapshot" ) == 1 );
+                CHECK( result.records == 3 );
+                CHECK( result.messages.size( ) == 2 );
+                REQUIRE( result.removed == std::vector<std::string>{"/device-1/state"} );
+            }
+        }
+    }
+}
+
+SCENARIO( "retained_messages with a retained_store", "[persistence]" )
+{
+    const auto dir = framework::temp_directory{};
+    const auto options = std::vector<const char*>{"--retain-store-dir", dir.path( ).c_str( )};
+
+    GIVEN( "a retained_messages instance that retained three messages and removed one of them" )
+    {
+        {
+            auto under_test = io_wally::dispatch::retained_messages{framework::create_context( options )};
+            under_test.retain( framework::create_publish_packet( "/site-1/device-1/state", true ) );
+            under_test.retain( framework::create_publish_packet( "/site-1/device-2/state", true ) );
+            under_test.retain( framework::create_publish_packet( "/site-2/device-1/state", true ) );
+            under_test.retain( framework::create_publish_packet( "/site-1/device-2/state", true, {} ) );
+        }
+
+        WHEN( "a new retained_messages instance starts using the same directory" )
+        {
+            auto under_test = io_wally::dispatch::retained_messages{framework::create_context( options )};
+            const auto matches = under_test.messages_for(
+                framework::create_subscribe_packet( {{"/site-1/#", packet::QoS::AT_MOST_ONCE}} ) );
+
+            THEN( "it should have loaded the two remaining messages" )
+            {
+                CHECK( under_test.size( ) == 2 );
+                REQUIRE( matches.size( ) == 1 );
+                REQUIRE( matches[0].first->topic( ).name( ) == "/site-1/device-1/state" );
+            }
+        }
+    }
+}
+
+TEST_CASE( "retained_store startup", "[.][benchmark]" )
+{
+    // 1000 sites, each retaining the state of 5000 devices
+    constexpr auto MESSAGES = 5000000;
+    // Our target for loading them. Not met yet: reading and checking all records takes well below a second, yet each
+    // message is still materialized on load, interning its topic, allocating its packet and inserting it into our
+    // topic tree, which takes several microseconds per message.
+    constexpr auto TARGET = std::chrono::milliseconds{5000};
+    const auto dir = framework::temp_directory{};
+    {
+        auto store = retained_store{dir.path( ), io_wally::logging::logger_factory::disabled( )};
+        const auto payload = std::vector<std::uint8_t>( 64, 'x' );
+        const auto retained_at = retained_store::clock::now( );
+        for ( auto device = 0; device < MESSAGES; ++device )
+        {
+            store.retain( *framework::create_publish_packet(
+                              "/site-" + std::to_string( device % 1000 ) + "/device-" + std::to_string( device ),
+                              true, payload ),
+                          retained_at );
+        }
+        REQUIRE( store.sync( ) );
+    }
+
+    const auto started = std::chrono::steady_clock::now( );
+    const auto under_test = io_wally::dispatch::retained_messages{
+        framework::create_context( {"--retain-store-dir", dir.path( ).c_str( )} )};
+    const auto elapsed =
+        std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::steady_clock::now( ) - started );
+
+    WARN( "Loaded " << under_test.size( ) << " retained messages in " << elapsed.count( ) << " ms (target: "
+                    << TARGET.count( ) << " ms)" );
+    REQUIRE( under_test.size( ) == MESSAGES );
+    CHECK( elapsed.count( ) <= TARGET.count( ) );
+}
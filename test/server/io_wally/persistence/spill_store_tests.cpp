@@ -0,0 +1,176 @@
+#include "catch.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "framework/factories.hpp"
+#include "framework/temp_directory.hpp"
+
+#include "io_wally/logging/logging.hpp"
+#include "io_wally/persistence/spill_store.hpp"
+#include "io_wally/protocol/publish_packet.hpp"
+
+using namespace io_wally::protocol;
+using io_wally::persistence::spill_store;
+
+namespace
+{
+    auto files_in( const std::filesystem::path& dir ) -> std::size_t
+    {
+        auto count = std::size_t{0};
+        for ( [[maybe_unused]] const auto& file : std::filesystem::directory_iterator{dir} )
+            ++count;
+        return count;
+    }
+}  // namespace
+
+SCENARIO( "spill_store", "[persistence]" )
+{
+    const auto dir = framework::temp_directory{};
+    const auto logger_factory = io_wally::logging::logger_factory::disabled( );
+    const auto device_1 = framework::create_publish_packet( "/device-1/state", false, {'o', 'n'} );
+    const auto device_2 = framework::create_publish_packet( "/device-2/state", false, {'o', 'f', 'f'} );
+
+    GIVEN( "a spill_store with a memory threshold of 100 bytes" )
+    {
+        auto under_test = spill_store{dir.path( ), 100, logger_factory};
+
+        WHEN( "callers ask to keep queued publications in memory" )
+        {
+            const auto first = under_test.admit( 60 );
+            const auto second = under_test.admit( 60 );
+
+            THEN( "it should only admit those fitting below its threshold" )
+            {
+                REQUIRE( first );
+                REQUIRE( !second );
+                REQUIRE( under_test.resident_bytes( ) == 60 );
+            }
+        }
+
+        WHEN( "a caller spills two publications and loads them back" )
+        {
+            const auto spilled_1 = under_test.spill( device_1->body( ) );
+            const auto spilled_2 = under_test.spill( device_2->body( ) );
+            const auto loaded_1 = under_test.load( *spilled_1 );
+            const auto loaded_2 = under_test.load( *spilled_2 );
+
+            THEN( "it should receive their topics and application messages" )
+            {
+                REQUIRE( loaded_1->topic == "/device-1/state" );
+                REQUIRE( loaded_1->application_message == device_1->application_message( ) );
+                REQUIRE( loaded_2->topic == "/device-2/state" );
+                REQUIRE( loaded_2->application_message == device_2->application_message( ) );
+            }
+        }
+
+        WHEN( "two callers spill copies of the same publication" )
+        {
+            const auto copy = device_1->with_new_packet_identifier( 7 );
+            const auto spilled_1 = under_test.spill( device_1->body( ) );
+            const auto spilled_2 = under_test.spill( copy->body( ) );
+
+            THEN( "it should write that publication only once, and hand out the same location to both" )
+            {
+                REQUIRE( under_test.records_written( ) == 1 );
+                REQUIRE( spilled_1->segment == spilled_2->segment );
+                REQUIRE( spilled_1->offset == spilled_2->offset );
+            }
+        }
+    }
+
+    GIVEN( "a spill_store using segments of 64 bytes" )
+    {
+        auto under_test = spill_store{dir.path( ), 0, logger_factory, 64};
+
+        WHEN( "a caller spills more publications than fit into one segment, and flushes them by spilling more" )
+        {
+            auto spilled = std::vector<spill_store::location>{};
+            auto publications = std::vector<std::shared_ptr<publish>>{};
+            for ( auto i = 0; i < 8; ++i )
+            {
+                publications.push_back( framework::create_publish_packet( "/device-" + std::to_string( i ) ) );
+                spilled.push_back( *under_test.spill( publications.back( )->body( ) ) );
+            }
+
+            THEN( "it should roll over to new segments, and still load all publications back" )
+            {
+                REQUIRE( under_test.segments( ) > 1 );
+                for ( auto i = 0; i < 8; ++i )
+                    REQUIRE( under_test.load( spilled[i] )->topic == "/device-" + std::to_string( i ) );
+            }
+
+            AND_WHEN( "all of them are released" )
+            {
+                for ( const auto& where : spilled )
+                    under_test.release( where );
+
+                THEN( "it should remove all segment files but the one it currently appends to" )
+                {
+                    REQUIRE( under_test.segments( ) == 1 );
+                    REQUIRE( files_in( dir.path( ) ) == 1 );
+                }
+            }
+        }
+    }
+
+    GIVEN( "a spill_store using segments of 64 bytes, its second segment failing all writes" )
+    {
+        auto under_test = spill_store{dir.path( ), 0, logger_factory, 64};
+        std::filesystem::create_symlink( "/dev/full", dir.path( ) / "spill-00000002.seg" );
+
+        WHEN( "a caller spills publications to that second segment, and flushes them by spilling more" )
+        {
+            auto spilled = std::vector<spill_store::location>{};
+            auto publications = std::vector<std::shared_ptr<publish>>{};
+            for ( auto i = 0; i < 8; ++i )
+            {
+                publications.push_back( framework::create_publish_packet( "/device-" + std::to_string( i ) ) );
+                spilled.push_back( *under_test.spill( publications.back( )->body( ) ) );
+            }
+            publications.clear( );
+
+            THEN( "it should keep those publications in memory, and still load all publications back" )
+            {
+                REQUIRE( spilled.back( ).segment > 2 );
+                REQUIRE( under_test.resident_bytes( ) > 0 );
+                for ( auto i = 0; i < 8; ++i )
+                    REQUIRE( under_test.load( spilled[i] )->topic == "/device-" + std::to_string( i ) );
+            }
+
+            AND_WHEN( "all of them are released" )
+            {
+                for ( const auto& where : spilled )
+                    under_test.release( where );
+
+                THEN( "it should no longer charge them to memory" )
+                {
+                    REQUIRE( under_test.resident_bytes( ) == 0 );
+                }
+            }
+        }
+    }
+
+    GIVEN( "a directory containing a segment file left behind by an earlier run" )
+    {
+        std::ofstream{dir.path( ) / "spill-00000001.seg"} << "left behind";
+        std::ofstream{dir.path( ) / "spill-00000007.seg"} << "left behind";
+
+        WHEN( "a spill_store is created in that directory, and destroyed again" )
+        {
+            {
+                auto under_test = spill_store{dir.path( ), 0, logger_factory};
+                REQUIRE( files_in( dir.path( ) ) == 1 );
+            }
+
+            THEN( "it should have removed all segment files" )
+            {
+                REQUIRE( files_in( dir.path( ) ) == 0 );
+            }
+        }
+    }
+}
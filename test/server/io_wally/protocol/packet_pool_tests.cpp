@@ -0,0 +1,78 @@
+#include "catch.hpp"
+
+#include <memory>
+#include <thread>
+
+#include "io_wally/protocol/packet_pool.hpp"
+#include "io_wally/protocol/puback_packet.hpp"
+
+using namespace io_wally::protocol;
+
+SCENARIO( "packet_pool", "[packets]" )
+{
+    GIVEN( "a packet allocated from calling thread's packet_pool" )
+    {
+        auto packet = make_packet<puback>( 7 );
+        const auto* const address = packet.get( );
+
+        WHEN( "calling thread releases that packet and allocates another one" )
+        {
+            packet.reset( );
+            const auto cached = packet_pool::local( ).cached_blocks( );
+            const auto next = make_packet<puback>( 8 );
+
+            THEN( "it should reuse the released packet's block" )
+            {
+                REQUIRE( cached >= 1 );
+                REQUIRE( next.get( ) == address );
+                REQUIRE( next->packet_identifier( ) == 8 );
+            }
+        }
+
+        WHEN( "another thread releases that packet and calling thread allocates another one" )
+        {
+            auto releaser = std::thread{[released = std::move( packet )]( ) mutable { released.reset( ); }};
+            releaser.join( );
+            const auto next = make_packet<puback>( 8 );
+
+            THEN( "it should reclaim and reuse the released packet's block" )
+            {
+                REQUIRE( next.get( ) == address );
+            }
+        }
+    }
+
+    GIVEN( "a packet allocated on a thread that has since exited" )
+    {
+        auto packet = std::shared_ptr<puback>{};
+        auto allocator = std::thread{[&packet]( ) { packet = make_packet<puback>( 7 ); }};
+        allocator.join( );
+
+        WHEN( "calling thread releases that packet" )
+        {
+            REQUIRE( packet->packet_identifier( ) == 7 );
+            packet.reset( );
+
+            THEN( "it should not crash" )
+            {
+                REQUIRE( packet == nullptr );
+            }
+        }
+    }
+
+    GIVEN( "an allocation larger than packet_pool::MAX_BLOCK_SIZE" )
+    {
+        auto* const memory = packet_pool::allocate( packet_pool::MAX_BLOCK_SIZE );
+
+        WHEN( "calling thread releases it" )
+        {
+            const auto cached = packet_pool::local( ).cached_blocks( );
+            packet_pool::deallocate( memory );
+
+            THEN( "it should not cache it" )
+            {
+                REQUIRE( packet_pool::local( ).cached_blocks( ) == cached );
+            }
+        }
+    }
+}
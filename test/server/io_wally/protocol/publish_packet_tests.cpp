@@ -22,7 +22,7 @@ SCENARIO( "publish", "[packets]" )
 
         const auto msg = std::vector<uint8_t>{0x00, 0x00};
 
-        auto under_test = publish{flgs, rem_len, topic, pktid, msg};
+        auto under_test = publish{flgs, rem_len, topic_name::intern( topic ), pktid, msg};
 
         WHEN( "a caller calls dup( true )" )
         {
@@ -56,7 +56,7 @@ SCENARIO( "publish", "[packets]" )
 
         const auto msg = std::vector<uint8_t>{0x00, 0x00};
 
-        auto under_test = publish{flgs, rem_len, topic, pktid, msg};
+        auto under_test = publish{flgs, rem_len, topic_name::intern( topic ), pktid, msg};
 
         WHEN( "a caller calls dup( true )" )
         {
@@ -88,7 +88,7 @@ SCENARIO( "publish", "[packets]" )
 
         const auto msg = std::vector<uint8_t>{0x01, 0x02};
 
-        auto under_test = publish{flgs, rem_len, topic, 0, msg};
+        auto under_test = publish{flgs, rem_len, topic_name::intern( topic ), 0, msg};
 
         WHEN( "a caller calls qos()" )
         {
@@ -141,7 +141,7 @@ SCENARIO( "publish", "[packets]" )
 
         const auto msg = std::vector<uint8_t>{0x00, 0x00};
 
-        auto under_test = publish{flgs, rem_len, topic, pktid, msg};
+        auto under_test = publish{flgs, rem_len, topic_name::intern( topic ), pktid, msg};
 
         WHEN( "a caller calls qos()" )
         {
@@ -191,7 +191,7 @@ SCENARIO( "publish", "[packets]" )
 
         const auto msg = std::vector<uint8_t>{0x00, 0x00};
 
-        auto under_test = publish{flgs, rem_len, topic, pktid, msg};
+        auto under_test = publish{flgs, rem_len, topic_name::intern( topic ), pktid, msg};
 
         WHEN( "a caller calls qos()" )
         {
@@ -241,7 +241,7 @@ SCENARIO( "publish", "[packets]" )
 
         const auto msg = std::vector<uint8_t>{0x00, 0x00};
 
-        auto under_test = publish{flgs, rem_len, topic, pktid, msg};
+        auto under_test = publish{flgs, rem_len, topic_name::intern( topic ), pktid, msg};
 
         WHEN( "a caller calls retain( false )" )
         {
@@ -275,7 +275,7 @@ SCENARIO( "publish", "[packets]" )
 
         const auto msg = std::vector<uint8_t>{0x00, 0x00};
 
-        auto under_test = publish{flgs, rem_len, topic, pktid, msg};
+        auto under_test = publish{flgs, rem_len, topic_name::intern( topic ), pktid, msg};
 
         WHEN( "a caller calls retain( false )" )
         {
@@ -390,3 +390,29 @@ SCENARIO( "publish#create", "[packets]" )
         }
     }
 }
+
+SCENARIO( "publish#with_new_packet_identifier", "[packets]" )
+{
+    GIVEN( "a publish packet" )
+    {
+        const auto original = publish::create( false, packet::QoS::AT_LEAST_ONCE, false, "surgemq/topic"s, 7,
+                                               std::vector<uint8_t>{'m', 'e', 's', 's', 'a', 'g', 'e'} );
+
+        WHEN( "a caller calls with_new_packet_identifier(...)" )
+        {
+            const auto copy = original->with_new_packet_identifier( 42 );
+
+            THEN( "it should receive a publish packet with that new packet identifier" )
+            {
+                CHECK( copy->packet_identifier( ) == 42 );
+                CHECK( copy->topic( ) == original->topic( ) );
+                REQUIRE( copy->application_message( ) == original->application_message( ) );
+            }
+
+            AND_THEN( "that publish packet should share the original's topic and application message" )
+            {
+                REQUIRE( copy->body( ) == original->body( ) );
+            }
+        }
+    }
+}
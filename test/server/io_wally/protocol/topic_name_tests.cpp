@@ -0,0 +1,78 @@
+#include "catch.hpp"
+
+#include <cstdint>
+#include <string>
+#include <thread>
+
+#include "io_wally/protocol/topic_name.hpp"
+
+using namespace io_wally::protocol;
+
+SCENARIO( "topic_name", "[packets]" )
+{
+    GIVEN( "a topic name interned from a string" )
+    {
+        const auto under_test = topic_name::intern( "sport/tennis//player1" );
+
+        THEN( "it should split that string into its topic levels" )
+        {
+            REQUIRE( under_test.name( ) == "sport/tennis//player1" );
+            REQUIRE( under_test.level_count( ) == 4 );
+            REQUIRE( under_test.level( 0 ) == "sport" );
+            REQUIRE( under_test.level( 1 ) == "tennis" );
+            REQUIRE( under_test.level( 2 ).empty( ) );
+            REQUIRE( under_test.level( 3 ) == "player1" );
+            REQUIRE( under_test.level_offset( 3 ) == 14 );
+            REQUIRE( under_test.level_hash( 1 ) == topic_name::hash_level( "tennis" ) );
+        }
+
+        WHEN( "a caller interns the same string again" )
+        {
+            const auto again = topic_name::intern( std::string{"sport/tennis//player1"} );
+
+            THEN( "it should get the same interned topic name" )
+            {
+                REQUIRE( again == under_test );
+                REQUIRE( again.id( ) == under_test.id( ) );
+                REQUIRE( &again.name( ) == &under_test.name( ) );
+            }
+        }
+
+        WHEN( "a caller interns a different string" )
+        {
+            const auto other = topic_name::intern( "sport/tennis" );
+
+            THEN( "it should get a different interned topic name" )
+            {
+                REQUIRE( other != under_test );
+                REQUIRE( other.id( ) != under_test.id( ) );
+            }
+        }
+
+        WHEN( "another thread interns the same string" )
+        {
+            auto id = std::uint64_t{0};
+            auto interner = std::thread{[&id]( ) { id = topic_name::intern( "sport/tennis//player1" ).id( ); }};
+            interner.join( );
+
+            THEN( "it should get the same interned topic name" )
+            {
+                REQUIRE( id == under_test.id( ) );
+            }
+        }
+    }
+
+    GIVEN( "a topic name that is no longer referenced" )
+    {
+        const auto interned_before = topic_name::interned_count( );
+        {
+            const auto released = topic_name::intern( "released/topic" );
+            REQUIRE( topic_name::interned_count( ) == interned_before + 1 );
+        }
+
+        THEN( "it should no longer be interned" )
+        {
+            REQUIRE( topic_name::interned_count( ) == interned_before );
+        }
+    }
+}
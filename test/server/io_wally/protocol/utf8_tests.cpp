@@ -0,0 +1,183 @@
+#include "catch.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "io_wally/error/protocol.hpp"
+#include "io_wally/protocol/utf8.hpp"
+
+using namespace io_wally::protocol;
+
+namespace
+{
+    auto instruction_sets( ) -> std::vector<utf8::instruction_set>
+    {
+        auto supported = std::vector<utf8::instruction_set>{utf8::instruction_set::scalar};
+        if ( utf8::supported_instruction_set( ) >= utf8::instruction_set::sse2 )
+            supported.push_back( utf8::instruction_set::sse2 );
+        if ( utf8::supported_instruction_set( ) >= utf8::instruction_set::avx2 )
+            supported.push_back( utf8::instruction_set::avx2 );
+
+        return supported;
+    }
+
+    /// Embed \c sequence at \c offset in an ASCII string \c length bytes long, exercising chunk boundaries and tails
+    auto embed( const std::string& sequence, const std::size_t offset, const std::size_t length ) -> std::string
+    {
+        auto embedded = std::string( length, 'x' );
+        embedded.replace( offset, sequence.size( ), sequence );
+
+        return embedded;
+    }
+}  // namespace
+
+SCENARIO( "utf8::scan", "[packets]" )
+{
+    for ( const auto isa : instruction_sets( ) )
+    {
+        GIVEN( "instruction set " + std::to_string( static_cast<int>( isa ) ) )
+        {
+            WHEN( "scanning ASCII strings of various lengths" )
+            {
+                THEN( "it should find them well-formed and free of special characters" )
+                {
+                    for ( auto length = std::size_t{0}; length < 100; ++length )
+                    {
+                        const auto result = utf8::scan( std::string( length, 'a' ), isa );
+                        REQUIRE( result.well_formed );
+                        REQUIRE( !result.contains_null );
+                        REQUIRE( !result.contains_wildcard );
+                    }
+                }
+            }
+
+            WHEN( "scanning strings containing special characters at various offsets" )
+            {
+                THEN( "it should find each of them" )
+                {
+                    for ( auto offset = std::size_t{0}; offset < 70; ++offset )
+                    {
+                        REQUIRE( utf8::scan( embed( std::string( 1, '\0' ), offset, 70 ), isa ).contains_null );
+                        REQUIRE( utf8::scan( embed( "+", offset, 70 ), isa ).contains_wildcard );
+                        REQUIRE( utf8::scan( embed( "#", offset, 70 ), isa ).contains_wildcard );
+                        // Special characters following a multibyte sequence
+                        REQUIRE( utf8::scan( embed( "\xC3\xA4#", offset, 72 ), isa ).contains_wildcard );
+                    }
+                }
+            }
+
+            WHEN( "scanning well-formed multibyte sequences at various offsets" )
+            {
+                THEN( "it should find them well-formed" )
+                {
+                    for ( const auto* sequence : {"\xC3\xA4", "\xE2\x82\xAC", "\xED\x9F\xBF", "\xF0\x9F\x98\x80",
+                                                  "\xF4\x8F\xBF\xBF"} )
+                    {
+                        for ( auto offset = std::size_t{0}; offset < 66; ++offset )
+                        {
+                            const auto result = utf8::scan( embed( sequence, offset, 70 ), isa );
+                            REQUIRE( result.well_formed );
+                            REQUIRE( !result.contains_null );
+                            REQUIRE( !result.contains_wildcard );
+                        }
+                    }
+                }
+            }
+
+            WHEN( "scanning ill-formed sequences at various offsets" )
+            {
+                THEN( "it should find them ill-formed" )
+                {
+                    // Stray continuation byte, overlong encodings, surrogates, beyond U+10FFFF, invalid bytes
+                    for ( const auto* sequence : {"\x80", "\xC0\xAF", "\xC1\xBF", "\xE0\x80\xAF", "\xF0\x80\x80\xAF",
+                                                  "\xED\xA0\x80", "\xED\xBF\xBF", "\xF4\x90\x80\x80", "\xF5\x80\x80",
+                                                  "\xFF", "\xC3x", "\xE2\x82x"} )
+                    {
+                        for ( auto offset = std::size_t{0}; offset < 66; ++offset )
+                        {
+                            REQUIRE( !utf8::scan( embed( sequence, offset, 70 ), isa ).well_formed );
+                        }
+                    }
+                }
+            }
+
+            WHEN( "scanning a string truncated in the middle of a multibyte sequence" )
+            {
+                THEN( "it should find it ill-formed" )
+                {
+                    REQUIRE( !utf8::scan( std::string( 40, 'x' ) + "\xF0\x9F\x98", isa ).well_formed );
+                    REQUIRE( !utf8::scan( "\xC3", isa ).well_formed );
+                }
+            }
+        }
+    }
+}
+
+SCENARIO( "utf8::check_topic_name", "[packets]" )
+{
+    GIVEN( "well-formed topic names" )
+    {
+        THEN( "it should accept them" )
+        {
+            REQUIRE_NOTHROW( utf8::check_topic_name( "sport/tennis/player1" ) );
+            REQUIRE_NOTHROW( utf8::check_topic_name( "/" ) );
+            REQUIRE_NOTHROW( utf8::check_topic_name( "sport/t\xC3\xA4nnis//" ) );
+        }
+    }
+
+    GIVEN( "ill-formed topic names" )
+    {
+        THEN( "it should reject them" )
+        {
+            REQUIRE_THROWS_AS( utf8::check_topic_name( "" ), io_wally::error::malformed_mqtt_packet );
+            REQUIRE_THROWS_AS( utf8::check_topic_name( std::string( "sport\0tennis", 12 ) ),
+                               io_wally::error::malformed_mqtt_packet );
+            REQUIRE_THROWS_AS( utf8::check_topic_name( "sport/+" ), io_wally::error::malformed_mqtt_packet );
+            REQUIRE_THROWS_AS( utf8::check_topic_name( "sport/#" ), io_wally::error::malformed_mqtt_packet );
+            REQUIRE_THROWS_AS( utf8::check_topic_name( "sport/\xED\xA0\x80" ), io_wally::error::malformed_mqtt_packet );
+        }
+    }
+}
+
+SCENARIO( "utf8::check_topic_filter", "[packets]" )
+{
+    GIVEN( "well-formed topic filters" )
+    {
+        THEN( "it should accept them" )
+        {
+            for ( const auto* filter : {"sport/tennis", "#", "+", "/", "sport/#", "sport/+/player1", "+/+/#", "+/",
+                                        "sport/t\xC3\xA4nnis/+"} )
+            {
+                REQUIRE_NOTHROW( utf8::check_topic_filter( filter ) );
+            }
+        }
+    }
+
+    GIVEN( "ill-formed topic filters" )
+    {
+        THEN( "it should reject them" )
+        {
+            for ( const auto* filter : {"", "sport/#/player1", "sport#", "sport/#x", "sport+", "sport/+x/player1",
+                                        "##", "sport/\xC0\xAF"} )
+            {
+                REQUIRE_THROWS_AS( utf8::check_topic_filter( filter ), io_wally::error::malformed_mqtt_packet );
+            }
+            REQUIRE_THROWS_AS( utf8::check_topic_filter( std::string( "sport/\0", 7 ) ),
+                               io_wally::error::malformed_mqtt_packet );
+        }
+    }
+}
+
+TEST_CASE( "utf8::scan vs. scalar validation", "[.][benchmark]" )
+{
+    const auto topic = std::string{"devices/building-17/floor-04/room-0815/sensors/temperature/celsius"};
+
+    for ( const auto isa : instruction_sets( ) )
+    {
+        BENCHMARK( "instruction set " + std::to_string( static_cast<int>( isa ) ) )
+        {
+            return utf8::scan( topic, isa ).well_formed;
+        };
+    }
+}
@@ -0,0 +1,104 @@
+#include "catch.hpp"
+
+#include <chrono>
+#include <vector>
+
+#include <asio.hpp>
+
+#include "io_wally/timing_wheel.hpp"
+
+using namespace std::chrono_literals;
+
+SCENARIO( "timing_wheel", "[timing]" )
+{
+    auto io_service = asio::io_service{};
+    auto& under_test = asio::use_service<io_wally::timing_wheel>( io_service );
+    auto fired = std::vector<int>{};
+
+    GIVEN( "a timing_wheel with several pending timeouts" )
+    {
+        under_test.schedule( 50ms, [&fired]( ) { fired.push_back( 3 ); } );
+        under_test.schedule( 10ms, [&fired]( ) { fired.push_back( 1 ); } );
+        under_test.schedule( 30ms, [&fired]( ) { fired.push_back( 2 ); } );
+
+        WHEN( "its io_service runs" )
+        {
+            const auto start = std::chrono::steady_clock::now( );
+            io_service.run( );
+            const auto elapsed = std::chrono::steady_clock::now( ) - start;
+
+            THEN( "it should invoke all callbacks in order of their timeouts" )
+            {
+                REQUIRE( fired == std::vector<int>{1, 2, 3} );
+            }
+
+            AND_THEN( "it should not invoke them before their timeouts expired" )
+            {
+                REQUIRE( elapsed >= 50ms );
+            }
+
+            AND_THEN( "it should have no pending timeouts left, and stop ticking" )
+            {
+                REQUIRE( under_test.size( ) == 0 );
+            }
+        }
+
+        WHEN( "a caller cancels one of those timeouts" )
+        {
+            auto timer = under_test.schedule( 20ms, [&fired]( ) { fired.push_back( 4 ); } );
+            const auto cancelled = under_test.cancel( timer );
+            io_service.run( );
+
+            THEN( "it should not invoke that timeout's callback" )
+            {
+                REQUIRE( cancelled );
+                REQUIRE( fired == std::vector<int>{1, 2, 3} );
+            }
+
+            AND_THEN( "cancelling that timeout again should have no effect" )
+            {
+                REQUIRE( !under_test.cancel( timer ) );
+            }
+        }
+    }
+
+    GIVEN( "a timing_wheel with a timeout longer than one revolution" )
+    {
+        const auto revolution = io_wally::timing_wheel::TICK * io_wally::timing_wheel::SLOT_COUNT;
+        auto timer = under_test.schedule( revolution + 20ms, [&fired]( ) { fired.push_back( 1 ); } );
+        auto short_timer = under_test.schedule( 20ms, [&fired]( ) { fired.push_back( 2 ); } );
+
+        WHEN( "both timeouts share a slot, and the shorter one expires" )
+        {
+            io_service.run_one( );
+            while ( fired.empty( ) )
+                io_service.run_one( );
+
+            THEN( "it should only invoke the shorter timeout's callback" )
+            {
+                REQUIRE( fired == std::vector<int>{2} );
+                REQUIRE( under_test.size( ) == 1 );
+                REQUIRE( !under_test.cancel( short_timer ) );
+                REQUIRE( under_test.cancel( timer ) );
+            }
+        }
+    }
+
+    GIVEN( "a timing_wheel with a timeout scheduling another timeout" )
+    {
+        under_test.schedule( 10ms, [&]( ) {
+            fired.push_back( 1 );
+            under_test.schedule( 10ms, [&fired]( ) { fired.push_back( 2 ); } );
+        } );
+
+        WHEN( "its io_service runs" )
+        {
+            io_service.run( );
+
+            THEN( "it should invoke both callbacks" )
+            {
+                REQUIRE( fired == std::vector<int>{1, 2} );
+            }
+        }
+    }
+}